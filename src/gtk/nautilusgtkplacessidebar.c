@@ -124,6 +124,12 @@ struct _NautilusGtkPlacesSidebar {
 
   GtkWidget *trash_row;
 
+  /* Rows from before the current update_places() that may be reused,
+   * by row key, see add_place() */
+  GHashTable *reusable_rows;
+  /* Bookmark uri -> BookmarkInfo */
+  GHashTable *bookmark_infos;
+
   /* DND */
   gboolean   dragging_over;
   GtkWidget *drag_row;
@@ -239,6 +245,9 @@ enum {
 #define ICON_NAME_FOLDER_VIDEOS   "folder-videos-symbolic"
 #define ICON_NAME_FOLDER_SAVED_SEARCH   "folder-saved-search-symbolic"
 
+/* Cached bookmark infos older than this are queried again, in microseconds */
+#define BOOKMARK_INFO_MAX_AGE (60 * G_USEC_PER_SEC)
+
 static guint places_sidebar_signals [LAST_SIGNAL] = { 0 };
 static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 
@@ -384,6 +393,35 @@ list_box_header_func (GtkListBoxRow *row,
     }
 }
 
+static char *
+get_row_key (NautilusGtkPlacesPlaceType    place_type,
+             NautilusGtkPlacesSectionType  section_type,
+             const char                   *uri,
+             GDrive                       *drive,
+             GVolume                      *volume,
+             GMount                       *mount,
+             CloudProvidersAccount        *cloud_provider_account)
+{
+  return g_strdup_printf ("%d:%d:%p:%p:%p:%p:%s",
+                          place_type, section_type,
+                          drive, volume, mount, cloud_provider_account,
+                          uri != NULL ? uri : "");
+}
+
+static gboolean
+row_is_reusable (NautilusGtkPlacesSidebar *sidebar,
+                 GtkWidget                *row)
+{
+  const char *key;
+
+  if (sidebar->reusable_rows == NULL)
+    return FALSE;
+
+  key = g_object_get_data (G_OBJECT (row), "nautilus-sidebar-row-key");
+
+  return key != NULL && g_hash_table_lookup (sidebar->reusable_rows, key) == row;
+}
+
 static GtkWidget*
 add_place (NautilusGtkPlacesSidebar            *sidebar,
            NautilusGtkPlacesPlaceType           place_type,
@@ -405,6 +443,7 @@ add_place (NautilusGtkPlacesSidebar            *sidebar,
   GtkWidget *eject_button;
   GtkGesture *gesture;
   char *eject_tooltip;
+  g_autofree char *key = NULL;
 
   check_unmount_and_eject (mount, volume, drive,
                            &show_unmount, &show_eject);
@@ -420,6 +459,29 @@ add_place (NautilusGtkPlacesSidebar            *sidebar,
   else
     eject_tooltip = _("Unmount");
 
+  key = get_row_key (place_type, section_type, uri,
+                     drive, volume, mount, cloud_provider_account);
+
+  /* Update the row of the same place instead of replacing it, so that
+   * updates don't flicker. */
+  row = sidebar->reusable_rows != NULL ? g_hash_table_lookup (sidebar->reusable_rows, key) : NULL;
+  if (row != NULL)
+    {
+      g_hash_table_remove (sidebar->reusable_rows, key);
+      g_object_set (row,
+                    "start-icon", start_icon,
+                    "end-icon", end_icon,
+                    "label", name,
+                    "tooltip", tooltip,
+                    "ejectable", show_eject_button,
+                    "eject-tooltip", eject_tooltip,
+                    "order-index", index,
+                    NULL);
+      gtk_list_box_row_changed (GTK_LIST_BOX_ROW (row));
+
+      return row;
+    }
+
   row = g_object_new (NAUTILUS_TYPE_GTK_SIDEBAR_ROW,
                       "sidebar", sidebar,
                       "start-icon", start_icon,
@@ -437,6 +499,8 @@ add_place (NautilusGtkPlacesSidebar            *sidebar,
                       "mount", mount,
                       "cloud-provider-account", cloud_provider_account,
                       NULL);
+  g_object_set_data_full (G_OBJECT (row), "nautilus-sidebar-row-key",
+                          g_steal_pointer (&key), g_free);
 
   eject_button = nautilus_gtk_sidebar_row_get_eject_button (NAUTILUS_GTK_SIDEBAR_ROW (row));
 
@@ -655,7 +719,7 @@ file_is_shown (NautilusGtkPlacesSidebar *sidebar,
        row != NULL && !found;
        row = gtk_widget_get_next_sibling (row))
     {
-      if (!GTK_IS_LIST_BOX_ROW (row))
+      if (!GTK_IS_LIST_BOX_ROW (row) || row_is_reusable (sidebar, row))
         continue;
 
       g_object_get (row, "uri", &uri, NULL);
@@ -748,31 +812,50 @@ add_application_shortcuts (NautilusGtkPlacesSidebar *sidebar)
     }
 }
 
+typedef struct {
+  GFileInfo *info; /* NULL if the query failed */
+  gint64 timestamp;
+} BookmarkInfo;
+
+static void
+bookmark_info_free (BookmarkInfo *bookmark_info)
+{
+  g_clear_object (&bookmark_info->info);
+  g_free (bookmark_info);
+}
+
+static gboolean
+bookmark_infos_equal (GFileInfo *info_1,
+                      GFileInfo *info_2)
+{
+  if (info_1 == NULL || info_2 == NULL)
+    return info_1 == info_2;
+
+  return g_strcmp0 (g_file_info_get_display_name (info_1),
+                    g_file_info_get_display_name (info_2)) == 0 &&
+         g_icon_equal (g_file_info_get_symbolic_icon (info_1),
+                       g_file_info_get_symbolic_icon (info_2));
+}
+
 typedef struct {
   NautilusGtkPlacesSidebar *sidebar;
   int index;
   gboolean is_native;
+  gboolean shown;
 } BookmarkQueryClosure;
 
 static void
-on_bookmark_query_info_complete (GObject      *source,
-                                 GAsyncResult *result,
-                                 gpointer      data)
+add_bookmark (NautilusGtkPlacesSidebar *sidebar,
+              GFile                    *root,
+              GFileInfo                *info,
+              int                       index,
+              gboolean                  is_native)
 {
-  BookmarkQueryClosure *clos = data;
-  NautilusGtkPlacesSidebar *sidebar = clos->sidebar;
-  GFile *root = G_FILE (source);
-  GError *error = NULL;
-  GFileInfo *info;
   char *bookmark_name;
   char *mount_uri;
   char *tooltip;
   GIcon *start_icon;
 
-  info = g_file_query_info_finish (root, result, &error);
-  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-    goto out;
-
   bookmark_name = _nautilus_gtk_bookmarks_manager_get_bookmark_label (sidebar->bookmarks_manager, root);
   if (bookmark_name == NULL && info != NULL)
     bookmark_name = g_strdup (g_file_info_get_display_name (info));
@@ -781,33 +864,100 @@ on_bookmark_query_info_complete (GObject      *source,
       /* Don't add non-UTF-8 bookmarks */
       bookmark_name = g_file_get_basename (root);
       if (bookmark_name == NULL)
-        goto out;
+        return;
 
       if (!g_utf8_validate (bookmark_name, -1, NULL))
         {
           g_free (bookmark_name);
-          goto out;
+          return;
         }
     }
 
   if (info)
     start_icon = g_object_ref (g_file_info_get_symbolic_icon (info));
   else
-    start_icon = g_themed_icon_new_with_default_fallbacks (clos->is_native ? ICON_NAME_FOLDER : ICON_NAME_FOLDER_NETWORK);
+    start_icon = g_themed_icon_new_with_default_fallbacks (is_native ? ICON_NAME_FOLDER : ICON_NAME_FOLDER_NETWORK);
 
   mount_uri = g_file_get_uri (root);
-  tooltip = clos->is_native ? g_file_get_path (root) : g_uri_unescape_string (mount_uri, NULL);
+  tooltip = is_native ? g_file_get_path (root) : g_uri_unescape_string (mount_uri, NULL);
 
   add_place (sidebar, NAUTILUS_GTK_PLACES_BOOKMARK,
              NAUTILUS_GTK_PLACES_SECTION_BOOKMARKS,
              bookmark_name, start_icon, NULL, mount_uri,
-             NULL, NULL, NULL, NULL, clos->index,
+             NULL, NULL, NULL, NULL, index,
              tooltip);
 
   g_free (mount_uri);
   g_free (tooltip);
   g_free (bookmark_name);
   g_object_unref (start_icon);
+}
+
+static void
+remove_bookmark_row (NautilusGtkPlacesSidebar *sidebar,
+                     const char               *uri)
+{
+  GtkWidget *row;
+
+  for (row = gtk_widget_get_first_child (GTK_WIDGET (sidebar->list_box));
+       row != NULL;
+       row = gtk_widget_get_next_sibling (row))
+    {
+      NautilusGtkPlacesPlaceType place_type;
+      g_autofree char *row_uri = NULL;
+
+      if (!NAUTILUS_IS_GTK_SIDEBAR_ROW (row))
+        continue;
+
+      g_object_get (row,
+                    "place-type", &place_type,
+                    "uri", &row_uri,
+                    NULL);
+      if (place_type == NAUTILUS_GTK_PLACES_BOOKMARK &&
+          g_strcmp0 (row_uri, uri) == 0)
+        {
+          gtk_list_box_remove (GTK_LIST_BOX (sidebar->list_box), row);
+          return;
+        }
+    }
+}
+
+static void
+on_bookmark_query_info_complete (GObject      *source,
+                                 GAsyncResult *result,
+                                 gpointer      data)
+{
+  BookmarkQueryClosure *clos = data;
+  NautilusGtkPlacesSidebar *sidebar = clos->sidebar;
+  GFile *root = G_FILE (source);
+  GError *error = NULL;
+  GFileInfo *info;
+  BookmarkInfo *bookmark_info;
+  char *uri;
+  gboolean changed;
+
+  info = g_file_query_info_finish (root, result, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    goto out;
+
+  uri = g_file_get_uri (root);
+  bookmark_info = g_hash_table_lookup (sidebar->bookmark_infos, uri);
+  changed = bookmark_info == NULL || !bookmark_infos_equal (bookmark_info->info, info);
+
+  bookmark_info = g_new0 (BookmarkInfo, 1);
+  bookmark_info->info = info != NULL ? g_object_ref (info) : NULL;
+  bookmark_info->timestamp = g_get_monotonic_time ();
+  g_hash_table_insert (sidebar->bookmark_infos, g_strdup (uri), bookmark_info);
+
+  /* The row was added from the previous info already, only replace it if
+   * the info changed meanwhile. */
+  if (clos->shown && changed)
+    remove_bookmark_row (sidebar, uri);
+
+  if (!clos->shown || changed)
+    add_bookmark (sidebar, root, info, clos->index, clos->is_native);
+
+  g_free (uri);
 
 out:
   g_clear_object (&info);
@@ -953,6 +1103,7 @@ update_places (NautilusGtkPlacesSidebar *sidebar)
   GList *cloud_providers_accounts;
   CloudProvidersAccount *cloud_provider_account;
   CloudProvidersProvider *cloud_provider;
+  GHashTableIter iter;
 
   /* save original selection */
   selected = gtk_list_box_get_selected_row (GTK_LIST_BOX (sidebar->list_box));
@@ -969,8 +1120,23 @@ update_places (NautilusGtkPlacesSidebar *sidebar)
   /* Reset drag state, just in case we update the places while dragging or
    * ending a drag */
   stop_drop_feedback (sidebar);
-  while ((child = gtk_widget_get_first_child (GTK_WIDGET (sidebar->list_box))))
-    gtk_list_box_remove (GTK_LIST_BOX (sidebar->list_box), child);
+
+  /* Keep the current rows around, add_place() updates the ones that are
+   * still there, and the rest is removed at the end. */
+  sidebar->reusable_rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  child = gtk_widget_get_first_child (GTK_WIDGET (sidebar->list_box));
+  while (child != NULL)
+    {
+      GtkWidget *next = gtk_widget_get_next_sibling (child);
+      const char *key = g_object_get_data (G_OBJECT (child), "nautilus-sidebar-row-key");
+
+      if (key != NULL && !g_hash_table_contains (sidebar->reusable_rows, key))
+        g_hash_table_insert (sidebar->reusable_rows, g_strdup (key), child);
+      else
+        gtk_list_box_remove (GTK_LIST_BOX (sidebar->list_box), child);
+
+      child = next;
+    }
 
   network_mounts = network_volumes = NULL;
 
@@ -1042,14 +1208,20 @@ update_places (NautilusGtkPlacesSidebar *sidebar)
   /* Trash */
   if (sidebar->show_trash)
     {
+      GtkWidget *trash_row;
+
       start_icon = nautilus_trash_monitor_get_symbolic_icon ();
-      sidebar->trash_row = add_place (sidebar, NAUTILUS_GTK_PLACES_BUILT_IN,
-                                      NAUTILUS_GTK_PLACES_SECTION_COMPUTER,
-                                      _("Trash"), start_icon, NULL, "trash:///",
-                                      NULL, NULL, NULL, NULL, 0,
-                                      _("Open the trash"));
-      g_object_add_weak_pointer (G_OBJECT (sidebar->trash_row),
-                                 (gpointer *) &sidebar->trash_row);
+      trash_row = add_place (sidebar, NAUTILUS_GTK_PLACES_BUILT_IN,
+                             NAUTILUS_GTK_PLACES_SECTION_COMPUTER,
+                             _("Trash"), start_icon, NULL, "trash:///",
+                             NULL, NULL, NULL, NULL, 0,
+                             _("Open the trash"));
+      if (trash_row != sidebar->trash_row)
+        {
+          sidebar->trash_row = trash_row;
+          g_object_add_weak_pointer (G_OBJECT (sidebar->trash_row),
+                                     (gpointer *) &sidebar->trash_row);
+        }
       g_object_unref (start_icon);
     }
 
@@ -1336,6 +1508,8 @@ update_places (NautilusGtkPlacesSidebar *sidebar)
     {
       gboolean is_native;
       BookmarkQueryClosure *clos;
+      BookmarkInfo *bookmark_info;
+      g_autofree char *bookmark_uri = NULL;
 
       root = sl->data;
       is_native = g_file_is_native (root);
@@ -1343,10 +1517,22 @@ update_places (NautilusGtkPlacesSidebar *sidebar)
       if (_nautilus_gtk_bookmarks_manager_get_is_builtin (sidebar->bookmarks_manager, root))
         continue;
 
+      /* Show the cached info right away, and query it again in the
+       * background only once it got old. */
+      bookmark_uri = g_file_get_uri (root);
+      bookmark_info = g_hash_table_lookup (sidebar->bookmark_infos, bookmark_uri);
+      if (bookmark_info != NULL)
+        {
+          add_bookmark (sidebar, root, bookmark_info->info, index, is_native);
+          if (g_get_monotonic_time () - bookmark_info->timestamp < BOOKMARK_INFO_MAX_AGE)
+            continue;
+        }
+
       clos = g_slice_new (BookmarkQueryClosure);
       clos->sidebar = sidebar;
       clos->index = index;
       clos->is_native = is_native;
+      clos->shown = bookmark_info != NULL;
       g_file_query_info_async (root,
                                "standard::display-name,standard::symbolic-icon",
                                G_FILE_QUERY_INFO_NONE,
@@ -1435,6 +1621,12 @@ update_places (NautilusGtkPlacesSidebar *sidebar)
       g_object_unref (start_icon);
     }
 
+  /* Remove the places which are gone */
+  g_hash_table_iter_init (&iter, sidebar->reusable_rows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &child))
+    gtk_list_box_remove (GTK_LIST_BOX (sidebar->list_box), child);
+  g_clear_pointer (&sidebar->reusable_rows, g_hash_table_unref);
+
   gtk_widget_show (GTK_WIDGET (sidebar));
   /* We want this hidden by default, but need to do it after the show_all call */
   nautilus_gtk_sidebar_row_hide (NAUTILUS_GTK_SIDEBAR_ROW (sidebar->new_bookmark_row), TRUE);
@@ -3881,6 +4073,8 @@ nautilus_gtk_places_sidebar_init (NautilusGtkPlacesSidebar *sidebar)
   GtkGesture *gesture;
 
   sidebar->cancellable = g_cancellable_new ();
+  sidebar->bookmark_infos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                   (GDestroyNotify) bookmark_info_free);
 
   sidebar->show_trash = TRUE;
   sidebar->show_other_locations = TRUE;
@@ -4102,6 +4296,8 @@ nautilus_gtk_places_sidebar_dispose (GObject *object)
       sidebar->cancellable = NULL;
     }
 
+  g_clear_pointer (&sidebar->bookmark_infos, g_hash_table_unref);
+
   if (sidebar->bookmarks_manager != NULL)
     {
       _nautilus_gtk_bookmarks_manager_free (sidebar->bookmarks_manager);
@@ -818,6 +818,15 @@ action_quit (GSimpleAction *action,
     g_list_free (windows);
 }
 
+static void
+action_trace (GSimpleAction *action,
+              GVariant      *state,
+              gpointer       user_data)
+{
+    nautilus_profile_set_tracing (g_variant_get_boolean (state));
+    g_simple_action_set_state (action, state);
+}
+
 static void
 action_show_help_overlay (GSimpleAction *action,
                           GVariant      *state,
@@ -839,6 +848,8 @@ const static GActionEntry app_entries[] =
     { "quit", action_quit, NULL, NULL, NULL },
     { "kill", action_kill, NULL, NULL, NULL },
     { "show-help-overlay", action_show_help_overlay, NULL, NULL, NULL },
+    /* Not exposed in the UI, toggled over D-Bus. See nautilus-profile.h */
+    { "trace", NULL, NULL, "false", action_trace },
 };
 
 static void
@@ -847,7 +858,9 @@ nautilus_init_application_actions (NautilusApplication *app)
     g_action_map_add_action_entries (G_ACTION_MAP (app),
                                      app_entries, G_N_ELEMENTS (app_entries),
                                      app);
-
+    g_simple_action_set_state (G_SIMPLE_ACTION (g_action_map_lookup_action (G_ACTION_MAP (app),
+                                                                            "trace")),
+                               g_variant_new_boolean (nautilus_profile_is_tracing ()));
 
     nautilus_application_set_accelerator (G_APPLICATION (app),
                                           "app.clone-window", "<Primary>n");
@@ -1118,6 +1131,9 @@ on_application_shutdown (GApplication *application,
     g_list_free (notification_ids);
 
     nautilus_icon_info_clear_caches ();
+
+    /* Flushes the trace if it was enabled through NAUTILUS_TRACE or D-Bus. */
+    nautilus_profile_set_tracing (FALSE);
 }
 
 static void
@@ -1171,6 +1187,8 @@ nautilus_application_startup_common (NautilusApplication *self)
 {
     NautilusApplicationPrivate *priv;
 
+    nautilus_profile_init ();
+
     nautilus_profile_start (NULL);
     priv = nautilus_application_get_instance_private (self);
 
@@ -19,6 +19,7 @@
 #include <config.h>
 
 #include "nautilus-batch-rename-dialog.h"
+#include "nautilus-batch-rename-item.h"
 #include "nautilus-file.h"
 #include "nautilus-error-reporting.h"
 #include "nautilus-batch-rename-utilities.h"
@@ -39,9 +40,7 @@ struct _NautilusBatchRenameDialog
     NautilusWindow *window;
 
     GtkWidget *cancel_button;
-    GtkWidget *original_name_listbox;
-    GtkWidget *arrow_listbox;
-    GtkWidget *result_listbox;
+    GtkWidget *preview_list_view;
     GtkWidget *name_entry;
     GtkWidget *rename_button;
     GtkWidget *find_entry;
@@ -58,13 +57,14 @@ struct _NautilusBatchRenameDialog
     GtkWidget *conflict_down;
     GtkWidget *conflict_up;
 
-    GList *listbox_labels_new;
-    GList *listbox_labels_old;
-    GList *listbox_icons;
-    GtkSizeGroup *size_group;
+    /* NautilusBatchRenameItem for each selected file, in selection order */
+    GListStore *preview_model;
 
     GList *selection;
+    /* BatchRenameSource for each selected file, in selection order */
+    GPtrArray *sources;
     GList *new_names;
+    GCancellable *new_names_cancellable;
     NautilusBatchRenameDialogMode mode;
     NautilusDirectory *directory;
 
@@ -80,7 +80,9 @@ struct _NautilusBatchRenameDialog
     /* total conflicts number */
     gint conflicts_number;
 
-    GList *duplicates;
+    /* ConflictData sorted by row index */
+    GPtrArray *conflicts;
+    GPtrArray *pending_conflicts;
     GList *distinct_parent_directories;
     GList *directories_pending_conflict_check;
 
@@ -89,10 +91,6 @@ struct _NautilusBatchRenameDialog
      * and position */
     GHashTable *tag_info_table;
 
-    GtkWidget *preselected_row1;
-    GtkWidget *preselected_row2;
-
-    gint row_height;
     gboolean rename_clicked;
 
     GCancellable *metadata_cancellable;
@@ -109,7 +107,25 @@ typedef struct
 } TagData;
 
 
+typedef struct
+{
+    NautilusBatchRenameDialogMode mode;
+    GPtrArray *sources;
+    GList *text_chunks;
+    GList *selection_metadata;
+    gchar *entry_text;
+    gchar *replace_text;
+} NewNamesRequest;
+
+typedef struct
+{
+    GList *new_names;
+    /* markup of the original names, only used in replace mode */
+    GPtrArray *original_markups;
+} NewNamesResult;
+
 static void     update_display_text (NautilusBatchRenameDialog *dialog);
+static void     update_preview_model (NautilusBatchRenameDialog *dialog);
 static void     cancel_conflict_check (NautilusBatchRenameDialog *self);
 
 G_DEFINE_TYPE (NautilusBatchRenameDialog, nautilus_batch_rename_dialog, GTK_TYPE_DIALOG);
@@ -136,6 +152,7 @@ change_numbering_order (GSimpleAction *action,
             dialog->selection = nautilus_batch_rename_dialog_sort (dialog->selection,
                                                                    sorts_constants[i].sort_mode,
                                                                    dialog->create_date);
+            update_preview_model (dialog);
             break;
         }
     }
@@ -365,202 +382,213 @@ split_entry_text (NautilusBatchRenameDialog *self,
     return result;
 }
 
-static GList *
-batch_rename_dialog_get_new_names (NautilusBatchRenameDialog *dialog)
+static void
+new_names_request_free (gpointer data)
 {
-    GList *result = NULL;
-    GList *selection;
-    GList *text_chunks;
-    g_autofree gchar *entry_text = NULL;
-    g_autofree gchar *replace_text = NULL;
-
-    selection = dialog->selection;
-    text_chunks = NULL;
+    NewNamesRequest *request = data;
 
-    if (dialog->mode == NAUTILUS_BATCH_RENAME_DIALOG_REPLACE)
-    {
-        entry_text = g_strdup (gtk_editable_get_text (GTK_EDITABLE (dialog->find_entry)));
-    }
-    else
-    {
-        entry_text = g_strdup (gtk_editable_get_text (GTK_EDITABLE (dialog->name_entry)));
-    }
-
-    replace_text = g_strdup (gtk_editable_get_text (GTK_EDITABLE (dialog->replace_entry)));
-
-    if (dialog->mode == NAUTILUS_BATCH_RENAME_DIALOG_REPLACE)
-    {
-        result = batch_rename_dialog_get_new_names_list (dialog->mode,
-                                                         selection,
-                                                         NULL,
-                                                         NULL,
-                                                         entry_text,
-                                                         replace_text);
-    }
-    else
-    {
-        text_chunks = split_entry_text (dialog, entry_text);
-
-        result = batch_rename_dialog_get_new_names_list (dialog->mode,
-                                                         selection,
-                                                         text_chunks,
-                                                         dialog->selection_metadata,
-                                                         entry_text,
-                                                         replace_text);
-        g_list_free_full (text_chunks, string_free);
-    }
-
-    result = g_list_reverse (result);
-
-    return result;
+    g_ptr_array_unref (request->sources);
+    g_list_free_full (request->text_chunks, string_free);
+    g_free (request->entry_text);
+    g_free (request->replace_text);
+    g_free (request);
 }
 
 static void
-begin_batch_rename (NautilusBatchRenameDialog *dialog,
-                    GList                     *new_names)
+new_names_result_free (gpointer data)
 {
-    batch_rename_sort_lists_for_rename (&dialog->selection, &new_names, NULL, NULL, NULL, FALSE);
+    NewNamesResult *result = data;
 
-    /* do the actual rename here */
-    nautilus_file_batch_rename (dialog->selection, new_names, NULL, NULL);
-
-    gtk_widget_set_cursor (GTK_WIDGET (dialog->window), NULL);
+    g_list_free_full (result->new_names, string_free);
+    g_clear_pointer (&result->original_markups, g_ptr_array_unref);
+    g_free (result);
 }
 
 static void
-listbox_header_func (GtkListBoxRow             *row,
-                     GtkListBoxRow             *before,
-                     NautilusBatchRenameDialog *dialog)
+new_names_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
 {
-    GtkWidget *separator;
+    NewNamesRequest *request = task_data;
+    NewNamesResult *result;
+    GList *new_names;
+    guint i;
 
-    if (before == NULL)
+    new_names = batch_rename_dialog_get_new_names_list (request->mode,
+                                                        request->sources,
+                                                        request->text_chunks,
+                                                        request->selection_metadata,
+                                                        request->entry_text,
+                                                        request->replace_text,
+                                                        cancellable);
+    if (g_task_return_error_if_cancelled (task))
     {
-        /* First row needs no separator */
-        gtk_list_box_row_set_header (row, NULL);
+        g_list_free_full (new_names, string_free);
         return;
     }
 
-    separator = gtk_list_box_row_get_header (row);
-    if (separator == NULL)
+    result = g_new0 (NewNamesResult, 1);
+    result->new_names = g_list_reverse (new_names);
+
+    if (request->mode == NAUTILUS_BATCH_RENAME_DIALOG_REPLACE)
     {
-        separator = gtk_separator_new (GTK_ORIENTATION_HORIZONTAL);
-        gtk_widget_show (separator);
+        result->original_markups = g_ptr_array_new_full (request->sources->len, g_free);
+        for (i = 0; i < request->sources->len; i++)
+        {
+            BatchRenameSource *source = g_ptr_array_index (request->sources, i);
+            GString *markup;
 
-        gtk_list_box_row_set_header (row, separator);
+            markup = batch_rename_replace_label_text (source->name, request->entry_text);
+            g_ptr_array_add (result->original_markups, g_string_free (markup, FALSE));
+        }
     }
+
+    g_task_return_pointer (task, result, new_names_result_free);
 }
 
-/* This is manually done instead of using GtkSizeGroup because of the computational
- * complexity of the later.*/
 static void
-update_rows_height (NautilusBatchRenameDialog *dialog)
+cancel_new_names (NautilusBatchRenameDialog *dialog)
 {
-    GList *l;
-    GtkRequisition current_row_natural_size;
-    gint maximum_height;
+    if (dialog->new_names_cancellable != NULL)
+    {
+        g_cancellable_cancel (dialog->new_names_cancellable);
+        g_clear_object (&dialog->new_names_cancellable);
+    }
+}
 
-    maximum_height = -1;
+static void
+update_preview_names (NautilusBatchRenameDialog *dialog,
+                      GPtrArray                 *original_markups)
+{
+    GList *l;
+    guint i;
 
-    /* check if maximum height has changed */
-    for (l = dialog->listbox_labels_new; l != NULL; l = l->next)
+    /* The items only notify when their text really changes, so rows that
+     * are unaffected by the edit, or not bound at all, cost next to nothing. */
+    for (l = dialog->new_names, i = 0; l != NULL; l = l->next, i++)
     {
-        gtk_widget_get_preferred_size (GTK_WIDGET (l->data),
-                                       NULL,
-                                       &current_row_natural_size);
+        g_autoptr (NautilusBatchRenameItem) item = NULL;
+        GString *new_name = l->data;
 
-        if (current_row_natural_size.height > maximum_height)
+        item = g_list_model_get_item (G_LIST_MODEL (dialog->preview_model), i);
+        if (item == NULL)
         {
-            maximum_height = current_row_natural_size.height;
+            break;
         }
+
+        nautilus_batch_rename_item_set_new_name (item, new_name->str);
+        nautilus_batch_rename_item_set_original_markup (item,
+                                                        original_markups != NULL ?
+                                                        g_ptr_array_index (original_markups, i) : NULL);
     }
+}
 
-    for (l = dialog->listbox_labels_old; l != NULL; l = l->next)
-    {
-        gtk_widget_get_preferred_size (GTK_WIDGET (l->data),
-                                       NULL,
-                                       &current_row_natural_size);
+static gboolean have_unallowed_character (NautilusBatchRenameDialog *dialog);
+static void     file_names_list_has_duplicates_async (NautilusBatchRenameDialog *self);
+static void     set_conflicts (NautilusBatchRenameDialog *dialog,
+                               GPtrArray                 *conflicts);
 
-        if (current_row_natural_size.height > maximum_height)
-        {
-            maximum_height = current_row_natural_size.height;
-        }
-    }
+static void
+on_new_names_ready (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+    NautilusBatchRenameDialog *dialog;
+    NewNamesResult *result;
 
-    for (l = dialog->listbox_icons; l != NULL; l = l->next)
+    dialog = NAUTILUS_BATCH_RENAME_DIALOG (source_object);
+    result = g_task_propagate_pointer (G_TASK (res), NULL);
+    if (result == NULL)
     {
-        gtk_widget_get_preferred_size (GTK_WIDGET (l->data),
-                                       NULL,
-                                       &current_row_natural_size);
-
-        if (current_row_natural_size.height > maximum_height)
-        {
-            maximum_height = current_row_natural_size.height;
-        }
+        /* Superseded by a newer edit, or the dialog went away */
+        return;
     }
 
-    if (maximum_height != dialog->row_height)
-    {
-        dialog->row_height = maximum_height + ROW_MARGIN_TOP_BOTTOM * 2;
+    g_clear_object (&dialog->new_names_cancellable);
 
-        for (l = dialog->listbox_icons; l != NULL; l = l->next)
-        {
-            g_object_set (G_OBJECT (l->data), "height-request", dialog->row_height, NULL);
-        }
+    g_list_free_full (dialog->new_names, string_free);
+    dialog->new_names = g_steal_pointer (&result->new_names);
 
-        for (l = dialog->listbox_labels_new; l != NULL; l = l->next)
-        {
-            g_object_set (G_OBJECT (l->data), "height-request", dialog->row_height, NULL);
-        }
+    update_preview_names (dialog, result->original_markups);
+    new_names_result_free (result);
 
-        for (l = dialog->listbox_labels_old; l != NULL; l = l->next)
-        {
-            g_object_set (G_OBJECT (l->data), "height-request", dialog->row_height, NULL);
-        }
+    if (have_unallowed_character (dialog))
+    {
+        set_conflicts (dialog, g_ptr_array_new_with_free_func (conflict_data_free));
+        dialog->rename_clicked = FALSE;
+
+        return;
     }
+
+    file_names_list_has_duplicates_async (dialog);
 }
 
-static GtkWidget *
-create_original_name_label (NautilusBatchRenameDialog *dialog,
-                            const gchar               *old_text)
+/* Generating the names is linear in the selection size, so it happens in a
+ * worker thread working on snapshots of the files. Each edit cancels the
+ * previous request, and the preview keeps showing the last result until the
+ * new one is ready. */
+static void
+batch_rename_dialog_get_new_names_async (NautilusBatchRenameDialog *dialog)
 {
-    GtkWidget *label_old;
+    g_autoptr (GTask) task = NULL;
+    NewNamesRequest *request;
 
-    label_old = gtk_label_new (old_text);
-    gtk_label_set_xalign (GTK_LABEL (label_old), 0.0);
-    gtk_widget_set_hexpand (label_old, TRUE);
-    gtk_widget_set_margin_start (label_old, ROW_MARGIN_START);
-    gtk_label_set_ellipsize (GTK_LABEL (label_old), PANGO_ELLIPSIZE_END);
+    cancel_new_names (dialog);
 
-    dialog->listbox_labels_old = g_list_prepend (dialog->listbox_labels_old, label_old);
+    request = g_new0 (NewNamesRequest, 1);
+    request->mode = dialog->mode;
+    request->sources = g_ptr_array_ref (dialog->sources);
+    request->replace_text = g_strdup (gtk_editable_get_text (GTK_EDITABLE (dialog->replace_entry)));
 
-    gtk_widget_show (label_old);
+    if (dialog->mode == NAUTILUS_BATCH_RENAME_DIALOG_REPLACE)
+    {
+        request->entry_text = g_strdup (gtk_editable_get_text (GTK_EDITABLE (dialog->find_entry)));
+    }
+    else
+    {
+        request->entry_text = g_strdup (gtk_editable_get_text (GTK_EDITABLE (dialog->name_entry)));
+        request->text_chunks = split_entry_text (dialog, request->entry_text);
+        request->selection_metadata = dialog->selection_metadata;
+    }
+
+    dialog->new_names_cancellable = g_cancellable_new ();
 
-    return label_old;
+    task = g_task_new (dialog, dialog->new_names_cancellable, on_new_names_ready, NULL);
+    g_task_set_task_data (task, request, new_names_request_free);
+    g_task_run_in_thread (task, new_names_thread);
 }
 
-static GtkWidget *
-create_result_label (NautilusBatchRenameDialog *dialog,
-                     const gchar               *new_text)
+static void
+begin_batch_rename (NautilusBatchRenameDialog *dialog,
+                    GList                     *new_names)
 {
-    GtkWidget *label_new;
-
-    label_new = gtk_label_new (new_text);
-    gtk_label_set_xalign (GTK_LABEL (label_new), 0.0);
-    gtk_widget_set_hexpand (label_new, TRUE);
-    gtk_widget_set_margin_start (label_new, ROW_MARGIN_START);
-    gtk_label_set_ellipsize (GTK_LABEL (label_new), PANGO_ELLIPSIZE_END);
-
-    dialog->listbox_labels_new = g_list_prepend (dialog->listbox_labels_new, label_new);
+    /* do the actual rename here */
+    nautilus_file_batch_rename (dialog->selection, new_names, NULL, NULL);
 
-    gtk_widget_show (label_new);
+    gtk_widget_set_cursor (GTK_WIDGET (dialog->window), NULL);
+}
 
-    return label_new;
+static GtkWidget *
+create_name_label (void)
+{
+    GtkWidget *label;
+
+    label = gtk_label_new (NULL);
+    gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+    gtk_widget_set_hexpand (label, TRUE);
+    gtk_widget_set_margin_start (label, ROW_MARGIN_START);
+    gtk_widget_set_margin_top (label, ROW_MARGIN_TOP_BOTTOM);
+    gtk_widget_set_margin_bottom (label, ROW_MARGIN_TOP_BOTTOM);
+    gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_END);
+    /* Keep the natural width small, so both columns get the same share */
+    gtk_label_set_max_width_chars (GTK_LABEL (label), 1);
+
+    return label;
 }
 
 static GtkWidget *
-create_arrow (NautilusBatchRenameDialog *dialog,
-              GtkTextDirection           text_direction)
+create_arrow (GtkTextDirection text_direction)
 {
     GtkWidget *icon;
 
@@ -577,19 +605,109 @@ create_arrow (NautilusBatchRenameDialog *dialog,
     gtk_widget_set_hexpand (icon, FALSE);
     gtk_widget_set_margin_start (icon, ROW_MARGIN_START);
 
-    dialog->listbox_icons = g_list_prepend (dialog->listbox_icons, icon);
+    return icon;
+}
 
-    gtk_widget_show (icon);
+static void
+update_preview_row (GtkListItem *list_item)
+{
+    NautilusBatchRenameItem *item;
+    GtkWidget *row;
+    GtkWidget *original_label;
+    GtkWidget *result_label;
+    const gchar *original_name;
+    const gchar *original_markup;
+    const gchar *new_name;
 
-    return icon;
+    item = NAUTILUS_BATCH_RENAME_ITEM (gtk_list_item_get_item (list_item));
+    row = gtk_list_item_get_child (list_item);
+    original_label = gtk_widget_get_first_child (row);
+    result_label = gtk_widget_get_last_child (row);
+
+    original_name = nautilus_batch_rename_item_get_original_name (item);
+    original_markup = nautilus_batch_rename_item_get_original_markup (item);
+    if (original_markup != NULL)
+    {
+        gtk_label_set_markup (GTK_LABEL (original_label), original_markup);
+    }
+    else
+    {
+        gtk_label_set_text (GTK_LABEL (original_label), original_name);
+    }
+    gtk_widget_set_tooltip_text (original_label, original_name);
+
+    new_name = nautilus_batch_rename_item_get_new_name (item);
+    gtk_label_set_text (GTK_LABEL (result_label), new_name != NULL ? new_name : "");
+    gtk_widget_set_tooltip_text (result_label, new_name);
+
+    if (nautilus_batch_rename_item_get_has_conflict (item))
+    {
+        gtk_widget_add_css_class (row, "conflict-row");
+    }
+    else
+    {
+        gtk_widget_remove_css_class (row, "conflict-row");
+    }
+}
+
+static void
+on_preview_item_notify (GObject    *object,
+                        GParamSpec *pspec,
+                        gpointer    user_data)
+{
+    update_preview_row (GTK_LIST_ITEM (user_data));
+}
+
+static void
+on_preview_row_setup (GtkSignalListItemFactory *factory,
+                      GtkListItem              *list_item,
+                      gpointer                  user_data)
+{
+    NautilusBatchRenameDialog *dialog;
+    GtkWidget *row;
+
+    dialog = NAUTILUS_BATCH_RENAME_DIALOG (user_data);
+
+    row = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+    gtk_box_append (GTK_BOX (row), create_name_label ());
+    gtk_box_append (GTK_BOX (row), create_arrow (gtk_widget_get_direction (GTK_WIDGET (dialog))));
+    gtk_box_append (GTK_BOX (row), create_name_label ());
+
+    gtk_list_item_set_child (list_item, row);
+    gtk_list_item_set_activatable (list_item, FALSE);
+}
+
+static void
+on_preview_row_bind (GtkSignalListItemFactory *factory,
+                     GtkListItem              *list_item,
+                     gpointer                  user_data)
+{
+    GObject *item;
+
+    item = gtk_list_item_get_item (list_item);
+    g_signal_connect (item, "notify", G_CALLBACK (on_preview_item_notify), list_item);
+
+    update_preview_row (list_item);
+}
+
+static void
+on_preview_row_unbind (GtkSignalListItemFactory *factory,
+                       GtkListItem              *list_item,
+                       gpointer                  user_data)
+{
+    GObject *item;
+
+    item = gtk_list_item_get_item (list_item);
+    g_signal_handlers_disconnect_by_func (item, on_preview_item_notify, list_item);
 }
 
 static void
 prepare_batch_rename (NautilusBatchRenameDialog *dialog)
 {
-    /* wait for checking conflicts to finish, to be sure that
-     * the rename can actually take place */
-    if (dialog->directories_pending_conflict_check != NULL)
+    /* wait for the new names and the conflict check to finish, to be
+     * sure that the rename can actually take place */
+    if (dialog->new_names_cancellable != NULL ||
+        dialog->directories_pending_conflict_check != NULL)
     {
         dialog->rename_clicked = TRUE;
         return;
@@ -630,117 +748,60 @@ batch_rename_dialog_on_response (NautilusBatchRenameDialog *dialog,
     }
 }
 
+/* Takes a new snapshot of the selection, in its current order. Rows are only
+ * realized by the list view when they are scrolled into view. */
 static void
-fill_display_listbox (NautilusBatchRenameDialog *dialog)
+update_preview_model (NautilusBatchRenameDialog *dialog)
 {
-    GtkWidget *row_child;
-    GList *l1;
-    GList *l2;
-    NautilusFile *file;
-    GString *new_name;
-    gchar *name;
-    GtkTextDirection text_direction;
-
-    gtk_size_group_add_widget (dialog->size_group, dialog->result_listbox);
-    gtk_size_group_add_widget (dialog->size_group, dialog->original_name_listbox);
+    g_autoptr (GPtrArray) items = NULL;
+    BatchRenameSource *source;
+    GList *l;
 
-    text_direction = gtk_widget_get_direction (GTK_WIDGET (dialog));
+    g_clear_pointer (&dialog->sources, g_ptr_array_unref);
+    dialog->sources = g_ptr_array_new_with_free_func (batch_rename_source_free);
+    items = g_ptr_array_new_with_free_func (g_object_unref);
 
-    for (l1 = dialog->new_names, l2 = dialog->selection; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
+    for (l = dialog->selection; l != NULL; l = l->next)
     {
-        file = NAUTILUS_FILE (l2->data);
-        new_name = l1->data;
-
-        name = nautilus_file_get_name (file);
-        row_child = create_original_name_label (dialog, name);
-        gtk_list_box_insert (GTK_LIST_BOX (dialog->original_name_listbox), row_child, -1);
-
-        row_child = create_arrow (dialog, text_direction);
-        gtk_list_box_insert (GTK_LIST_BOX (dialog->arrow_listbox), row_child, -1);
-
-        row_child = create_result_label (dialog, new_name->str);
-        gtk_list_box_insert (GTK_LIST_BOX (dialog->result_listbox), row_child, -1);
-
-        g_free (name);
+        source = batch_rename_source_new (NAUTILUS_FILE (l->data));
+        g_ptr_array_add (dialog->sources, source);
+        g_ptr_array_add (items, nautilus_batch_rename_item_new (source->name));
     }
 
-    dialog->listbox_labels_old = g_list_reverse (dialog->listbox_labels_old);
-    dialog->listbox_labels_new = g_list_reverse (dialog->listbox_labels_new);
-    dialog->listbox_icons = g_list_reverse (dialog->listbox_icons);
+    /* The conflicts refer to rows of the old order */
+    g_ptr_array_set_size (dialog->conflicts, 0);
+
+    g_list_store_splice (dialog->preview_model,
+                         0, g_list_model_get_n_items (G_LIST_MODEL (dialog->preview_model)),
+                         items->pdata, items->len);
 }
 
 static void
 select_nth_conflict (NautilusBatchRenameDialog *dialog)
 {
-    GList *l;
-    GString *conflict_file_name;
-    GString *display_text;
-    GString *new_name;
-    gint nth_conflict_index;
-    gint nth_conflict;
-    gint name_occurences;
-    GtkAdjustment *adjustment;
-    GtkAllocation allocation;
+    g_autofree gchar *display_text = NULL;
     ConflictData *conflict_data;
-    GtkListBoxRow *list_box_row;
-
-    nth_conflict = dialog->selected_conflict;
-    l = g_list_nth (dialog->duplicates, nth_conflict);
-    conflict_data = l->data;
-
-    /* the conflict that has to be selected */
-    conflict_file_name = g_string_new (conflict_data->name);
-    display_text = g_string_new ("");
 
-    nth_conflict_index = conflict_data->index;
-
-    l = g_list_nth (dialog->listbox_labels_new, nth_conflict_index);
-    list_box_row = GTK_LIST_BOX_ROW (gtk_widget_get_parent (l->data));
-    gtk_list_box_select_row (GTK_LIST_BOX (dialog->original_name_listbox),
-                             list_box_row);
-
-    l = g_list_nth (dialog->listbox_labels_old, nth_conflict_index);
-    list_box_row = GTK_LIST_BOX_ROW (gtk_widget_get_parent (l->data));
-    gtk_list_box_select_row (GTK_LIST_BOX (dialog->arrow_listbox),
-                             list_box_row);
-
-    l = g_list_nth (dialog->listbox_icons, nth_conflict_index);
-    list_box_row = GTK_LIST_BOX_ROW (gtk_widget_get_parent (l->data));
-    gtk_list_box_select_row (GTK_LIST_BOX (dialog->result_listbox),
-                             list_box_row);
+    conflict_data = g_ptr_array_index (dialog->conflicts, dialog->selected_conflict);
 
     /* scroll to the selected row */
-    adjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (dialog->scrolled_window));
-    gtk_widget_get_allocation (GTK_WIDGET (l->data), &allocation);
-    gtk_adjustment_set_value (adjustment, (allocation.height + 1) * nth_conflict_index);
+    gtk_widget_activate_action (dialog->preview_list_view,
+                                "list.scroll-to-item",
+                                "u",
+                                conflict_data->index);
 
-    name_occurences = 0;
-    for (l = dialog->new_names; l != NULL; l = l->next)
-    {
-        new_name = l->data;
-        if (g_string_equal (new_name, conflict_file_name))
-        {
-            name_occurences++;
-        }
-    }
-    if (name_occurences > 1)
+    if (conflict_data->is_duplicate)
     {
-        g_string_append_printf (display_text,
-                                _("“%s” would not be a unique new name."),
-                                conflict_file_name->str);
+        display_text = g_strdup_printf (_("“%s” would not be a unique new name."),
+                                        conflict_data->name);
     }
     else
     {
-        g_string_append_printf (display_text,
-                                _("“%s” would conflict with an existing file."),
-                                conflict_file_name->str);
+        display_text = g_strdup_printf (_("“%s” would conflict with an existing file."),
+                                        conflict_data->name);
     }
 
-    gtk_label_set_label (GTK_LABEL (dialog->conflict_label),
-                         display_text->str);
-
-    g_string_free (conflict_file_name, TRUE);
-    g_string_free (display_text, TRUE);
+    gtk_label_set_label (GTK_LABEL (dialog->conflict_label), display_text);
 }
 
 static void
@@ -780,115 +841,54 @@ select_next_conflict_up (NautilusBatchRenameDialog *dialog)
 }
 
 static void
-update_conflict_row_background (NautilusBatchRenameDialog *dialog)
+set_conflicts_highlighted (NautilusBatchRenameDialog *dialog,
+                           gboolean                   highlighted)
 {
-    GList *l1;
-    GList *l2;
-    GList *l3;
-    GList *duplicates;
-    gint index;
-    GtkStyleContext *context;
-    ConflictData *conflict_data;
-
-    index = 0;
-
-    duplicates = dialog->duplicates;
+    guint i;
 
-    for (l1 = dialog->listbox_labels_new,
-         l2 = dialog->listbox_labels_old,
-         l3 = dialog->listbox_icons;
-         l1 != NULL && l2 != NULL && l3 != NULL;
-         l1 = l1->next, l2 = l2->next, l3 = l3->next)
+    for (i = 0; i < dialog->conflicts->len; i++)
     {
-        GtkWidget *row1 = gtk_widget_get_parent (l1->data);
-        GtkWidget *row2 = gtk_widget_get_parent (l2->data);
-        GtkWidget *row3 = gtk_widget_get_parent (l3->data);
-
-        context = gtk_widget_get_style_context (row1);
+        g_autoptr (NautilusBatchRenameItem) item = NULL;
+        ConflictData *conflict_data = g_ptr_array_index (dialog->conflicts, i);
 
-        if (gtk_style_context_has_class (context, "conflict-row"))
+        item = g_list_model_get_item (G_LIST_MODEL (dialog->preview_model), conflict_data->index);
+        if (item != NULL)
         {
-            gtk_style_context_remove_class (context, "conflict-row");
-
-            context = gtk_widget_get_style_context (row2);
-            gtk_style_context_remove_class (context, "conflict-row");
-
-            context = gtk_widget_get_style_context (row3);
-            gtk_style_context_remove_class (context, "conflict-row");
+            nautilus_batch_rename_item_set_has_conflict (item, highlighted);
         }
-
-        if (duplicates != NULL)
-        {
-            conflict_data = duplicates->data;
-            if (conflict_data->index == index)
-            {
-                context = gtk_widget_get_style_context (row1);
-                gtk_style_context_add_class (context, "conflict-row");
-
-                context = gtk_widget_get_style_context (row2);
-                gtk_style_context_add_class (context, "conflict-row");
-
-                context = gtk_widget_get_style_context (row3);
-                gtk_style_context_add_class (context, "conflict-row");
-
-                duplicates = duplicates->next;
-            }
-        }
-        index++;
     }
 }
 
+/* Takes ownership of @conflicts, which must be sorted by index. Only the rows
+ * that were or become conflicting are touched. */
 static void
-update_listbox (NautilusBatchRenameDialog *dialog)
+set_conflicts (NautilusBatchRenameDialog *dialog,
+               GPtrArray                 *conflicts)
 {
-    GList *l1;
-    GList *l2;
-    NautilusFile *file;
-    gchar *old_name;
-    GtkLabel *label;
+    set_conflicts_highlighted (dialog, FALSE);
+    g_ptr_array_unref (dialog->conflicts);
+    dialog->conflicts = conflicts;
+    set_conflicts_highlighted (dialog, TRUE);
+}
+
+static void
+update_preview_conflicts (NautilusBatchRenameDialog *dialog)
+{
+    GList *l;
     GString *new_name;
     gboolean empty_name = FALSE;
 
-    for (l1 = dialog->new_names, l2 = dialog->listbox_labels_new; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
+    for (l = dialog->new_names; l != NULL; l = l->next)
     {
-        label = GTK_LABEL (l2->data);
-        new_name = l1->data;
-
-        gtk_label_set_label (label, new_name->str);
-        gtk_widget_set_tooltip_text (GTK_WIDGET (label), new_name->str);
+        new_name = l->data;
 
         if (g_strcmp0 (new_name->str, "") == 0)
         {
             empty_name = TRUE;
+            break;
         }
     }
 
-    for (l1 = dialog->selection, l2 = dialog->listbox_labels_old; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
-    {
-        label = GTK_LABEL (l2->data);
-        file = NAUTILUS_FILE (l1->data);
-
-        old_name = nautilus_file_get_name (file);
-        gtk_widget_set_tooltip_text (GTK_WIDGET (label), old_name);
-
-        if (dialog->mode == NAUTILUS_BATCH_RENAME_DIALOG_FORMAT)
-        {
-            gtk_label_set_label (label, old_name);
-        }
-        else
-        {
-            new_name = batch_rename_replace_label_text (old_name,
-                                                        gtk_editable_get_text (GTK_EDITABLE (dialog->find_entry)));
-            gtk_label_set_markup (GTK_LABEL (label), new_name->str);
-
-            g_string_free (new_name, TRUE);
-        }
-
-        g_free (old_name);
-    }
-
-    update_rows_height (dialog);
-
     if (empty_name)
     {
         gtk_widget_set_sensitive (dialog->rename_button, FALSE);
@@ -897,22 +897,20 @@ update_listbox (NautilusBatchRenameDialog *dialog)
     }
 
     /* check if there are name conflicts and display them if they exist */
-    if (dialog->duplicates != NULL)
+    if (dialog->conflicts->len > 0)
     {
-        update_conflict_row_background (dialog);
-
         gtk_widget_set_sensitive (dialog->rename_button, FALSE);
 
         gtk_widget_show (dialog->conflict_box);
 
         dialog->selected_conflict = 0;
-        dialog->conflicts_number = g_list_length (dialog->duplicates);
+        dialog->conflicts_number = dialog->conflicts->len;
 
         select_nth_conflict (dialog);
 
         gtk_widget_set_sensitive (dialog->conflict_up, FALSE);
 
-        if (g_list_length (dialog->duplicates) == 1)
+        if (dialog->conflicts_number == 1)
         {
             gtk_widget_set_sensitive (dialog->conflict_down, FALSE);
         }
@@ -926,20 +924,19 @@ update_listbox (NautilusBatchRenameDialog *dialog)
         gtk_widget_hide (dialog->conflict_box);
 
         /* re-enable the rename button if there are no more name conflicts */
-        if (dialog->duplicates == NULL && !gtk_widget_is_sensitive (dialog->rename_button))
+        if (!gtk_widget_is_sensitive (dialog->rename_button))
         {
-            update_conflict_row_background (dialog);
             gtk_widget_set_sensitive (dialog->rename_button, TRUE);
         }
     }
 
     /* if the rename button was clicked and there's no conflict, then start renaming */
-    if (dialog->rename_clicked && dialog->duplicates == NULL)
+    if (dialog->rename_clicked && dialog->conflicts->len == 0)
     {
         prepare_batch_rename (dialog);
     }
 
-    if (dialog->rename_clicked && dialog->duplicates != NULL)
+    if (dialog->rename_clicked && dialog->conflicts->len > 0)
     {
         dialog->rename_clicked = FALSE;
     }
@@ -952,19 +949,21 @@ check_conflict_for_files (NautilusBatchRenameDialog *dialog,
 {
     gchar *current_directory;
     gchar *parent_uri;
-    gchar *name;
     NautilusFile *file;
+    BatchRenameSource *source;
     GString *new_name;
-    GString *file_name;
+    GString *renamed_to;
     GList *l1, *l2;
     GHashTable *directory_files_table;
     GHashTable *new_names_table;
     GHashTable *names_conflicts_table;
+    GHashTable *renamed_files_table;
     gboolean exists;
     gboolean have_conflict;
     gboolean tag_present;
     gboolean same_parent_directory;
     ConflictData *conflict_data;
+    guint i;
 
     current_directory = nautilus_directory_get_uri (directory);
 
@@ -980,15 +979,18 @@ check_conflict_for_files (NautilusBatchRenameDialog *dialog,
                                                    g_str_equal,
                                                    (GDestroyNotify) g_free,
                                                    (GDestroyNotify) g_free);
+    /* old name -> new name of the selected files in this directory */
+    renamed_files_table = g_hash_table_new (g_str_hash, g_str_equal);
 
     /* names_conflicts_table is used for knowing which names from the list are not unique,
      * so that they can easily be reached when needed */
-    for (l1 = dialog->new_names, l2 = dialog->selection;
+    for (l1 = dialog->new_names, l2 = dialog->selection, i = 0;
          l1 != NULL && l2 != NULL;
-         l1 = l1->next, l2 = l2->next)
+         l1 = l1->next, l2 = l2->next, i++)
     {
         new_name = l1->data;
         file = NAUTILUS_FILE (l2->data);
+        source = g_ptr_array_index (dialog->sources, i);
         parent_uri = nautilus_file_get_parent_uri (file);
 
         tag_present = g_hash_table_lookup (new_names_table, new_name->str) != NULL;
@@ -1008,6 +1010,11 @@ check_conflict_for_files (NautilusBatchRenameDialog *dialog,
                                      g_strdup (new_name->str),
                                      nautilus_file_get_parent_uri (file));
             }
+
+            if (!g_hash_table_contains (renamed_files_table, source->name))
+            {
+                g_hash_table_insert (renamed_files_table, source->name, new_name);
+            }
         }
 
         g_free (parent_uri);
@@ -1021,13 +1028,12 @@ check_conflict_for_files (NautilusBatchRenameDialog *dialog,
                              GINT_TO_POINTER (TRUE));
     }
 
-    for (l1 = dialog->selection, l2 = dialog->new_names; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
+    for (l1 = dialog->selection, l2 = dialog->new_names, i = 0;
+         l1 != NULL && l2 != NULL;
+         l1 = l1->next, l2 = l2->next, i++)
     {
         file = NAUTILUS_FILE (l1->data);
-
-        name = nautilus_file_get_name (file);
-        file_name = g_string_new (name);
-        g_free (name);
+        source = g_ptr_array_index (dialog->sources, i);
 
         parent_uri = nautilus_file_get_parent_uri (file);
 
@@ -1038,18 +1044,23 @@ check_conflict_for_files (NautilusBatchRenameDialog *dialog,
         /* check for duplicate only if the parent of the current file is
          * the current directory and the name of the file has changed */
         if (g_strcmp0 (parent_uri, current_directory) == 0 &&
-            !g_string_equal (new_name, file_name))
+            g_strcmp0 (new_name->str, source->name) != 0)
         {
             exists = GPOINTER_TO_INT (g_hash_table_lookup (directory_files_table, new_name->str));
 
+            /* A new name that matches an existing file is fine if that file
+             * is part of the selection and is getting renamed itself. */
+            renamed_to = g_hash_table_lookup (renamed_files_table, new_name->str);
+
             if (exists == TRUE &&
-                !file_name_conflicts_with_results (dialog->selection, dialog->new_names, new_name, parent_uri))
+                (renamed_to == NULL || g_string_equal (renamed_to, new_name)))
             {
                 conflict_data = g_new (ConflictData, 1);
                 conflict_data->name = g_strdup (new_name->str);
-                conflict_data->index = g_list_index (dialog->selection, l1->data);
-                dialog->duplicates = g_list_prepend (dialog->duplicates,
-                                                     conflict_data);
+                conflict_data->index = i;
+                conflict_data->is_duplicate = g_hash_table_contains (names_conflicts_table,
+                                                                     new_name->str);
+                g_ptr_array_add (dialog->pending_conflicts, conflict_data);
 
                 have_conflict = TRUE;
             }
@@ -1064,15 +1075,14 @@ check_conflict_for_files (NautilusBatchRenameDialog *dialog,
             {
                 conflict_data = g_new (ConflictData, 1);
                 conflict_data->name = g_strdup (new_name->str);
-                conflict_data->index = g_list_index (dialog->selection, l1->data);
-                dialog->duplicates = g_list_prepend (dialog->duplicates,
-                                                     conflict_data);
+                conflict_data->index = i;
+                conflict_data->is_duplicate = TRUE;
+                g_ptr_array_add (dialog->pending_conflicts, conflict_data);
 
                 have_conflict = TRUE;
             }
         }
 
-        g_string_free (file_name, TRUE);
         g_free (parent_uri);
     }
 
@@ -1080,6 +1090,17 @@ check_conflict_for_files (NautilusBatchRenameDialog *dialog,
     g_hash_table_destroy (directory_files_table);
     g_hash_table_destroy (new_names_table);
     g_hash_table_destroy (names_conflicts_table);
+    g_hash_table_destroy (renamed_files_table);
+}
+
+static gint
+compare_conflict_index (gconstpointer a,
+                        gconstpointer b)
+{
+    const ConflictData *conflict_data1 = *(ConflictData **) a;
+    const ConflictData *conflict_data2 = *(ConflictData **) b;
+
+    return conflict_data1->index - conflict_data2->index;
 }
 
 static void
@@ -1101,9 +1122,11 @@ on_directory_attributes_ready_for_conflicts_check (NautilusDirectory *conflict_d
 
     if (self->directories_pending_conflict_check == NULL)
     {
-        self->duplicates = g_list_reverse (self->duplicates);
+        g_ptr_array_sort (self->pending_conflicts, compare_conflict_index);
+        set_conflicts (self, g_steal_pointer (&self->pending_conflicts));
+        self->pending_conflicts = g_ptr_array_new_with_free_func (conflict_data_free);
 
-        update_listbox (self);
+        update_preview_conflicts (self);
     }
 }
 
@@ -1123,6 +1146,7 @@ cancel_conflict_check (NautilusBatchRenameDialog *self)
     }
 
     g_clear_list (&self->directories_pending_conflict_check, g_object_unref);
+    g_ptr_array_set_size (self->pending_conflicts, 0);
 }
 
 static void
@@ -1136,7 +1160,6 @@ file_names_list_has_duplicates_async (NautilusBatchRenameDialog *self)
     }
 
     self->directories_pending_conflict_check = nautilus_directory_list_copy (self->distinct_parent_directories);
-    self->duplicates = NULL;
 
     for (l = self->distinct_parent_directories; l != NULL; l = l->next)
     {
@@ -1287,22 +1310,11 @@ numbering_tag_is_some_added (NautilusBatchRenameDialog *self)
 static void
 update_display_text (NautilusBatchRenameDialog *dialog)
 {
-    if (dialog->selection == NULL)
+    if (dialog->sources == NULL)
     {
         return;
     }
 
-    if (dialog->duplicates != NULL)
-    {
-        g_list_free_full (dialog->duplicates, conflict_data_free);
-        dialog->duplicates = NULL;
-    }
-
-    if (dialog->new_names != NULL)
-    {
-        g_list_free_full (dialog->new_names, string_free);
-    }
-
     if (!numbering_tag_is_some_added (dialog))
     {
         gtk_revealer_set_reveal_child (GTK_REVEALER (dialog->numbering_revealer), FALSE);
@@ -1312,14 +1324,13 @@ update_display_text (NautilusBatchRenameDialog *dialog)
         gtk_revealer_set_reveal_child (GTK_REVEALER (dialog->numbering_revealer), TRUE);
     }
 
-    dialog->new_names = batch_rename_dialog_get_new_names (dialog);
-
-    if (have_unallowed_character (dialog))
+    /* The pending check is about names that are going to be replaced */
+    if (dialog->directories_pending_conflict_check != NULL)
     {
-        return;
+        cancel_conflict_check (dialog);
     }
 
-    file_names_list_has_duplicates_async (dialog);
+    batch_rename_dialog_get_new_names_async (dialog);
 }
 
 static void
@@ -1412,101 +1423,6 @@ nautilus_batch_rename_dialog_query_finished (NautilusBatchRenameDialog *dialog,
     }
 }
 
-static void
-update_row_shadowing (GtkWidget *row,
-                      gboolean   shown)
-{
-    GtkStyleContext *context;
-    GtkStateFlags flags;
-
-    if (!GTK_IS_LIST_BOX_ROW (row))
-    {
-        return;
-    }
-
-    context = gtk_widget_get_style_context (row);
-    flags = gtk_style_context_get_state (context);
-
-    if (shown)
-    {
-        flags |= GTK_STATE_FLAG_PRELIGHT;
-    }
-    else
-    {
-        flags &= ~GTK_STATE_FLAG_PRELIGHT;
-    }
-
-    gtk_style_context_set_state (context, flags);
-}
-
-static void
-on_event_controller_motion_motion (GtkEventControllerMotion *controller,
-                                   double                    x,
-                                   double                    y,
-                                   gpointer                  user_data)
-{
-    GtkWidget *widget;
-    NautilusBatchRenameDialog *dialog;
-    GtkListBoxRow *row;
-
-    widget = gtk_event_controller_get_widget (GTK_EVENT_CONTROLLER (controller));
-    dialog = NAUTILUS_BATCH_RENAME_DIALOG (user_data);
-
-    if (dialog->preselected_row1 && dialog->preselected_row2)
-    {
-        update_row_shadowing (dialog->preselected_row1, FALSE);
-        update_row_shadowing (dialog->preselected_row2, FALSE);
-    }
-
-    if (widget == dialog->result_listbox)
-    {
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->original_name_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row1 = GTK_WIDGET (row);
-
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->arrow_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row2 = GTK_WIDGET (row);
-    }
-
-    if (widget == dialog->arrow_listbox)
-    {
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->original_name_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row1 = GTK_WIDGET (row);
-
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->result_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row2 = GTK_WIDGET (row);
-    }
-
-    if (widget == dialog->original_name_listbox)
-    {
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->result_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row1 = GTK_WIDGET (row);
-
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->arrow_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row2 = GTK_WIDGET (row);
-    }
-}
-
-static void
-on_event_controller_motion_leave (GtkEventControllerMotion *controller,
-                                  gpointer                  user_data)
-{
-    NautilusBatchRenameDialog *dialog;
-
-    dialog = NAUTILUS_BATCH_RENAME_DIALOG (user_data);
-
-    update_row_shadowing (dialog->preselected_row1, FALSE);
-    update_row_shadowing (dialog->preselected_row2, FALSE);
-
-    dialog->preselected_row1 = NULL;
-    dialog->preselected_row2 = NULL;
-}
-
 static void
 nautilus_batch_rename_dialog_initialize_actions (NautilusBatchRenameDialog *dialog)
 {
@@ -1755,6 +1671,20 @@ file_names_widget_entry_on_changed (NautilusBatchRenameDialog *self)
     update_display_text (self);
 }
 
+static void
+nautilus_batch_rename_dialog_dispose (GObject *object)
+{
+    NautilusBatchRenameDialog *dialog;
+
+    dialog = NAUTILUS_BATCH_RENAME_DIALOG (object);
+
+    /* The pending task keeps the dialog alive, make sure its result is
+     * dropped instead of being applied to a destroyed dialog. */
+    cancel_new_names (dialog);
+
+    G_OBJECT_CLASS (nautilus_batch_rename_dialog_parent_class)->dispose (object);
+}
+
 static void
 nautilus_batch_rename_dialog_finalize (GObject *object)
 {
@@ -1769,9 +1699,7 @@ nautilus_batch_rename_dialog_finalize (GObject *object)
         cancel_conflict_check (dialog);
     }
 
-    g_list_free (dialog->listbox_labels_new);
-    g_list_free (dialog->listbox_labels_old);
-    g_list_free (dialog->listbox_icons);
+    cancel_new_names (dialog);
 
     for (l = dialog->selection_metadata; l != NULL; l = l->next)
     {
@@ -1796,14 +1724,15 @@ nautilus_batch_rename_dialog_finalize (GObject *object)
     }
 
     g_list_free_full (dialog->new_names, string_free);
-    g_list_free_full (dialog->duplicates, conflict_data_free);
+    g_ptr_array_unref (dialog->conflicts);
+    g_ptr_array_unref (dialog->pending_conflicts);
+    g_clear_pointer (&dialog->sources, g_ptr_array_unref);
+    g_object_unref (dialog->preview_model);
 
     nautilus_file_list_free (dialog->selection);
     nautilus_directory_unref (dialog->directory);
     nautilus_directory_list_free (dialog->distinct_parent_directories);
 
-    g_object_unref (dialog->size_group);
-
     g_hash_table_destroy (dialog->tag_info_table);
 
     g_cancellable_cancel (dialog->metadata_cancellable);
@@ -1821,15 +1750,14 @@ nautilus_batch_rename_dialog_class_init (NautilusBatchRenameDialogClass *klass)
     widget_class = GTK_WIDGET_CLASS (klass);
     oclass = G_OBJECT_CLASS (klass);
 
+    oclass->dispose = nautilus_batch_rename_dialog_dispose;
     oclass->finalize = nautilus_batch_rename_dialog_finalize;
 
     gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/nautilus/ui/nautilus-batch-rename-dialog.ui");
 
     gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, grid);
     gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, cancel_button);
-    gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, original_name_listbox);
-    gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, arrow_listbox);
-    gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, result_listbox);
+    gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, preview_list_view);
     gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, name_entry);
     gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, rename_button);
     gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, find_entry);
@@ -1929,12 +1857,10 @@ nautilus_batch_rename_dialog_new (GList             *selection,
 
     add_tag (dialog, metadata_tags_constants[ORIGINAL_FILE_NAME]);
 
+    /* Applying the initial numbering order fills the preview and generates
+     * the first set of new names. */
     nautilus_batch_rename_dialog_initialize_actions (dialog);
 
-    update_display_text (dialog);
-
-    fill_display_listbox (dialog);
-
     gtk_widget_set_cursor (GTK_WIDGET (window), NULL);
 
     g_string_free (dialog_title, TRUE);
@@ -1942,49 +1868,35 @@ nautilus_batch_rename_dialog_new (GList             *selection,
     return GTK_WIDGET (dialog);
 }
 
-static void
-connect_to_pointer_motion_events (NautilusBatchRenameDialog *self,
-                                  GtkWidget                 *listbox)
-{
-    GtkEventController *controller;
-
-    controller = gtk_event_controller_motion_new ();
-    gtk_widget_add_controller (listbox, controller);
-    gtk_event_controller_set_propagation_phase (controller, GTK_PHASE_CAPTURE);
-    g_signal_connect (controller, "leave",
-                      G_CALLBACK (on_event_controller_motion_leave), self);
-    g_signal_connect (controller, "motion",
-                      G_CALLBACK (on_event_controller_motion_motion), self);
-}
-
 static void
 nautilus_batch_rename_dialog_init (NautilusBatchRenameDialog *self)
 {
+    g_autoptr (GtkListItemFactory) factory = NULL;
+    g_autoptr (GtkNoSelection) preview_selection = NULL;
     TagData *tag_data;
     guint i;
 
     gtk_widget_init_template (GTK_WIDGET (self));
 
-    gtk_list_box_set_header_func (GTK_LIST_BOX (self->original_name_listbox),
-                                  (GtkListBoxUpdateHeaderFunc) listbox_header_func,
-                                  self,
-                                  NULL);
-    gtk_list_box_set_header_func (GTK_LIST_BOX (self->arrow_listbox),
-                                  (GtkListBoxUpdateHeaderFunc) listbox_header_func,
-                                  self,
-                                  NULL);
-    gtk_list_box_set_header_func (GTK_LIST_BOX (self->result_listbox),
-                                  (GtkListBoxUpdateHeaderFunc) listbox_header_func,
-                                  self,
-                                  NULL);
+    self->preview_model = g_list_store_new (NAUTILUS_TYPE_BATCH_RENAME_ITEM);
+    preview_selection = gtk_no_selection_new (g_object_ref (G_LIST_MODEL (self->preview_model)));
 
+    factory = gtk_signal_list_item_factory_new ();
+    g_signal_connect (factory, "setup", G_CALLBACK (on_preview_row_setup), self);
+    g_signal_connect (factory, "bind", G_CALLBACK (on_preview_row_bind), self);
+    g_signal_connect (factory, "unbind", G_CALLBACK (on_preview_row_unbind), self);
+
+    gtk_list_view_set_factory (GTK_LIST_VIEW (self->preview_list_view), factory);
+    gtk_list_view_set_model (GTK_LIST_VIEW (self->preview_list_view),
+                             GTK_SELECTION_MODEL (preview_selection));
 
     self->mode = NAUTILUS_BATCH_RENAME_DIALOG_FORMAT;
 
     gtk_label_set_ellipsize (GTK_LABEL (self->conflict_label), PANGO_ELLIPSIZE_END);
     gtk_label_set_max_width_chars (GTK_LABEL (self->conflict_label), 1);
 
-    self->duplicates = NULL;
+    self->conflicts = g_ptr_array_new_with_free_func (conflict_data_free);
+    self->pending_conflicts = g_ptr_array_new_with_free_func (conflict_data_free);
     self->distinct_parent_directories = NULL;
     self->directories_pending_conflict_check = NULL;
     self->new_names = NULL;
@@ -2023,18 +1935,10 @@ nautilus_batch_rename_dialog_init (NautilusBatchRenameDialog *self)
         g_hash_table_insert (self->tag_info_table, g_strdup (tag_text_representation), tag_data);
     }
 
-    self->row_height = -1;
-
     g_signal_connect_object (gtk_editable_get_delegate (GTK_EDITABLE (self->name_entry)),
                              "delete-text", G_CALLBACK (on_delete_text), self, 0);
     g_signal_connect_object (gtk_editable_get_delegate (GTK_EDITABLE (self->name_entry)),
                              "insert-text", G_CALLBACK (on_insert_text), self, 0);
 
-    self->size_group = gtk_size_group_new (GTK_SIZE_GROUP_HORIZONTAL);
-
-    connect_to_pointer_motion_events (self, self->original_name_listbox);
-    connect_to_pointer_motion_events (self, self->result_listbox);
-    connect_to_pointer_motion_events (self, self->arrow_listbox);
-
     self->metadata_cancellable = g_cancellable_new ();
 }
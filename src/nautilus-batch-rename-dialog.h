@@ -210,6 +210,9 @@ typedef struct
 {
     gchar *name;
     gint index;
+    /* TRUE if the new name is used more than once in the selection, rather
+     * than clashing with a file that isn't being renamed */
+    gboolean is_duplicate;
 } ConflictData;
 
 typedef struct {
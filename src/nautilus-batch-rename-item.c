@@ -0,0 +1,255 @@
+/* nautilus-batch-rename-item.c
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "nautilus-batch-rename-item.h"
+
+struct _NautilusBatchRenameItem
+{
+    GObject parent_instance;
+    gchar *original_name;
+    gchar *original_markup;
+    gchar *new_name;
+    gboolean has_conflict;
+};
+
+G_DEFINE_TYPE (NautilusBatchRenameItem, nautilus_batch_rename_item, G_TYPE_OBJECT)
+
+enum
+{
+    PROP_0,
+    PROP_ORIGINAL_NAME,
+    PROP_ORIGINAL_MARKUP,
+    PROP_NEW_NAME,
+    PROP_HAS_CONFLICT,
+    N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS] = { NULL, };
+
+static void
+nautilus_batch_rename_item_finalize (GObject *object)
+{
+    NautilusBatchRenameItem *self = NAUTILUS_BATCH_RENAME_ITEM (object);
+
+    g_free (self->original_name);
+    g_free (self->original_markup);
+    g_free (self->new_name);
+
+    G_OBJECT_CLASS (nautilus_batch_rename_item_parent_class)->finalize (object);
+}
+
+static void
+nautilus_batch_rename_item_get_property (GObject    *object,
+                                         guint       prop_id,
+                                         GValue     *value,
+                                         GParamSpec *pspec)
+{
+    NautilusBatchRenameItem *self = NAUTILUS_BATCH_RENAME_ITEM (object);
+
+    switch (prop_id)
+    {
+        case PROP_ORIGINAL_NAME:
+        {
+            g_value_set_string (value, self->original_name);
+        }
+        break;
+
+        case PROP_ORIGINAL_MARKUP:
+        {
+            g_value_set_string (value, self->original_markup);
+        }
+        break;
+
+        case PROP_NEW_NAME:
+        {
+            g_value_set_string (value, self->new_name);
+        }
+        break;
+
+        case PROP_HAS_CONFLICT:
+        {
+            g_value_set_boolean (value, self->has_conflict);
+        }
+        break;
+
+        default:
+        {
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        }
+    }
+}
+
+static void
+nautilus_batch_rename_item_set_property (GObject      *object,
+                                         guint         prop_id,
+                                         const GValue *value,
+                                         GParamSpec   *pspec)
+{
+    NautilusBatchRenameItem *self = NAUTILUS_BATCH_RENAME_ITEM (object);
+
+    switch (prop_id)
+    {
+        case PROP_ORIGINAL_NAME:
+        {
+            self->original_name = g_value_dup_string (value);
+        }
+        break;
+
+        case PROP_ORIGINAL_MARKUP:
+        {
+            nautilus_batch_rename_item_set_original_markup (self, g_value_get_string (value));
+        }
+        break;
+
+        case PROP_NEW_NAME:
+        {
+            nautilus_batch_rename_item_set_new_name (self, g_value_get_string (value));
+        }
+        break;
+
+        case PROP_HAS_CONFLICT:
+        {
+            nautilus_batch_rename_item_set_has_conflict (self, g_value_get_boolean (value));
+        }
+        break;
+
+        default:
+        {
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        }
+    }
+}
+
+static void
+nautilus_batch_rename_item_init (NautilusBatchRenameItem *self)
+{
+}
+
+static void
+nautilus_batch_rename_item_class_init (NautilusBatchRenameItemClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->finalize = nautilus_batch_rename_item_finalize;
+    object_class->get_property = nautilus_batch_rename_item_get_property;
+    object_class->set_property = nautilus_batch_rename_item_set_property;
+
+    properties[PROP_ORIGINAL_NAME] = g_param_spec_string ("original-name",
+                                                          "", "",
+                                                          NULL,
+                                                          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+    properties[PROP_ORIGINAL_MARKUP] = g_param_spec_string ("original-markup",
+                                                            "", "",
+                                                            NULL,
+                                                            G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+    properties[PROP_NEW_NAME] = g_param_spec_string ("new-name",
+                                                     "", "",
+                                                     NULL,
+                                                     G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+    properties[PROP_HAS_CONFLICT] = g_param_spec_boolean ("has-conflict",
+                                                          "", "",
+                                                          FALSE,
+                                                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+    g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+NautilusBatchRenameItem *
+nautilus_batch_rename_item_new (const gchar *original_name)
+{
+    return g_object_new (NAUTILUS_TYPE_BATCH_RENAME_ITEM,
+                         "original-name", original_name,
+                         NULL);
+}
+
+const gchar *
+nautilus_batch_rename_item_get_original_name (NautilusBatchRenameItem *self)
+{
+    g_return_val_if_fail (NAUTILUS_IS_BATCH_RENAME_ITEM (self), NULL);
+
+    return self->original_name;
+}
+
+/* Markup highlighting the replaced parts of the original name, or NULL if
+ * the original name should be shown as is. */
+const gchar *
+nautilus_batch_rename_item_get_original_markup (NautilusBatchRenameItem *self)
+{
+    g_return_val_if_fail (NAUTILUS_IS_BATCH_RENAME_ITEM (self), NULL);
+
+    return self->original_markup;
+}
+
+void
+nautilus_batch_rename_item_set_original_markup (NautilusBatchRenameItem *self,
+                                                const gchar             *original_markup)
+{
+    g_return_if_fail (NAUTILUS_IS_BATCH_RENAME_ITEM (self));
+
+    /* Only notify real changes, so that regenerating the names for the whole
+     * selection only touches the rows whose text actually changed. */
+    if (g_strcmp0 (self->original_markup, original_markup) != 0)
+    {
+        g_free (self->original_markup);
+        self->original_markup = g_strdup (original_markup);
+        g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_ORIGINAL_MARKUP]);
+    }
+}
+
+const gchar *
+nautilus_batch_rename_item_get_new_name (NautilusBatchRenameItem *self)
+{
+    g_return_val_if_fail (NAUTILUS_IS_BATCH_RENAME_ITEM (self), NULL);
+
+    return self->new_name;
+}
+
+void
+nautilus_batch_rename_item_set_new_name (NautilusBatchRenameItem *self,
+                                         const gchar             *new_name)
+{
+    g_return_if_fail (NAUTILUS_IS_BATCH_RENAME_ITEM (self));
+
+    if (g_strcmp0 (self->new_name, new_name) != 0)
+    {
+        g_free (self->new_name);
+        self->new_name = g_strdup (new_name);
+        g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_NEW_NAME]);
+    }
+}
+
+gboolean
+nautilus_batch_rename_item_get_has_conflict (NautilusBatchRenameItem *self)
+{
+    g_return_val_if_fail (NAUTILUS_IS_BATCH_RENAME_ITEM (self), FALSE);
+
+    return self->has_conflict;
+}
+
+void
+nautilus_batch_rename_item_set_has_conflict (NautilusBatchRenameItem *self,
+                                             gboolean                 has_conflict)
+{
+    g_return_if_fail (NAUTILUS_IS_BATCH_RENAME_ITEM (self));
+
+    has_conflict = !!has_conflict;
+    if (self->has_conflict != has_conflict)
+    {
+        self->has_conflict = has_conflict;
+        g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_HAS_CONFLICT]);
+    }
+}
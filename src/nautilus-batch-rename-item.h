@@ -0,0 +1,45 @@
+/* nautilus-batch-rename-item.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/* One row of the batch rename preview. The dialog keeps one of these per
+ * selected file in a GListModel, so only the rows on screen have widgets. */
+#define NAUTILUS_TYPE_BATCH_RENAME_ITEM (nautilus_batch_rename_item_get_type())
+
+G_DECLARE_FINAL_TYPE (NautilusBatchRenameItem, nautilus_batch_rename_item, NAUTILUS, BATCH_RENAME_ITEM, GObject)
+
+NautilusBatchRenameItem * nautilus_batch_rename_item_new                 (const gchar             *original_name);
+
+const gchar *             nautilus_batch_rename_item_get_original_name   (NautilusBatchRenameItem *self);
+const gchar *             nautilus_batch_rename_item_get_original_markup (NautilusBatchRenameItem *self);
+void                      nautilus_batch_rename_item_set_original_markup (NautilusBatchRenameItem *self,
+                                                                          const gchar             *original_markup);
+const gchar *             nautilus_batch_rename_item_get_new_name        (NautilusBatchRenameItem *self);
+void                      nautilus_batch_rename_item_set_new_name        (NautilusBatchRenameItem *self,
+                                                                          const gchar             *new_name);
+gboolean                  nautilus_batch_rename_item_get_has_conflict    (NautilusBatchRenameItem *self);
+void                      nautilus_batch_rename_item_set_has_conflict    (NautilusBatchRenameItem *self,
+                                                                          gboolean                 has_conflict);
+
+G_END_DECLS
@@ -142,126 +142,6 @@ batch_rename_replace (gchar *string,
     return new_string;
 }
 
-void
-batch_rename_sort_lists_for_rename (GList    **selection,
-                                    GList    **new_names,
-                                    GList    **old_names,
-                                    GList    **new_files,
-                                    GList    **old_files,
-                                    gboolean   is_undo_redo)
-{
-    GList *new_names_list;
-    GList *new_names_list2;
-    GList *files;
-    GList *files2;
-    GList *old_names_list = NULL;
-    GList *new_files_list = NULL;
-    GList *old_files_list = NULL;
-    GList *old_names_list2 = NULL;
-    GList *new_files_list2 = NULL;
-    GList *old_files_list2 = NULL;
-    GString *new_file_name;
-    GString *new_name;
-    GString *old_name;
-    GFile *new_file;
-    GFile *old_file;
-    NautilusFile *file;
-    gboolean order_changed = TRUE;
-
-    /* in the following case:
-     * file1 -> file2
-     * file2 -> file3
-     * file2 must be renamed first, so because of that, the list has to be reordered
-     */
-    while (order_changed)
-    {
-        order_changed = FALSE;
-
-        if (is_undo_redo)
-        {
-            old_names_list = *old_names;
-            new_files_list = *new_files;
-            old_files_list = *old_files;
-        }
-
-        for (new_names_list = *new_names, files = *selection;
-             new_names_list != NULL && files != NULL;
-             new_names_list = new_names_list->next, files = files->next)
-        {
-            g_autofree gchar *old_file_name = NULL;
-            g_autoptr (NautilusFile) parent = NULL;
-
-            old_file_name = nautilus_file_get_name (NAUTILUS_FILE (files->data));
-            new_file_name = new_names_list->data;
-            parent = nautilus_file_get_parent (NAUTILUS_FILE (files->data));
-
-            if (is_undo_redo)
-            {
-                old_names_list2 = old_names_list;
-                new_files_list2 = new_files_list;
-                old_files_list2 = old_files_list;
-            }
-
-            for (files2 = files, new_names_list2 = new_names_list;
-                 files2 != NULL && new_names_list2 != NULL;
-                 files2 = files2->next, new_names_list2 = new_names_list2->next)
-            {
-                g_autofree gchar *file_name = NULL;
-                g_autoptr (NautilusFile) parent2 = NULL;
-
-                file_name = nautilus_file_get_name (NAUTILUS_FILE (files2->data));
-                new_name = new_names_list2->data;
-
-                parent2 = nautilus_file_get_parent (NAUTILUS_FILE (files2->data));
-
-                if (files2 != files && g_strcmp0 (file_name, new_file_name->str) == 0 &&
-                    parent == parent2)
-                {
-                    file = NAUTILUS_FILE (files2->data);
-
-                    *selection = g_list_remove_link (*selection, files2);
-                    *new_names = g_list_remove_link (*new_names, new_names_list2);
-
-                    *selection = g_list_prepend (*selection, file);
-                    *new_names = g_list_prepend (*new_names, new_name);
-
-                    if (is_undo_redo)
-                    {
-                        old_name = old_names_list2->data;
-                        new_file = new_files_list2->data;
-                        old_file = old_files_list2->data;
-
-                        *old_names = g_list_remove_link (*old_names, old_names_list2);
-                        *new_files = g_list_remove_link (*new_files, new_files_list2);
-                        *old_files = g_list_remove_link (*old_files, old_files_list2);
-
-                        *old_names = g_list_prepend (*old_names, old_name);
-                        *new_files = g_list_prepend (*new_files, new_file);
-                        *old_files = g_list_prepend (*old_files, old_file);
-                    }
-
-                    order_changed = TRUE;
-                    break;
-                }
-
-                if (is_undo_redo)
-                {
-                    old_names_list2 = old_names_list2->next;
-                    new_files_list2 = new_files_list2->next;
-                    old_files_list2 = old_files_list2->next;
-                }
-            }
-
-            if (is_undo_redo)
-            {
-                old_names_list = old_names_list->next;
-                new_files_list = new_files_list->next;
-                old_files_list = old_files_list->next;
-            }
-        }
-    }
-}
-
 /* This function changes the background color of the replaced part of the name */
 GString *
 batch_rename_replace_label_text (gchar       *label,
@@ -319,53 +199,46 @@ batch_rename_replace_label_text (gchar       *label,
 }
 
 static gchar *
-get_metadata (GList        *selection_metadata,
+get_metadata (GHashTable   *metadata_table,
               gchar        *file_name,
               MetadataType  metadata_type)
 {
-    GList *l;
     FileMetadata *file_metadata;
-    gchar *metadata = NULL;
 
-    for (l = selection_metadata; l != NULL; l = l->next)
+    if (metadata_table == NULL)
     {
-        file_metadata = l->data;
-        if (g_strcmp0 (file_name, file_metadata->file_name->str) == 0)
-        {
-            if (file_metadata->metadata[metadata_type] &&
-                file_metadata->metadata[metadata_type]->len > 0)
-            {
-                metadata = file_metadata->metadata[metadata_type]->str;
-            }
+        return NULL;
+    }
 
-            break;
-        }
+    file_metadata = g_hash_table_lookup (metadata_table, file_name);
+    if (file_metadata != NULL &&
+        file_metadata->metadata[metadata_type] &&
+        file_metadata->metadata[metadata_type]->len > 0)
+    {
+        return file_metadata->metadata[metadata_type]->str;
     }
 
-    return metadata;
+    return NULL;
 }
 
 static GString *
-batch_rename_format (NautilusFile *file,
-                     GList        *text_chunks,
-                     GList        *selection_metadata,
-                     gint          count)
+batch_rename_format (BatchRenameSource *source,
+                     GList             *text_chunks,
+                     GHashTable        *metadata_table,
+                     gint               count)
 {
     GList *l;
     GString *tag_string;
     GString *new_name;
     gboolean added_tag;
     MetadataType metadata_type;
-    g_autofree gchar *file_name = NULL;
-    g_autofree gchar *extension = NULL;
+    gchar *file_name;
+    gchar *extension;
     gint i;
     gchar *metadata;
 
-    file_name = nautilus_file_get_display_name (file);
-    if (!nautilus_file_is_directory (file))
-    {
-        extension = nautilus_file_get_extension (file);
-    }
+    file_name = source->display_name;
+    extension = source->extension;
 
     new_name = g_string_new ("");
 
@@ -426,7 +299,7 @@ batch_rename_format (NautilusFile *file,
             if (g_strcmp0 (tag_string->str, tag_text_representation) == 0)
             {
                 metadata_type = metadata_tags_constants[i].metadata_type;
-                metadata = get_metadata (selection_metadata, file_name, metadata_type);
+                metadata = get_metadata (metadata_table, file_name, metadata_type);
 
                 /* TODO: This is a hack, we should provide a cancellable for checking
                  * the metadata, and if that is happening don't enter here. We can
@@ -442,7 +315,7 @@ batch_rename_format (NautilusFile *file,
                 {
                     case ORIGINAL_FILE_NAME:
                     {
-                        if (nautilus_file_is_directory (file))
+                        if (source->is_directory)
                         {
                             new_name = g_string_append (new_name, file_name);
                         }
@@ -494,104 +367,101 @@ batch_rename_format (NautilusFile *file,
     return new_name;
 }
 
+BatchRenameSource *
+batch_rename_source_new (NautilusFile *file)
+{
+    BatchRenameSource *source;
+
+    source = g_new0 (BatchRenameSource, 1);
+    source->name = nautilus_file_get_name (file);
+    source->display_name = nautilus_file_get_display_name (file);
+    source->is_directory = nautilus_file_is_directory (file);
+    if (!source->is_directory)
+    {
+        source->extension = nautilus_file_get_extension (file);
+    }
+
+    return source;
+}
+
+void
+batch_rename_source_free (gpointer mem)
+{
+    BatchRenameSource *source = mem;
+
+    g_free (source->name);
+    g_free (source->display_name);
+    g_free (source->extension);
+    g_free (source);
+}
+
+/* Only touches the snapshots in @sources, so it can run in a worker thread.
+ * Returns NULL if @cancellable is cancelled half way. */
 GList *
 batch_rename_dialog_get_new_names_list (NautilusBatchRenameDialogMode  mode,
-                                        GList                         *selection,
+                                        GPtrArray                     *sources,
                                         GList                         *text_chunks,
                                         GList                         *selection_metadata,
                                         gchar                         *entry_text,
-                                        gchar                         *replace_text)
+                                        gchar                         *replace_text,
+                                        GCancellable                  *cancellable)
 {
+    g_autoptr (GHashTable) metadata_table = NULL;
+    BatchRenameSource *source;
+    GString *new_name;
     GList *l;
     GList *result;
-    GString *file_name;
-    GString *new_name;
-    NautilusFile *file;
-    gchar *name;
-    gint count;
+    guint i;
 
     result = NULL;
-    count = 1;
 
-    for (l = selection; l != NULL; l = l->next)
+    if (mode == NAUTILUS_BATCH_RENAME_DIALOG_FORMAT && selection_metadata != NULL)
     {
-        file = NAUTILUS_FILE (l->data);
+        metadata_table = g_hash_table_new (g_str_hash, g_str_equal);
+        for (l = selection_metadata; l != NULL; l = l->next)
+        {
+            FileMetadata *file_metadata = l->data;
+
+            if (!g_hash_table_contains (metadata_table, file_metadata->file_name->str))
+            {
+                g_hash_table_insert (metadata_table, file_metadata->file_name->str, file_metadata);
+            }
+        }
+    }
 
-        name = nautilus_file_get_name (file);
-        file_name = g_string_new (name);
+    for (i = 0; i < sources->len; i++)
+    {
+        if (g_cancellable_is_cancelled (cancellable))
+        {
+            g_list_free_full (result, string_free);
+
+            return NULL;
+        }
+
+        source = g_ptr_array_index (sources, i);
 
         /* get the new name here and add it to the list*/
         if (mode == NAUTILUS_BATCH_RENAME_DIALOG_FORMAT)
         {
-            new_name = batch_rename_format (file,
+            new_name = batch_rename_format (source,
                                             text_chunks,
-                                            selection_metadata,
-                                            count++);
+                                            metadata_table,
+                                            i + 1);
             result = g_list_prepend (result, new_name);
         }
 
         if (mode == NAUTILUS_BATCH_RENAME_DIALOG_REPLACE)
         {
-            new_name = batch_rename_replace (file_name->str,
+            new_name = batch_rename_replace (source->name,
                                              entry_text,
                                              replace_text);
             result = g_list_prepend (result, new_name);
         }
-
-        g_string_free (file_name, TRUE);
-        g_free (name);
     }
 
     return result;
 }
 
-/* There is a case that a new name for a file conflicts with an existing file name
- * in the directory but it's not a problem because the file in the directory that
- * conflicts is part of the batch renaming selection and it's going to change the name anyway. */
-gboolean
-file_name_conflicts_with_results (GList   *selection,
-                                  GList   *new_names,
-                                  GString *old_name,
-                                  gchar   *parent_uri)
-{
-    GList *l1;
-    GList *l2;
-    NautilusFile *selection_file;
-    GString *new_name;
-
-    for (l1 = selection, l2 = new_names; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
-    {
-        g_autofree gchar *name1 = NULL;
-        g_autofree gchar *selection_parent_uri = NULL;
-
-        selection_file = NAUTILUS_FILE (l1->data);
-        name1 = nautilus_file_get_name (selection_file);
-
-        selection_parent_uri = nautilus_file_get_parent_uri (selection_file);
-
-        if (g_strcmp0 (name1, old_name->str) == 0)
-        {
-            new_name = l2->data;
-
-            /* if the name didn't change, then there's a conflict */
-            if (g_string_equal (old_name, new_name) &&
-                (parent_uri == NULL || g_strcmp0 (parent_uri, selection_parent_uri) == 0))
-            {
-                return FALSE;
-            }
-
-
-            /* if this file exists and it changed it's name, then there's no
-             * conflict */
-            return TRUE;
-        }
-    }
-
-    /* the case this function searched for doesn't exist, so the file
-     * has a conlfict */
-    return FALSE;
-}
-
 static gint
 compare_files_by_name_ascending (gconstpointer a,
                                  gconstpointer b)
@@ -22,12 +22,27 @@
 #include <gtk/gtk.h>
 #include <tracker-sparql.h>
 
+/* What name generation needs to know about a selected file, copied out of
+ * the NautilusFile so that the names can be computed off the main thread. */
+typedef struct
+{
+    gchar *name;
+    gchar *display_name;
+    gchar *extension;
+    gboolean is_directory;
+} BatchRenameSource;
+
+BatchRenameSource* batch_rename_source_new             (NautilusFile                  *file);
+
+void batch_rename_source_free                          (gpointer                       mem);
+
 GList* batch_rename_dialog_get_new_names_list          (NautilusBatchRenameDialogMode  mode,
-                                                        GList                         *selection,
+                                                        GPtrArray                     *sources,
                                                         GList                         *tags_list,
                                                         GList                         *selection_metadata,
                                                         gchar                         *entry_text,
-                                                        gchar                         *replace_text);
+                                                        gchar                         *replace_text,
+                                                        GCancellable                  *cancellable);
 
 GList* file_names_list_has_duplicates                      (NautilusBatchRenameDialog   *dialog,
                                                             NautilusDirectory           *model,
@@ -52,19 +67,7 @@ void conflict_data_free                         (gpointer mem);
 
 GList* batch_rename_files_get_distinct_parents  (GList *selection);
 
-gboolean file_name_conflicts_with_results       (GList        *selection,
-                                                 GList        *new_names,
-                                                 GString      *old_name,
-                                                 gchar        *parent_uri);
-
 GString* batch_rename_replace_label_text        (gchar             *label,
                                                  const gchar       *substr);
 
-gchar*   batch_rename_get_tag_text_representation (TagConstants tag_constants);
-
-void batch_rename_sort_lists_for_rename (GList    **selection,
-                                         GList    **new_names,
-                                         GList    **old_names,
-                                         GList    **new_files,
-                                         GList    **old_files,
-                                         gboolean   is_undo_redo);
\ No newline at end of file
+gchar*   batch_rename_get_tag_text_representation (TagConstants tag_constants);
\ No newline at end of file
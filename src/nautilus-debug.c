@@ -53,6 +53,7 @@ static GDebugKey keys[] =
     { "Undo", NAUTILUS_DEBUG_UNDO },
     { "Thumbnails", NAUTILUS_DEBUG_THUMBNAILS },
     { "TagManager", NAUTILUS_DEBUG_TAG_MANAGER },
+    { "Extensions", NAUTILUS_DEBUG_EXTENSIONS },
     { 0, }
 };
 
@@ -22,6 +22,7 @@
 #include <libxml/parser.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define DEBUG_FLAG NAUTILUS_DEBUG_ASYNC_JOBS
 
@@ -46,6 +47,11 @@
 /* Keep async. jobs down to this number for all directories. */
 #define MAX_ASYNC_JOBS 10
 
+/* Deep counts are reused for this long, as changes deep inside a tree
+ * that no one monitors don't update the mtime of the counted directory. */
+#define DEEP_COUNT_CACHE_MAX_AGE (60 * G_USEC_PER_SEC)
+#define DEEP_COUNT_CACHE_MAX_ENTRIES 256
+
 struct ThumbnailState
 {
     NautilusDirectory *directory;
@@ -117,8 +123,25 @@ struct DeepCountState
     GList *deep_count_subdirectories;
     GArray *seen_deep_count_inodes;
     char *fs_id;
+    char *uri;
+    guint64 mtime;
+    /* Something below changed while counting, see deep_count_cache_store (). */
+    gboolean outdated;
+    /* Cached counts of a tree with hard links could be reused by counts
+     * which see the other links, and would count the linked files twice. */
+    gboolean has_hard_links;
 };
 
+typedef struct
+{
+    guint directory_count;
+    guint file_count;
+    guint unreadable_count;
+    goffset size;
+    guint64 mtime;
+    gint64 timestamp;
+} DeepCountCacheEntry;
+
 
 
 typedef struct
@@ -164,6 +187,12 @@ static GHashTable *waiting_directories;
 static GHashTable *async_jobs;
 #endif
 
+/* Finished deep counts of directories, shared by all files and
+ * directories of the process, keyed by uri. */
+static GHashTable *deep_count_cache;
+/* The deep counts in progress, to mark them outdated. */
+static GList *deep_count_states;
+
 /* Forward declarations for functions that need them. */
 static void     deep_count_load (DeepCountState *state,
                                  GFile          *location);
@@ -964,6 +993,9 @@ dequeue_pending_idle_callback (gpointer callback_data)
     nautilus_directory_ref (directory);
 
     nautilus_profile_start ("nitems %d", g_list_length (directory->details->pending_file_info));
+    nautilus_profile_span_begin ("directory", "file-info-batch");
+    nautilus_profile_counter ("pending-file-info",
+                              g_list_length (directory->details->pending_file_info));
 
     directory->details->dequeue_pending_idle_id = 0;
 
@@ -1110,6 +1142,7 @@ drain:
     /* Get the state machine running again. */
     nautilus_directory_async_state_changed (directory);
 
+    nautilus_profile_span_end ("directory", "file-info-batch");
     nautilus_profile_end (NULL);
 
     nautilus_directory_unref (directory);
@@ -1173,6 +1206,8 @@ directory_load_cancel (NautilusDirectory *directory)
         state->directory = NULL;
         directory->details->directory_load_in_progress = NULL;
         async_job_end (directory, "file list");
+
+        nautilus_profile_async_end ("directory", "load", state);
     }
 }
 
@@ -2117,6 +2152,18 @@ nautilus_directory_is_anyone_monitoring_file_list (NautilusDirectory *directory)
     return FALSE;
 }
 
+/* This checks if @client itself monitors the file list. */
+gboolean
+nautilus_directory_is_client_monitoring_file_list (NautilusDirectory *directory,
+                                                   gconstpointer      client)
+{
+    Monitor *monitor;
+
+    monitor = find_monitor (directory, NULL, client);
+
+    return monitor != NULL && REQUEST_WANTS_TYPE (monitor->request, REQUEST_FILE_LIST);
+}
+
 /* This checks if the file list being monitored. */
 gboolean
 nautilus_directory_is_file_list_monitored (NautilusDirectory *directory)
@@ -2304,6 +2351,7 @@ start_monitoring_file_list (NautilusDirectory *directory)
 
     directory->details->directory_load_in_progress = state;
 
+    nautilus_profile_async_begin ("directory", "load", state);
     g_file_enumerate_children_async (directory->details->location,
                                      NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
                                      0,     /* flags */
@@ -2786,6 +2834,181 @@ directory_count_start (NautilusDirectory *directory,
     g_object_unref (location);
 }
 
+static DeepCountCacheEntry *
+deep_count_cache_lookup (const char *uri,
+                         guint64     mtime)
+{
+    DeepCountCacheEntry *entry;
+
+    if (deep_count_cache == NULL || mtime == 0)
+    {
+        return NULL;
+    }
+
+    entry = g_hash_table_lookup (deep_count_cache, uri);
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+
+    if (entry->mtime != mtime ||
+        g_get_monotonic_time () - entry->timestamp > DEEP_COUNT_CACHE_MAX_AGE)
+    {
+        g_hash_table_remove (deep_count_cache, uri);
+        return NULL;
+    }
+
+    return entry;
+}
+
+/* Drops the expired entries, and the oldest ones while there are still
+ * too many to add another. */
+static void
+deep_count_cache_prune (gint64 now)
+{
+    GHashTableIter iter;
+    DeepCountCacheEntry *entry;
+    const char *oldest_uri;
+    gint64 oldest_timestamp;
+
+    g_hash_table_iter_init (&iter, deep_count_cache);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+        if (now - entry->timestamp > DEEP_COUNT_CACHE_MAX_AGE)
+        {
+            g_hash_table_iter_remove (&iter);
+        }
+    }
+
+    while (g_hash_table_size (deep_count_cache) >= DEEP_COUNT_CACHE_MAX_ENTRIES)
+    {
+        const char *uri;
+
+        oldest_uri = NULL;
+        oldest_timestamp = G_MAXINT64;
+
+        g_hash_table_iter_init (&iter, deep_count_cache);
+        while (g_hash_table_iter_next (&iter, (gpointer *) &uri, (gpointer *) &entry))
+        {
+            if (entry->timestamp < oldest_timestamp)
+            {
+                oldest_uri = uri;
+                oldest_timestamp = entry->timestamp;
+            }
+        }
+
+        g_hash_table_remove (deep_count_cache, oldest_uri);
+    }
+}
+
+static void
+deep_count_cache_store (DeepCountState *state,
+                        NautilusFile   *file)
+{
+    DeepCountCacheEntry *entry;
+    gint64 now;
+
+    /* Something below the counted directory changed while it was
+     * being counted, so the result may already be outdated. */
+    if (state->mtime == 0 || state->outdated || state->has_hard_links)
+    {
+        return;
+    }
+
+    if (deep_count_cache == NULL)
+    {
+        deep_count_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, g_free);
+    }
+
+    now = g_get_monotonic_time ();
+    if (!g_hash_table_contains (deep_count_cache, state->uri))
+    {
+        deep_count_cache_prune (now);
+    }
+
+    entry = g_new (DeepCountCacheEntry, 1);
+    entry->directory_count = file->details->deep_directory_count;
+    entry->file_count = file->details->deep_file_count;
+    entry->unreadable_count = file->details->deep_unreadable_count;
+    entry->size = file->details->deep_size;
+    entry->mtime = state->mtime;
+    entry->timestamp = now;
+
+    g_hash_table_insert (deep_count_cache, g_strdup (state->uri), entry);
+}
+
+static gboolean
+uri_is_in_directory (const char *uri,
+                     const char *directory_uri)
+{
+    size_t length = strlen (directory_uri);
+
+    return strncmp (uri, directory_uri, length) == 0 &&
+           (uri[length] == '\0' || uri[length] == '/' ||
+            (length > 0 && directory_uri[length - 1] == '/'));
+}
+
+void
+nautilus_directory_invalidate_deep_count_cache (GFile *location)
+{
+    g_autofree char *uri = NULL;
+
+    if (deep_count_states == NULL &&
+        (deep_count_cache == NULL || g_hash_table_size (deep_count_cache) == 0))
+    {
+        return;
+    }
+
+    uri = g_file_get_uri (location);
+
+    for (GList *l = deep_count_states; l != NULL; l = l->next)
+    {
+        DeepCountState *state = l->data;
+
+        if (uri_is_in_directory (uri, state->uri))
+        {
+            state->outdated = TRUE;
+        }
+    }
+
+    if (deep_count_cache == NULL || g_hash_table_size (deep_count_cache) == 0)
+    {
+        return;
+    }
+
+    /* The deep counts of all the ancestors include the location. Their uris
+     * are prefixes of this one, so cut it down instead of asking GIO for
+     * each parent.
+     */
+    while (TRUE)
+    {
+        char *separator;
+
+        g_hash_table_remove (deep_count_cache, uri);
+
+        separator = strrchr (uri, '/');
+        if (separator == NULL)
+        {
+            break;
+        }
+
+        if (separator > uri && separator[-1] == '/')
+        {
+            /* Only the root is left, e.g. file:/// */
+            if (separator[1] == '\0')
+            {
+                break;
+            }
+            separator[1] = '\0';
+        }
+        else
+        {
+            separator[0] = '\0';
+        }
+    }
+}
+
 static inline gboolean
 seen_inode (DeepCountState *state,
             GFileInfo      *info)
@@ -2843,6 +3066,12 @@ deep_count_one (DeepCountState *state,
         mark_inode_as_seen (state, info);
     }
 
+    if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY &&
+        g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_NLINK) > 1)
+    {
+        state->has_hard_links = TRUE;
+    }
+
     file = state->directory->details->deep_count_file;
 
     if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
@@ -2854,10 +3083,30 @@ deep_count_one (DeepCountState *state,
         fs_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
         if (g_strcmp0 (fs_id, state->fs_id) == 0)
         {
+            g_autofree char *uri = NULL;
+            DeepCountCacheEntry *entry;
+
             /* only if it is on the same filesystem */
             subdir = g_file_get_child (state->deep_count_location, g_file_info_get_name (info));
-            state->deep_count_subdirectories = g_list_prepend
-                                                   (state->deep_count_subdirectories, subdir);
+
+            /* Reuse the counts of a subdirectory that was already counted,
+             * e.g. for the properties of a selection of siblings. */
+            uri = g_file_get_uri (subdir);
+            entry = deep_count_cache_lookup (uri,
+                                             g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+            if (entry != NULL)
+            {
+                file->details->deep_directory_count += entry->directory_count;
+                file->details->deep_file_count += entry->file_count;
+                file->details->deep_unreadable_count += entry->unreadable_count;
+                file->details->deep_size += entry->size;
+                g_object_unref (subdir);
+            }
+            else
+            {
+                state->deep_count_subdirectories = g_list_prepend
+                                                       (state->deep_count_subdirectories, subdir);
+            }
         }
     }
     else
@@ -2876,6 +3125,8 @@ deep_count_one (DeepCountState *state,
 static void
 deep_count_state_free (DeepCountState *state)
 {
+    deep_count_states = g_list_remove (deep_count_states, state);
+
     if (state->enumerator)
     {
         if (!g_file_enumerator_is_closed (state->enumerator))
@@ -2893,6 +3144,7 @@ deep_count_state_free (DeepCountState *state)
     g_list_free_full (state->deep_count_subdirectories, g_object_unref);
     g_array_free (state->seen_deep_count_inodes, TRUE);
     g_free (state->fs_id);
+    g_free (state->uri);
     g_free (state);
 }
 
@@ -2924,6 +3176,7 @@ deep_count_next_dir (DeepCountState *state)
     else
     {
         file->details->deep_counts_status = NAUTILUS_REQUEST_DONE;
+        deep_count_cache_store (state, file);
         directory->details->deep_count_file = NULL;
         directory->details->deep_count_in_progress = NULL;
         deep_count_state_free (state);
@@ -3052,7 +3305,9 @@ deep_count_load (DeepCountState *state,
                                      G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN ","
                                      G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP ","
                                      G_FILE_ATTRIBUTE_ID_FILESYSTEM ","
-                                     G_FILE_ATTRIBUTE_UNIX_INODE,
+                                     G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                                     G_FILE_ATTRIBUTE_UNIX_INODE ","
+                                     G_FILE_ATTRIBUTE_UNIX_NLINK,
                                      G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,     /* flags */
                                      G_PRIORITY_LOW,     /* prio */
                                      state->cancellable,
@@ -3112,6 +3367,9 @@ deep_count_start (NautilusDirectory *directory,
 {
     GFile *location;
     DeepCountState *state;
+    DeepCountCacheEntry *entry;
+    g_autofree char *uri = NULL;
+    guint64 mtime;
 
     if (directory->details->deep_count_in_progress != NULL)
     {
@@ -3135,8 +3393,29 @@ deep_count_start (NautilusDirectory *directory,
         return;
     }
 
+    location = nautilus_file_get_location (file);
+    uri = g_file_get_uri (location);
+    mtime = nautilus_file_get_mtime (file);
+
+    entry = deep_count_cache_lookup (uri, mtime);
+    if (entry != NULL)
+    {
+        file->details->deep_directory_count = entry->directory_count;
+        file->details->deep_file_count = entry->file_count;
+        file->details->deep_unreadable_count = entry->unreadable_count;
+        file->details->deep_size = entry->size;
+        file->details->deep_counts_status = NAUTILUS_REQUEST_DONE;
+        g_object_unref (location);
+
+        nautilus_file_updated_deep_count_in_progress (file);
+        nautilus_file_changed (file);
+        nautilus_directory_async_state_changed (directory);
+        return;
+    }
+
     if (!async_job_start (directory, "deep count"))
     {
+        g_object_unref (location);
         return;
     }
 
@@ -3153,10 +3432,12 @@ deep_count_start (NautilusDirectory *directory,
     state->cancellable = g_cancellable_new ();
     state->seen_deep_count_inodes = g_array_new (FALSE, TRUE, sizeof (guint64));
     state->fs_id = NULL;
+    state->uri = g_steal_pointer (&uri);
+    state->mtime = mtime;
+    deep_count_states = g_list_prepend (deep_count_states, state);
 
     directory->details->deep_count_in_progress = state;
 
-    location = nautilus_file_get_location (file);
     g_file_query_info_async (location,
                              G_FILE_ATTRIBUTE_ID_FILESYSTEM,
                              G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
@@ -3603,11 +3884,7 @@ thumbnail_done (NautilusDirectory *directory,
     time_t thumb_mtime = 0;
 
     file->details->thumbnail_is_up_to_date = TRUE;
-    if (file->details->thumbnail)
-    {
-        g_object_unref (file->details->thumbnail);
-        file->details->thumbnail = NULL;
-    }
+    nautilus_file_clear_thumbnail (file);
 
     if (pixbuf)
     {
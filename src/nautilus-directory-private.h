@@ -163,8 +163,11 @@ void               nautilus_directory_get_info_for_new_files          (NautilusD
 								       GList                     *vfs_uris);
 NautilusFile *     nautilus_directory_get_existing_corresponding_file (NautilusDirectory         *directory);
 void               nautilus_directory_invalidate_count_and_mime_list  (NautilusDirectory         *directory);
+void               nautilus_directory_invalidate_deep_count_cache     (GFile                     *location);
 gboolean           nautilus_directory_is_file_list_monitored          (NautilusDirectory         *directory);
 gboolean           nautilus_directory_is_anyone_monitoring_file_list  (NautilusDirectory         *directory);
+gboolean           nautilus_directory_is_client_monitoring_file_list  (NautilusDirectory         *directory,
+								       gconstpointer              client);
 gboolean           nautilus_directory_has_active_request_for_file     (NautilusDirectory         *directory,
 								       NautilusFile              *file);
 void               nautilus_directory_remove_file_monitor_link        (NautilusDirectory         *directory,
@@ -62,6 +62,28 @@ static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 
 static GHashTable *directories;
 
+/* Directories whose last view went away are kept loaded and monitored for a
+ * while, so that going back to them doesn't enumerate everything again. The
+ * cache is bounded by a rough estimate of the memory held by their files,
+ * by the number of file system monitors it keeps, and by time.
+ */
+#define WARM_CACHE_MAX_BYTES (128 * 1024 * 1024)
+#define WARM_CACHE_BYTES_PER_FILE 1024
+#define WARM_CACHE_MAX_DIRECTORIES 32
+#define WARM_CACHE_MAX_AGE_SECONDS (5 * 60)
+
+typedef struct
+{
+    NautilusDirectory *directory;
+    gsize cost;
+    gint64 added_time;
+} WarmCacheEntry;
+
+/* Most recently released first. */
+static GQueue warm_cache = G_QUEUE_INIT;
+static gsize warm_cache_cost;
+static guint warm_cache_timeout_id;
+
 static NautilusDirectory *nautilus_directory_new (GFile *location);
 static void               set_directory_location (NautilusDirectory *directory,
                                                   GFile             *location);
@@ -1243,6 +1265,8 @@ nautilus_directory_notify_files_added (GList *files)
     {
         location = p->data;
 
+        nautilus_directory_invalidate_deep_count_cache (location);
+
         /* See if the directory is already known. */
         directory = get_parent_directory_if_exists (location);
         if (directory == NULL)
@@ -1332,6 +1356,8 @@ nautilus_directory_notify_files_changed (GList *files)
     {
         location = node->data;
 
+        nautilus_directory_invalidate_deep_count_cache (location);
+
         /* Find the file. */
         file = nautilus_file_get_existing (location);
         if (file != NULL)
@@ -1389,6 +1415,8 @@ nautilus_directory_notify_files_removed (GList *files)
 
         location = p->data;
 
+        nautilus_directory_invalidate_deep_count_cache (location);
+
         /* Update file count for parent directory if anyone might care. */
         directory = get_parent_directory_if_exists (location);
         if (directory != NULL)
@@ -1611,6 +1639,9 @@ nautilus_directory_notify_files_moved (GList *file_pairs)
         from_location = pair->from;
         to_location = pair->to;
 
+        nautilus_directory_invalidate_deep_count_cache (from_location);
+        nautilus_directory_invalidate_deep_count_cache (to_location);
+
         /* Handle overwriting a file. */
         file = nautilus_file_get_existing (to_location);
         if (file != NULL)
@@ -1778,6 +1809,149 @@ nautilus_directory_cancel_callback (NautilusDirectory         *directory,
         (directory, callback, callback_data);
 }
 
+static GList *
+warm_cache_find (NautilusDirectory *directory)
+{
+    for (GList *l = warm_cache.head; l != NULL; l = l->next)
+    {
+        WarmCacheEntry *entry = l->data;
+
+        if (entry->directory == directory)
+        {
+            return l;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+warm_cache_release (GList *link)
+{
+    WarmCacheEntry *entry = link->data;
+
+    g_queue_delete_link (&warm_cache, link);
+    warm_cache_cost -= entry->cost;
+
+    NAUTILUS_DIRECTORY_CLASS (G_OBJECT_GET_CLASS (entry->directory))->file_monitor_remove
+        (entry->directory, &warm_cache);
+    nautilus_directory_unref (entry->directory);
+    g_free (entry);
+}
+
+static void warm_cache_schedule_expiry (void);
+
+static gboolean
+warm_cache_expire (gpointer user_data)
+{
+    gint64 now = g_get_monotonic_time ();
+
+    warm_cache_timeout_id = 0;
+
+    while (warm_cache.tail != NULL &&
+           now - ((WarmCacheEntry *) warm_cache.tail->data)->added_time >=
+           WARM_CACHE_MAX_AGE_SECONDS * G_USEC_PER_SEC)
+    {
+        warm_cache_release (warm_cache.tail);
+    }
+
+    warm_cache_schedule_expiry ();
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Wakes up when the oldest entry expires. */
+static void
+warm_cache_schedule_expiry (void)
+{
+    WarmCacheEntry *oldest;
+    gint64 age;
+
+    if (warm_cache_timeout_id != 0 || warm_cache.tail == NULL)
+    {
+        return;
+    }
+
+    oldest = warm_cache.tail->data;
+    age = (g_get_monotonic_time () - oldest->added_time) / G_USEC_PER_SEC;
+    warm_cache_timeout_id = g_timeout_add_seconds (MAX (WARM_CACHE_MAX_AGE_SECONDS - age, 1),
+                                                   warm_cache_expire, NULL);
+}
+
+/* Called right before @client stops monitoring @directory. If it is the last
+ * one, take over its place so the file list, the files and the file system
+ * monitor stay alive and up to date.
+ */
+static void
+warm_cache_add (NautilusDirectory *directory,
+                gconstpointer      client)
+{
+    WarmCacheEntry *entry;
+    gsize cost;
+
+    /* Without a working file system monitor the cached file list could
+     * silently go stale, so only keep local directories. */
+    if (!NAUTILUS_IS_VFS_DIRECTORY (directory) ||
+        !directory->details->directory_loaded ||
+        directory->details->monitor == NULL ||
+        directory->details->monitor_counters[REQUEST_FILE_LIST] != 1 ||
+        !nautilus_directory_is_client_monitoring_file_list (directory, client) ||
+        !nautilus_directory_is_local_or_fuse (directory) ||
+        warm_cache_find (directory) != NULL)
+    {
+        return;
+    }
+
+    cost = (g_hash_table_size (directory->details->file_hash) + 1) * WARM_CACHE_BYTES_PER_FILE;
+    if (cost > WARM_CACHE_MAX_BYTES)
+    {
+        return;
+    }
+
+    NAUTILUS_DIRECTORY_CLASS (G_OBJECT_GET_CLASS (directory))->file_monitor_add
+        (directory, &warm_cache, TRUE, 0, NULL, NULL);
+
+    entry = g_new (WarmCacheEntry, 1);
+    entry->directory = nautilus_directory_ref (directory);
+    entry->cost = cost;
+    entry->added_time = g_get_monotonic_time ();
+    g_queue_push_head (&warm_cache, entry);
+    warm_cache_cost += cost;
+
+    while (warm_cache_cost > WARM_CACHE_MAX_BYTES ||
+           warm_cache.length > WARM_CACHE_MAX_DIRECTORIES)
+    {
+        warm_cache_release (warm_cache.tail);
+    }
+
+    warm_cache_schedule_expiry ();
+}
+
+/* Called right after a client started monitoring @directory again. */
+static void
+warm_cache_take (NautilusDirectory *directory)
+{
+    GList *link;
+    NautilusFile *file;
+
+    link = warm_cache_find (directory);
+    if (link == NULL)
+    {
+        return;
+    }
+
+    warm_cache_release (link);
+
+    /* The monitor only reports changes to the children, so check that the
+     * directory itself didn't go away meanwhile. */
+    file = nautilus_directory_get_existing_corresponding_file (directory);
+    if (file != NULL && nautilus_file_is_gone (file))
+    {
+        nautilus_directory_force_reload (directory);
+    }
+    nautilus_file_unref (file);
+}
+
 void
 nautilus_directory_file_monitor_add (NautilusDirectory         *directory,
                                      gconstpointer              client,
@@ -1794,6 +1968,8 @@ nautilus_directory_file_monitor_add (NautilusDirectory         *directory,
         monitor_hidden_files,
         file_attributes,
         callback, callback_data);
+
+    warm_cache_take (directory);
 }
 
 void
@@ -1803,6 +1979,8 @@ nautilus_directory_file_monitor_remove (NautilusDirectory *directory,
     g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
     g_return_if_fail (client != NULL);
 
+    warm_cache_add (directory, client);
+
     NAUTILUS_DIRECTORY_CLASS (G_OBJECT_GET_CLASS (directory))->file_monitor_remove
         (directory, client);
 }
@@ -21,6 +21,7 @@
 #include "nautilus-file-changes-queue.h"
 
 #include "nautilus-directory-notify.h"
+#include "nautilus-search-index.h"
 #include "nautilus-tag-manager.h"
 
 typedef enum
@@ -298,6 +299,12 @@ nautilus_file_changes_consume_changes (gboolean consume_all)
             return;
         }
 
+        nautilus_search_index_invalidate (change->from);
+        if (change->to != NULL)
+        {
+            nautilus_search_index_invalidate (change->to);
+        }
+
         /* add the new change to the list */
         switch (change->kind)
         {
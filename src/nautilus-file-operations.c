@@ -29,7 +29,11 @@
 #include <locale.h>
 #include <math.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
 #include <stdlib.h>
 
 #include "nautilus-file-operations.h"
@@ -38,6 +42,7 @@
 #include "nautilus-lib-self-check-functions.h"
 
 #include "nautilus-progress-info.h"
+#include "nautilus-progress-info-manager.h"
 
 #include <eel/eel-glib-extensions.h>
 #include <eel/eel-vfs-extensions.h>
@@ -60,6 +65,7 @@
 #include "nautilus-file-utilities.h"
 #include "nautilus-file-undo-operations.h"
 #include "nautilus-file-undo-manager.h"
+#include "nautilus-profile.h"
 #include "nautilus-ui-utilities.h"
 
 #ifdef GDK_WINDOWING_X11
@@ -72,7 +78,10 @@
 
 typedef struct
 {
+    /* Jobs may run several workers, so the timer is only accessed through
+     * job_timer_*(), under time_mutex. */
     GTimer *time;
+    GMutex time_mutex;
     GtkWindow *parent_window;
     NautilusFileOperationsDBusData *dbus_data;
     guint inhibit_cookie;
@@ -96,6 +105,10 @@ typedef struct
     GFile *destination;
     GFile *fake_display_source;
     GHashTable *debuting_files;
+    /* Destination directory -> set of the names known to exist there, or
+     * %NULL if it couldn't be listed, see get_destination_names (). */
+    GHashTable *destination_names;
+    guint n_duplicates;
     gchar *target_name;
     NautilusCopyCallback done_callback;
     gpointer done_callback_data;
@@ -154,8 +167,25 @@ typedef struct
     guint32 file_mask;
     guint32 dir_permissions;
     guint32 dir_mask;
+
+    /* Directories are processed by several workers, see
+     * SET_PERMISSIONS_MAX_WORKERS. Protects the fields below. */
+    GMutex mutex;
+    GCond cond;
+    GQueue pending_dirs;
+    guint n_queued_fds;
+    guint n_busy_workers;
+    guint n_changed;
 } SetPermissionsJob;
 
+/* A local directory is queued with an fd opened relative to its parent,
+ * so that nothing is ever resolved by path again; otherwise fd is -1. */
+typedef struct
+{
+    GFile *location;
+    int fd;
+} SetPermissionsDir;
+
 typedef enum
 {
     OP_KIND_COPY,
@@ -203,20 +233,38 @@ typedef struct
     CommonJob common;
     GList *source_files;
     GFile *destination_directory;
-    GList *output_files;
-    gboolean destination_decided;
-    gboolean extraction_failed;
 
-    gdouble base_progress;
+    /* Archives are extracted by several workers, see EXTRACT_MAX_WORKERS. */
+    GArray *archives;
+    gint next_archive;
 
-    guint64 archive_compressed_size;
+    /* Protects the fields below, which are shared by the workers. */
+    GMutex mutex;
+    GList *output_files;
     guint64 total_compressed_size;
+    guint64 completed_size;
     gint total_files;
+    gint n_extracted;
+
+    /* Only one worker at a time may ask the user something, so that the
+     * answer to “Skip All” applies to the other archives too.
+     */
+    GMutex dialog_mutex;
 
     NautilusExtractCallback done_callback;
     gpointer done_callback_data;
 } ExtractJob;
 
+typedef struct
+{
+    ExtractJob *job;
+    GFile *source_file;
+    GFile *output_file;
+    guint64 compressed_size;
+    guint64 completed_size;
+    gboolean failed;
+} ExtractArchive;
+
 typedef struct
 {
     CommonJob common;
@@ -251,7 +299,16 @@ G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (SourceInfo, source_info_clear)
 #define SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE 8
 #define NSEC_PER_MICROSEC 1000
 #define PROGRESS_NOTIFY_INTERVAL 100 * NSEC_PER_MICROSEC
+#define EXTRACT_MAX_WORKERS 4
+#define SET_PERMISSIONS_MAX_WORKERS 8
+#define SET_PERMISSIONS_POLL_INTERVAL (100 * G_TIME_SPAN_MILLISECOND)
+/* Beyond this many queued directory fds, subdirectories are processed right
+ * away by the worker that found them instead. */
+#define SET_PERMISSIONS_MAX_QUEUED_FDS 256
 #define LONG_JOB_THRESHOLD_IN_SECONDS 2
+/* Below this many duplicates, probing the names on disk is cheaper than
+ * listing the destination. */
+#define DESTINATION_NAMES_MIN_DUPLICATES 8
 
 #define MAXIMUM_DISPLAYED_FILE_NAME_LENGTH 50
 
@@ -1095,6 +1152,7 @@ init_common (gsize                           job_size,
     common->progress = nautilus_progress_info_new ();
     common->cancellable = nautilus_progress_info_get_cancellable (common->progress);
     common->time = g_timer_new ();
+    g_mutex_init (&common->time_mutex);
     common->inhibit_cookie = 0;
 
     return common;
@@ -1103,6 +1161,7 @@ init_common (gsize                           job_size,
 static void
 finalize_common (CommonJob *common)
 {
+    nautilus_progress_info_manager_release_device (common->progress);
     nautilus_progress_info_finish (common->progress);
 
     if (common->inhibit_cookie != 0)
@@ -1113,6 +1172,7 @@ finalize_common (CommonJob *common)
 
     common->inhibit_cookie = 0;
     g_timer_destroy (common->time);
+    g_mutex_clear (&common->time_mutex);
 
     if (common->parent_window)
     {
@@ -1145,6 +1205,42 @@ finalize_common (CommonJob *common)
     g_free (common);
 }
 
+static void
+job_timer_start (CommonJob *job)
+{
+    g_mutex_lock (&job->time_mutex);
+    g_timer_start (job->time);
+    g_mutex_unlock (&job->time_mutex);
+}
+
+static void
+job_timer_stop (CommonJob *job)
+{
+    g_mutex_lock (&job->time_mutex);
+    g_timer_stop (job->time);
+    g_mutex_unlock (&job->time_mutex);
+}
+
+static void
+job_timer_continue (CommonJob *job)
+{
+    g_mutex_lock (&job->time_mutex);
+    g_timer_continue (job->time);
+    g_mutex_unlock (&job->time_mutex);
+}
+
+static gdouble
+job_timer_elapsed (CommonJob *job)
+{
+    gdouble elapsed;
+
+    g_mutex_lock (&job->time_mutex);
+    elapsed = g_timer_elapsed (job->time, NULL);
+    g_mutex_unlock (&job->time_mutex);
+
+    return elapsed;
+}
+
 static void
 skip_file (CommonJob *common,
            GFile     *file)
@@ -1454,7 +1550,7 @@ run_simple_dialog_va (CommonJob      *job,
     const char *button_title;
     GPtrArray *ptr_array;
 
-    g_timer_stop (job->time);
+    job_timer_stop (job);
 
     data = g_new0 (RunSimpleDialogData, 1);
     data->parent_window = &job->parent_window;
@@ -1502,7 +1598,7 @@ run_simple_dialog_va (CommonJob      *job,
     g_free (data->button_titles);
     g_free (data);
 
-    g_timer_continue (job->time);
+    job_timer_continue (job);
 
     g_free (primary_text);
     g_free (secondary_text);
@@ -1844,7 +1940,7 @@ report_delete_progress (CommonJob    *job,
                                                              source_info->num_files));
     }
 
-    elapsed = g_timer_elapsed (job->time, NULL);
+    elapsed = job_timer_elapsed (job);
     transfer_rate = 0;
     remaining_time = INT_MAX;
     if (elapsed > 0)
@@ -2127,7 +2223,8 @@ delete_files (CommonJob *job,
         return;
     }
 
-    g_timer_start (job->time);
+    job_timer_start (job);
+    nautilus_profile_span_begin ("file-operation", "delete");
 
     memset (&transfer_info, 0, sizeof (transfer_info));
     report_delete_progress (job, &source_info, &transfer_info);
@@ -2159,6 +2256,8 @@ delete_files (CommonJob *job,
             (*files_skipped)++;
         }
     }
+
+    nautilus_profile_span_end ("file-operation", "delete");
 }
 
 #pragma GCC diagnostic push
@@ -2235,7 +2334,7 @@ report_trash_progress (CommonJob    *job,
     }
 
 
-    elapsed = g_timer_elapsed (job->time, NULL);
+    elapsed = job_timer_elapsed (job);
     transfer_rate = 0;
     remaining_time = INT_MAX;
     if (elapsed > 0)
@@ -2324,6 +2423,216 @@ report_trash_progress (CommonJob    *job,
 }
 #pragma GCC diagnostic pop
 
+/* Trashing into the home trash without going through g_file_trash () for
+ * every file. For a large selection on the home file system GIO spends most
+ * of its time working out again and again which trash directory to use;
+ * here that is decided once per parent directory, and each file only costs
+ * the info file write and the rename.
+ * Anything that doesn't fit, or fails, goes through trash_file () instead.
+ */
+typedef struct
+{
+    gchar *files_directory;
+    gchar *info_directory;
+    gchar *trash_directory;
+    dev_t device;
+
+    /* Parent directory -> whether it is on the same device as the trash. */
+    GHashTable *parents;
+} TrashBatch;
+
+static void
+trash_batch_free (TrashBatch *batch)
+{
+    g_free (batch->files_directory);
+    g_free (batch->info_directory);
+    g_free (batch->trash_directory);
+    g_hash_table_destroy (batch->parents);
+    g_free (batch);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (TrashBatch, trash_batch_free)
+
+static TrashBatch *
+trash_batch_new (void)
+{
+    g_autoptr (TrashBatch) batch = NULL;
+    GStatBuf trash_stat;
+
+    batch = g_new0 (TrashBatch, 1);
+    batch->trash_directory = g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+    batch->files_directory = g_build_filename (batch->trash_directory, "files", NULL);
+    batch->info_directory = g_build_filename (batch->trash_directory, "info", NULL);
+    batch->parents = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                            g_object_unref, NULL);
+
+    if (g_mkdir_with_parents (batch->files_directory, 0700) != 0 ||
+        g_mkdir_with_parents (batch->info_directory, 0700) != 0 ||
+        g_stat (batch->trash_directory, &trash_stat) != 0)
+    {
+        return NULL;
+    }
+    batch->device = trash_stat.st_dev;
+
+    return g_steal_pointer (&batch);
+}
+
+static gboolean
+trash_batch_handles_file (TrashBatch *batch,
+                          GFile      *file)
+{
+    g_autoptr (GFile) parent = NULL;
+    const char *path;
+    gpointer same_device;
+
+    path = g_file_peek_path (file);
+    if (path == NULL)
+    {
+        return FALSE;
+    }
+
+    /* Files in the trash itself, but not siblings like "Trash-backup". */
+    if (g_str_has_prefix (path, batch->trash_directory) &&
+        (path[strlen (batch->trash_directory)] == '\0' ||
+         path[strlen (batch->trash_directory)] == G_DIR_SEPARATOR))
+    {
+        return FALSE;
+    }
+
+    parent = g_file_get_parent (file);
+    if (parent == NULL)
+    {
+        return FALSE;
+    }
+
+    if (!g_hash_table_lookup_extended (batch->parents, parent, NULL, &same_device))
+    {
+        GStatBuf parent_stat;
+
+        same_device = GINT_TO_POINTER (g_stat (g_file_peek_path (parent), &parent_stat) == 0 &&
+                                       parent_stat.st_dev == batch->device);
+        g_hash_table_insert (batch->parents, g_object_ref (parent), same_device);
+    }
+
+    return GPOINTER_TO_INT (same_device);
+}
+
+static gboolean
+write_all (int         fd,
+           const char *data,
+           gsize       length)
+{
+    while (length > 0)
+    {
+        gssize written;
+
+        written = write (fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return FALSE;
+        }
+
+        data += written;
+        length -= written;
+    }
+
+    return TRUE;
+}
+
+/* Follows the freedesktop.org trash specification: the info file is created
+ * exclusively first, which reserves the name, then the file is moved.
+ */
+static gboolean
+trash_batch_trash_file (TrashBatch *batch,
+                        GFile      *file)
+{
+    const char *path;
+    g_autofree char *basename = NULL;
+    g_autofree char *escaped_path = NULL;
+    g_autofree char *info_data = NULL;
+    g_autofree char *info_path = NULL;
+    g_autofree char *trashed_path = NULL;
+    g_autofree char *deletion_date = NULL;
+    g_autoptr (GDateTime) now = NULL;
+    int fd = -1;
+    gboolean written;
+
+    path = g_file_peek_path (file);
+    basename = g_path_get_basename (path);
+
+    for (guint i = 1; fd < 0 && i < 1000; i++)
+    {
+        g_autofree char *trash_name = NULL;
+        g_autofree char *info_name = NULL;
+        GStatBuf trashed_stat;
+
+        g_clear_pointer (&info_path, g_free);
+        g_clear_pointer (&trashed_path, g_free);
+
+        trash_name = i == 1 ? g_strdup (basename) : g_strdup_printf ("%s.%u", basename, i);
+        info_name = g_strconcat (trash_name, ".trashinfo", NULL);
+        info_path = g_build_filename (batch->info_directory, info_name, NULL);
+        trashed_path = g_build_filename (batch->files_directory, trash_name, NULL);
+
+        /* Never replace a leftover from an earlier, interrupted trashing. */
+        if (g_lstat (trashed_path, &trashed_stat) == 0)
+        {
+            continue;
+        }
+
+        fd = g_open (info_path, O_CREAT | O_EXCL | O_WRONLY, 0600);
+        if (fd < 0 && errno != EEXIST)
+        {
+            return FALSE;
+        }
+    }
+
+    if (fd < 0)
+    {
+        return FALSE;
+    }
+
+    /* Undo looks for trashed files by the time they were trashed, so the
+     * date has to be the one of this file, not of the start of the batch.
+     */
+    now = g_date_time_new_now_local ();
+    deletion_date = g_date_time_format (now, "%Y-%m-%dT%H:%M:%S");
+    escaped_path = g_uri_escape_string (path, "/", FALSE);
+    info_data = g_strdup_printf ("[Trash Info]\nPath=%s\nDeletionDate=%s\n",
+                                 escaped_path, deletion_date);
+    written = write_all (fd, info_data, strlen (info_data));
+
+    if (!g_close (fd, NULL) || !written ||
+        g_rename (path, trashed_path) != 0)
+    {
+        g_unlink (info_path);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+report_file_trashed (CommonJob    *job,
+                     GFile        *file,
+                     SourceInfo   *source_info,
+                     TransferInfo *transfer_info)
+{
+    transfer_info->num_files++;
+    nautilus_file_changes_queue_file_removed (file);
+
+    if (job->undo_info != NULL)
+    {
+        nautilus_file_undo_info_trash_add_file (NAUTILUS_FILE_UNDO_INFO_TRASH (job->undo_info), file);
+    }
+
+    report_trash_progress (job, source_info, transfer_info);
+}
+
 static void
 trash_file (CommonJob     *job,
             GFile         *file,
@@ -2348,15 +2657,7 @@ trash_file (CommonJob     *job,
 
     if (g_file_trash (file, job->cancellable, &error))
     {
-        transfer_info->num_files++;
-        nautilus_file_changes_queue_file_removed (file);
-
-        if (job->undo_info != NULL)
-        {
-            nautilus_file_undo_info_trash_add_file (NAUTILUS_FILE_UNDO_INFO_TRASH (job->undo_info), file);
-        }
-
-        report_trash_progress (job, source_info, transfer_info);
+        report_file_trashed (job, file, source_info, transfer_info);
         return;
     }
 
@@ -2500,6 +2801,7 @@ trash_files (CommonJob *job,
     g_auto (SourceInfo) source_info = SOURCE_INFO_INIT;
     TransferInfo transfer_info;
     gboolean skipped_file;
+    g_autoptr (TrashBatch) batch = NULL;
 
     if (job_aborted (job))
     {
@@ -2515,11 +2817,14 @@ trash_files (CommonJob *job,
         return;
     }
 
-    g_timer_start (job->time);
+    job_timer_start (job);
+    nautilus_profile_span_begin ("file-operation", "trash");
 
     memset (&transfer_info, 0, sizeof (transfer_info));
     report_trash_progress (job, &source_info, &transfer_info);
 
+    batch = trash_batch_new ();
+
     to_delete = NULL;
     for (l = files;
          l != NULL && !job_aborted (job);
@@ -2527,6 +2832,15 @@ trash_files (CommonJob *job,
     {
         file = l->data;
 
+        if (batch != NULL &&
+            !should_skip_file (job, file) &&
+            trash_batch_handles_file (batch, file) &&
+            trash_batch_trash_file (batch, file))
+        {
+            report_file_trashed (job, file, &source_info, &transfer_info);
+            continue;
+        }
+
         skipped_file = FALSE;
         trash_file (job, file,
                     &skipped_file,
@@ -2540,6 +2854,8 @@ trash_files (CommonJob *job,
         }
     }
 
+    nautilus_profile_span_end ("file-operation", "trash");
+
     if (to_delete)
     {
         to_delete = g_list_reverse (to_delete);
@@ -3699,6 +4015,7 @@ scan_sources (GList      *files,
                                                             (GDestroyNotify) g_object_unref,
                                                             (GDestroyNotify) g_free);
 
+    nautilus_profile_span_begin ("file-operation", "scan-sources");
     report_preparing_count_progress (job, source_info);
 
     for (l = files; l != NULL && !job_aborted (job); l = l->next)
@@ -3712,6 +4029,7 @@ scan_sources (GList      *files,
 
     /* Make sure we report the final count */
     report_preparing_count_progress (job, source_info);
+    nautilus_profile_span_end ("file-operation", "scan-sources");
 }
 
 static void
@@ -3936,6 +4254,138 @@ retry:
     g_object_unref (fsinfo);
 }
 
+/* Formats the details of copy and move jobs from the numbers published by
+ * report_copy_progress (). Runs in the main loop.
+ */
+static char *
+format_transfer_details (NautilusProgressInfo *info)
+{
+    gint files_done;
+    gint files_total;
+    gint files_left;
+    goffset bytes_done;
+    goffset bytes_total;
+    goffset transfer_rate;
+    int remaining_time;
+    char *details;
+
+    nautilus_progress_info_get_transfer (info,
+                                         &files_done, &files_total,
+                                         &bytes_done, &bytes_total,
+                                         &transfer_rate);
+    files_left = files_total - files_done;
+
+    if (transfer_rate == 0)
+    {
+        if (files_total == 1)
+        {
+            g_autofree gchar *formatted_size_bytes_done = NULL;
+            g_autofree gchar *formatted_size_bytes_total = NULL;
+
+            formatted_size_bytes_done = g_format_size (bytes_done);
+            formatted_size_bytes_total = g_format_size (bytes_total);
+            /* To translators: %s will expand to a size like "2 bytes" or "3 MB", so something like "4 kb / 4 MB" */
+            details = g_strdup_printf (_("%s / %s"),
+                                       formatted_size_bytes_done,
+                                       formatted_size_bytes_total);
+        }
+        else
+        {
+            if (files_left > 0)
+            {
+                /* To translators: %'d is the number of files completed for the operation,
+                 * so it will be something like 2/14. */
+                details = g_strdup_printf (_("%'d / %'d"),
+                                           files_done + 1,
+                                           files_total);
+            }
+            else
+            {
+                /* To translators: %'d is the number of files completed for the operation,
+                 * so it will be something like 2/14. */
+                details = g_strdup_printf (_("%'d / %'d"),
+                                           files_done,
+                                           files_total);
+            }
+        }
+    }
+    else
+    {
+        remaining_time = (bytes_total - bytes_done) / transfer_rate;
+
+        if (files_total == 1)
+        {
+            if (files_left > 0)
+            {
+                g_autofree gchar *formatted_time = NULL;
+                g_autofree gchar *formatted_size_bytes_done = NULL;
+                g_autofree gchar *formatted_size_bytes_total = NULL;
+                g_autofree gchar *formatted_size_transfer_rate = NULL;
+
+                formatted_time = get_formatted_time (remaining_time);
+                formatted_size_bytes_done = g_format_size (bytes_done);
+                formatted_size_bytes_total = g_format_size (bytes_total);
+                formatted_size_transfer_rate = g_format_size (transfer_rate);
+                /* To translators: %s will expand to a size like "2 bytes" or "3 MB", %s to a time duration like
+                 * "2 minutes". So the whole thing will be something like "2 kb / 4 MB -- 2 hours left (4kb/sec)"
+                 *
+                 * The singular/plural form will be used depending on the remaining time (i.e. the %s argument).
+                 */
+                details = g_strdup_printf (ngettext ("%s / %s \xE2\x80\x94 %s left (%s/sec)",
+                                                     "%s / %s \xE2\x80\x94 %s left (%s/sec)",
+                                                     seconds_count_format_time_units (remaining_time)),
+                                           formatted_size_bytes_done,
+                                           formatted_size_bytes_total,
+                                           formatted_time,
+                                           formatted_size_transfer_rate);
+            }
+            else
+            {
+                g_autofree gchar *formatted_size_bytes_done = NULL;
+                g_autofree gchar *formatted_size_bytes_total = NULL;
+
+                formatted_size_bytes_done = g_format_size (bytes_done);
+                formatted_size_bytes_total = g_format_size (bytes_total);
+                /* To translators: %s will expand to a size like "2 bytes" or "3 MB". */
+                details = g_strdup_printf (_("%s / %s"),
+                                           formatted_size_bytes_done,
+                                           formatted_size_bytes_total);
+            }
+        }
+        else
+        {
+            if (files_left > 0)
+            {
+                g_autofree gchar *formatted_time = NULL;
+                g_autofree gchar *formatted_size = NULL;
+                formatted_time = get_formatted_time (remaining_time);
+                formatted_size = g_format_size (transfer_rate);
+                /* To translators: %s will expand to a time duration like "2 minutes".
+                 * So the whole thing will be something like "1 / 5 -- 2 hours left (4kb/sec)"
+                 *
+                 * The singular/plural form will be used depending on the remaining time (i.e. the %s argument).
+                 */
+                details = g_strdup_printf (ngettext ("%'d / %'d \xE2\x80\x94 %s left (%s/sec)",
+                                                     "%'d / %'d \xE2\x80\x94 %s left (%s/sec)",
+                                                     seconds_count_format_time_units (remaining_time)),
+                                           files_done + 1, files_total,
+                                           formatted_time,
+                                           formatted_size);
+            }
+            else
+            {
+                /* To translators: %'d is the number of files completed for the operation,
+                 * so it will be something like 2/14. */
+                details = g_strdup_printf (_("%'d / %'d"),
+                                           files_done,
+                                           files_total);
+            }
+        }
+    }
+
+    return details;
+}
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat-nonliteral"
 static void
@@ -3951,7 +4401,6 @@ report_copy_progress (CopyMoveJob  *copy_job,
     CommonJob *job;
     gboolean is_move;
     gchar *status;
-    char *details;
     gchar *tmp;
 
     job = (CommonJob *) copy_job;
@@ -4146,7 +4595,7 @@ report_copy_progress (CopyMoveJob  *copy_job,
 
     total_size = MAX (source_info->num_bytes, transfer_info->num_bytes);
 
-    elapsed = g_timer_elapsed (job->time, NULL);
+    elapsed = job_timer_elapsed (job);
     transfer_rate = 0;
     remaining_time = INT_MAX;
     if (elapsed > 0)
@@ -4158,122 +4607,24 @@ report_copy_progress (CopyMoveJob  *copy_job,
         }
     }
 
-    if (elapsed < SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE ||
-        transfer_rate == 0 ||
-        !transfer_info->partial_progress)
+    /* Only the numbers are published here, the details are formatted by
+     * format_transfer_details () when the UI refreshes. */
+    nautilus_progress_info_set_details_func (job->progress, format_transfer_details);
+    nautilus_progress_info_set_transfer (job->progress,
+                                         transfer_info->num_files,
+                                         source_info->num_files,
+                                         transfer_info->num_bytes,
+                                         total_size,
+                                         (elapsed < SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE ||
+                                          !transfer_info->partial_progress) ? 0 : (goffset) transfer_rate);
+
+    if (elapsed > SECONDS_NEEDED_FOR_APROXIMATE_TRANSFER_RATE)
     {
-        if (source_info->num_files == 1)
-        {
-            g_autofree gchar *formatted_size_num_bytes = NULL;
-            g_autofree gchar *formatted_size_total_size = NULL;
-
-            formatted_size_num_bytes = g_format_size (transfer_info->num_bytes);
-            formatted_size_total_size = g_format_size (total_size);
-            /* To translators: %s will expand to a size like "2 bytes" or "3 MB", so something like "4 kb / 4 MB" */
-            details = g_strdup_printf (_("%s / %s"),
-                                       formatted_size_num_bytes,
-                                       formatted_size_total_size);
-        }
-        else
-        {
-            if (files_left > 0)
-            {
-                /* To translators: %'d is the number of files completed for the operation,
-                 * so it will be something like 2/14. */
-                details = g_strdup_printf (_("%'d / %'d"),
-                                           transfer_info->num_files + 1,
-                                           source_info->num_files);
-            }
-            else
-            {
-                /* To translators: %'d is the number of files completed for the operation,
-                 * so it will be something like 2/14. */
-                details = g_strdup_printf (_("%'d / %'d"),
-                                           transfer_info->num_files,
-                                           source_info->num_files);
-            }
-        }
-    }
-    else
-    {
-        if (source_info->num_files == 1)
-        {
-            if (files_left > 0)
-            {
-                g_autofree gchar *formatted_time = NULL;
-                g_autofree gchar *formatted_size_num_bytes = NULL;
-                g_autofree gchar *formatted_size_total_size = NULL;
-                g_autofree gchar *formatted_size_transfer_rate = NULL;
-
-                formatted_time = get_formatted_time (remaining_time);
-                formatted_size_num_bytes = g_format_size (transfer_info->num_bytes);
-                formatted_size_total_size = g_format_size (total_size);
-                formatted_size_transfer_rate = g_format_size ((goffset) transfer_rate);
-                /* To translators: %s will expand to a size like "2 bytes" or "3 MB", %s to a time duration like
-                 * "2 minutes". So the whole thing will be something like "2 kb / 4 MB -- 2 hours left (4kb/sec)"
-                 *
-                 * The singular/plural form will be used depending on the remaining time (i.e. the %s argument).
-                 */
-                details = g_strdup_printf (ngettext ("%s / %s \xE2\x80\x94 %s left (%s/sec)",
-                                                     "%s / %s \xE2\x80\x94 %s left (%s/sec)",
-                                                     seconds_count_format_time_units (remaining_time)),
-                                           formatted_size_num_bytes,
-                                           formatted_size_total_size,
-                                           formatted_time,
-                                           formatted_size_transfer_rate);
-            }
-            else
-            {
-                g_autofree gchar *formatted_size_num_bytes = NULL;
-                g_autofree gchar *formatted_size_total_size = NULL;
-
-                formatted_size_num_bytes = g_format_size (transfer_info->num_bytes);
-                formatted_size_total_size = g_format_size (total_size);
-                /* To translators: %s will expand to a size like "2 bytes" or "3 MB". */
-                details = g_strdup_printf (_("%s / %s"),
-                                           formatted_size_num_bytes,
-                                           formatted_size_total_size);
-            }
-        }
-        else
-        {
-            if (files_left > 0)
-            {
-                g_autofree gchar *formatted_time = NULL;
-                g_autofree gchar *formatted_size = NULL;
-                formatted_time = get_formatted_time (remaining_time);
-                formatted_size = g_format_size ((goffset) transfer_rate);
-                /* To translators: %s will expand to a time duration like "2 minutes".
-                 * So the whole thing will be something like "1 / 5 -- 2 hours left (4kb/sec)"
-                 *
-                 * The singular/plural form will be used depending on the remaining time (i.e. the %s argument).
-                 */
-                details = g_strdup_printf (ngettext ("%'d / %'d \xE2\x80\x94 %s left (%s/sec)",
-                                                     "%'d / %'d \xE2\x80\x94 %s left (%s/sec)",
-                                                     seconds_count_format_time_units (remaining_time)),
-                                           transfer_info->num_files + 1, source_info->num_files,
-                                           formatted_time,
-                                           formatted_size);
-            }
-            else
-            {
-                /* To translators: %'d is the number of files completed for the operation,
-                 * so it will be something like 2/14. */
-                details = g_strdup_printf (_("%'d / %'d"),
-                                           transfer_info->num_files,
-                                           source_info->num_files);
-            }
-        }
-    }
-    nautilus_progress_info_take_details (job->progress, details);
-
-    if (elapsed > SECONDS_NEEDED_FOR_APROXIMATE_TRANSFER_RATE)
-    {
-        nautilus_progress_info_set_remaining_time (job->progress,
-                                                   remaining_time);
-        nautilus_progress_info_set_elapsed_time (job->progress,
-                                                 elapsed);
-    }
+        nautilus_progress_info_set_remaining_time (job->progress,
+                                                   remaining_time);
+        nautilus_progress_info_set_elapsed_time (job->progress,
+                                                 elapsed);
+    }
 
     nautilus_progress_info_set_progress (job->progress, transfer_info->num_bytes, total_size);
 }
@@ -4413,6 +4764,159 @@ get_unique_target_file (GFile      *src,
     return dest;
 }
 
+static void
+destination_names_free (gpointer names)
+{
+    if (names != NULL)
+    {
+        g_hash_table_unref (names);
+    }
+}
+
+/* Returns the names present in @dest_dir, listed once per job and kept up
+ * to date as the job creates files there, or %NULL if it can't be listed.
+ * This turns picking a free duplicate name into hash lookups, which only
+ * pays off for batches with many duplicates.
+ */
+static GHashTable *
+get_destination_names (CopyMoveJob *job,
+                       GFile       *dest_dir)
+{
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+    GHashTable *names = NULL;
+    GFileInfo *info;
+
+    if (job->n_duplicates < DESTINATION_NAMES_MIN_DUPLICATES)
+    {
+        return NULL;
+    }
+
+    if (job->destination_names == NULL)
+    {
+        job->destination_names = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                        g_object_unref,
+                                                        destination_names_free);
+    }
+
+    /* A directory which failed to be listed is not tried again. */
+    if (g_hash_table_lookup_extended (job->destination_names, dest_dir,
+                                      NULL, (gpointer *) &names))
+    {
+        return names;
+    }
+
+    enumerator = g_file_enumerate_children (dest_dir,
+                                            G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            job->common.cancellable,
+                                            NULL);
+    if (enumerator != NULL)
+    {
+        names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+        while ((info = g_file_enumerator_next_file (enumerator, job->common.cancellable, NULL)) != NULL)
+        {
+            g_hash_table_add (names, g_strdup (g_file_info_get_name (info)));
+            g_object_unref (info);
+        }
+    }
+
+    g_hash_table_insert (job->destination_names, g_object_ref (dest_dir), names);
+
+    return names;
+}
+
+static void
+destination_names_add (CopyMoveJob *job,
+                       GFile       *file)
+{
+    g_autoptr (GFile) parent = NULL;
+    GHashTable *names;
+
+    if (job->destination_names == NULL)
+    {
+        return;
+    }
+
+    parent = g_file_get_parent (file);
+    if (parent == NULL)
+    {
+        return;
+    }
+
+    names = g_hash_table_lookup (job->destination_names, parent);
+    if (names != NULL)
+    {
+        g_hash_table_add (names, g_file_get_basename (file));
+    }
+}
+
+/* Like get_unique_target_file (), but skips over the duplicate names already
+ * taken in @dest_dir instead of trying them one by one on disk.
+ */
+static GFile *
+get_free_unique_target_file (CopyMoveJob *job,
+                             GFile       *src,
+                             GFile       *dest_dir,
+                             gboolean     same_fs,
+                             const char  *dest_fs_type,
+                             int         *count)
+{
+    GHashTable *names;
+    g_autoptr (GFileInfo) info = NULL;
+    g_autoptr (NautilusFile) file = NULL;
+    const char *editname = NULL;
+    int max_length;
+    gboolean ignore_extension;
+
+    job->n_duplicates++;
+
+    names = get_destination_names (job, dest_dir);
+    if (names != NULL)
+    {
+        info = g_file_query_info (src,
+                                  G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME,
+                                  0, NULL, NULL);
+    }
+    if (info != NULL)
+    {
+        editname = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME);
+    }
+    if (editname == NULL)
+    {
+        return get_unique_target_file (src, dest_dir, same_fs, dest_fs_type, (*count)++);
+    }
+
+    max_length = nautilus_get_max_child_name_length_for_location (dest_dir);
+    file = nautilus_file_get (src);
+    ignore_extension = nautilus_file_is_directory (file);
+
+    while (TRUE)
+    {
+        g_autofree char *new_name = NULL;
+        g_autofree char *basename = NULL;
+        GFile *dest;
+        int n;
+
+        n = (*count)++;
+        new_name = get_duplicate_name (editname, n, max_length, ignore_extension);
+        make_file_name_valid_for_dest_fs (new_name, dest_fs_type);
+        dest = g_file_get_child_for_display_name (dest_dir, new_name, NULL);
+        if (dest == NULL)
+        {
+            return get_unique_target_file (src, dest_dir, same_fs, dest_fs_type, n);
+        }
+
+        basename = g_file_get_basename (dest);
+        if (!g_hash_table_contains (names, basename))
+        {
+            return dest;
+        }
+
+        g_object_unref (dest);
+    }
+}
+
 static GFile *
 get_target_file_for_link (GFile      *src,
                           GFile      *dest_dir,
@@ -5277,7 +5781,7 @@ handle_copy_move_conflict (CommonJob *job,
     g_autofree gchar *suggestion = NULL;
     gboolean should_start_inactive;
 
-    g_timer_stop (job->time);
+    job_timer_stop (job);
     nautilus_progress_info_pause (job->progress);
 
     should_start_inactive = is_long_job (job);
@@ -5294,7 +5798,7 @@ handle_copy_move_conflict (CommonJob *job,
                                                    suggestion);
 
     nautilus_progress_info_resume (job->progress);
-    g_timer_continue (job->time);
+    job_timer_continue (job);
 
     return response;
 }
@@ -5413,7 +5917,7 @@ copy_move_file (CopyMoveJob   *copy_job,
 
     if (unique_names)
     {
-        dest = get_unique_target_file (src, dest_dir, same_fs, *dest_fs_type, unique_name_nr++);
+        dest = get_free_unique_target_file (copy_job, src, dest_dir, same_fs, *dest_fs_type, &unique_name_nr);
     }
     else if (copy_job->target_name != NULL)
     {
@@ -5600,6 +6104,8 @@ retry:
                                                                 src, dest);
         }
 
+        destination_names_add (copy_job, dest);
+
         g_object_unref (dest);
         return;
     }
@@ -5651,8 +6157,10 @@ retry:
 
         if (unique_names)
         {
+            /* The index was out of date, somebody else created the file. */
+            destination_names_add (copy_job, dest);
             g_object_unref (dest);
-            dest = get_unique_target_file (src, dest_dir, same_fs, *dest_fs_type, unique_name_nr++);
+            dest = get_free_unique_target_file (copy_job, src, dest_dir, same_fs, *dest_fs_type, &unique_name_nr);
             goto retry;
         }
 
@@ -5910,6 +6418,7 @@ copy_files (CopyMoveJob  *job,
 
     common = &job->common;
 
+    nautilus_profile_span_begin ("file-operation", "copy");
     report_copy_progress (job, source_info, transfer_info);
 
     /* Query the source dir, not the file because if it's a symlink we'll follow it */
@@ -5969,6 +6478,7 @@ copy_files (CopyMoveJob  *job,
     }
 
     g_free (dest_fs_type);
+    nautilus_profile_span_end ("file-operation", "copy");
 }
 
 static void
@@ -5992,6 +6502,7 @@ copy_task_done (GObject      *source_object,
         g_object_unref (job->destination);
     }
     g_hash_table_unref (job->debuting_files);
+    g_clear_pointer (&job->destination_names, g_hash_table_unref);
     g_free (job->target_name);
 
     g_clear_object (&job->fake_display_source);
@@ -6088,13 +6599,20 @@ nautilus_file_operations_copy (GTask        *task,
                         dest,
                         &dest_fs_id,
                         source_info.num_bytes);
+    if (job_aborted (common))
+    {
+        g_object_unref (dest);
+        return;
+    }
+
+    nautilus_progress_info_manager_wait_for_device (common->progress, dest);
     g_object_unref (dest);
     if (job_aborted (common))
     {
         return;
     }
 
-    g_timer_start (job->common.time);
+    job_timer_start ((CommonJob *) job);
 
     memset (&transfer_info, 0, sizeof (transfer_info));
     copy_files (job,
@@ -6208,6 +6726,169 @@ get_files_from_fallbacks (GList *fallbacks)
     return g_list_reverse (res);
 }
 
+/* Moves within one local file system are plain renames, so there is no need
+ * to ask GIO about every file first. The destination is listed once to find
+ * the conflicts, and whatever doesn't conflict is renamed right away. Any file
+ * that doesn't fit, or fails, is left to move_file_prepare ().
+ */
+typedef struct
+{
+    GFile *destination;
+    dev_t device;
+
+    /* Names present in the destination, including the ones moved there. */
+    GHashTable *taken_names;
+    /* Parent directory -> whether it is on the same device as the destination. */
+    GHashTable *parents;
+} MovePlan;
+
+static void
+move_plan_free (MovePlan *plan)
+{
+    g_object_unref (plan->destination);
+    g_hash_table_destroy (plan->taken_names);
+    g_hash_table_destroy (plan->parents);
+    g_free (plan);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MovePlan, move_plan_free)
+
+static MovePlan *
+move_plan_new (GFile *destination)
+{
+    g_autoptr (MovePlan) plan = NULL;
+    g_autoptr (GDir) dir = NULL;
+    const char *path;
+    const char *name;
+    GStatBuf destination_stat;
+
+#ifndef RENAME_NOREPLACE
+    /* Without it, move_plan_move_file () can't rename anything. */
+    return NULL;
+#endif
+
+    path = g_file_peek_path (destination);
+    if (path == NULL || g_stat (path, &destination_stat) != 0)
+    {
+        return NULL;
+    }
+
+    dir = g_dir_open (path, 0, NULL);
+    if (dir == NULL)
+    {
+        return NULL;
+    }
+
+    plan = g_new0 (MovePlan, 1);
+    plan->destination = g_object_ref (destination);
+    plan->device = destination_stat.st_dev;
+    plan->taken_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    plan->parents = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                           g_object_unref, NULL);
+
+    while ((name = g_dir_read_name (dir)) != NULL)
+    {
+        g_hash_table_add (plan->taken_names, g_strdup (name));
+    }
+
+    return g_steal_pointer (&plan);
+}
+
+static gboolean
+move_plan_is_same_device (MovePlan *plan,
+                          GFile    *parent)
+{
+    gpointer same_device;
+
+    if (!g_hash_table_lookup_extended (plan->parents, parent, NULL, &same_device))
+    {
+        GStatBuf parent_stat;
+
+        same_device = GINT_TO_POINTER (g_stat (g_file_peek_path (parent), &parent_stat) == 0 &&
+                                       parent_stat.st_dev == plan->device);
+        g_hash_table_insert (plan->parents, g_object_ref (parent), same_device);
+    }
+
+    return GPOINTER_TO_INT (same_device);
+}
+
+/* Returns the new location of @src if it could be moved. */
+static GFile *
+move_plan_move_file (MovePlan *plan,
+                     GFile    *src)
+{
+    g_autoptr (GFile) parent = NULL;
+    g_autoptr (GFile) dest = NULL;
+    g_autofree char *basename = NULL;
+    const char *src_path;
+    const char *dest_path;
+    int res;
+
+    src_path = g_file_peek_path (src);
+    parent = g_file_get_parent (src);
+    if (src_path == NULL || parent == NULL ||
+        !move_plan_is_same_device (plan, parent))
+    {
+        return NULL;
+    }
+
+    basename = g_file_get_basename (src);
+    if (g_hash_table_contains (plan->taken_names, basename))
+    {
+        return NULL;
+    }
+
+    /* Moving a folder into itself has to be reported to the user. */
+    if (g_file_equal (plan->destination, src) ||
+        g_file_has_prefix (plan->destination, src))
+    {
+        return NULL;
+    }
+
+    dest = g_file_get_child (plan->destination, basename);
+    dest_path = g_file_peek_path (dest);
+
+#ifdef RENAME_NOREPLACE
+    /* Something might have appeared since the destination was listed. */
+    res = renameat2 (AT_FDCWD, src_path, AT_FDCWD, dest_path, RENAME_NOREPLACE);
+#else
+    /* A plain rename would silently replace anything that appeared since the
+     * destination was listed, so leave it to move_file_prepare (), which
+     * handles conflicts.
+     */
+    res = -1;
+#endif
+    if (res != 0)
+    {
+        return NULL;
+    }
+
+    g_hash_table_add (plan->taken_names, g_steal_pointer (&basename));
+
+    return g_steal_pointer (&dest);
+}
+
+static void
+report_file_moved (CopyMoveJob *move_job,
+                   GFile       *src,
+                   GFile       *dest)
+{
+    CommonJob *job = (CommonJob *) move_job;
+
+    if (move_job->debuting_files)
+    {
+        g_hash_table_replace (move_job->debuting_files, g_object_ref (dest), GINT_TO_POINTER (TRUE));
+    }
+
+    nautilus_file_changes_queue_file_moved (src, dest);
+
+    if (job->undo_info != NULL)
+    {
+        nautilus_file_undo_info_ext_add_origin_target_pair (NAUTILUS_FILE_UNDO_INFO_EXT (job->undo_info),
+                                                            src, dest);
+    }
+}
+
 static void
 move_file_prepare (CopyMoveJob  *move_job,
                    GFile        *src,
@@ -6554,20 +7235,40 @@ move_files_prepare (CopyMoveJob  *job,
     gboolean same_fs;
     int i;
     int total, left;
+    g_autoptr (MovePlan) plan = NULL;
 
     common = &job->common;
 
     total = left = g_list_length (job->files);
 
+    nautilus_profile_span_begin ("file-operation", "move-prepare");
+
     report_preparing_move_progress (job, total, left);
 
+    plan = move_plan_new (job->destination);
+
     i = 0;
     for (l = job->files;
          l != NULL && !job_aborted (common);
          l = l->next)
     {
+        g_autoptr (GFile) dest = NULL;
+
         src = l->data;
 
+        if (plan != NULL)
+        {
+            dest = move_plan_move_file (plan, src);
+        }
+
+        if (dest != NULL)
+        {
+            report_file_moved (job, src, dest);
+            report_preparing_move_progress (job, total, --left);
+            i++;
+            continue;
+        }
+
         same_fs = FALSE;
         if (dest_fs_id)
         {
@@ -6584,6 +7285,7 @@ move_files_prepare (CopyMoveJob  *job,
     }
 
     *fallbacks = g_list_reverse (*fallbacks);
+    nautilus_profile_span_end ("file-operation", "move-prepare");
 }
 
 static void
@@ -6603,6 +7305,7 @@ move_files (CopyMoveJob   *job,
     MoveFileCopyFallback *fallback;
     common = &job->common;
 
+    nautilus_profile_span_begin ("file-operation", "move");
     report_copy_progress (job, source_info, transfer_info);
 
     i = 0;
@@ -6635,6 +7338,8 @@ move_files (CopyMoveJob   *job,
             report_copy_progress (job, source_info, transfer_info);
         }
     }
+
+    nautilus_profile_span_end ("file-operation", "move");
 }
 
 
@@ -6656,6 +7361,7 @@ move_task_done (GObject      *source_object,
     g_list_free_full (job->files, g_object_unref);
     g_object_unref (job->destination);
     g_hash_table_unref (job->debuting_files);
+    g_clear_pointer (&job->destination_names, g_hash_table_unref);
 
     finalize_common ((CommonJob *) job);
 
@@ -6839,6 +7545,14 @@ nautilus_file_operations_move (GTask        *task,
         goto aborted;
     }
 
+    /* Only the copies wait for the device, renames are done by now. */
+    nautilus_progress_info_manager_wait_for_device (common->progress,
+                                                    job->destination);
+    if (job_aborted (common))
+    {
+        goto aborted;
+    }
+
     memset (&transfer_info, 0, sizeof (transfer_info));
     move_files (job,
                 fallbacks,
@@ -7085,6 +7799,7 @@ link_task_done (GObject      *source_object,
     g_list_free_full (job->files, g_object_unref);
     g_object_unref (job->destination);
     g_hash_table_unref (job->debuting_files);
+    g_clear_pointer (&job->destination_names, g_hash_table_unref);
 
     finalize_common ((CommonJob *) job);
 
@@ -7215,6 +7930,17 @@ nautilus_file_operations_duplicate (GList                          *files,
     g_task_run_in_thread (task, nautilus_file_operations_copy);
 }
 
+static void
+set_permissions_dir_free (SetPermissionsDir *dir)
+{
+    g_object_unref (dir->location);
+    if (dir->fd >= 0)
+    {
+        close (dir->fd);
+    }
+    g_free (dir);
+}
+
 static void
 set_permissions_task_done (GObject      *source_object,
                            GAsyncResult *res,
@@ -7225,6 +7951,9 @@ set_permissions_task_done (GObject      *source_object,
     job = user_data;
 
     g_object_unref (job->file);
+    g_queue_clear_full (&job->pending_dirs, (GDestroyNotify) set_permissions_dir_free);
+    g_cond_clear (&job->cond);
+    g_mutex_clear (&job->mutex);
 
     if (job->done_callback)
     {
@@ -7235,19 +7964,220 @@ set_permissions_task_done (GObject      *source_object,
     finalize_common ((CommonJob *) job);
 }
 
+static guint32
+get_new_permissions (SetPermissionsJob *job,
+                     guint32            current,
+                     gboolean           is_directory)
+{
+    if (is_directory)
+    {
+        return (current & ~job->dir_mask) | job->dir_permissions;
+    }
+    else
+    {
+        return (current & ~job->file_mask) | job->file_permissions;
+    }
+}
+
 static void
-set_permissions_file (SetPermissionsJob *job,
+add_undo_permissions (SetPermissionsJob *job,
                       GFile             *file,
-                      GFileInfo         *info);
+                      guint32            current)
+{
+    CommonJob *common;
+
+    common = (CommonJob *) job;
 
+    g_mutex_lock (&job->mutex);
+    nautilus_file_undo_info_rec_permissions_add_file (NAUTILUS_FILE_UNDO_INFO_REC_PERMISSIONS (common->undo_info),
+                                                      file, current);
+    g_mutex_unlock (&job->mutex);
+}
+
+/* Takes ownership of @fd. */
 static void
-set_permissions_contained_files (SetPermissionsJob *job,
-                                 GFile             *file)
+queue_directory (SetPermissionsJob *job,
+                 GFile             *directory,
+                 int                fd)
+{
+    SetPermissionsDir *dir;
+
+    dir = g_new0 (SetPermissionsDir, 1);
+    dir->location = g_object_ref (directory);
+    dir->fd = fd;
+
+    g_mutex_lock (&job->mutex);
+    if (fd >= 0)
+    {
+        job->n_queued_fds++;
+    }
+    g_queue_push_tail (&job->pending_dirs, dir);
+    g_cond_signal (&job->cond);
+    g_mutex_unlock (&job->mutex);
+}
+
+/* Opens @name relative to @dir_fd, without following symlinks, and only if it
+ * is still the file @expected was read from. Anyone with write access to a
+ * directory can swap an entry for a symlink between the two. */
+static int
+open_verified (int                dir_fd,
+               const char        *name,
+               const struct stat *expected,
+               int                flags)
+{
+    struct stat statbuf;
+    int fd;
+
+    fd = openat (dir_fd, name, flags | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    if (fstat (fd, &statbuf) != 0 ||
+        statbuf.st_dev != expected->st_dev ||
+        statbuf.st_ino != expected->st_ino)
+    {
+        close (fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* Changes the mode of the file @path_fd, an O_PATH fd for @name in
+ * @dir_fd, refers to. */
+static gboolean
+chmod_verified (int         path_fd,
+                int         dir_fd,
+                const char *name,
+                mode_t      mode)
+{
+    char proc_path[64];
+
+    g_snprintf (proc_path, sizeof (proc_path), "/proc/self/fd/%d", path_fd);
+    if (chmod (proc_path, mode) == 0)
+    {
+        return TRUE;
+    }
+
+    /* Without /proc, at least never follow a symlink put there since. */
+    return errno == ENOENT &&
+           fchmodat (dir_fd, name, mode, AT_SYMLINK_NOFOLLOW) == 0;
+}
+
+/* Local directories are walked with syscalls relative to the directory
+ * fd, which avoids resolving the full path and creating a GFileInfo for
+ * every entry. Takes ownership of @dir_fd. */
+static guint
+set_permissions_contained_files_local (SetPermissionsJob *job,
+                                       GFile             *file,
+                                       int                dir_fd)
+{
+    CommonJob *common;
+    DIR *dir;
+    struct dirent *entry;
+    guint n_changed;
+
+    common = (CommonJob *) job;
+    n_changed = 0;
+
+    dir = fdopendir (dir_fd);
+    if (dir == NULL)
+    {
+        close (dir_fd);
+        return 0;
+    }
+
+    while (!job_aborted (common) && (entry = readdir (dir)) != NULL)
+    {
+        g_autoptr (GFile) child = NULL;
+        struct stat statbuf;
+        gboolean is_directory;
+        gboolean queue;
+        guint32 current;
+        int path_fd;
+        int child_fd;
+
+        if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+
+        /* Ignore errors, and don't follow symlinks. */
+        if (fstatat (dir_fd, entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) != 0 ||
+            S_ISLNK (statbuf.st_mode))
+        {
+            continue;
+        }
+
+        path_fd = open_verified (dir_fd, entry->d_name, &statbuf, O_PATH);
+        if (path_fd < 0)
+        {
+            continue;
+        }
+
+        is_directory = S_ISDIR (statbuf.st_mode);
+        current = statbuf.st_mode;
+
+        if (common->undo_info != NULL || is_directory)
+        {
+            child = g_file_get_child (file, entry->d_name);
+        }
+
+        if (common->undo_info != NULL)
+        {
+            add_undo_permissions (job, child, current);
+        }
+
+        if (chmod_verified (path_fd, dir_fd, entry->d_name,
+                            get_new_permissions (job, current, is_directory) & 07777))
+        {
+            n_changed++;
+        }
+        close (path_fd);
+
+        if (!is_directory)
+        {
+            continue;
+        }
+
+        /* Opened only now, as the new mode may be what allows reading it. */
+        child_fd = open_verified (dir_fd, entry->d_name, &statbuf, O_RDONLY | O_DIRECTORY);
+        if (child_fd < 0)
+        {
+            continue;
+        }
+
+        g_mutex_lock (&job->mutex);
+        queue = job->n_queued_fds < SET_PERMISSIONS_MAX_QUEUED_FDS;
+        g_mutex_unlock (&job->mutex);
+
+        if (queue)
+        {
+            queue_directory (job, child, child_fd);
+        }
+        else
+        {
+            n_changed += set_permissions_contained_files_local (job, child, child_fd);
+        }
+    }
+
+    closedir (dir);
+
+    return n_changed;
+}
+
+static guint
+set_permissions_contained_files_gio (SetPermissionsJob *job,
+                                     GFile             *file)
 {
     CommonJob *common;
     GFileEnumerator *enumerator;
+    guint n_changed;
 
     common = (CommonJob *) job;
+    n_changed = 0;
 
     enumerator = g_file_enumerate_children (file,
                                             G_FILE_ATTRIBUTE_STANDARD_NAME ","
@@ -7264,89 +8194,122 @@ set_permissions_contained_files (SetPermissionsJob *job,
                (child_info = g_file_enumerator_next_file (enumerator, common->cancellable, NULL)) != NULL)
         {
             GFile *child;
+            gboolean is_directory;
 
             child = g_file_get_child (file,
                                       g_file_info_get_name (child_info));
-            set_permissions_file (job, child, child_info);
+            is_directory = g_file_info_get_file_type (child_info) == G_FILE_TYPE_DIRECTORY;
+
+            if (g_file_info_has_attribute (child_info, G_FILE_ATTRIBUTE_UNIX_MODE))
+            {
+                guint32 current;
+
+                current = g_file_info_get_attribute_uint32 (child_info, G_FILE_ATTRIBUTE_UNIX_MODE);
+
+                if (common->undo_info != NULL)
+                {
+                    add_undo_permissions (job, child, current);
+                }
+
+                if (g_file_set_attribute_uint32 (child, G_FILE_ATTRIBUTE_UNIX_MODE,
+                                                 get_new_permissions (job, current, is_directory),
+                                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                 common->cancellable, NULL))
+                {
+                    n_changed++;
+                }
+            }
+
+            if (is_directory)
+            {
+                queue_directory (job, child, -1);
+            }
+
             g_object_unref (child);
             g_object_unref (child_info);
         }
         g_file_enumerator_close (enumerator, common->cancellable, NULL);
         g_object_unref (enumerator);
     }
+
+    return n_changed;
 }
 
-static void
-set_permissions_file (SetPermissionsJob *job,
-                      GFile             *file,
-                      GFileInfo         *info)
+static guint
+set_permissions_contained_files (SetPermissionsJob *job,
+                                 SetPermissionsDir *dir)
 {
-    CommonJob *common;
-    gboolean free_info;
-    guint32 current;
-    guint32 value;
-    guint32 mask;
+    if (dir->fd >= 0)
+    {
+        int fd = dir->fd;
 
-    common = (CommonJob *) job;
+        dir->fd = -1;
+        return set_permissions_contained_files_local (job, dir->location, fd);
+    }
 
-    nautilus_progress_info_pulse_progress (common->progress);
+    return set_permissions_contained_files_gio (job, dir->location);
+}
 
-    free_info = FALSE;
-    if (info == NULL)
-    {
-        free_info = TRUE;
-        info = g_file_query_info (file,
-                                  G_FILE_ATTRIBUTE_STANDARD_TYPE ","
-                                  G_FILE_ATTRIBUTE_UNIX_MODE,
-                                  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                  common->cancellable,
-                                  NULL);
-        /* Ignore errors */
-        if (info == NULL)
-        {
-            return;
-        }
-    }
+static gpointer
+set_permissions_worker_thread_func (gpointer user_data)
+{
+    SetPermissionsJob *job = user_data;
+    CommonJob *common;
 
-    if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
-    {
-        value = job->dir_permissions;
-        mask = job->dir_mask;
-    }
-    else
+    common = (CommonJob *) job;
+
+    g_mutex_lock (&job->mutex);
+    while (!job_aborted (common))
     {
-        value = job->file_permissions;
-        mask = job->file_mask;
-    }
+        SetPermissionsDir *directory;
+        g_autofree char *details = NULL;
+        guint n_changed;
 
+        directory = g_queue_pop_head (&job->pending_dirs);
+        if (directory == NULL)
+        {
+            if (job->n_busy_workers == 0)
+            {
+                break;
+            }
 
-    if (!job_aborted (common) &&
-        g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_MODE))
-    {
-        current = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_MODE);
+            /* Another worker may still find subdirectories. Wake up
+             * regularly anyway to notice cancellation. */
+            g_cond_wait_until (&job->cond, &job->mutex,
+                               g_get_monotonic_time () + SET_PERMISSIONS_POLL_INTERVAL);
+            continue;
+        }
 
-        if (common->undo_info != NULL)
+        if (directory->fd >= 0)
         {
-            nautilus_file_undo_info_rec_permissions_add_file (NAUTILUS_FILE_UNDO_INFO_REC_PERMISSIONS (common->undo_info),
-                                                              file, current);
+            job->n_queued_fds--;
         }
+        job->n_busy_workers++;
+        g_mutex_unlock (&job->mutex);
 
-        current = (current & ~mask) | value;
+        n_changed = set_permissions_contained_files (job, directory);
+        set_permissions_dir_free (directory);
 
-        g_file_set_attribute_uint32 (file, G_FILE_ATTRIBUTE_UNIX_MODE,
-                                     current, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                     common->cancellable, NULL);
-    }
+        g_mutex_lock (&job->mutex);
+        job->n_busy_workers--;
+        job->n_changed += n_changed;
+        details = g_strdup_printf (ngettext ("Changed permissions of %'u file",
+                                             "Changed permissions of %'u files",
+                                             job->n_changed),
+                                   job->n_changed);
+        g_mutex_unlock (&job->mutex);
 
-    if (!job_aborted (common) &&
-        g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
-    {
-        set_permissions_contained_files (job, file);
-    }
-    if (free_info)
-    {
-        g_object_unref (info);
+        nautilus_progress_info_set_details (common->progress, details);
+        nautilus_progress_info_pulse_progress (common->progress);
+
+        g_mutex_lock (&job->mutex);
     }
+
+    /* Let the other workers notice that the queue is drained. */
+    g_cond_broadcast (&job->cond);
+    g_mutex_unlock (&job->mutex);
+
+    return NULL;
 }
 
 static void
@@ -7357,6 +8320,9 @@ set_permissions_thread_func (GTask        *task,
 {
     SetPermissionsJob *job = task_data;
     CommonJob *common;
+    g_autoptr (GPtrArray) workers = NULL;
+    g_autofree char *path = NULL;
+    guint n_workers;
 
     common = (CommonJob *) job;
 
@@ -7364,7 +8330,60 @@ set_permissions_thread_func (GTask        *task,
                                        _("Setting permissions"));
 
     nautilus_progress_info_start (job->common.progress);
-    set_permissions_contained_files (job, job->file);
+
+    /* The top directory is the one the user picked, possibly through a
+     * symlink, so it is opened by path here, following it like GIO does;
+     * everything below is opened relative to it, without following any.
+     */
+    path = g_file_get_path (job->file);
+    if (path != NULL)
+    {
+        int fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (fd < 0)
+        {
+            g_autofree char *basename = NULL;
+            int saved_errno = errno;
+
+            basename = get_basename (job->file);
+            run_error (common,
+                       g_strdup_printf (_("Error while setting the permissions of “%s”."), basename),
+                       g_strdup (g_strerror (saved_errno)),
+                       NULL,
+                       FALSE,
+                       CANCEL,
+                       NULL);
+            abort_job (common);
+            return;
+        }
+
+        queue_directory (job, job->file, fd);
+    }
+    else
+    {
+        queue_directory (job, job->file, -1);
+    }
+
+    /* Sibling directories are independent of each other, so several
+     * workers take them from the queue. This thread is one of them.
+     */
+    n_workers = MIN (g_get_num_processors (), SET_PERMISSIONS_MAX_WORKERS);
+
+    workers = g_ptr_array_new ();
+    for (guint i = 1; i < n_workers; i++)
+    {
+        g_ptr_array_add (workers,
+                         g_thread_new ("nautilus-permissions",
+                                       set_permissions_worker_thread_func,
+                                       job));
+    }
+
+    set_permissions_worker_thread_func (job);
+
+    for (guint i = 0; i < workers->len; i++)
+    {
+        g_thread_join (g_ptr_array_index (workers, i));
+    }
 }
 
 void
@@ -7387,6 +8406,9 @@ nautilus_file_set_permissions_recursive (const char         *directory,
     job->dir_mask = dir_mask;
     job->done_callback = callback;
     job->done_callback_data = callback_data;
+    g_mutex_init (&job->mutex);
+    g_cond_init (&job->cond);
+    g_queue_init (&job->pending_dirs);
 
     if (!nautilus_file_undo_manager_is_operating ())
     {
@@ -8243,6 +9265,15 @@ nautilus_file_operations_empty_trash (GtkWidget                      *parent_vie
     g_task_run_in_thread (task, empty_trash_thread_func);
 }
 
+static void
+extract_archive_clear (gpointer data)
+{
+    ExtractArchive *archive = data;
+
+    g_clear_object (&archive->source_file);
+    g_clear_object (&archive->output_file);
+}
+
 static void
 extract_task_done (GObject      *source_object,
                    GAsyncResult *res,
@@ -8261,68 +9292,174 @@ extract_task_done (GObject      *source_object,
     g_list_free_full (extract_job->source_files, g_object_unref);
     g_list_free_full (extract_job->output_files, g_object_unref);
     g_object_unref (extract_job->destination_directory);
+    g_clear_pointer (&extract_job->archives, g_array_unref);
+    g_mutex_clear (&extract_job->mutex);
+    g_mutex_clear (&extract_job->dialog_mutex);
 
     finalize_common ((CommonJob *) extract_job);
 
     nautilus_file_changes_consume_changes (TRUE);
 }
 
+static gboolean
+extract_job_destination_is_taken (ExtractJob *extract_job,
+                                  GFile      *destination)
+{
+    for (GList *l = extract_job->output_files; l != NULL; l = l->next)
+    {
+        if (g_file_equal (l->data, destination))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* Called with the job mutex held. Another worker may have decided on a
+ * destination which doesn't exist on disk yet, so avoid those as well.
+ */
+static GFile *
+extract_job_reserve_destination (ExtractJob *extract_job,
+                                 const char *basename)
+{
+    g_autofree char *basename_without_extension = NULL;
+    const char *extension;
+    GFile *destination;
+    int copy;
+
+    basename_without_extension = eel_filename_strip_extension (basename);
+    extension = eel_filename_get_extension_offset (basename);
+
+    destination = nautilus_generate_unique_file_in_directory (extract_job->destination_directory,
+                                                              basename);
+
+    copy = 1;
+    while (extract_job_destination_is_taken (extract_job, destination))
+    {
+        g_autofree char *filename = NULL;
+
+        g_object_unref (destination);
+
+        filename = g_strdup_printf ("%s (%d)%s",
+                                    basename_without_extension,
+                                    copy,
+                                    extension ? extension : "");
+        destination = nautilus_generate_unique_file_in_directory (extract_job->destination_directory,
+                                                                  filename);
+
+        copy++;
+    }
+
+    extract_job->output_files = g_list_prepend (extract_job->output_files,
+                                                destination);
+
+    return destination;
+}
+
 static GFile *
 extract_job_on_decide_destination (AutoarExtractor *extractor,
                                    GFile           *destination,
                                    GList           *files,
                                    gpointer         user_data)
 {
-    ExtractJob *extract_job = user_data;
+    ExtractArchive *archive = user_data;
+    ExtractJob *extract_job = archive->job;
     GFile *decided_destination;
     g_autofree char *basename = NULL;
 
     nautilus_progress_info_set_details (extract_job->common.progress,
                                         _("Verifying destination"));
 
-    basename = g_file_get_basename (destination);
-    decided_destination = nautilus_generate_unique_file_in_directory (extract_job->destination_directory,
-                                                                      basename);
-
     if (job_aborted ((CommonJob *) extract_job))
     {
-        g_object_unref (decided_destination);
         return NULL;
     }
 
-    /* The extract_job->destination_decided variable signalizes whether the
-     * extract_job->output_files list already contains the final location as
-     * its first link. There is no way to get this over the AutoarExtractor
-     * API currently.
-     */
-    extract_job->output_files = g_list_prepend (extract_job->output_files,
-                                                decided_destination);
-    extract_job->destination_decided = TRUE;
+    basename = g_file_get_basename (destination);
+
+    g_mutex_lock (&extract_job->mutex);
+    decided_destination = extract_job_reserve_destination (extract_job, basename);
+    g_mutex_unlock (&extract_job->mutex);
+
+    archive->output_file = g_object_ref (decided_destination);
 
     return g_object_ref (decided_destination);
 }
 
+/* Formats the details of extract jobs from the numbers published by
+ * extract_job_on_progress (). Runs in the main loop.
+ */
+static char *
+format_extract_details (NautilusProgressInfo *info)
+{
+    gint files_done;
+    gint files_total;
+    goffset bytes_done;
+    goffset bytes_total;
+    goffset transfer_rate;
+    int remaining_time;
+    g_autofree gchar *formatted_size_bytes_done = NULL;
+    g_autofree gchar *formatted_size_bytes_total = NULL;
+    g_autofree gchar *formatted_time = NULL;
+    g_autofree gchar *formatted_size_transfer_rate = NULL;
+
+    nautilus_progress_info_get_transfer (info,
+                                         &files_done, &files_total,
+                                         &bytes_done, &bytes_total,
+                                         &transfer_rate);
+
+    formatted_size_bytes_done = g_format_size (bytes_done);
+    formatted_size_bytes_total = g_format_size (bytes_total);
+    if (transfer_rate == 0)
+    {
+        /* To translators: %s will expand to a size like "2 bytes" or
+         * "3 MB", so something like "4 kb / 4 MB"
+         */
+        return g_strdup_printf (_("%s / %s"), formatted_size_bytes_done,
+                                formatted_size_bytes_total);
+    }
+
+    remaining_time = (bytes_total - bytes_done) / transfer_rate;
+    formatted_time = get_formatted_time (remaining_time);
+    formatted_size_transfer_rate = g_format_size (transfer_rate);
+    /* To translators: %s will expand to a size like "2 bytes" or
+     * "3 MB", %s to a time duration like "2 minutes". So the whole
+     * thing will be something like
+     * "2 kb / 4 MB -- 2 hours left (4kb/sec)"
+     *
+     * The singular/plural form will be used depending on the
+     * remaining time (i.e. the %s argument).
+     */
+    return g_strdup_printf (ngettext ("%s / %s \xE2\x80\x94 %s left (%s/sec)",
+                                      "%s / %s \xE2\x80\x94 %s left (%s/sec)",
+                                      seconds_count_format_time_units (remaining_time)),
+                            formatted_size_bytes_done,
+                            formatted_size_bytes_total,
+                            formatted_time,
+                            formatted_size_transfer_rate);
+}
+
 static void
 extract_job_on_progress (AutoarExtractor *extractor,
                          guint64          archive_current_decompressed_size,
                          guint            archive_current_decompressed_files,
                          gpointer         user_data)
 {
-    ExtractJob *extract_job = user_data;
-    CommonJob *common = user_data;
+    ExtractArchive *archive = user_data;
+    ExtractJob *extract_job = archive->job;
+    CommonJob *common = (CommonJob *) extract_job;
     GFile *source_file;
-    char *details;
     double elapsed;
     double transfer_rate;
     int remaining_time;
     guint64 archive_total_decompressed_size;
-    gdouble archive_weight;
-    gdouble archive_decompress_progress;
+    guint64 archive_completed_size;
     guint64 job_completed_size;
-    gdouble job_progress;
+    guint64 total_compressed_size;
+    gint n_extracted;
+    gint total_files;
     g_autofree gchar *basename = NULL;
-    g_autofree gchar *formatted_size_job_completed_size = NULL;
-    g_autofree gchar *formatted_size_total_compressed_size = NULL;
 
     source_file = autoar_extractor_get_source_file (extractor);
 
@@ -8333,71 +9470,50 @@ extract_job_on_progress (AutoarExtractor *extractor,
 
     archive_total_decompressed_size = autoar_extractor_get_total_size (extractor);
 
-    archive_decompress_progress = (gdouble) archive_current_decompressed_size /
-                                  (gdouble) archive_total_decompressed_size;
-
-    archive_weight = 0;
-    if (extract_job->total_compressed_size)
+    /* Each archive weighs in with its compressed size. */
+    archive_completed_size = 0;
+    if (archive_total_decompressed_size > 0)
     {
-        archive_weight = (gdouble) extract_job->archive_compressed_size /
-                         (gdouble) extract_job->total_compressed_size;
+        archive_completed_size = ((gdouble) archive_current_decompressed_size /
+                                  (gdouble) archive_total_decompressed_size) *
+                                 archive->compressed_size;
+        archive_completed_size = MIN (archive_completed_size, archive->compressed_size);
     }
 
-    job_progress = archive_decompress_progress * archive_weight + extract_job->base_progress;
+    g_mutex_lock (&extract_job->mutex);
+    extract_job->completed_size -= archive->completed_size;
+    extract_job->completed_size += archive_completed_size;
+    archive->completed_size = archive_completed_size;
 
-    elapsed = g_timer_elapsed (common->time, NULL);
+    job_completed_size = extract_job->completed_size;
+    total_compressed_size = extract_job->total_compressed_size;
+    n_extracted = extract_job->n_extracted;
+    total_files = extract_job->total_files;
+    g_mutex_unlock (&extract_job->mutex);
+
+    elapsed = job_timer_elapsed (common);
 
     transfer_rate = 0;
     remaining_time = -1;
 
-    job_completed_size = job_progress * extract_job->total_compressed_size;
-
     if (elapsed > 0)
     {
         transfer_rate = job_completed_size / elapsed;
     }
     if (transfer_rate > 0)
     {
-        remaining_time = (extract_job->total_compressed_size - job_completed_size) /
+        remaining_time = (total_compressed_size - job_completed_size) /
                          transfer_rate;
     }
 
-    formatted_size_job_completed_size = g_format_size (job_completed_size);
-    formatted_size_total_compressed_size = g_format_size (extract_job->total_compressed_size);
-    if (elapsed < SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE ||
-        transfer_rate == 0)
-    {
-        /* To translators: %s will expand to a size like "2 bytes" or
-         * "3 MB", so something like "4 kb / 4 MB"
-         */
-        details = g_strdup_printf (_("%s / %s"), formatted_size_job_completed_size,
-                                   formatted_size_total_compressed_size);
-    }
-    else
-    {
-        g_autofree gchar *formatted_time = NULL;
-        g_autofree gchar *formatted_size_transfer_rate = NULL;
-
-        formatted_time = get_formatted_time (remaining_time);
-        formatted_size_transfer_rate = g_format_size ((goffset) transfer_rate);
-        /* To translators: %s will expand to a size like "2 bytes" or
-         * "3 MB", %s to a time duration like "2 minutes". So the whole
-         * thing will be something like
-         * "2 kb / 4 MB -- 2 hours left (4kb/sec)"
-         *
-         * The singular/plural form will be used depending on the
-         * remaining time (i.e. the %s argument).
-         */
-        details = g_strdup_printf (ngettext ("%s / %s \xE2\x80\x94 %s left (%s/sec)",
-                                             "%s / %s \xE2\x80\x94 %s left (%s/sec)",
-                                             seconds_count_format_time_units (remaining_time)),
-                                   formatted_size_job_completed_size,
-                                   formatted_size_total_compressed_size,
-                                   formatted_time,
-                                   formatted_size_transfer_rate);
-    }
-
-    nautilus_progress_info_take_details (common->progress, details);
+    nautilus_progress_info_set_details_func (common->progress, format_extract_details);
+    nautilus_progress_info_set_transfer (common->progress,
+                                         n_extracted,
+                                         total_files,
+                                         job_completed_size,
+                                         total_compressed_size,
+                                         elapsed < SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE ?
+                                         0 : (goffset) transfer_rate);
 
     if (elapsed > SECONDS_NEEDED_FOR_APROXIMATE_TRANSFER_RATE)
     {
@@ -8407,7 +9523,9 @@ extract_job_on_progress (AutoarExtractor *extractor,
                                                  elapsed);
     }
 
-    nautilus_progress_info_set_progress (common->progress, job_progress, 1);
+    nautilus_progress_info_set_progress (common->progress,
+                                         job_completed_size,
+                                         total_compressed_size);
 }
 
 static void
@@ -8415,10 +9533,11 @@ extract_job_on_error (AutoarExtractor *extractor,
                       GError          *error,
                       gpointer         user_data)
 {
-    ExtractJob *extract_job = user_data;
+    ExtractArchive *archive = user_data;
+    ExtractJob *extract_job = archive->job;
     GFile *source_file;
-    GFile *destination;
     gint response_id;
+    gint total_files;
     gint remaining_files;
     g_autofree gchar *basename = NULL;
 
@@ -8426,29 +9545,36 @@ extract_job_on_error (AutoarExtractor *extractor,
 
     if (IS_IO_ERROR (error, NOT_SUPPORTED))
     {
+        g_mutex_lock (&extract_job->dialog_mutex);
         handle_unsupported_compressed_file (extract_job->common.parent_window,
                                             source_file);
+        g_mutex_unlock (&extract_job->dialog_mutex);
 
         return;
     }
 
-    extract_job->extraction_failed = TRUE;
+    archive->failed = TRUE;
 
-    /* It is safe to use extract_job->output_files->data only when the
-     * extract_job->destination_decided variable was set, see comment in the
-     * extract_job_on_decide_destination function.
-     */
-    if (extract_job->destination_decided)
+    if (archive->output_file != NULL)
     {
-        destination = extract_job->output_files->data;
-        delete_file_recursively (destination, NULL, NULL, NULL);
-        extract_job->output_files = g_list_delete_link (extract_job->output_files,
-                                                        extract_job->output_files);
-        g_object_unref (destination);
+        delete_file_recursively (archive->output_file, NULL, NULL, NULL);
+
+        g_mutex_lock (&extract_job->mutex);
+        extract_job->output_files = g_list_remove (extract_job->output_files,
+                                                   archive->output_file);
+        g_mutex_unlock (&extract_job->mutex);
+
+        /* Drop the reference held by the output list, then our own. */
+        g_object_unref (archive->output_file);
+        g_clear_object (&archive->output_file);
     }
 
-    if (extract_job->common.skip_all_error)
+    g_mutex_lock (&extract_job->dialog_mutex);
+
+    if (extract_job->common.skip_all_error ||
+        job_aborted ((CommonJob *) extract_job))
     {
+        g_mutex_unlock (&extract_job->dialog_mutex);
         return;
     }
 
@@ -8457,16 +9583,18 @@ extract_job_on_error (AutoarExtractor *extractor,
                                         g_strdup_printf (_("Error extracting “%s”"),
                                                          basename));
 
-    remaining_files = g_list_length (g_list_find_custom (extract_job->source_files,
-                                                         source_file,
-                                                         (GCompareFunc) g_file_equal)) - 1;
+    g_mutex_lock (&extract_job->mutex);
+    total_files = extract_job->total_files;
+    remaining_files = total_files - extract_job->n_extracted - 1;
+    g_mutex_unlock (&extract_job->mutex);
+
     response_id = run_cancel_or_skip_warning ((CommonJob *) extract_job,
                                               g_strdup_printf (_("There was an error while extracting “%s”."),
                                                                basename),
                                               g_strdup (error->message),
                                               NULL,
-                                              extract_job->total_files,
-                                              remaining_files);
+                                              total_files,
+                                              MAX (remaining_files, 0));
 
     if (response_id == 0 || response_id == GTK_RESPONSE_DELETE_EVENT)
     {
@@ -8476,40 +9604,50 @@ extract_job_on_error (AutoarExtractor *extractor,
     {
         extract_job->common.skip_all_error = TRUE;
     }
+
+    g_mutex_unlock (&extract_job->dialog_mutex);
 }
 
 static void
 extract_job_on_completed (AutoarExtractor *extractor,
                           gpointer         user_data)
 {
-    ExtractJob *extract_job = user_data;
-    GFile *output_file;
+    ExtractArchive *archive = user_data;
 
-    output_file = G_FILE (extract_job->output_files->data);
-
-    nautilus_file_changes_queue_file_added (output_file);
+    if (archive->output_file != NULL)
+    {
+        nautilus_file_changes_queue_file_added (archive->output_file);
+    }
 }
 
 static gchar *
 extract_job_on_request_passphrase (AutoarExtractor *extractor,
                                    gpointer         user_data)
 {
-    ExtractJob *extract_job = user_data;
+    ExtractArchive *archive = user_data;
+    ExtractJob *extract_job = archive->job;
     GtkWindow *parent_window;
     GFile *source_file;
     g_autofree gchar *basename = NULL;
-    gchar *passphrase;
+    gchar *passphrase = NULL;
 
     parent_window = extract_job->common.parent_window;
     source_file = autoar_extractor_get_source_file (extractor);
     basename = get_basename (source_file);
 
-    passphrase = extract_ask_passphrase (parent_window, basename);
-    if (passphrase == NULL)
+    g_mutex_lock (&extract_job->dialog_mutex);
+
+    if (!job_aborted ((CommonJob *) extract_job))
     {
-        abort_job ((CommonJob *) extract_job);
+        passphrase = extract_ask_passphrase (parent_window, basename);
+        if (passphrase == NULL)
+        {
+            abort_job ((CommonJob *) extract_job);
+        }
     }
 
+    g_mutex_unlock (&extract_job->dialog_mutex);
+
     return passphrase;
 }
 
@@ -8519,13 +9657,13 @@ extract_job_on_scanned (AutoarExtractor *extractor,
                         gpointer         user_data)
 {
     guint64 total_size;
-    ExtractJob *extract_job;
+    ExtractArchive *archive = user_data;
+    ExtractJob *extract_job = archive->job;
     GFile *source_file;
     g_autofree gchar *basename = NULL;
-    GFileInfo *fsinfo;
+    g_autoptr (GFileInfo) fsinfo = NULL;
     guint64 free_size;
 
-    extract_job = user_data;
     total_size = autoar_extractor_get_total_size (extractor);
     source_file = autoar_extractor_get_source_file (extractor);
     basename = get_basename (source_file);
@@ -8543,18 +9681,25 @@ extract_job_on_scanned (AutoarExtractor *extractor,
      */
     if (total_size != G_MAXUINT64 && total_size > free_size)
     {
-        nautilus_progress_info_take_status (extract_job->common.progress,
-                                            g_strdup_printf (_("Error extracting “%s”"),
-                                                             basename));
-        run_error (&extract_job->common,
-                   g_strdup_printf (_("Not enough free space to extract %s"), basename),
-                   NULL,
-                   NULL,
-                   FALSE,
-                   CANCEL,
-                   NULL);
+        g_mutex_lock (&extract_job->dialog_mutex);
 
-        abort_job ((CommonJob *) extract_job);
+        if (!job_aborted ((CommonJob *) extract_job))
+        {
+            nautilus_progress_info_take_status (extract_job->common.progress,
+                                                g_strdup_printf (_("Error extracting “%s”"),
+                                                                 basename));
+            run_error (&extract_job->common,
+                       g_strdup_printf (_("Not enough free space to extract %s"), basename),
+                       NULL,
+                       NULL,
+                       FALSE,
+                       CANCEL,
+                       NULL);
+
+            abort_job ((CommonJob *) extract_job);
+        }
+
+        g_mutex_unlock (&extract_job->dialog_mutex);
     }
 }
 
@@ -8604,6 +9749,80 @@ report_extract_final_progress (ExtractJob *extract_job)
     nautilus_progress_info_set_progress (extract_job->common.progress, 1, 1);
 }
 
+static void
+extract_archive (ExtractArchive *archive)
+{
+    ExtractJob *extract_job = archive->job;
+    g_autoptr (AutoarExtractor) extractor = NULL;
+
+    extractor = autoar_extractor_new (archive->source_file,
+                                      extract_job->destination_directory);
+
+    autoar_extractor_set_notify_interval (extractor,
+                                          PROGRESS_NOTIFY_INTERVAL);
+    g_signal_connect (extractor, "scanned",
+                      G_CALLBACK (extract_job_on_scanned),
+                      archive);
+    g_signal_connect (extractor, "error",
+                      G_CALLBACK (extract_job_on_error),
+                      archive);
+    g_signal_connect (extractor, "decide-destination",
+                      G_CALLBACK (extract_job_on_decide_destination),
+                      archive);
+    g_signal_connect (extractor, "progress",
+                      G_CALLBACK (extract_job_on_progress),
+                      archive);
+    g_signal_connect (extractor, "completed",
+                      G_CALLBACK (extract_job_on_completed),
+                      archive);
+    g_signal_connect (extractor, "request-passphrase",
+                      G_CALLBACK (extract_job_on_request_passphrase),
+                      archive);
+
+    autoar_extractor_start (extractor,
+                            extract_job->common.cancellable);
+
+    g_signal_handlers_disconnect_by_data (extractor,
+                                          archive);
+
+    g_mutex_lock (&extract_job->mutex);
+
+    extract_job->completed_size -= archive->completed_size;
+    if (!archive->failed)
+    {
+        extract_job->completed_size += archive->compressed_size;
+        extract_job->n_extracted++;
+    }
+    else
+    {
+        extract_job->total_files--;
+        extract_job->total_compressed_size -= archive->compressed_size;
+    }
+
+    g_mutex_unlock (&extract_job->mutex);
+}
+
+static gpointer
+extract_worker_thread_func (gpointer user_data)
+{
+    ExtractJob *extract_job = user_data;
+
+    while (!job_aborted ((CommonJob *) extract_job))
+    {
+        guint i;
+
+        i = g_atomic_int_add (&extract_job->next_archive, 1);
+        if (i >= extract_job->archives->len)
+        {
+            break;
+        }
+
+        extract_archive (&g_array_index (extract_job->archives, ExtractArchive, i));
+    }
+
+    return NULL;
+}
+
 static void
 extract_task_thread_func (GTask        *task,
                           gpointer      source_object,
@@ -8611,32 +9830,31 @@ extract_task_thread_func (GTask        *task,
                           GCancellable *cancellable)
 {
     ExtractJob *extract_job = task_data;
-    GList *l;
-    g_autofree guint64 *archive_compressed_sizes = NULL;
-    gint i;
+    g_autoptr (GPtrArray) workers = NULL;
+    guint n_workers;
 
-    g_timer_start (extract_job->common.time);
+    job_timer_start ((CommonJob *) extract_job);
 
     nautilus_progress_info_start (extract_job->common.progress);
 
     nautilus_progress_info_set_details (extract_job->common.progress,
                                         _("Preparing to extract"));
 
-    extract_job->total_files = g_list_length (extract_job->source_files);
-
-    archive_compressed_sizes = g_malloc0_n (extract_job->total_files,
-                                            sizeof (guint64));
+    extract_job->archives = g_array_new (FALSE, TRUE, sizeof (ExtractArchive));
+    g_array_set_clear_func (extract_job->archives, extract_archive_clear);
     extract_job->total_compressed_size = 0;
 
-    for (l = extract_job->source_files, i = 0;
+    for (GList *l = extract_job->source_files;
          l != NULL && !job_aborted ((CommonJob *) extract_job);
-         l = l->next, i++)
+         l = l->next)
     {
-        GFile *source_file;
+        ExtractArchive archive = { 0 };
         g_autoptr (GFileInfo) info = NULL;
 
-        source_file = G_FILE (l->data);
-        info = g_file_query_info (source_file,
+        archive.job = extract_job;
+        archive.source_file = g_object_ref (G_FILE (l->data));
+
+        info = g_file_query_info (archive.source_file,
                                   G_FILE_ATTRIBUTE_STANDARD_SIZE,
                                   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
                                   extract_job->common.cancellable,
@@ -8644,65 +9862,38 @@ extract_task_thread_func (GTask        *task,
 
         if (info)
         {
-            archive_compressed_sizes[i] = g_file_info_get_size (info);
-            extract_job->total_compressed_size += archive_compressed_sizes[i];
+            archive.compressed_size = g_file_info_get_size (info);
+            extract_job->total_compressed_size += archive.compressed_size;
         }
+
+        g_array_append_val (extract_job->archives, archive);
     }
 
-    extract_job->base_progress = 0;
+    extract_job->total_files = g_list_length (extract_job->source_files);
 
-    for (l = extract_job->source_files, i = 0;
-         l != NULL && !job_aborted ((CommonJob *) extract_job);
-         l = l->next, i++)
-    {
-        g_autoptr (AutoarExtractor) extractor = NULL;
-
-        extractor = autoar_extractor_new (G_FILE (l->data),
-                                          extract_job->destination_directory);
-
-        autoar_extractor_set_notify_interval (extractor,
-                                              PROGRESS_NOTIFY_INTERVAL);
-        g_signal_connect (extractor, "scanned",
-                          G_CALLBACK (extract_job_on_scanned),
-                          extract_job);
-        g_signal_connect (extractor, "error",
-                          G_CALLBACK (extract_job_on_error),
-                          extract_job);
-        g_signal_connect (extractor, "decide-destination",
-                          G_CALLBACK (extract_job_on_decide_destination),
-                          extract_job);
-        g_signal_connect (extractor, "progress",
-                          G_CALLBACK (extract_job_on_progress),
-                          extract_job);
-        g_signal_connect (extractor, "completed",
-                          G_CALLBACK (extract_job_on_completed),
-                          extract_job);
-        g_signal_connect (extractor, "request-passphrase",
-                          G_CALLBACK (extract_job_on_request_passphrase),
-                          extract_job);
-
-        extract_job->archive_compressed_size = archive_compressed_sizes[i];
-        extract_job->destination_decided = FALSE;
-        extract_job->extraction_failed = FALSE;
-
-        autoar_extractor_start (extractor,
-                                extract_job->common.cancellable);
-
-        g_signal_handlers_disconnect_by_data (extractor,
-                                              extract_job);
-
-        if (!extract_job->extraction_failed)
-        {
-            extract_job->base_progress += (gdouble) extract_job->archive_compressed_size /
-                                          (gdouble) extract_job->total_compressed_size;
-        }
-        else
-        {
-            extract_job->total_files--;
-            extract_job->base_progress *= extract_job->total_compressed_size;
-            extract_job->total_compressed_size -= extract_job->archive_compressed_size;
-            extract_job->base_progress /= extract_job->total_compressed_size;
-        }
+    nautilus_progress_info_manager_wait_for_device (extract_job->common.progress,
+                                                    extract_job->destination_directory);
+
+    /* Archives are independent of each other, so extract several at once.
+     * This thread is one of the workers.
+     */
+    n_workers = MIN (g_get_num_processors (), EXTRACT_MAX_WORKERS);
+    n_workers = MIN (n_workers, extract_job->archives->len);
+
+    workers = g_ptr_array_new ();
+    for (guint i = 1; i < n_workers; i++)
+    {
+        g_ptr_array_add (workers,
+                         g_thread_new ("nautilus-extract",
+                                       extract_worker_thread_func,
+                                       extract_job));
+    }
+
+    extract_worker_thread_func (extract_job);
+
+    for (guint i = 0; i < workers->len; i++)
+    {
+        g_thread_join (g_ptr_array_index (workers, i));
     }
 
     if (!job_aborted ((CommonJob *) extract_job))
@@ -8747,6 +9938,8 @@ nautilus_file_operations_extract_files (GList                          *files,
     extract_job->destination_directory = g_object_ref (destination_directory);
     extract_job->done_callback = done_callback;
     extract_job->done_callback_data = done_callback_data;
+    g_mutex_init (&extract_job->mutex);
+    g_mutex_init (&extract_job->dialog_mutex);
 
     inhibit_power_manager ((CommonJob *) extract_job, _("Extracting Files"));
 
@@ -8822,7 +10015,7 @@ compress_job_on_progress (AutoarCompressor *compressor,
     }
     nautilus_progress_info_take_status (common->progress, status);
 
-    elapsed = g_timer_elapsed (common->time, NULL);
+    elapsed = job_timer_elapsed (common);
 
     transfer_rate = 0;
     remaining_time = -1;
@@ -9035,8 +10228,9 @@ compress_task_thread_func (GTask        *task,
     CompressJob *compress_job = task_data;
     g_auto (SourceInfo) source_info = SOURCE_INFO_INIT;
     g_autoptr (AutoarCompressor) compressor = NULL;
+    g_autoptr (GFile) output_dir = NULL;
 
-    g_timer_start (compress_job->common.time);
+    job_timer_start ((CommonJob *) compress_job);
 
     nautilus_progress_info_start (compress_job->common.progress);
 
@@ -9048,6 +10242,14 @@ compress_task_thread_func (GTask        *task,
     compress_job->total_files = source_info.num_files;
     compress_job->total_size = source_info.num_bytes;
 
+    output_dir = g_file_get_parent (compress_job->output_file);
+    nautilus_progress_info_manager_wait_for_device (compress_job->common.progress,
+                                                    output_dir);
+    if (job_aborted ((CommonJob *) compress_job))
+    {
+        return;
+    }
+
     compressor = autoar_compressor_new (compress_job->source_files,
                                         compress_job->output_file,
                                         compress_job->format,
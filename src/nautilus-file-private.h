@@ -90,6 +90,16 @@ struct NautilusFileDetails
 	char *thumbnail_path;
 	GdkPixbuf *thumbnail;
 	time_t thumbnail_mtime;
+	/* Built from the thumbnail on demand, see nautilus_file_get_thumbnail_icon() */
+	GdkTexture *thumbnail_texture;
+	/* Only for the last requested size, which is the one the view shows */
+	GdkPaintable *thumbnail_paintable;
+	int thumbnail_paintable_size;
+	int thumbnail_paintable_scale;
+
+	/* Formatted dates by attribute quark, see get_date_as_cached_string() */
+	GHashTable *date_strings;
+	guint date_strings_generation;
 
 	GList *mime_list; /* If this is a directory, the list of MIME types in it. */
 
@@ -272,6 +282,7 @@ void                   nautilus_file_info_providers_done                (Nautilu
 /* Thumbnailing: */
 void          nautilus_file_set_is_thumbnailing            (NautilusFile           *file,
 							    gboolean                is_thumbnailing);
+void          nautilus_file_clear_thumbnail                (NautilusFile           *file);
 
 NautilusFileOperation *nautilus_file_operation_new      (NautilusFile                  *file,
 							 NautilusFileOperationCallback  callback,
@@ -64,6 +64,7 @@
 #include "nautilus-lib-self-check-functions.h"
 #include "nautilus-metadata.h"
 #include "nautilus-module.h"
+#include "nautilus-progress-info.h"
 #include "nautilus-signaller.h"
 #include "nautilus-tag-manager.h"
 #include "nautilus-thumbnails.h"
@@ -907,11 +908,9 @@ finalize (GObject *object)
     g_free (file->details->description);
     g_free (file->details->activation_uri);
     g_clear_object (&file->details->custom_icon);
+    g_clear_pointer (&file->details->date_strings, g_hash_table_unref);
 
-    if (file->details->thumbnail)
-    {
-        g_object_unref (file->details->thumbnail);
-    }
+    nautilus_file_clear_thumbnail (file);
 
     if (file->details->mount)
     {
@@ -2110,96 +2109,497 @@ nautilus_file_rename_handle_file_gone (NautilusFile                  *file,
     return FALSE;
 }
 
+typedef enum
+{
+    BATCH_RENAME_PENDING,
+    BATCH_RENAME_DONE,
+    BATCH_RENAME_FAILED,
+} BatchRenameState;
+
 typedef struct
 {
-    NautilusFileOperation *op;
     NautilusFile *file;
-} BatchRenameData;
+    GFile *location;
+    char *old_name;
+    char *new_name;
 
-static void
-batch_rename_get_info_callback (GObject      *source_object,
-                                GAsyncResult *res,
-                                gpointer      callback_data)
+    /* Only touched by the rename thread until it finishes. */
+    GFile *current;
+    char *current_name;
+    GFileInfo *new_info;
+    BatchRenameState state;
+    /* Whether the file currently has a temporary name, which must not be
+     * left behind whatever happens to the entry. */
+    gboolean is_moved_aside;
+} BatchRenameEntry;
+
+/* The rename thread records every rename it performs, so the main thread can
+ * replay them in the same order and keep the directory's name hash free of
+ * collisions while a cycle is being resolved.
+ */
+typedef struct
+{
+    BatchRenameEntry *entry;
+    char *name;
+    gboolean is_final;
+} BatchRenameStep;
+
+typedef struct
+{
+    NautilusProgressInfo *progress;
+    GList *old_files;
+    GList *new_files;
+    GError *error;
+    guint n_total;
+    gint n_processed;
+    guint n_pending_groups;
+    gboolean record_undo;
+} BatchRenameJob;
+
+/* All the renames in one directory, processed in order by a single thread. */
+typedef struct
 {
     NautilusFileOperation *op;
-    NautilusDirectory *directory;
-    NautilusFile *existing_file;
-    char *old_uri;
-    char *new_uri;
-    const char *new_name;
-    GFileInfo *new_info;
+    GPtrArray *entries;
+    GPtrArray *steps;
     GError *error;
-    BatchRenameData *data;
+} BatchRenameGroup;
 
-    data = callback_data;
+static void
+batch_rename_entry_free (BatchRenameEntry *entry)
+{
+    nautilus_file_unref (entry->file);
+    g_object_unref (entry->location);
+    g_clear_object (&entry->current);
+    g_clear_object (&entry->new_info);
+    g_free (entry->old_name);
+    g_free (entry->new_name);
+    g_free (entry->current_name);
+    g_free (entry);
+}
 
-    op = data->op;
-    op->file = data->file;
+static void
+batch_rename_step_free (BatchRenameStep *step)
+{
+    g_free (step->name);
+    g_free (step);
+}
 
-    error = NULL;
-    new_info = g_file_query_info_finish (G_FILE (source_object), res, &error);
-    if (new_info != NULL)
+static void
+batch_rename_group_free (BatchRenameGroup *group)
+{
+    g_ptr_array_unref (group->entries);
+    g_ptr_array_unref (group->steps);
+    g_clear_error (&group->error);
+    g_free (group);
+}
+
+static void
+batch_rename_job_free (BatchRenameJob *job)
+{
+    g_clear_object (&job->progress);
+    g_list_free_full (job->old_files, g_object_unref);
+    g_list_free_full (job->new_files, g_object_unref);
+    g_clear_error (&job->error);
+    g_free (job);
+}
+
+static gboolean
+batch_rename_entry_move (BatchRenameGroup  *group,
+                         GHashTable        *occupied,
+                         BatchRenameEntry  *entry,
+                         const char        *name,
+                         gboolean           is_final,
+                         GCancellable      *cancellable,
+                         GError           **error)
+{
+    BatchRenameStep *step;
+    GFile *renamed;
+
+    renamed = g_file_set_display_name (entry->current, name, cancellable, error);
+    if (renamed == NULL)
     {
-        old_uri = nautilus_file_get_uri (op->file);
+        return FALSE;
+    }
 
-        new_name = g_file_info_get_name (new_info);
+    if (g_hash_table_lookup (occupied, entry->current_name) == entry)
+    {
+        g_hash_table_remove (occupied, entry->current_name);
+    }
+    g_free (entry->current_name);
+    entry->current_name = g_strdup (name);
+    g_hash_table_replace (occupied, entry->current_name, entry);
 
-        directory = op->file->details->directory;
+    g_object_unref (entry->current);
+    entry->current = renamed;
+    entry->is_moved_aside = !is_final && g_strcmp0 (name, entry->old_name) != 0;
 
-        /* If there was another file by the same name in this
-         * directory and it is not the same file that we are
-         * renaming, mark it gone.
-         */
-        existing_file = nautilus_directory_find_file_by_name (directory, new_name);
-        if (existing_file != NULL && existing_file != op->file)
+    step = g_new0 (BatchRenameStep, 1);
+    step->entry = entry;
+    step->name = g_strdup (name);
+    step->is_final = is_final;
+    g_ptr_array_add (group->steps, step);
+
+    return TRUE;
+}
+
+static void
+batch_rename_entry_finish (BatchRenameGroup *group,
+                           BatchRenameEntry *entry,
+                           GError           *error)
+{
+    BatchRenameJob *job = group->op->data;
+    gint n_processed;
+
+    if (error == NULL)
+    {
+        entry->state = BATCH_RENAME_DONE;
+        entry->new_info = g_file_query_info (entry->current,
+                                             NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
+                                             0, NULL, NULL);
+    }
+    else
+    {
+        DEBUG ("Batch rename of %s to %s failed: %s",
+               entry->old_name, entry->new_name, error->message);
+
+        entry->state = BATCH_RENAME_FAILED;
+        if (group->error == NULL)
         {
-            nautilus_file_mark_gone (existing_file);
-            nautilus_file_changed (existing_file);
+            group->error = g_error_copy (error);
         }
+    }
 
-        update_info_and_name (op->file, new_info);
+    n_processed = g_atomic_int_add (&job->n_processed, 1) + 1;
+    nautilus_progress_info_take_details (job->progress,
+                                         g_strdup_printf (_("%'d of %'d"),
+                                                          n_processed, job->n_total));
+    nautilus_progress_info_set_progress (job->progress, n_processed, job->n_total);
+}
 
-        new_uri = nautilus_file_get_uri (op->file);
-        nautilus_directory_moved (old_uri, new_uri);
-        g_free (new_uri);
-        g_free (old_uri);
-        g_object_unref (new_info);
+/* Renames @entry, then every entry that was waiting for the name it freed. */
+static void
+batch_rename_entry_chain (BatchRenameGroup *group,
+                          GHashTable       *occupied,
+                          GHashTable       *waiting,
+                          BatchRenameEntry *entry,
+                          gboolean          force,
+                          GCancellable     *cancellable)
+{
+    while (entry != NULL &&
+           entry->state == BATCH_RENAME_PENDING &&
+           !g_cancellable_is_cancelled (cancellable))
+    {
+        g_autoptr (GError) error = NULL;
+        g_autofree char *freed_name = NULL;
+        BatchRenameEntry *blocker;
+        BatchRenameEntry *next;
+
+        blocker = g_hash_table_lookup (occupied, entry->new_name);
+        if (!force && blocker != NULL && blocker != entry)
+        {
+            return;
+        }
+        force = FALSE;
+
+        freed_name = g_strdup (entry->current_name);
+        batch_rename_entry_move (group, occupied, entry, entry->new_name, TRUE,
+                                 cancellable, &error);
+        batch_rename_entry_finish (group, entry, error);
+        if (error != NULL)
+        {
+            return;
+        }
+
+        next = g_hash_table_lookup (waiting, freed_name);
+        entry = next != entry ? next : NULL;
+    }
+}
+
+static gboolean
+batch_rename_entry_move_aside (BatchRenameGroup  *group,
+                               GHashTable        *occupied,
+                               BatchRenameEntry  *entry,
+                               GCancellable      *cancellable,
+                               GError           **error)
+{
+    for (guint attempt = 0; attempt < 100; attempt++)
+    {
+        g_autofree char *temporary_name = NULL;
+        g_autoptr (GError) local_error = NULL;
+
+        temporary_name = g_strdup_printf (".%s.nautilus-rename-%u", entry->old_name, attempt);
+        if (strlen (temporary_name) > NAME_MAX)
+        {
+            g_free (temporary_name);
+            temporary_name = g_strdup_printf (".%08x.nautilus-rename-%u",
+                                              g_str_hash (entry->old_name), attempt);
+        }
+
+        if (g_hash_table_contains (occupied, temporary_name))
+        {
+            continue;
+        }
+
+        if (batch_rename_entry_move (group, occupied, entry, temporary_name, FALSE,
+                                     cancellable, &local_error))
+        {
+            return TRUE;
+        }
+
+        if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_EXISTS))
+        {
+            g_propagate_error (error, g_steal_pointer (&local_error));
+            return FALSE;
+        }
     }
 
-    op->renamed_files++;
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+                         _("Could not find a free temporary name"));
+    return FALSE;
+}
 
-    if (op->files == NULL ||
-        op->renamed_files + op->skipped_files == g_list_length (op->files))
+static void
+batch_rename_thread_func (GTask        *task,
+                          gpointer      source_object,
+                          gpointer      task_data,
+                          GCancellable *cancellable)
+{
+    BatchRenameGroup *group = task_data;
+    g_autoptr (GHashTable) occupied = NULL;
+    g_autoptr (GHashTable) waiting = NULL;
+
+    /* Names currently held by entries of this group, and the entry that
+     * wants to take each name. */
+    occupied = g_hash_table_new (g_str_hash, g_str_equal);
+    waiting = g_hash_table_new (g_str_hash, g_str_equal);
+
+    for (guint i = 0; i < group->entries->len; i++)
     {
-        nautilus_file_operation_complete (op, NULL, error);
+        BatchRenameEntry *entry = g_ptr_array_index (group->entries, i);
+
+        g_hash_table_insert (occupied, entry->current_name, entry);
+        if (!g_hash_table_contains (waiting, entry->new_name))
+        {
+            g_hash_table_insert (waiting, entry->new_name, entry);
+        }
     }
 
-    g_free (data);
+    /* Rename everything whose target is free, following chains as names are
+     * released, so a chain of dependent renames is resolved in one pass. */
+    for (guint i = 0; i < group->entries->len; i++)
+    {
+        batch_rename_entry_chain (group, occupied, waiting,
+                                  g_ptr_array_index (group->entries, i),
+                                  FALSE, cancellable);
+    }
 
-    if (error)
+    /* What's left is either part of a cycle, which is broken by moving one
+     * entry to a temporary name, or blocked on a name that won't be freed. */
+    for (guint i = 0; i < group->entries->len; i++)
     {
-        g_error_free (error);
+        BatchRenameEntry *entry = g_ptr_array_index (group->entries, i);
+        BatchRenameEntry *blocker;
+
+        if (entry->state != BATCH_RENAME_PENDING ||
+            g_cancellable_is_cancelled (cancellable))
+        {
+            continue;
+        }
+
+        blocker = g_hash_table_lookup (occupied, entry->new_name);
+        if (blocker != NULL && blocker != entry &&
+            blocker->state == BATCH_RENAME_PENDING)
+        {
+            g_autoptr (GError) error = NULL;
+            g_autofree char *freed_name = g_strdup (entry->current_name);
+
+            if (!batch_rename_entry_move_aside (group, occupied, entry, cancellable, &error))
+            {
+                batch_rename_entry_finish (group, entry, error);
+                continue;
+            }
+
+            batch_rename_entry_chain (group, occupied, waiting,
+                                      g_hash_table_lookup (waiting, freed_name),
+                                      FALSE, cancellable);
+        }
+        else
+        {
+            batch_rename_entry_chain (group, occupied, waiting, entry, TRUE, cancellable);
+        }
+    }
+
+    /* Don't leave temporary names behind when cancelled in the middle of a
+     * cycle, or when the final rename failed after moving aside. Finish a
+     * pending rename if its target is free by now, otherwise put the
+     * original name back. */
+    for (guint i = 0; i < group->entries->len; i++)
+    {
+        BatchRenameEntry *entry = g_ptr_array_index (group->entries, i);
+        g_autoptr (GError) error = NULL;
+
+        if (!entry->is_moved_aside)
+        {
+            continue;
+        }
+
+        if (entry->state == BATCH_RENAME_PENDING &&
+            batch_rename_entry_move (group, occupied, entry, entry->new_name, TRUE,
+                                     NULL, NULL))
+        {
+            batch_rename_entry_finish (group, entry, NULL);
+        }
+        else if (!batch_rename_entry_move (group, occupied, entry, entry->old_name, FALSE,
+                                           NULL, &error))
+        {
+            g_warning ("Could not restore %s from its temporary name %s: %s",
+                       entry->old_name, entry->current_name, error->message);
+        }
     }
+
+    g_task_return_boolean (task, TRUE);
 }
 
+static void
+batch_rename_apply_step (BatchRenameJob  *job,
+                         BatchRenameStep *step)
+{
+    BatchRenameEntry *entry = step->entry;
+    NautilusDirectory *directory;
+    NautilusFile *existing_file;
+    g_autofree char *old_uri = NULL;
+    g_autofree char *new_uri = NULL;
+
+    if (!step->is_final || entry->state != BATCH_RENAME_DONE)
+    {
+        nautilus_file_update_name (entry->file, step->name);
+        return;
+    }
+
+    directory = entry->file->details->directory;
+
+    /* If there was another file by the same name in this
+     * directory and it is not the same file that we are
+     * renaming, mark it gone.
+     */
+    existing_file = nautilus_directory_find_file_by_name (directory,
+                                                          entry->new_info != NULL ?
+                                                          g_file_info_get_name (entry->new_info) :
+                                                          step->name);
+    if (existing_file != NULL && existing_file != entry->file)
+    {
+        nautilus_file_mark_gone (existing_file);
+        nautilus_file_changed (existing_file);
+    }
+
+    if (entry->new_info != NULL)
+    {
+        update_info_and_name (entry->file, entry->new_info);
+    }
+    else
+    {
+        g_autofree char *basename = g_file_get_basename (entry->current);
+
+        nautilus_file_update_name (entry->file, basename);
+    }
+
+    old_uri = g_file_get_uri (entry->location);
+    new_uri = g_file_get_uri (entry->current);
+    nautilus_directory_moved (old_uri, new_uri);
+    nautilus_tag_manager_update_moved_uris (nautilus_tag_manager_get (),
+                                            entry->location,
+                                            entry->current);
+
+    job->old_files = g_list_prepend (job->old_files, g_object_ref (entry->location));
+    job->new_files = g_list_prepend (job->new_files, g_object_ref (entry->current));
+}
+
+static void
+batch_rename_group_done (GObject      *source_object,
+                         GAsyncResult *res,
+                         gpointer      user_data)
+{
+    BatchRenameGroup *group;
+    NautilusFileOperation *op;
+    BatchRenameJob *job;
+    GError *error = NULL;
+
+    group = g_task_get_task_data (G_TASK (res));
+    op = group->op;
+    job = op->data;
+
+    for (guint i = 0; i < group->steps->len; i++)
+    {
+        batch_rename_apply_step (job, g_ptr_array_index (group->steps, i));
+    }
+
+    for (guint i = 0; i < group->entries->len; i++)
+    {
+        BatchRenameEntry *entry = g_ptr_array_index (group->entries, i);
+
+        if (entry->state == BATCH_RENAME_DONE)
+        {
+            op->renamed_files++;
+        }
+        else
+        {
+            op->skipped_files++;
+            nautilus_file_changed (entry->file);
+        }
+    }
+
+    if (job->error == NULL && group->error != NULL)
+    {
+        job->error = g_steal_pointer (&group->error);
+    }
+
+    job->n_pending_groups--;
+    if (job->n_pending_groups > 0)
+    {
+        return;
+    }
+
+    nautilus_progress_info_finish (job->progress);
+
+    if (job->new_files != NULL && job->record_undo)
+    {
+        op->undo_info = nautilus_file_undo_info_batch_rename_new (g_list_length (job->new_files));
+
+        nautilus_file_undo_info_batch_rename_set_data_pre (NAUTILUS_FILE_UNDO_INFO_BATCH_RENAME (op->undo_info),
+                                                           g_list_reverse (g_steal_pointer (&job->old_files)));
+        nautilus_file_undo_info_batch_rename_set_data_post (NAUTILUS_FILE_UNDO_INFO_BATCH_RENAME (op->undo_info),
+                                                            g_list_reverse (g_steal_pointer (&job->new_files)));
+    }
+
+    /* Partial success still completes the operation, so the renames that
+     * went through can be undone. */
+    if (op->renamed_files == 0)
+    {
+        error = job->error;
+    }
+
+    nautilus_file_operation_complete (op, NULL, error);
+}
+
+/* Renames run in a thread per parent directory, so independent directories
+ * are processed concurrently while renames that depend on each other, such as
+ * a -> b and b -> a, are ordered within their directory.
+ */
 static void
 real_batch_rename (GList                         *files,
                    GList                         *new_names,
                    NautilusFileOperationCallback  callback,
                    gpointer                       callback_data)
 {
-    GList *l1, *l2, *old_files, *new_files;
+    GList *l1, *l2;
     NautilusFileOperation *op;
-    GFile *location;
-    GString *new_name;
     NautilusFile *file;
-    GError *error;
-    GFile *new_file;
-    BatchRenameData *data;
-
-    error = NULL;
-    old_files = NULL;
-    new_files = NULL;
+    GString *new_name;
+    BatchRenameJob *job;
+    g_autoptr (GHashTable) groups = NULL;
+    GHashTableIter iter;
+    BatchRenameGroup *group;
 
     /* Set up a batch renaming operation. */
     op = nautilus_file_operation_new (files->data, callback, callback_data);
@@ -2207,6 +2607,11 @@ real_batch_rename (GList                         *files,
     op->renamed_files = 0;
     op->skipped_files = 0;
 
+    job = g_new0 (BatchRenameJob, 1);
+    job->record_undo = !nautilus_file_undo_manager_is_operating ();
+    op->data = job;
+    op->free_data = (GDestroyNotify) batch_rename_job_free;
+
     for (l1 = files->next; l1 != NULL; l1 = l1->next)
     {
         file = NAUTILUS_FILE (l1->data);
@@ -2215,14 +2620,18 @@ real_batch_rename (GList                         *files,
                                                                 op);
     }
 
+    groups = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                    g_object_unref, NULL);
+
     for (l1 = files, l2 = new_names; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
     {
         g_autofree gchar *new_file_name = NULL;
+        BatchRenameEntry *entry;
+        GFile *parent;
+
         file = NAUTILUS_FILE (l1->data);
         new_name = l2->data;
 
-        location = nautilus_file_get_location (file);
-
         new_file_name = nautilus_file_can_rename_file (file,
                                                        new_name->str,
                                                        callback,
@@ -2235,59 +2644,62 @@ real_batch_rename (GList                         *files,
             continue;
         }
 
-        g_assert (G_IS_FILE (location));
+        entry = g_new0 (BatchRenameEntry, 1);
+        entry->file = nautilus_file_ref (file);
+        entry->location = nautilus_file_get_location (file);
+        entry->old_name = nautilus_file_get_name (file);
+        entry->new_name = g_steal_pointer (&new_file_name);
+        entry->current = g_object_ref (entry->location);
+        entry->current_name = g_strdup (entry->old_name);
 
-        /* Do the renaming. */
-        new_file = g_file_set_display_name (location,
-                                            new_file_name,
-                                            op->cancellable,
-                                            &error);
+        g_assert (G_IS_FILE (entry->location));
 
-        data = g_new0 (BatchRenameData, 1);
-        data->op = op;
-        data->file = file;
-
-        g_file_query_info_async (new_file,
-                                 NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
-                                 0,
-                                 G_PRIORITY_DEFAULT,
-                                 op->cancellable,
-                                 batch_rename_get_info_callback,
-                                 data);
-
-        if (error != NULL)
+        parent = g_file_get_parent (entry->location);
+        group = g_hash_table_lookup (groups, parent);
+        if (group == NULL)
         {
-            g_warning ("Batch rename for file \"%s\" failed", nautilus_file_get_name (file));
-            g_error_free (error);
-            error = NULL;
-
-            op->skipped_files++;
+            group = g_new0 (BatchRenameGroup, 1);
+            group->op = op;
+            group->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) batch_rename_entry_free);
+            group->steps = g_ptr_array_new_with_free_func ((GDestroyNotify) batch_rename_step_free);
+            g_hash_table_insert (groups, parent, group);
         }
         else
         {
-            old_files = g_list_append (old_files, location);
-            new_files = g_list_append (new_files, new_file);
+            g_object_unref (parent);
         }
+        g_ptr_array_add (group->entries, entry);
+        job->n_total++;
     }
 
-    /* Tell the undo manager a batch rename is taking place if at least
-     * a file has been renamed*/
-    if (!nautilus_file_undo_manager_is_operating () && op->skipped_files != g_list_length (files))
+    if (job->n_total == 0)
     {
-        op->undo_info = nautilus_file_undo_info_batch_rename_new (g_list_length (new_files));
+        nautilus_file_operation_complete (op, NULL, NULL);
+        return;
+    }
 
-        nautilus_file_undo_info_batch_rename_set_data_pre (NAUTILUS_FILE_UNDO_INFO_BATCH_RENAME (op->undo_info),
-                                                           old_files);
+    /* Cancelling from the progress UI cancels the operation. */
+    job->progress = nautilus_progress_info_new ();
+    g_object_unref (op->cancellable);
+    op->cancellable = g_object_ref (nautilus_progress_info_get_cancellable (job->progress));
 
-        nautilus_file_undo_info_batch_rename_set_data_post (NAUTILUS_FILE_UNDO_INFO_BATCH_RENAME (op->undo_info),
-                                                            new_files);
+    nautilus_progress_info_take_status (job->progress,
+                                        g_strdup_printf (ngettext ("Renaming %'d file",
+                                                                   "Renaming %'d files",
+                                                                   job->n_total),
+                                                         job->n_total));
+    nautilus_progress_info_start (job->progress);
 
-        nautilus_file_undo_manager_set_action (op->undo_info);
-    }
+    job->n_pending_groups = g_hash_table_size (groups);
 
-    if (op->skipped_files == g_list_length (files))
+    g_hash_table_iter_init (&iter, groups);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &group))
     {
-        nautilus_file_operation_complete (op, NULL, error);
+        g_autoptr (GTask) task = NULL;
+
+        task = g_task_new (NULL, op->cancellable, batch_rename_group_done, NULL);
+        g_task_set_task_data (task, group, (GDestroyNotify) batch_rename_group_free);
+        g_task_run_in_thread (task, batch_rename_thread_func);
     }
 }
 
@@ -4233,6 +4645,24 @@ nautilus_file_set_metadata_list (NautilusFile  *file,
     NAUTILUS_FILE_CLASS (G_OBJECT_GET_CLASS (file))->set_metadata_as_list (file, key, list);
 }
 
+/**
+ * nautilus_file_set_metadata_from_info:
+ * @file: A #NautilusFile to set metadata into.
+ * @info: (transfer none): A #GFileInfo holding "metadata::" attributes.
+ *
+ * Set several metadata attributes with a single write. Attributes of
+ * type %G_FILE_ATTRIBUTE_TYPE_INVALID are unset.
+ */
+void
+nautilus_file_set_metadata_from_info (NautilusFile *file,
+                                      GFileInfo    *info)
+{
+    g_return_if_fail (NAUTILUS_IS_FILE (file));
+    g_return_if_fail (G_IS_FILE_INFO (info));
+
+    NAUTILUS_FILE_CLASS (G_OBJECT_GET_CLASS (file))->set_metadata_from_info (file, info);
+}
+
 gboolean
 nautilus_file_get_boolean_metadata (NautilusFile *file,
                                     const char   *key,
@@ -5085,54 +5515,112 @@ nautilus_file_get_thumbnail_path (NautilusFile *file)
     return g_strdup (file->details->thumbnail_path);
 }
 
+void
+nautilus_file_clear_thumbnail (NautilusFile *file)
+{
+    g_clear_object (&file->details->thumbnail);
+    g_clear_object (&file->details->thumbnail_texture);
+    g_clear_object (&file->details->thumbnail_paintable);
+}
+
+static void
+count_thumbnail_texture_upload (void)
+{
+    static guint uploads = 0;
+    static gint64 period_start = 0;
+    gint64 now;
+
+    uploads++;
+
+    now = g_get_monotonic_time ();
+    if (now - period_start >= G_USEC_PER_SEC)
+    {
+        if (period_start != 0)
+        {
+            DEBUG ("Uploaded %u thumbnail textures in %.1f s",
+                   uploads, (now - period_start) / (double) G_USEC_PER_SEC);
+        }
+
+        uploads = 0;
+        period_start = now;
+    }
+}
+
+static GdkPaintable *
+create_thumbnail_paintable (NautilusFile *file,
+                            int           size,
+                            int           scale)
+{
+    GdkPixbuf *pixbuf = file->details->thumbnail;
+    double width = gdk_pixbuf_get_width (pixbuf) / scale;
+    double height = gdk_pixbuf_get_height (pixbuf) / scale;
+    g_autoptr (GtkSnapshot) snapshot = gtk_snapshot_new ();
+    GskRoundedRect rounded_rect;
+
+    if (file->details->thumbnail_texture == NULL)
+    {
+        file->details->thumbnail_texture = gdk_texture_new_for_pixbuf (pixbuf);
+        count_thumbnail_texture_upload ();
+    }
+
+    if (MAX (width, height) > size)
+    {
+        float scale_down_factor = MAX (width, height) / size;
+
+        width = width / scale_down_factor;
+        height = height / scale_down_factor;
+    }
+
+    gsk_rounded_rect_init_from_rect (&rounded_rect,
+                                     &GRAPHENE_RECT_INIT (0, 0, width, height),
+                                     2 /* radius*/);
+    gtk_snapshot_push_rounded_clip (snapshot, &rounded_rect);
+
+    gdk_paintable_snapshot (GDK_PAINTABLE (file->details->thumbnail_texture),
+                            GDK_SNAPSHOT (snapshot),
+                            width, height);
+
+    if (size >= NAUTILUS_GRID_ICON_SIZE_SMALL &&
+        nautilus_is_video_file (file))
+    {
+        nautilus_ui_frame_video (snapshot, width, height);
+    }
+
+    gtk_snapshot_pop (snapshot); /* End rounded clip */
+
+    DEBUG ("Created thumbnail paintable, at size %d %d",
+           (int) (width), (int) (height));
+
+    return gtk_snapshot_to_paintable (snapshot, NULL);
+}
+
 static NautilusIconInfo *
 nautilus_file_get_thumbnail_icon (NautilusFile          *file,
                                   int                    size,
                                   int                    scale,
                                   NautilusFileIconFlags  flags)
 {
-    g_autoptr (GdkPaintable) paintable = NULL;
+    GdkPaintable *paintable = NULL;
     NautilusIconInfo *icon;
 
     icon = NULL;
 
     if (file->details->thumbnail != NULL)
     {
-        GdkPixbuf *pixbuf = file->details->thumbnail;
-        double width = gdk_pixbuf_get_width (pixbuf) / scale;
-        double height = gdk_pixbuf_get_height (pixbuf) / scale;
-        g_autoptr (GdkTexture) texture = gdk_texture_new_for_pixbuf (pixbuf);
-        g_autoptr (GtkSnapshot) snapshot = gtk_snapshot_new ();
-        GskRoundedRect rounded_rect;
-
-        if (MAX (width, height) > size)
-        {
-            float scale_down_factor = MAX (width, height) / size;
-
-            width = width / scale_down_factor;
-            height = height / scale_down_factor;
-        }
-
-        gsk_rounded_rect_init_from_rect (&rounded_rect,
-                                         &GRAPHENE_RECT_INIT (0, 0, width, height),
-                                         2 /* radius*/);
-        gtk_snapshot_push_rounded_clip (snapshot, &rounded_rect);
-
-        gdk_paintable_snapshot (GDK_PAINTABLE (texture),
-                                GDK_SNAPSHOT (snapshot),
-                                width, height);
-
-        if (size >= NAUTILUS_GRID_ICON_SIZE_SMALL &&
-            nautilus_is_video_file (file))
+        /* Binding a cell asks for the icon again, so keep the paintable
+         * around until the thumbnail or the zoom level changes.
+         */
+        if (file->details->thumbnail_paintable == NULL ||
+            file->details->thumbnail_paintable_size != size ||
+            file->details->thumbnail_paintable_scale != scale)
         {
-            nautilus_ui_frame_video (snapshot, width, height);
+            g_clear_object (&file->details->thumbnail_paintable);
+            file->details->thumbnail_paintable = create_thumbnail_paintable (file, size, scale);
+            file->details->thumbnail_paintable_size = size;
+            file->details->thumbnail_paintable_scale = scale;
         }
 
-        gtk_snapshot_pop (snapshot); /* End rounded clip */
-
-        DEBUG ("Returning thumbnailed image, at size %d %d",
-               (int) (width), (int) (height));
-        paintable = gtk_snapshot_to_paintable (snapshot, NULL);
+        paintable = file->details->thumbnail_paintable;
     }
     else if (file->details->thumbnail_path == NULL &&
              file->details->can_read &&
@@ -5487,6 +5975,91 @@ nautilus_file_get_date_as_string (NautilusFile       *file,
     return result_with_ratio;
 }
 
+/* Formatted dates are cached per file, see get_date_as_cached_string().
+ * Dates are formatted relative to the current day, so all the cached
+ * strings expire together at midnight, or when the clock format changes.
+ */
+static guint date_strings_generation = 0;
+
+static void
+invalidate_date_strings (void)
+{
+    date_strings_generation++;
+}
+
+static void
+update_date_strings_generation (void)
+{
+    static gint64 expiry = 0;
+    static gboolean connected = FALSE;
+    g_autoptr (GDateTime) now = NULL;
+    g_autoptr (GDateTime) today_midnight = NULL;
+    g_autoptr (GDateTime) tomorrow_midnight = NULL;
+
+    if (!connected)
+    {
+        g_signal_connect_swapped (gnome_interface_preferences, "changed::clock-format",
+                                  G_CALLBACK (invalidate_date_strings), NULL);
+        connected = TRUE;
+    }
+
+    /* A deadline in wall-clock time, unlike a timeout, also holds across
+     * suspend. */
+    if (g_get_real_time () < expiry)
+    {
+        return;
+    }
+
+    invalidate_date_strings ();
+
+    now = g_date_time_new_now_local ();
+    today_midnight = g_date_time_new_local (g_date_time_get_year (now),
+                                            g_date_time_get_month (now),
+                                            g_date_time_get_day_of_month (now),
+                                            0, 0, 0);
+    tomorrow_midnight = g_date_time_add_days (today_midnight, 1);
+    expiry = g_date_time_to_unix (tomorrow_midnight) * G_USEC_PER_SEC;
+}
+
+static char *
+get_date_as_cached_string (NautilusFile       *file,
+                           GQuark              attribute_q,
+                           NautilusDateType    date_type,
+                           NautilusDateFormat  date_format)
+{
+    const char *cached;
+    char *result;
+
+    update_date_strings_generation ();
+
+    if (file->details->date_strings != NULL &&
+        file->details->date_strings_generation != date_strings_generation)
+    {
+        g_clear_pointer (&file->details->date_strings, g_hash_table_unref);
+    }
+
+    if (file->details->date_strings != NULL &&
+        g_hash_table_lookup_extended (file->details->date_strings,
+                                      GUINT_TO_POINTER (attribute_q),
+                                      NULL, (gpointer *) &cached))
+    {
+        return g_strdup (cached);
+    }
+
+    result = nautilus_file_get_date_as_string (file, date_type, date_format);
+
+    if (file->details->date_strings == NULL)
+    {
+        file->details->date_strings = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+        file->details->date_strings_generation = date_strings_generation;
+    }
+    g_hash_table_insert (file->details->date_strings,
+                         GUINT_TO_POINTER (attribute_q),
+                         g_strdup (result));
+
+    return result;
+}
+
 static void
 show_directory_item_count_changed_callback (gpointer callback_data)
 {
@@ -7064,63 +7637,63 @@ nautilus_file_get_string_attribute_q (NautilusFile *file,
     }
     if (attribute_q == attribute_date_modified_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_MODIFIED,
-                                                 NAUTILUS_DATE_FORMAT_REGULAR);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_MODIFIED,
+                                          NAUTILUS_DATE_FORMAT_REGULAR);
     }
     if (attribute_q == attribute_date_modified_full_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_MODIFIED,
-                                                 NAUTILUS_DATE_FORMAT_FULL);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_MODIFIED,
+                                          NAUTILUS_DATE_FORMAT_FULL);
     }
     if (attribute_q == attribute_date_modified_with_time_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_MODIFIED,
-                                                 NAUTILUS_DATE_FORMAT_REGULAR_WITH_TIME);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_MODIFIED,
+                                          NAUTILUS_DATE_FORMAT_REGULAR_WITH_TIME);
     }
     if (attribute_q == attribute_date_accessed_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_ACCESSED,
-                                                 NAUTILUS_DATE_FORMAT_REGULAR);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_ACCESSED,
+                                          NAUTILUS_DATE_FORMAT_REGULAR);
     }
     if (attribute_q == attribute_date_accessed_full_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_ACCESSED,
-                                                 NAUTILUS_DATE_FORMAT_FULL);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_ACCESSED,
+                                          NAUTILUS_DATE_FORMAT_FULL);
     }
     if (attribute_q == attribute_date_created_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_CREATED,
-                                                 NAUTILUS_DATE_FORMAT_REGULAR);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_CREATED,
+                                          NAUTILUS_DATE_FORMAT_REGULAR);
     }
     if (attribute_q == attribute_date_created_full_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_CREATED,
-                                                 NAUTILUS_DATE_FORMAT_FULL);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_CREATED,
+                                          NAUTILUS_DATE_FORMAT_FULL);
     }
     if (attribute_q == attribute_trashed_on_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_TRASHED,
-                                                 NAUTILUS_DATE_FORMAT_REGULAR);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_TRASHED,
+                                          NAUTILUS_DATE_FORMAT_REGULAR);
     }
     if (attribute_q == attribute_trashed_on_full_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_TRASHED,
-                                                 NAUTILUS_DATE_FORMAT_FULL);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_TRASHED,
+                                          NAUTILUS_DATE_FORMAT_FULL);
     }
     if (attribute_q == attribute_recency_q)
     {
-        return nautilus_file_get_date_as_string (file,
-                                                 NAUTILUS_DATE_TYPE_RECENCY,
-                                                 NAUTILUS_DATE_FORMAT_REGULAR);
+        return get_date_as_cached_string (file, attribute_q,
+                                          NAUTILUS_DATE_TYPE_RECENCY,
+                                          NAUTILUS_DATE_FORMAT_REGULAR);
     }
     if (attribute_q == attribute_permissions_q)
     {
@@ -8247,6 +8820,9 @@ nautilus_file_emit_changed (NautilusFile *file)
 
     g_assert (NAUTILUS_IS_FILE (file));
 
+    /* Any of the dates may have changed. */
+    g_clear_pointer (&file->details->date_strings, g_hash_table_unref);
+
     /* Send out a signal. */
     g_signal_emit (file, signals[CHANGED], 0, file);
 
@@ -9076,6 +9652,13 @@ real_set_metadata_as_list (NautilusFile  *file,
     /* Dummy default impl */
 }
 
+static void
+real_set_metadata_from_info (NautilusFile *file,
+                             GFileInfo    *info)
+{
+    /* Dummy default impl */
+}
+
 static void
 nautilus_file_class_init (NautilusFileClass *class)
 {
@@ -9124,6 +9707,7 @@ nautilus_file_class_init (NautilusFileClass *class)
     class->get_deep_counts = real_get_deep_counts;
     class->set_metadata = real_set_metadata;
     class->set_metadata_as_list = real_set_metadata_as_list;
+    class->set_metadata_from_info = real_set_metadata_from_info;
 
     signals[CHANGED] =
         g_signal_new ("changed",
@@ -357,6 +357,8 @@ void                    nautilus_file_set_metadata                      (Nautilu
 void                    nautilus_file_set_metadata_list                 (NautilusFile                   *file,
 									 const char                     *key,
 									 gchar                         **list);
+void                    nautilus_file_set_metadata_from_info            (NautilusFile                   *file,
+									 GFileInfo                      *info);
 
 /* Covers for common data types. */
 gboolean                nautilus_file_get_boolean_metadata              (NautilusFile                   *file,
@@ -558,6 +560,8 @@ typedef struct {
 	void                  (* set_metadata_as_list)   (NautilusFile           *file,
 							  const char             *key,
 							  char                  **value);
+	void                  (* set_metadata_from_info) (NautilusFile           *file,
+							  GFileInfo              *info);
 	
 	void                  (* mount)                  (NautilusFile                   *file,
 							  GMountOperation                *mount_op,
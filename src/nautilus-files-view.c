@@ -108,7 +108,11 @@
 #define DUPLICATE_HORIZONTAL_ICON_OFFSET 70
 #define DUPLICATE_VERTICAL_ICON_OFFSET   30
 
-#define MAX_QUEUED_UPDATES 500
+/* Microseconds that applying pending file changes may take before the rest
+ * is deferred to the next idle, so that frames keep being drawn. */
+#define MAX_CHANGES_APPLY_TIME 8000
+/* Number of added and changed files applied between checks of the time budget */
+#define CHANGES_APPLY_BATCH_SIZE 100
 
 #define MAX_MENU_LEVELS 5
 #define TEMPLATE_LIMIT 30
@@ -204,8 +208,15 @@ typedef struct
     GList *new_added_files;
     GList *new_changed_files;
     GHashTable *non_ready_files;
-    GList *old_added_files;
-    GList *old_changed_files;
+    /* Applied in the order the files became ready, see process_old_files() */
+    GQueue old_added_files;
+    GQueue old_changed_files;
+    /* NautilusFile -> number of times it is in old_added_files */
+    GHashTable *old_added_counts;
+    /* Pending FileAndDirectory -> its link in new_added_files or in
+     * new_changed_files, see queue_pending_files() */
+    GHashTable *new_added_links;
+    GHashTable *new_changed_links;
 
     GList *pending_selection;
     GHashTable *pending_reveal;
@@ -3420,6 +3431,9 @@ nautilus_files_view_finalize (GObject *object)
     g_free (priv->toolbar_menu_sections);
 
     g_hash_table_destroy (priv->non_ready_files);
+    g_hash_table_destroy (priv->new_added_links);
+    g_hash_table_destroy (priv->new_changed_links);
+    g_hash_table_destroy (priv->old_added_counts);
     g_hash_table_destroy (priv->pending_reveal);
 
     g_clear_object (&priv->clipboard_cancellable);
@@ -3440,13 +3454,13 @@ nautilus_files_view_finalize (GObject *object)
 void
 nautilus_files_view_display_selection_info (NautilusFilesView *view)
 {
-    g_autolist (NautilusFile) selection = NULL;
+    g_autoptr (NautilusSelectionSnapshot) own_snapshot = NULL;
+    const NautilusSelectionSnapshot *snapshot = NULL;
     goffset non_folder_size;
     gboolean non_folder_size_known;
     guint non_folder_count, folder_count, folder_item_count;
     gboolean folder_item_count_known;
-    guint file_item_count;
-    GList *p;
+    NautilusFile *first_file;
     char *first_item_name;
     char *non_folder_count_str;
     char *non_folder_item_count_str;
@@ -3456,57 +3470,47 @@ nautilus_files_view_display_selection_info (NautilusFilesView *view)
     char *folder_counts_str;
     char *primary_status;
     char *detail_status;
-    NautilusFile *file;
 
     g_return_if_fail (NAUTILUS_IS_FILES_VIEW (view));
 
-    selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
-
-    folder_item_count_known = TRUE;
-    folder_count = 0;
-    folder_item_count = 0;
-    non_folder_count = 0;
-    non_folder_size_known = FALSE;
-    non_folder_size = 0;
-    first_item_name = NULL;
-    folder_count_str = NULL;
-    folder_item_count_str = NULL;
-    folder_counts_str = NULL;
-    non_folder_count_str = NULL;
-    non_folder_item_count_str = NULL;
-    non_folder_counts_str = NULL;
+    if (NAUTILUS_FILES_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->get_selection_snapshot != NULL)
+    {
+        snapshot = NAUTILUS_FILES_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->get_selection_snapshot (view);
+    }
 
-    for (p = selection; p != NULL; p = p->next)
+    if (snapshot == NULL)
     {
-        file = p->data;
-        if (nautilus_file_is_directory (file))
+        g_autolist (NautilusFile) selection = NULL;
+
+        selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
+        own_snapshot = nautilus_selection_snapshot_new ();
+        for (GList *l = selection; l != NULL; l = l->next)
         {
-            folder_count++;
-            if (nautilus_file_get_directory_item_count (file, &file_item_count, NULL))
-            {
-                folder_item_count += file_item_count;
-            }
-            else
-            {
-                folder_item_count_known = FALSE;
-            }
+            nautilus_selection_snapshot_add (own_snapshot, l->data, l->data);
         }
-        else
+        if (selection != NULL)
         {
-            non_folder_count++;
-            if (!nautilus_file_can_get_size (file))
-            {
-                non_folder_size_known = TRUE;
-                non_folder_size += nautilus_file_get_size (file);
-            }
+            nautilus_selection_snapshot_set_first_file (own_snapshot, selection->data);
         }
 
-        if (first_item_name == NULL)
-        {
-            first_item_name = nautilus_file_get_display_name (file);
-        }
+        snapshot = own_snapshot;
     }
 
+    folder_count = nautilus_selection_snapshot_get_folder_count (snapshot);
+    folder_item_count_known = nautilus_selection_snapshot_get_folder_item_count (snapshot,
+                                                                                 &folder_item_count);
+    non_folder_count = nautilus_selection_snapshot_get_non_folder_count (snapshot);
+    non_folder_size_known = nautilus_selection_snapshot_get_non_folder_size (snapshot,
+                                                                             &non_folder_size);
+    first_file = nautilus_selection_snapshot_get_first_file (snapshot);
+    first_item_name = first_file != NULL ? nautilus_file_get_display_name (first_file) : NULL;
+    folder_count_str = NULL;
+    folder_item_count_str = NULL;
+    folder_counts_str = NULL;
+    non_folder_count_str = NULL;
+    non_folder_item_count_str = NULL;
+    non_folder_counts_str = NULL;
+
     /* Break out cases for localization's sake. But note that there are still pieces
      * being assembled in a particular order, which may be a problem for some localizers.
      */
@@ -4122,6 +4126,33 @@ ready_to_load (NautilusFile *file)
                                          NAUTILUS_FILE_ATTRIBUTES_FOR_ICON);
 }
 
+static void
+old_added_counts_add (NautilusFilesViewPrivate *priv,
+                      NautilusFile             *file)
+{
+    guint count;
+
+    count = GPOINTER_TO_UINT (g_hash_table_lookup (priv->old_added_counts, file));
+    g_hash_table_insert (priv->old_added_counts, file, GUINT_TO_POINTER (count + 1));
+}
+
+static void
+old_added_counts_remove (NautilusFilesViewPrivate *priv,
+                         NautilusFile             *file)
+{
+    guint count;
+
+    count = GPOINTER_TO_UINT (g_hash_table_lookup (priv->old_added_counts, file));
+    if (count <= 1)
+    {
+        g_hash_table_remove (priv->old_added_counts, file);
+    }
+    else
+    {
+        g_hash_table_insert (priv->old_added_counts, file, GUINT_TO_POINTER (count - 1));
+    }
+}
+
 /* Go through all the new added and changed files.
  * Put any that are not ready to load in the non_ready_files hash table.
  * Add all the rest to the old_added_files and old_changed_files lists.
@@ -4133,8 +4164,6 @@ process_new_files (NautilusFilesView *view)
     NautilusFilesViewPrivate *priv;
     g_autolist (FileAndDirectory) new_added_files = NULL;
     g_autolist (FileAndDirectory) new_changed_files = NULL;
-    GList *old_added_files;
-    GList *old_changed_files;
     GHashTable *non_ready_files;
     GList *node, *next;
     FileAndDirectory *pending;
@@ -4142,14 +4171,14 @@ process_new_files (NautilusFilesView *view)
 
     priv = nautilus_files_view_get_instance_private (view);
 
-    new_added_files = g_steal_pointer (&priv->new_added_files);
-    new_changed_files = g_steal_pointer (&priv->new_changed_files);
+    /* The pending lists are newest first. */
+    new_added_files = g_list_reverse (g_steal_pointer (&priv->new_added_files));
+    new_changed_files = g_list_reverse (g_steal_pointer (&priv->new_changed_files));
+    g_hash_table_remove_all (priv->new_added_links);
+    g_hash_table_remove_all (priv->new_changed_links);
 
     non_ready_files = priv->non_ready_files;
 
-    old_added_files = priv->old_added_files;
-    old_changed_files = priv->old_changed_files;
-
     /* Newly added files go into the old_added_files list if they're
      * ready, and into the hash table if they're not.
      */
@@ -4167,7 +4196,8 @@ process_new_files (NautilusFilesView *view)
                     g_hash_table_remove (non_ready_files, pending);
                 }
                 new_added_files = g_list_delete_link (new_added_files, node);
-                old_added_files = g_list_prepend (old_added_files, pending);
+                g_queue_push_tail (&priv->old_added_files, pending);
+                old_added_counts_add (priv, pending->file);
             }
             else
             {
@@ -4197,26 +4227,17 @@ process_new_files (NautilusFilesView *view)
                 if (still_should_show_file (view, pending))
                 {
                     new_changed_files = g_list_delete_link (new_changed_files, node);
-                    old_added_files = g_list_prepend (old_added_files, pending);
+                    g_queue_push_tail (&priv->old_added_files, pending);
+                    old_added_counts_add (priv, pending->file);
                 }
             }
             else
             {
                 new_changed_files = g_list_delete_link (new_changed_files, node);
-                old_changed_files = g_list_prepend (old_changed_files, pending);
+                g_queue_push_tail (&priv->old_changed_files, pending);
             }
         }
     }
-
-    if (old_added_files != priv->old_added_files)
-    {
-        priv->old_added_files = old_added_files;
-    }
-
-    if (old_changed_files != priv->old_changed_files)
-    {
-        priv->old_changed_files = old_changed_files;
-    }
 }
 
 static void
@@ -4309,19 +4330,18 @@ _g_lists_sort_and_check_for_intersection (GList **list_1,
 }
 
 static void
-process_old_files (NautilusFilesView *view)
+apply_file_changes (NautilusFilesView *view,
+                    GList             *added,
+                    GList             *changed)
 {
     NautilusFilesViewPrivate *priv;
-    g_autolist (FileAndDirectory) files_added = NULL;
-    g_autolist (FileAndDirectory) files_changed = NULL;
+    g_autolist (FileAndDirectory) files_added = added;
+    g_autolist (FileAndDirectory) files_changed = changed;
     FileAndDirectory *pending;
     GList *files;
     g_autoptr (GList) pending_additions = NULL;
 
     priv = nautilus_files_view_get_instance_private (view);
-    files_added = g_steal_pointer (&priv->old_added_files);
-    files_changed = g_steal_pointer (&priv->old_changed_files);
-
 
     if (files_added != NULL || files_changed != NULL)
     {
@@ -4397,16 +4417,112 @@ process_old_files (NautilusFilesView *view)
     }
 }
 
+/* Splits off the first @n elements of @queue, the oldest ones. */
+static GList *
+split_queue_head (GQueue *queue,
+                  guint   n)
+{
+    GList *head;
+    GList *last;
+
+    head = queue->head;
+    if (queue->length <= n)
+    {
+        g_queue_init (queue);
+        return head;
+    }
+
+    last = g_list_nth (head, n - 1);
+    queue->head = last->next;
+    queue->head->prev = NULL;
+    queue->length -= n;
+    last->next = NULL;
+
+    return head;
+}
+
+/* Applies the ready changes to the view in batches, until the time budget
+ * is spent. Returns whether all of them were applied.
+ */
+static gboolean
+process_old_files (NautilusFilesView *view)
+{
+    NautilusFilesViewPrivate *priv;
+    gint64 start_time;
+
+    priv = nautilus_files_view_get_instance_private (view);
+    start_time = g_get_monotonic_time ();
+
+    while (!g_queue_is_empty (&priv->old_added_files) ||
+           !g_queue_is_empty (&priv->old_changed_files))
+    {
+        GList *files_added;
+        GList *files_changed;
+
+        /* While loading, the view is only shown once everything is added,
+         * and adding everything at once sorts only once. */
+        if (priv->loading)
+        {
+            files_added = priv->old_added_files.head;
+            files_changed = priv->old_changed_files.head;
+            g_queue_init (&priv->old_added_files);
+            g_queue_init (&priv->old_changed_files);
+            g_hash_table_remove_all (priv->old_added_counts);
+            apply_file_changes (view, files_added, files_changed);
+            continue;
+        }
+
+        /* A batch of each, so that a long run of additions doesn't hold
+         * back changes and removals. */
+        files_added = split_queue_head (&priv->old_added_files, CHANGES_APPLY_BATCH_SIZE);
+        for (GList *l = files_added; l != NULL; l = l->next)
+        {
+            old_added_counts_remove (priv, ((FileAndDirectory *) l->data)->file);
+        }
+
+        files_changed = split_queue_head (&priv->old_changed_files, CHANGES_APPLY_BATCH_SIZE);
+        for (GList *l = files_changed, *next; l != NULL; l = next)
+        {
+            next = l->next;
+
+            /* A change can't be applied before the addition of the same
+             * file, so it waits until that one is applied. */
+            if (g_hash_table_contains (priv->old_added_counts,
+                                       ((FileAndDirectory *) l->data)->file))
+            {
+                files_changed = g_list_remove_link (files_changed, l);
+                g_queue_push_tail_link (&priv->old_changed_files, l);
+            }
+        }
+
+        apply_file_changes (view, files_added, files_changed);
+
+        if (g_get_monotonic_time () - start_time > MAX_CHANGES_APPLY_TIME)
+        {
+            break;
+        }
+    }
+
+    return g_queue_is_empty (&priv->old_added_files) &&
+           g_queue_is_empty (&priv->old_changed_files);
+}
+
 static void
 display_pending_files (NautilusFilesView *view)
 {
     NautilusFilesViewPrivate *priv;
     g_autolist (NautilusFile) selection = NULL;
 
+    priv = nautilus_files_view_get_instance_private (view);
+
     process_new_files (view);
-    process_old_files (view);
+    if (!process_old_files (view))
+    {
+        /* Continue as soon as the next frame allows. */
+        schedule_idle_display_of_pending_files (view);
+        return;
+    }
 
-    priv = nautilus_files_view_get_instance_private (view);
     selection = nautilus_files_view_get_selection (NAUTILUS_VIEW (view));
 
     if (selection == NULL &&
@@ -4564,10 +4680,10 @@ static void
 queue_pending_files (NautilusFilesView  *view,
                      NautilusDirectory  *directory,
                      GList              *files,
-                     GList             **pending_list)
+                     GList             **pending_list,
+                     GHashTable         *pending_links)
 {
     NautilusFilesViewPrivate *priv;
-    GList *fad_list;
 
     priv = nautilus_files_view_get_instance_private (view);
 
@@ -4576,8 +4692,43 @@ queue_pending_files (NautilusFilesView  *view,
         return;
     }
 
-    fad_list = g_list_copy_deep (files, (GCopyFunc) file_and_directory_new, directory);
-    *pending_list = g_list_concat (fad_list, *pending_list);
+    /* The view only looks at the current state of a file when applying an
+     * event for it, so repeated events for the same file are merged.
+     */
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        FileAndDirectory key = { l->data, directory };
+        FileAndDirectory *fad;
+
+        if (g_hash_table_contains (pending_links, &key))
+        {
+            continue;
+        }
+
+        if (pending_links == priv->new_changed_links)
+        {
+            GList *added_link;
+
+            added_link = g_hash_table_lookup (priv->new_added_links, &key);
+            if (added_link != NULL)
+            {
+                if (!nautilus_file_is_gone (key.file))
+                {
+                    continue;
+                }
+
+                /* Removed before the addition was shown. The removal is still
+                 * queued in case the file was shown earlier. */
+                g_hash_table_remove (priv->new_added_links, &key);
+                file_and_directory_free (added_link->data);
+                priv->new_added_files = g_list_delete_link (priv->new_added_files, added_link);
+            }
+        }
+
+        fad = file_and_directory_new (key.file, directory);
+        *pending_list = g_list_prepend (*pending_list, fad);
+        g_hash_table_insert (pending_links, fad, *pending_list);
+    }
     /* Generally we don't want to show the files while the directory is loading
      * the files themselves, so we avoid jumping and oddities. However, for
      * search it can be a long wait, and we actually want to show files as
@@ -4703,7 +4854,8 @@ files_added_callback (NautilusDirectory *directory,
 
     schedule_changes (view);
 
-    queue_pending_files (view, directory, files, &priv->new_added_files);
+    queue_pending_files (view, directory, files,
+                         &priv->new_added_files, priv->new_added_links);
 
     /* The number of items could have changed */
     schedule_update_status (view);
@@ -4732,7 +4884,8 @@ files_changed_callback (NautilusDirectory *directory,
 
     schedule_changes (view);
 
-    queue_pending_files (view, directory, files, &priv->new_changed_files);
+    queue_pending_files (view, directory, files,
+                         &priv->new_changed_files, priv->new_changed_links);
 
     /* The free space or the number of items could have changed */
     schedule_update_status (view);
@@ -8578,16 +8731,21 @@ void
 nautilus_files_view_notify_selection_changed (NautilusFilesView *view)
 {
     NautilusFilesViewPrivate *priv;
-    GtkWindow *window;
-    g_autolist (NautilusFile) selection = NULL;
 
     g_return_if_fail (NAUTILUS_IS_FILES_VIEW (view));
 
     priv = nautilus_files_view_get_instance_private (view);
 
-    selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
-    window = nautilus_files_view_get_containing_window (view);
-    DEBUG_FILES (selection, "Selection changed in window %p", window);
+    /* Don't build the whole selection list on every change just to log it */
+    if (DEBUGGING)
+    {
+        g_autolist (NautilusFile) selection = NULL;
+        GtkWindow *window;
+
+        selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
+        window = nautilus_files_view_get_containing_window (view);
+        DEBUG_FILES (selection, "Selection changed in window %p", window);
+    }
 
     priv->selection_was_removed = FALSE;
 
@@ -8920,13 +9078,14 @@ nautilus_files_view_stop_loading (NautilusFilesView *view)
     g_list_free_full (priv->new_changed_files, file_and_directory_free);
     priv->new_changed_files = NULL;
 
+    g_hash_table_remove_all (priv->new_added_links);
+    g_hash_table_remove_all (priv->new_changed_links);
     g_hash_table_remove_all (priv->non_ready_files);
 
-    g_list_free_full (priv->old_added_files, file_and_directory_free);
-    priv->old_added_files = NULL;
+    g_queue_clear_full (&priv->old_added_files, file_and_directory_free);
+    g_hash_table_remove_all (priv->old_added_counts);
 
-    g_list_free_full (priv->old_changed_files, file_and_directory_free);
-    priv->old_changed_files = NULL;
+    g_queue_clear_full (&priv->old_changed_files, file_and_directory_free);
 
     g_list_free_full (priv->pending_selection, g_object_unref);
     priv->pending_selection = NULL;
@@ -9724,6 +9883,11 @@ nautilus_files_view_init (NautilusFilesView *view)
                                file_and_directory_equal,
                                file_and_directory_free,
                                NULL);
+    priv->new_added_links = g_hash_table_new (file_and_directory_hash,
+                                              file_and_directory_equal);
+    priv->new_changed_links = g_hash_table_new (file_and_directory_hash,
+                                                file_and_directory_equal);
+    priv->old_added_counts = g_hash_table_new (NULL, NULL);
 
     priv->pending_reveal = g_hash_table_new (NULL, NULL);
 
@@ -29,6 +29,7 @@
 
 #include "nautilus-directory.h"
 #include "nautilus-file.h"
+#include "nautilus-selection-snapshot.h"
 
 #include "nautilus-window.h"
 #include "nautilus-view.h"
@@ -118,6 +119,13 @@ struct _NautilusFilesViewClass {
          */
         GList *        (* get_selection)     (NautilusFilesView *view);
 
+        /* get_selection_snapshot is a function pointer that subclasses may
+         * override to provide running totals of the selection, so they don't
+         * have to be recomputed from get_selection on every change. The
+         * snapshot is owned by the view.
+         */
+        const NautilusSelectionSnapshot * (* get_selection_snapshot) (NautilusFilesView *view);
+
         /* get_selection_for_file_transfer  is a function pointer for
          * subclasses to replace (override). Subclasses must replace it
          * with a function that returns a newly-allocated GList of
@@ -29,6 +29,7 @@
 #include "nautilus-file-utilities.h"
 
 #include <glib/gstdio.h>
+#include <string.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -193,20 +194,16 @@ nautilus_keyfile_metadata_set_string (NautilusFile *file,
 
 #define STRV_TERMINATOR "@x-nautilus-desktop-metadata-term@"
 
-void
-nautilus_keyfile_metadata_set_stringv (NautilusFile       *file,
-                                       const char         *keyfile_filename,
-                                       const char         *name,
-                                       const char         *key,
-                                       const char * const *stringv)
+static void
+set_stringv_in_keyfile (GKeyFile           *keyfile,
+                        const char         *name,
+                        const char         *key,
+                        const char * const *stringv)
 {
-    GKeyFile *keyfile;
     guint length;
     gchar **actual_stringv = NULL;
     gboolean free_strv = FALSE;
 
-    keyfile = get_keyfile (keyfile_filename);
-
     /* if we would be setting a single-length strv, append a fake
      * terminator to the array, to be able to differentiate it later from
      * the single string case
@@ -234,16 +231,79 @@ nautilus_keyfile_metadata_set_stringv (NautilusFile       *file,
                                 (const gchar **) actual_stringv,
                                 length);
 
+    if (free_strv)
+    {
+        g_free (actual_stringv);
+    }
+}
+
+void
+nautilus_keyfile_metadata_set_stringv (NautilusFile       *file,
+                                       const char         *keyfile_filename,
+                                       const char         *name,
+                                       const char         *key,
+                                       const char * const *stringv)
+{
+    GKeyFile *keyfile;
+
+    keyfile = get_keyfile (keyfile_filename);
+
+    set_stringv_in_keyfile (keyfile, name, key, stringv);
+
     save_in_idle (keyfile_filename);
 
     if (nautilus_keyfile_metadata_update_from_keyfile (file, keyfile_filename, name))
     {
         nautilus_file_changed (file);
     }
+}
 
-    if (free_strv)
+void
+nautilus_keyfile_metadata_set_from_info (NautilusFile *file,
+                                         const char   *keyfile_filename,
+                                         const char   *name,
+                                         GFileInfo    *info)
+{
+    GKeyFile *keyfile;
+    g_auto (GStrv) attributes = NULL;
+
+    keyfile = get_keyfile (keyfile_filename);
+    attributes = g_file_info_list_attributes (info, "metadata");
+
+    for (guint i = 0; attributes[i] != NULL; i++)
     {
-        g_free (actual_stringv);
+        const char *key = attributes[i] + strlen ("metadata::");
+
+        switch (g_file_info_get_attribute_type (info, attributes[i]))
+        {
+            case G_FILE_ATTRIBUTE_TYPE_STRING:
+            {
+                g_key_file_set_string (keyfile, name, key,
+                                       g_file_info_get_attribute_string (info, attributes[i]));
+            }
+            break;
+
+            case G_FILE_ATTRIBUTE_TYPE_STRINGV:
+            {
+                set_stringv_in_keyfile (keyfile, name, key,
+                                        (const char * const *) g_file_info_get_attribute_stringv (info, attributes[i]));
+            }
+            break;
+
+            default:
+            {
+                g_key_file_remove_key (keyfile, name, key, NULL);
+            }
+            break;
+        }
+    }
+
+    /* All the keys end up in the same save. */
+    save_in_idle (keyfile_filename);
+
+    if (nautilus_keyfile_metadata_update_from_keyfile (file, keyfile_filename, name))
+    {
+        nautilus_file_changed (file);
     }
 }
 
@@ -22,7 +22,7 @@
 
 #pragma once
 
-#include <glib.h>
+#include <gio/gio.h>
 
 #include "nautilus-types.h"
 
@@ -38,6 +38,11 @@ void nautilus_keyfile_metadata_set_stringv (NautilusFile *file,
                                             const char *key,
                                             const char * const *stringv);
 
+void nautilus_keyfile_metadata_set_from_info (NautilusFile *file,
+                                              const char *keyfile_filename,
+                                              const char *name,
+                                              GFileInfo *info);
+
 gboolean nautilus_keyfile_metadata_update_from_keyfile (NautilusFile *file,
                                                         const char *keyfile_filename,
                                                         const gchar *name);
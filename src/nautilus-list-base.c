@@ -16,13 +16,23 @@
 #include "nautilus-file.h"
 #include "nautilus-file-operations.h"
 #include "nautilus-metadata.h"
+#include "nautilus-metadata-transaction.h"
 #include "nautilus-global-preferences.h"
 #include "nautilus-thumbnails.h"
 
+#include <math.h>
+
 #ifdef GDK_WINDOWING_X11
 #include <gdk/x11/gdkx.h>
 #endif
 
+/* How far ahead of the viewport to prefetch, in pages, when scrolling fast. */
+#define PREFETCH_MAX_PAGES 4
+/* Items to prefetch per idle iteration, to keep scrolling smooth. */
+#define PREFETCH_BATCH_SIZE 8
+/* The scroll velocity is considered stale after this, in microseconds. */
+#define SCROLL_VELOCITY_TIMEOUT (G_USEC_PER_SEC / 5)
+
 /**
  * NautilusListBase:
  *
@@ -44,9 +54,17 @@ struct _NautilusListBasePrivate
     GList *cut_files;
 
     guint scroll_to_file_handle_id;
-    guint prioritize_thumbnailing_handle_id;
+    guint update_viewport_handle_id;
     GtkAdjustment *vadjustment;
 
+    /* Viewport tracking, see update_viewport_on_idle() */
+    gdouble last_scroll_value;
+    gint64 last_scroll_time;
+    gdouble scroll_velocity; /* pixels per second, negative when scrolling up */
+    guint prefetch_handle_id;
+    guint prefetch_position;
+    guint prefetch_end;
+
     gboolean single_click_mode;
     gboolean activate_on_release;
     gboolean deny_background_click;
@@ -198,17 +216,20 @@ set_directory_sort_metadata (NautilusFile *file,
 {
     const SortConstants *default_sort;
     gboolean default_reversed;
+    NautilusMetadataTransaction *transaction;
 
     default_sort = get_default_sort_order (file, &default_reversed);
 
-    nautilus_file_set_metadata (file,
-                                NAUTILUS_METADATA_KEY_ICON_VIEW_SORT_BY,
-                                default_sort->metadata_name,
-                                metadata_name);
-    nautilus_file_set_boolean_metadata (file,
-                                        NAUTILUS_METADATA_KEY_ICON_VIEW_SORT_REVERSED,
-                                        default_reversed,
-                                        reversed);
+    transaction = nautilus_metadata_transaction_new ();
+    nautilus_metadata_transaction_set (transaction, file,
+                                       NAUTILUS_METADATA_KEY_ICON_VIEW_SORT_BY,
+                                       default_sort->metadata_name,
+                                       metadata_name);
+    nautilus_metadata_transaction_set_boolean (transaction, file,
+                                               NAUTILUS_METADATA_KEY_ICON_VIEW_SORT_REVERSED,
+                                               default_reversed,
+                                               reversed);
+    nautilus_metadata_transaction_commit (transaction);
 }
 
 static void
@@ -1124,6 +1145,7 @@ real_file_changed (NautilusFilesView *files_view,
 
     item = nautilus_view_model_get_item_from_file (priv->model, file);
     nautilus_view_item_file_changed (item);
+    nautilus_view_model_item_file_changed (priv->model, item);
 }
 
 static GList *
@@ -1131,26 +1153,37 @@ real_get_selection (NautilusFilesView *files_view)
 {
     NautilusListBase *self = NAUTILUS_LIST_BASE (files_view);
     NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
-    g_autoptr (GtkSelectionFilterModel) selection = NULL;
-    guint n_selected;
+    g_autoptr (GtkBitset) selection = NULL;
+    GtkBitsetIter iter;
+    guint position;
     GList *selected_files = NULL;
 
-    selection = gtk_selection_filter_model_new (GTK_SELECTION_MODEL (priv->model));
-    n_selected = g_list_model_get_n_items (G_LIST_MODEL (selection));
-    for (guint i = 0; i < n_selected; i++)
+    /* Walk the selection bitset directly instead of going through a
+     * GtkSelectionFilterModel, which would have to be built on each call. */
+    selection = gtk_selection_model_get_selection (GTK_SELECTION_MODEL (priv->model));
+    for (gboolean valid = gtk_bitset_iter_init_last (&iter, selection, &position);
+         valid;
+         valid = gtk_bitset_iter_previous (&iter, &position))
     {
         g_autoptr (NautilusViewItem) item = NULL;
 
-        item = get_view_item (G_LIST_MODEL (selection), i);
+        item = get_view_item (G_LIST_MODEL (priv->model), position);
         selected_files = g_list_prepend (selected_files,
                                          g_object_ref (nautilus_view_item_get_file (item)));
     }
 
-    selected_files = g_list_reverse (selected_files);
-
     return selected_files;
 }
 
+static const NautilusSelectionSnapshot *
+real_get_selection_snapshot (NautilusFilesView *files_view)
+{
+    NautilusListBase *self = NAUTILUS_LIST_BASE (files_view);
+    NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
+
+    return nautilus_view_model_get_selection_snapshot (priv->model);
+}
+
 static gboolean
 real_is_empty (NautilusFilesView *files_view)
 {
@@ -1626,7 +1659,8 @@ nautilus_list_base_dispose (GObject *object)
     NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
 
     g_clear_handle_id (&priv->scroll_to_file_handle_id, g_source_remove);
-    g_clear_handle_id (&priv->prioritize_thumbnailing_handle_id, g_source_remove);
+    g_clear_handle_id (&priv->update_viewport_handle_id, g_source_remove);
+    g_clear_handle_id (&priv->prefetch_handle_id, g_source_remove);
     g_clear_handle_id (&priv->hover_timer_id, g_source_remove);
 
     G_OBJECT_CLASS (nautilus_list_base_parent_class)->dispose (object);
@@ -1643,60 +1677,115 @@ nautilus_list_base_finalize (GObject *object)
     G_OBJECT_CLASS (nautilus_list_base_parent_class)->finalize (object);
 }
 
-static gboolean
-prioritize_thumbnailing_on_idle (NautilusListBase *self)
+/* Items have the same height in each row, so the visible items can be
+ * estimated from the adjustment alone, without looking at the widgets.
+ * The result is a half-open range.
+ */
+static void
+get_visible_range (NautilusListBase *self,
+                   guint            *first,
+                   guint            *end)
 {
     NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
+    guint n_items;
+    gdouble upper;
+    gdouble value;
     gdouble page_size;
-    GtkWidget *first_visible_child;
-    GtkWidget *next_child;
-    guint first_index;
-    guint next_index;
-    gdouble y;
-    guint last_index;
-    g_autoptr (NautilusViewItem) first_item = NULL;
-    NautilusFile *file;
-
-    priv->prioritize_thumbnailing_handle_id = 0;
 
+    n_items = g_list_model_get_n_items (G_LIST_MODEL (priv->model));
+    upper = gtk_adjustment_get_upper (priv->vadjustment);
+    value = gtk_adjustment_get_value (priv->vadjustment);
     page_size = gtk_adjustment_get_page_size (priv->vadjustment);
-    first_index = get_first_visible_item (self);
-    if (first_index == G_MAXUINT)
+
+    if (n_items == 0 || upper <= 0)
     {
-        return G_SOURCE_REMOVE;
+        *first = 0;
+        *end = 0;
+        return;
     }
 
-    first_item = get_view_item (G_LIST_MODEL (priv->model), first_index);
+    *first = MIN (n_items, (guint) floor (value / upper * n_items));
+    *end = MIN (n_items, (guint) ceil ((value + page_size) / upper * n_items));
+}
 
-    first_visible_child = nautilus_view_item_get_item_ui (first_item);
+static void
+prefetch_item (NautilusListBase *self,
+               guint             position)
+{
+    NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
+    g_autoptr (NautilusViewItem) item = NULL;
+    g_autoptr (GdkPaintable) paintable = NULL;
+    NautilusFile *file;
+    guint icon_size;
 
-    for (next_index = first_index + 1; next_index < g_list_model_get_n_items (G_LIST_MODEL (priv->model)); next_index++)
+    item = get_view_item (G_LIST_MODEL (priv->model), position);
+    file = item != NULL ? nautilus_view_item_get_file (item) : NULL;
+    if (file == NULL)
     {
-        g_autoptr (NautilusViewItem) next_item = NULL;
+        return;
+    }
 
-        next_item = get_view_item (G_LIST_MODEL (priv->model), next_index);
-        next_child = nautilus_view_item_get_item_ui (next_item);
-        if (next_child == NULL)
-        {
-            break;
-        }
-        if (gtk_widget_translate_coordinates (next_child, first_visible_child,
-                                              0, 0, NULL, &y))
-        {
-            if (y > page_size)
-            {
-                break;
-            }
-        }
+    /* This queues the thumbnail if needed, and caches the paintable for
+     * when the item gets bound. */
+    icon_size = nautilus_list_base_get_icon_size (self);
+    paintable = nautilus_file_get_icon_paintable (file, icon_size,
+                                                  gtk_widget_get_scale_factor (GTK_WIDGET (self)),
+                                                  NAUTILUS_FILE_ICON_FLAGS_USE_THUMBNAILS);
+}
+
+static gboolean
+prefetch_on_idle (NautilusListBase *self)
+{
+    NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
+    guint n_items;
+
+    n_items = g_list_model_get_n_items (G_LIST_MODEL (priv->model));
+    priv->prefetch_end = MIN (priv->prefetch_end, n_items);
+
+    for (guint i = 0;
+         i < PREFETCH_BATCH_SIZE && priv->prefetch_position < priv->prefetch_end;
+         i++)
+    {
+        prefetch_item (self, priv->prefetch_position);
+        priv->prefetch_position++;
+    }
+
+    if (priv->prefetch_position < priv->prefetch_end)
+    {
+        return G_SOURCE_CONTINUE;
+    }
+
+    priv->prefetch_handle_id = 0;
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean
+update_viewport_on_idle (NautilusListBase *self)
+{
+    NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
+    guint first_index;
+    guint end_index;
+    guint n_items;
+    guint n_ahead;
+    gdouble page_size;
+    gdouble velocity;
+
+    priv->update_viewport_handle_id = 0;
+
+    get_visible_range (self, &first_index, &end_index);
+    if (first_index == end_index)
+    {
+        return G_SOURCE_REMOVE;
     }
-    last_index = next_index - 1;
 
     /* Do the iteration in reverse to give higher priority to the top */
-    for (gint i = 0; i <= last_index - first_index; i++)
+    for (guint i = end_index; i > first_index; i--)
     {
         g_autoptr (NautilusViewItem) item = NULL;
+        NautilusFile *file;
 
-        item = get_view_item (G_LIST_MODEL (priv->model), last_index - i);
+        item = get_view_item (G_LIST_MODEL (priv->model), i - 1);
         g_return_val_if_fail (item != NULL, G_SOURCE_REMOVE);
 
         file = nautilus_view_item_get_file (NAUTILUS_VIEW_ITEM (item));
@@ -1707,6 +1796,44 @@ prioritize_thumbnailing_on_idle (NautilusListBase *self)
         }
     }
 
+    /* Look further ahead the faster we scroll, in the direction we scroll. */
+    velocity = priv->scroll_velocity;
+    if (g_get_monotonic_time () - priv->last_scroll_time > SCROLL_VELOCITY_TIMEOUT)
+    {
+        velocity = 0;
+    }
+
+    page_size = gtk_adjustment_get_page_size (priv->vadjustment);
+    n_ahead = end_index - first_index;
+    if (page_size > 0)
+    {
+        n_ahead = n_ahead * CLAMP (1 + fabs (velocity) / page_size, 1, PREFETCH_MAX_PAGES);
+    }
+
+    n_items = g_list_model_get_n_items (G_LIST_MODEL (priv->model));
+    if (velocity < 0)
+    {
+        priv->prefetch_position = first_index - MIN (first_index, n_ahead);
+        priv->prefetch_end = end_index;
+    }
+    else if (velocity > 0)
+    {
+        priv->prefetch_position = first_index;
+        priv->prefetch_end = MIN (n_items, end_index + n_ahead);
+    }
+    else
+    {
+        priv->prefetch_position = first_index - MIN (first_index, n_ahead);
+        priv->prefetch_end = MIN (n_items, end_index + n_ahead);
+    }
+
+    if (priv->prefetch_handle_id == 0)
+    {
+        priv->prefetch_handle_id = g_idle_add_full (G_PRIORITY_LOW,
+                                                    (GSourceFunc) prefetch_on_idle,
+                                                    self, NULL);
+    }
+
     return G_SOURCE_REMOVE;
 }
 
@@ -1719,11 +1846,42 @@ on_vadjustment_changed (GtkAdjustment *adjustment,
     guint handle_id;
 
     /* Schedule on idle to rate limit and to avoid delaying scrolling. */
-    if (priv->prioritize_thumbnailing_handle_id == 0)
+    if (priv->update_viewport_handle_id == 0)
+    {
+        handle_id = g_idle_add ((GSourceFunc) update_viewport_on_idle, self);
+        priv->update_viewport_handle_id = handle_id;
+    }
+}
+
+static void
+on_vadjustment_value_changed (GtkAdjustment *adjustment,
+                              gpointer       user_data)
+{
+    NautilusListBase *self = NAUTILUS_LIST_BASE (user_data);
+    NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
+    gdouble value;
+    gint64 now;
+
+    value = gtk_adjustment_get_value (adjustment);
+    now = g_get_monotonic_time ();
+
+    if (now - priv->last_scroll_time > SCROLL_VELOCITY_TIMEOUT)
+    {
+        priv->scroll_velocity = 0;
+    }
+    else if (now > priv->last_scroll_time)
     {
-        handle_id = g_idle_add ((GSourceFunc) prioritize_thumbnailing_on_idle, self);
-        priv->prioritize_thumbnailing_handle_id = handle_id;
+        gdouble velocity;
+
+        velocity = (value - priv->last_scroll_value) * G_USEC_PER_SEC / (now - priv->last_scroll_time);
+        /* Smooth out the jitter of individual scroll events. */
+        priv->scroll_velocity = (priv->scroll_velocity + velocity) / 2;
     }
+
+    priv->last_scroll_value = value;
+    priv->last_scroll_time = now;
+
+    on_vadjustment_changed (adjustment, user_data);
 }
 
 static gboolean
@@ -1788,6 +1946,7 @@ nautilus_list_base_class_init (NautilusListBaseClass *klass)
     files_view_class->click_policy_changed = real_click_policy_changed;
     files_view_class->file_changed = real_file_changed;
     files_view_class->get_selection = real_get_selection;
+    files_view_class->get_selection_snapshot = real_get_selection_snapshot;
     /* TODO: remove this get_selection_for_file_transfer, this doesn't even
      * take into account we could us the view for recursive search :/
      * CanvasView has the same issue. */
@@ -1838,7 +1997,7 @@ nautilus_list_base_init (NautilusListBase *self)
 
     priv->vadjustment = vadjustment;
     g_signal_connect (vadjustment, "changed", (GCallback) on_vadjustment_changed, self);
-    g_signal_connect (vadjustment, "value-changed", (GCallback) on_vadjustment_changed, self);
+    g_signal_connect (vadjustment, "value-changed", (GCallback) on_vadjustment_value_changed, self);
 
     priv->model = nautilus_view_model_new ();
 
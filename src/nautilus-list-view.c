@@ -22,6 +22,7 @@
 #include "nautilus-global-preferences.h"
 #include "nautilus-label-cell.h"
 #include "nautilus-metadata.h"
+#include "nautilus-metadata-transaction.h"
 #include "nautilus-name-cell.h"
 #include "nautilus-search-directory.h"
 #include "nautilus-star-cell.h"
@@ -453,6 +454,7 @@ column_chooser_changed_callback (NautilusColumnChooser *chooser,
     NautilusFile *file;
     char **visible_columns;
     char **column_order;
+    NautilusMetadataTransaction *transaction;
 
     file = nautilus_files_view_get_directory_as_file (NAUTILUS_FILES_VIEW (view));
 
@@ -460,12 +462,14 @@ column_chooser_changed_callback (NautilusColumnChooser *chooser,
                                           &visible_columns,
                                           &column_order);
 
-    nautilus_file_set_metadata_list (file,
-                                     NAUTILUS_METADATA_KEY_LIST_VIEW_VISIBLE_COLUMNS,
-                                     visible_columns);
-    nautilus_file_set_metadata_list (file,
-                                     NAUTILUS_METADATA_KEY_LIST_VIEW_COLUMN_ORDER,
-                                     column_order);
+    transaction = nautilus_metadata_transaction_new ();
+    nautilus_metadata_transaction_set_list (transaction, file,
+                                            NAUTILUS_METADATA_KEY_LIST_VIEW_VISIBLE_COLUMNS,
+                                            visible_columns);
+    nautilus_metadata_transaction_set_list (transaction, file,
+                                            NAUTILUS_METADATA_KEY_LIST_VIEW_COLUMN_ORDER,
+                                            column_order);
+    nautilus_metadata_transaction_commit (transaction);
 
     apply_columns_settings (view, column_order, visible_columns);
 
@@ -514,12 +518,15 @@ column_chooser_use_default_callback (NautilusColumnChooser *chooser,
     NautilusFile *file;
     char **default_columns;
     char **default_order;
+    NautilusMetadataTransaction *transaction;
 
     file = nautilus_files_view_get_directory_as_file
                (NAUTILUS_FILES_VIEW (view));
 
-    nautilus_file_set_metadata_list (file, NAUTILUS_METADATA_KEY_LIST_VIEW_COLUMN_ORDER, NULL);
-    nautilus_file_set_metadata_list (file, NAUTILUS_METADATA_KEY_LIST_VIEW_VISIBLE_COLUMNS, NULL);
+    transaction = nautilus_metadata_transaction_new ();
+    nautilus_metadata_transaction_set_list (transaction, file, NAUTILUS_METADATA_KEY_LIST_VIEW_COLUMN_ORDER, NULL);
+    nautilus_metadata_transaction_set_list (transaction, file, NAUTILUS_METADATA_KEY_LIST_VIEW_VISIBLE_COLUMNS, NULL);
+    nautilus_metadata_transaction_commit (transaction);
 
     /* set view values ourselves, as new metadata could not have been
      * updated yet.
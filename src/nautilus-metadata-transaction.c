@@ -0,0 +1,203 @@
+/* nautilus-metadata-transaction.c
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "nautilus-metadata-transaction.h"
+
+#include "nautilus-directory.h"
+#include "nautilus-file-private.h"
+
+struct _NautilusMetadataTransaction
+{
+    /* NautilusDirectory -> (NautilusFile -> GFileInfo) */
+    GHashTable *directories;
+};
+
+NautilusMetadataTransaction *
+nautilus_metadata_transaction_new (void)
+{
+    NautilusMetadataTransaction *transaction;
+
+    transaction = g_new0 (NautilusMetadataTransaction, 1);
+    transaction->directories = g_hash_table_new_full (NULL, NULL,
+                                                      (GDestroyNotify) nautilus_directory_unref,
+                                                      (GDestroyNotify) g_hash_table_unref);
+
+    return transaction;
+}
+
+void
+nautilus_metadata_transaction_free (NautilusMetadataTransaction *transaction)
+{
+    g_hash_table_unref (transaction->directories);
+    g_free (transaction);
+}
+
+static GFileInfo *
+get_info_for_file (NautilusMetadataTransaction *transaction,
+                   NautilusFile                *file)
+{
+    NautilusDirectory *directory;
+    GHashTable *files;
+    GFileInfo *info;
+
+    directory = nautilus_file_get_directory (file);
+    files = g_hash_table_lookup (transaction->directories, directory);
+    if (files == NULL)
+    {
+        files = g_hash_table_new_full (NULL, NULL,
+                                       (GDestroyNotify) nautilus_file_unref,
+                                       g_object_unref);
+        g_hash_table_insert (transaction->directories,
+                             nautilus_directory_ref (directory), files);
+    }
+
+    info = g_hash_table_lookup (files, file);
+    if (info == NULL)
+    {
+        info = g_file_info_new ();
+        g_hash_table_insert (files, nautilus_file_ref (file), info);
+    }
+
+    return info;
+}
+
+void
+nautilus_metadata_transaction_set (NautilusMetadataTransaction *transaction,
+                                   NautilusFile                *file,
+                                   const char                  *key,
+                                   const char                  *default_metadata,
+                                   const char                  *metadata)
+{
+    GFileInfo *info;
+    g_autofree char *gio_key = NULL;
+    const char *val;
+
+    g_return_if_fail (transaction != NULL);
+    g_return_if_fail (NAUTILUS_IS_FILE (file));
+    g_return_if_fail (key != NULL);
+    g_return_if_fail (key[0] != '\0');
+
+    val = metadata;
+    if (val == NULL)
+    {
+        val = default_metadata;
+    }
+
+    info = get_info_for_file (transaction, file);
+    gio_key = g_strconcat ("metadata::", key, NULL);
+    if (val != NULL)
+    {
+        g_file_info_set_attribute_string (info, gio_key, val);
+    }
+    else
+    {
+        /* Unset the key */
+        g_file_info_set_attribute (info, gio_key,
+                                   G_FILE_ATTRIBUTE_TYPE_INVALID,
+                                   NULL);
+    }
+}
+
+void
+nautilus_metadata_transaction_set_list (NautilusMetadataTransaction  *transaction,
+                                        NautilusFile                 *file,
+                                        const char                   *key,
+                                        char                        **list)
+{
+    GFileInfo *info;
+    g_autofree char *gio_key = NULL;
+
+    g_return_if_fail (transaction != NULL);
+    g_return_if_fail (NAUTILUS_IS_FILE (file));
+    g_return_if_fail (key != NULL);
+    g_return_if_fail (key[0] != '\0');
+
+    info = get_info_for_file (transaction, file);
+    gio_key = g_strconcat ("metadata::", key, NULL);
+    if (list == NULL)
+    {
+        g_file_info_set_attribute (info, gio_key, G_FILE_ATTRIBUTE_TYPE_INVALID, NULL);
+    }
+    else
+    {
+        g_file_info_set_attribute_stringv (info, gio_key, list);
+    }
+}
+
+void
+nautilus_metadata_transaction_set_boolean (NautilusMetadataTransaction *transaction,
+                                           NautilusFile                *file,
+                                           const char                  *key,
+                                           gboolean                     default_metadata,
+                                           gboolean                     metadata)
+{
+    nautilus_metadata_transaction_set (transaction, file, key,
+                                       default_metadata ? "true" : "false",
+                                       metadata ? "true" : "false");
+}
+
+void
+nautilus_metadata_transaction_set_integer (NautilusMetadataTransaction *transaction,
+                                           NautilusFile                *file,
+                                           const char                  *key,
+                                           int                          default_metadata,
+                                           int                          metadata)
+{
+    char value_as_string[32];
+    char default_as_string[32];
+
+    g_snprintf (value_as_string, sizeof (value_as_string), "%d", metadata);
+    g_snprintf (default_as_string, sizeof (default_as_string), "%d", default_metadata);
+
+    nautilus_metadata_transaction_set (transaction, file, key,
+                                       default_as_string, value_as_string);
+}
+
+/**
+ * nautilus_metadata_transaction_commit:
+ * @transaction: (transfer full): the transaction to apply.
+ *
+ * Writes the gathered metadata with one write per file, with the files
+ * of each directory written one after another.
+ */
+void
+nautilus_metadata_transaction_commit (NautilusMetadataTransaction *transaction)
+{
+    GHashTableIter dir_iter;
+    GHashTable *files;
+
+    g_return_if_fail (transaction != NULL);
+
+    g_hash_table_iter_init (&dir_iter, transaction->directories);
+    while (g_hash_table_iter_next (&dir_iter, NULL, (gpointer *) &files))
+    {
+        GHashTableIter file_iter;
+        NautilusFile *file;
+        GFileInfo *info;
+
+        g_hash_table_iter_init (&file_iter, files);
+        while (g_hash_table_iter_next (&file_iter, (gpointer *) &file, (gpointer *) &info))
+        {
+            nautilus_file_set_metadata_from_info (file, info);
+        }
+    }
+
+    nautilus_metadata_transaction_free (transaction);
+}
@@ -0,0 +1,54 @@
+/* nautilus-metadata-transaction.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "nautilus-types.h"
+
+/* Gathers metadata changes for many files, so that each file gets a
+ * single write when the transaction is committed instead of one write
+ * per key.
+ */
+typedef struct _NautilusMetadataTransaction NautilusMetadataTransaction;
+
+NautilusMetadataTransaction *nautilus_metadata_transaction_new          (void);
+void                         nautilus_metadata_transaction_set          (NautilusMetadataTransaction  *transaction,
+                                                                         NautilusFile                 *file,
+                                                                         const char                   *key,
+                                                                         const char                   *default_metadata,
+                                                                         const char                   *metadata);
+void                         nautilus_metadata_transaction_set_list     (NautilusMetadataTransaction  *transaction,
+                                                                         NautilusFile                 *file,
+                                                                         const char                   *key,
+                                                                         char                        **list);
+void                         nautilus_metadata_transaction_set_boolean  (NautilusMetadataTransaction  *transaction,
+                                                                         NautilusFile                 *file,
+                                                                         const char                   *key,
+                                                                         gboolean                      default_metadata,
+                                                                         gboolean                      metadata);
+void                         nautilus_metadata_transaction_set_integer  (NautilusMetadataTransaction  *transaction,
+                                                                         NautilusFile                 *file,
+                                                                         const char                   *key,
+                                                                         int                           default_metadata,
+                                                                         int                           metadata);
+void                         nautilus_metadata_transaction_commit       (NautilusMetadataTransaction  *transaction);
+void                         nautilus_metadata_transaction_free         (NautilusMetadataTransaction  *transaction);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (NautilusMetadataTransaction, nautilus_metadata_transaction_free)
@@ -25,6 +25,10 @@
 
 #include <eel/eel-debug.h>
 #include <gmodule.h>
+#include <glib/gstdio.h>
+#include <nautilus-extension.h>
+#define DEBUG_FLAG NAUTILUS_DEBUG_EXTENSIONS
+#include "nautilus-debug.h"
 
 #define NAUTILUS_TYPE_MODULE            (nautilus_module_get_type ())
 #define NAUTILUS_MODULE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NAUTILUS_TYPE_MODULE, NautilusModule))
@@ -48,6 +52,13 @@ struct _NautilusModule
 
     void (*list_types) (const GType **types,
                         int          *num_types);
+
+    /* Names of the interfaces implemented by the types of the module, as
+     * recorded in the manifest. */
+    GStrv interfaces;
+    /* Whether all of the types are registered by the module itself, so the
+     * library alone determines them. */
+    gboolean can_defer;
 };
 
 struct _NautilusModuleClass
@@ -58,6 +69,21 @@ struct _NautilusModuleClass
 static GList *module_objects = NULL;
 static GStrv installed_module_names = NULL;
 
+/* Modules which are known from the manifest, but are only loaded once one of
+ * the interfaces they provide is requested.
+ */
+static GList *deferred_modules = NULL;
+
+/* Entries are only valid for the nautilus and extension API versions which
+ * wrote them, as the interfaces may have changed in between. */
+#define MANIFEST_GROUP "Manifest"
+#define MANIFEST_KEY_VERSION "version"
+#define MANIFEST_KEY_API_VERSION "api-version"
+
+#define MANIFEST_KEY_MTIME "mtime"
+#define MANIFEST_KEY_SIZE "size"
+#define MANIFEST_KEY_INTERFACES "interfaces"
+
 static GType nautilus_module_get_type (void);
 
 G_DEFINE_TYPE (NautilusModule, nautilus_module, G_TYPE_TYPE_MODULE);
@@ -144,6 +170,7 @@ nautilus_module_finalize (GObject *object)
     module = NAUTILUS_MODULE (object);
 
     g_free (module->path);
+    g_strfreev (module->interfaces);
 
     G_OBJECT_CLASS (nautilus_module_parent_class)->finalize (object);
 }
@@ -168,39 +195,96 @@ module_object_weak_notify (gpointer  user_data,
     module_objects = g_list_remove (module_objects, object);
 }
 
-static void
+static GStrv
 add_module_objects (NautilusModule *module)
 {
+    g_autoptr (GPtrArray) interfaces = NULL;
     const GType *types;
     int num_types;
     int i;
 
+    interfaces = g_ptr_array_new_with_free_func (g_free);
+    module->can_defer = TRUE;
+
     module->list_types (&types, &num_types);
 
     for (i = 0; i < num_types; i++)
     {
+        g_autofree GType *type_interfaces = NULL;
+        guint n_type_interfaces;
+
         if (types[i] == 0)           /* Work around broken extensions */
         {
             break;
         }
         nautilus_module_add_type (types[i]);
+
+        /* Loaders like nautilus-python create their types from scripts,
+         * which can change without the library changing. */
+        if (g_type_get_plugin (types[i]) != G_TYPE_PLUGIN (module))
+        {
+            module->can_defer = FALSE;
+        }
+
+        type_interfaces = g_type_interfaces (types[i], &n_type_interfaces);
+        for (guint j = 0; j < n_type_interfaces; j++)
+        {
+            const gchar *name = g_type_name (type_interfaces[j]);
+
+            if (!g_ptr_array_find_with_equal_func (interfaces, name, g_str_equal, NULL))
+            {
+                g_ptr_array_add (interfaces, g_strdup (name));
+            }
+        }
     }
+
+    g_ptr_array_add (interfaces, NULL);
+
+    return (GStrv) g_ptr_array_free (g_steal_pointer (&interfaces), FALSE);
+}
+
+static gboolean
+nautilus_module_load_objects (NautilusModule *module)
+{
+    gint64 start_time;
+
+    start_time = g_get_monotonic_time ();
+
+    if (!g_type_module_use (G_TYPE_MODULE (module)))
+    {
+        return FALSE;
+    }
+
+    g_strfreev (module->interfaces);
+    module->interfaces = add_module_objects (module);
+    g_type_module_unuse (G_TYPE_MODULE (module));
+
+    DEBUG ("Loaded %s in %.2f ms",
+           module->path, (g_get_monotonic_time () - start_time) / 1000.0);
+
+    return TRUE;
 }
 
 static NautilusModule *
-nautilus_module_load_file (const char   *filename,
-                           GStrvBuilder *installed_module_name_builder)
+nautilus_module_new (const char *filename)
 {
     NautilusModule *module;
 
     module = g_object_new (NAUTILUS_TYPE_MODULE, NULL);
     module->path = g_strdup (filename);
 
-    if (g_type_module_use (G_TYPE_MODULE (module)))
+    return module;
+}
+
+static NautilusModule *
+nautilus_module_load_file (const char *filename)
+{
+    NautilusModule *module;
+
+    module = nautilus_module_new (filename);
+
+    if (nautilus_module_load_objects (module))
     {
-        add_module_objects (module);
-        g_type_module_unuse (G_TYPE_MODULE (module));
-        g_strv_builder_add (installed_module_name_builder, filename);
         return module;
     }
     else
@@ -216,12 +300,181 @@ nautilus_module_get_installed_module_names (void)
     return g_strjoinv ("\n", installed_module_names);
 }
 
+static gchar *
+get_manifest_path (void)
+{
+    return g_build_filename (g_get_user_cache_dir (), "nautilus",
+                             "extensions.ini", NULL);
+}
+
+static gboolean
+manifest_version_is_current (GKeyFile *manifest)
+{
+    g_autofree gchar *version = NULL;
+    g_autofree gchar *api_version = NULL;
+
+    version = g_key_file_get_string (manifest, MANIFEST_GROUP,
+                                     MANIFEST_KEY_VERSION, NULL);
+    api_version = g_key_file_get_string (manifest, MANIFEST_GROUP,
+                                         MANIFEST_KEY_API_VERSION, NULL);
+
+    return g_strcmp0 (version, PACKAGE_VERSION) == 0 &&
+           g_strcmp0 (api_version, NAUTILUS_EXTENSION_API_VERSION) == 0;
+}
+
+static gboolean
+manifest_entry_is_valid (GKeyFile   *manifest,
+                         const char *filename,
+                         GStatBuf   *stat_buf)
+{
+    return g_key_file_has_group (manifest, filename) &&
+           g_key_file_get_int64 (manifest, filename, MANIFEST_KEY_MTIME, NULL) == (gint64) stat_buf->st_mtime &&
+           g_key_file_get_int64 (manifest, filename, MANIFEST_KEY_SIZE, NULL) == (gint64) stat_buf->st_size &&
+           g_key_file_has_key (manifest, filename, MANIFEST_KEY_INTERFACES, NULL);
+}
+
+/* Modules are only ever asked for these interfaces, so a module providing
+ * none of them, which may do its work when initialized, is loaded eagerly.
+ */
+static gboolean
+module_provides_known_interface (NautilusModule *module)
+{
+    const GType known_types[] =
+    {
+        NAUTILUS_TYPE_COLUMN_PROVIDER,
+        NAUTILUS_TYPE_INFO_PROVIDER,
+        NAUTILUS_TYPE_MENU_PROVIDER,
+        NAUTILUS_TYPE_PROPERTIES_MODEL_PROVIDER,
+    };
+
+    for (guint i = 0; i < G_N_ELEMENTS (known_types); i++)
+    {
+        if (g_strv_contains ((const gchar * const *) module->interfaces,
+                             g_type_name (known_types[i])))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void
+load_module_file (const char   *filename,
+                  GKeyFile     *old_manifest,
+                  GKeyFile     *new_manifest,
+                  GStrvBuilder *installed_module_name_builder)
+{
+    NautilusModule *module;
+    GStatBuf stat_buf;
+
+    if (g_stat (filename, &stat_buf) != 0)
+    {
+        return;
+    }
+
+    if (manifest_entry_is_valid (old_manifest, filename, &stat_buf))
+    {
+        module = nautilus_module_new (filename);
+        module->interfaces = g_key_file_get_string_list (old_manifest, filename,
+                                                         MANIFEST_KEY_INTERFACES,
+                                                         NULL, NULL);
+        if (module->interfaces == NULL)
+        {
+            module->interfaces = g_new0 (gchar *, 1);
+        }
+        module->can_defer = TRUE;
+
+        if (module_provides_known_interface (module))
+        {
+            deferred_modules = g_list_prepend (deferred_modules, module);
+
+            DEBUG ("Deferred loading %s", filename);
+        }
+        else if (!nautilus_module_load_objects (module))
+        {
+            g_object_unref (module);
+            return;
+        }
+    }
+    else
+    {
+        module = nautilus_module_load_file (filename);
+        if (module == NULL)
+        {
+            return;
+        }
+    }
+
+    g_strv_builder_add (installed_module_name_builder, filename);
+
+    /* Without recorded interfaces, the module is always loaded right away. */
+    if (!module->can_defer)
+    {
+        return;
+    }
+
+    g_key_file_set_int64 (new_manifest, filename, MANIFEST_KEY_MTIME, stat_buf.st_mtime);
+    g_key_file_set_int64 (new_manifest, filename, MANIFEST_KEY_SIZE, stat_buf.st_size);
+    g_key_file_set_string_list (new_manifest, filename, MANIFEST_KEY_INTERFACES,
+                                (const gchar * const *) module->interfaces,
+                                g_strv_length (module->interfaces));
+}
+
+static void
+save_manifest (GKeyFile    *old_manifest,
+               GKeyFile    *new_manifest,
+               const gchar *manifest_path)
+{
+    g_autofree gchar *old_data = NULL;
+    g_autofree gchar *new_data = NULL;
+    g_autofree gchar *manifest_dir = NULL;
+    g_autoptr (GError) error = NULL;
+
+    old_data = g_key_file_to_data (old_manifest, NULL, NULL);
+    new_data = g_key_file_to_data (new_manifest, NULL, NULL);
+    if (g_strcmp0 (old_data, new_data) == 0)
+    {
+        return;
+    }
+
+    manifest_dir = g_path_get_dirname (manifest_path);
+    g_mkdir_with_parents (manifest_dir, 0700);
+
+    if (!g_key_file_save_to_file (new_manifest, manifest_path, &error))
+    {
+        g_warning ("Failed to save the extensions manifest: %s", error->message);
+    }
+}
+
 static void
 load_module_dir (const char *dirname)
 {
     GDir *dir;
+    g_autoptr (GKeyFile) old_manifest = g_key_file_new ();
+    g_autoptr (GKeyFile) new_manifest = g_key_file_new ();
+    g_autofree gchar *manifest_path = get_manifest_path ();
+    gint64 start_time;
 
     g_autoptr (GStrvBuilder) installed_module_name_builder = g_strv_builder_new ();
+
+    start_time = g_get_monotonic_time ();
+
+    /* The manifest records which interfaces each module provides, so modules
+     * which were already seen don't need to be loaded until they are used.
+     * A missing or outdated manifest just means loading everything.
+     */
+    g_key_file_load_from_file (old_manifest, manifest_path, G_KEY_FILE_NONE, NULL);
+    if (!manifest_version_is_current (old_manifest))
+    {
+        g_key_file_free (old_manifest);
+        old_manifest = g_key_file_new ();
+    }
+    g_key_file_set_string (new_manifest, MANIFEST_GROUP,
+                           MANIFEST_KEY_VERSION, PACKAGE_VERSION);
+    g_key_file_set_string (new_manifest, MANIFEST_GROUP,
+                           MANIFEST_KEY_API_VERSION, NAUTILUS_EXTENSION_API_VERSION);
+
     dir = g_dir_open (dirname, 0, NULL);
 
     if (dir)
@@ -237,7 +490,8 @@ load_module_dir (const char *dirname)
                 filename = g_build_filename (dirname,
                                              name,
                                              NULL);
-                nautilus_module_load_file (filename, installed_module_name_builder);
+                load_module_file (filename, old_manifest, new_manifest,
+                                  installed_module_name_builder);
                 g_free (filename);
             }
         }
@@ -246,6 +500,43 @@ load_module_dir (const char *dirname)
     }
 
     installed_module_names = g_strv_builder_end (installed_module_name_builder);
+
+    save_manifest (old_manifest, new_manifest, manifest_path);
+
+    DEBUG ("Extension setup took %.2f ms, %u of %u modules deferred",
+           (g_get_monotonic_time () - start_time) / 1000.0,
+           g_list_length (deferred_modules), g_strv_length (installed_module_names));
+}
+
+static void
+load_deferred_modules_for_type (GType type)
+{
+    const gchar *type_name;
+    GList *l, *next;
+
+    type_name = g_type_name (type);
+
+    for (l = deferred_modules; l != NULL; l = next)
+    {
+        NautilusModule *module = l->data;
+
+        next = l->next;
+
+        /* Only interfaces are recorded, so anything else requires all modules. */
+        if (G_TYPE_IS_INTERFACE (type) &&
+            !g_strv_contains ((const gchar * const *) module->interfaces, type_name))
+        {
+            continue;
+        }
+
+        deferred_modules = g_list_delete_link (deferred_modules, l);
+
+        DEBUG ("Loading %s on demand for %s", module->path, type_name);
+        if (!nautilus_module_load_objects (module))
+        {
+            g_object_unref (module);
+        }
+    }
 }
 
 static void
@@ -260,6 +551,7 @@ free_module_objects (void)
     }
 
     g_list_free (module_objects);
+    g_list_free_full (deferred_modules, g_object_unref);
     g_strfreev (installed_module_names);
 }
 
@@ -292,6 +584,8 @@ nautilus_module_get_extensions_for_type (GType type)
     GList *l;
     GList *ret = NULL;
 
+    load_deferred_modules_for_type (type);
+
     for (l = module_objects; l != NULL; l = l->next)
     {
         if (G_TYPE_CHECK_INSTANCE_TYPE (G_OBJECT (l->data),
@@ -67,3 +67,325 @@ _nautilus_profile_log (const char *func,
     g_access (str, F_OK);
     g_free (str);
 }
+
+#define TRACE_BUFFER_SIZE 32768
+
+typedef struct
+{
+    gint64 time;
+    const char *category;
+    const char *name;
+    gint64 value;
+    guint tid;
+    char phase;
+} TraceEvent;
+
+/* Buffers are recycled, so their memory is bounded by the number of
+ * threads tracing at the same time. A buffer left by an exited thread
+ * is taken over by the next thread starting to trace, which is why
+ * each event records its own tid.
+ */
+typedef struct
+{
+    guint tid;
+    /* Protected by the trace_buffers lock. */
+    gboolean exited;
+    /* Serializes the owning thread with exporting. */
+    GMutex mutex;
+    /* Total number of events written, the ring holds the last
+     * TRACE_BUFFER_SIZE of them. */
+    guint n_written;
+    TraceEvent events[TRACE_BUFFER_SIZE];
+} TraceBuffer;
+
+gint _nautilus_profile_tracing = 0;
+
+static gint64 trace_start_time;
+static char *trace_path;
+static guint next_tid = 1;
+
+G_LOCK_DEFINE_STATIC (trace_buffers);
+static GList *trace_buffers;
+
+static void
+trace_buffer_thread_exited (gpointer data)
+{
+    TraceBuffer *buffer = data;
+
+    G_LOCK (trace_buffers);
+    buffer->exited = TRUE;
+    G_UNLOCK (trace_buffers);
+}
+
+static GPrivate trace_buffer_key = G_PRIVATE_INIT (trace_buffer_thread_exited);
+
+static TraceBuffer *
+get_trace_buffer (void)
+{
+    TraceBuffer *buffer;
+
+    buffer = g_private_get (&trace_buffer_key);
+    if (G_LIKELY (buffer != NULL))
+    {
+        return buffer;
+    }
+
+    G_LOCK (trace_buffers);
+    for (GList *l = trace_buffers; l != NULL; l = l->next)
+    {
+        TraceBuffer *exited_buffer = l->data;
+
+        if (exited_buffer->exited)
+        {
+            buffer = exited_buffer;
+            buffer->exited = FALSE;
+            break;
+        }
+    }
+
+    if (buffer == NULL)
+    {
+        buffer = g_new0 (TraceBuffer, 1);
+        g_mutex_init (&buffer->mutex);
+        trace_buffers = g_list_prepend (trace_buffers, buffer);
+    }
+    G_UNLOCK (trace_buffers);
+
+    buffer->tid = g_atomic_int_add (&next_tid, 1);
+    g_private_set (&trace_buffer_key, buffer);
+
+    return buffer;
+}
+
+void
+_nautilus_profile_trace (const char *category,
+                         const char *name,
+                         gint64      value,
+                         char        phase)
+{
+    TraceBuffer *buffer;
+    TraceEvent *event;
+
+    buffer = get_trace_buffer ();
+
+    /* Only contended while a trace is being exported. */
+    g_mutex_lock (&buffer->mutex);
+    event = &buffer->events[buffer->n_written % TRACE_BUFFER_SIZE];
+    event->time = g_get_monotonic_time ();
+    event->category = category;
+    event->name = name;
+    event->value = value;
+    event->tid = buffer->tid;
+    event->phase = phase;
+    buffer->n_written++;
+    g_mutex_unlock (&buffer->mutex);
+}
+
+/* Copies the events of @buffer in the order they were written, so they can
+ * be formatted without holding up the owning thread.
+ */
+static GArray *
+trace_buffer_snapshot (TraceBuffer *buffer)
+{
+    GArray *events;
+    guint first;
+
+    g_mutex_lock (&buffer->mutex);
+    first = buffer->n_written > TRACE_BUFFER_SIZE ? buffer->n_written - TRACE_BUFFER_SIZE : 0;
+    events = g_array_sized_new (FALSE, FALSE, sizeof (TraceEvent),
+                                buffer->n_written - first);
+    for (guint i = first; i < buffer->n_written; i++)
+    {
+        g_array_append_val (events, buffer->events[i % TRACE_BUFFER_SIZE]);
+    }
+    g_mutex_unlock (&buffer->mutex);
+
+    return events;
+}
+
+static void
+trace_buffer_free (TraceBuffer *buffer)
+{
+    g_mutex_clear (&buffer->mutex);
+    g_free (buffer);
+}
+
+static void
+append_json_string (GString    *json,
+                    const char *str)
+{
+    g_string_append_c (json, '"');
+    for (const char *p = str != NULL ? str : ""; *p != '\0'; p++)
+    {
+        if (*p == '"' || *p == '\\')
+        {
+            g_string_append_printf (json, "\\%c", *p);
+        }
+        else if ((guchar) *p < 0x20)
+        {
+            g_string_append_printf (json, "\\u%04x", (guchar) *p);
+        }
+        else
+        {
+            g_string_append_c (json, *p);
+        }
+    }
+    g_string_append_c (json, '"');
+}
+
+static void
+append_trace_event (GString    *json,
+                    TraceEvent *event)
+{
+    if (json->str[json->len - 1] == '}')
+    {
+        g_string_append (json, ",\n");
+    }
+
+    g_string_append (json, "{\"name\":");
+    append_json_string (json, event->name);
+    g_string_append (json, ",\"cat\":");
+    append_json_string (json, event->category);
+    g_string_append_printf (json, ",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT
+                            ",\"pid\":%d,\"tid\":%u",
+                            event->phase, event->time, (int) getpid (), event->tid);
+
+    switch (event->phase)
+    {
+        case 'b':
+        case 'e':
+        {
+            g_string_append_printf (json, ",\"id\":\"0x%" G_GINT64_MODIFIER "x\"",
+                                    event->value);
+        }
+        break;
+
+        case 'C':
+        {
+            g_string_append_printf (json, ",\"args\":{\"value\":%" G_GINT64_FORMAT "}",
+                                    event->value);
+        }
+        break;
+
+        case 'i':
+        {
+            g_string_append (json, ",\"s\":\"t\"");
+        }
+        break;
+
+        default:
+        {
+        }
+        break;
+    }
+
+    g_string_append_c (json, '}');
+}
+
+/* Writes every event recorded since tracing was last enabled. Buffers of
+ * threads that have exited are released afterwards.
+ */
+gboolean
+nautilus_profile_write_trace (const char  *path,
+                              GError     **error)
+{
+    g_autoptr (GString) json = NULL;
+    g_autoptr (GPtrArray) snapshots = NULL;
+    GList *l, *next;
+    gboolean success;
+
+    json = g_string_new ("{\"traceEvents\":[\n");
+    snapshots = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+
+    G_LOCK (trace_buffers);
+    for (l = trace_buffers; l != NULL; l = next)
+    {
+        TraceBuffer *buffer = l->data;
+
+        next = l->next;
+
+        g_ptr_array_add (snapshots, trace_buffer_snapshot (buffer));
+
+        if (buffer->exited)
+        {
+            trace_buffers = g_list_delete_link (trace_buffers, l);
+            trace_buffer_free (buffer);
+        }
+    }
+    G_UNLOCK (trace_buffers);
+
+    for (guint i = 0; i < snapshots->len; i++)
+    {
+        GArray *events = g_ptr_array_index (snapshots, i);
+
+        for (guint j = 0; j < events->len; j++)
+        {
+            TraceEvent *event = &g_array_index (events, TraceEvent, j);
+
+            if (event->time >= trace_start_time)
+            {
+                append_trace_event (json, event);
+            }
+        }
+    }
+
+    g_string_append (json, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    success = g_file_set_contents (path, json->str, json->len, error);
+
+    return success;
+}
+
+void
+nautilus_profile_set_tracing (gboolean enabled)
+{
+    g_autoptr (GError) error = NULL;
+
+    if (enabled == nautilus_profile_is_tracing ())
+    {
+        return;
+    }
+
+    if (enabled)
+    {
+        trace_start_time = g_get_monotonic_time ();
+        g_atomic_int_set (&_nautilus_profile_tracing, 1);
+        return;
+    }
+
+    g_atomic_int_set (&_nautilus_profile_tracing, 0);
+
+    if (trace_path == NULL)
+    {
+        g_autofree char *directory = NULL;
+
+        directory = g_build_filename (g_get_user_cache_dir (), "nautilus", NULL);
+        g_mkdir_with_parents (directory, 0700);
+        trace_path = g_build_filename (directory, "trace.json", NULL);
+    }
+
+    if (nautilus_profile_write_trace (trace_path, &error))
+    {
+        g_message ("Trace written to %s", trace_path);
+    }
+    else
+    {
+        g_warning ("Failed to write trace: %s", error->message);
+    }
+}
+
+void
+nautilus_profile_init (void)
+{
+    const char *path;
+
+    path = g_getenv ("NAUTILUS_TRACE");
+    if (path == NULL || *path == '\0')
+    {
+        return;
+    }
+
+    g_free (trace_path);
+    trace_path = g_strdup (path);
+    nautilus_profile_set_tracing (TRUE);
+}
@@ -31,17 +31,17 @@ G_BEGIN_DECLS
 
 #ifdef ENABLE_PROFILING
 #ifdef G_HAVE_ISO_VARARGS
-#define nautilus_profile_start(...) _nautilus_profile_log (G_STRFUNC, "start", __VA_ARGS__)
-#define nautilus_profile_end(...)   _nautilus_profile_log (G_STRFUNC, "end", __VA_ARGS__)
+#define nautilus_profile_start(...) G_STMT_START { nautilus_profile_mark ("start"); _nautilus_profile_log (G_STRFUNC, "start", __VA_ARGS__); } G_STMT_END
+#define nautilus_profile_end(...)   G_STMT_START { nautilus_profile_mark ("end"); _nautilus_profile_log (G_STRFUNC, "end", __VA_ARGS__); } G_STMT_END
 #define nautilus_profile_msg(...)   _nautilus_profile_log (NULL, NULL, __VA_ARGS__)
 #elif defined(G_HAVE_GNUC_VARARGS)
-#define nautilus_profile_start(format...) _nautilus_profile_log (G_STRFUNC, "start", format)
-#define nautilus_profile_end(format...)   _nautilus_profile_log (G_STRFUNC, "end", format)
+#define nautilus_profile_start(format...) G_STMT_START { nautilus_profile_mark ("start"); _nautilus_profile_log (G_STRFUNC, "start", format); } G_STMT_END
+#define nautilus_profile_end(format...)   G_STMT_START { nautilus_profile_mark ("end"); _nautilus_profile_log (G_STRFUNC, "end", format); } G_STMT_END
 #define nautilus_profile_msg(format...)   _nautilus_profile_log (NULL, NULL, format)
 #endif
 #else
-#define nautilus_profile_start(...)
-#define nautilus_profile_end(...)
+#define nautilus_profile_start(...) nautilus_profile_mark ("start")
+#define nautilus_profile_end(...)   nautilus_profile_mark ("end")
 #define nautilus_profile_msg(...)
 #endif
 
@@ -50,4 +50,60 @@ void            _nautilus_profile_log    (const char *func,
                                           const char *format,
                                           ...) G_GNUC_PRINTF (3, 4);
 
-G_END_DECLS
\ No newline at end of file
+/*
+ * Structured tracing, available in every build.
+ *
+ * Events are recorded into per-thread ring buffers and exported as a
+ * Chrome/Perfetto JSON trace, which can be opened in ui.perfetto.dev or
+ * chrome://tracing. Tracing is enabled at startup by setting NAUTILUS_TRACE
+ * to the output path, or at runtime by toggling the "trace" action of the
+ * application over D-Bus:
+ *
+ *       gdbus call --session --dest org.gnome.Nautilus \
+ *                  --object-path /org/gnome/Nautilus \
+ *                  --method org.gtk.Actions.SetState trace "<true>" {}
+ *
+ * Category and name arguments must be static strings, they are stored as-is.
+ * When tracing is disabled every macro costs a single atomic load.
+ */
+extern gint _nautilus_profile_tracing;
+
+#define nautilus_profile_is_tracing() (g_atomic_int_get (&_nautilus_profile_tracing) != 0)
+
+#define _nautilus_profile_trace_if_enabled(category, name, value, phase) \
+    G_STMT_START { \
+        if (G_UNLIKELY (nautilus_profile_is_tracing ())) \
+        { \
+            _nautilus_profile_trace ((category), (name), (gint64) (value), (phase)); \
+        } \
+    } G_STMT_END
+
+/* Synchronous spans must begin and end on the same thread. */
+#define nautilus_profile_span_begin(category, name) \
+    _nautilus_profile_trace_if_enabled (category, name, 0, 'B')
+#define nautilus_profile_span_end(category, name) \
+    _nautilus_profile_trace_if_enabled (category, name, 0, 'E')
+
+/* Asynchronous spans are matched by @id and may cross threads and idles. */
+#define nautilus_profile_async_begin(category, name, id) \
+    _nautilus_profile_trace_if_enabled (category, name, GPOINTER_TO_SIZE (id), 'b')
+#define nautilus_profile_async_end(category, name, id) \
+    _nautilus_profile_trace_if_enabled (category, name, GPOINTER_TO_SIZE (id), 'e')
+
+#define nautilus_profile_counter(name, value) \
+    _nautilus_profile_trace_if_enabled ("counter", name, value, 'C')
+
+#define nautilus_profile_mark(note) \
+    _nautilus_profile_trace_if_enabled (note, G_STRFUNC, 0, 'i')
+
+void            _nautilus_profile_trace  (const char *category,
+                                          const char *name,
+                                          gint64      value,
+                                          char        phase);
+
+void            nautilus_profile_init          (void);
+void            nautilus_profile_set_tracing   (gboolean     enabled);
+gboolean        nautilus_profile_write_trace   (const char  *path,
+                                                GError     **error);
+
+G_END_DECLS
@@ -22,8 +22,19 @@
 
 #include <config.h>
 
+#include <gio/gio.h>
+#include <glib/gi18n.h>
+
 #include "nautilus-progress-info-manager.h"
 
+/* Jobs writing to the same device are queued, so that several large copies
+ * to e.g. the same USB stick don't thrash it with interleaved writes. Jobs
+ * on independent devices still run in parallel.
+ */
+#define MAX_JOBS_PER_DEVICE 2
+#define MAX_JOBS_PER_SLOW_DEVICE 1
+#define QUEUE_POLL_INTERVAL (G_TIME_SPAN_SECOND / 4)
+
 struct _NautilusProgressInfoManager
 {
     GObject parent_instance;
@@ -39,8 +50,25 @@ enum
     LAST_SIGNAL
 };
 
+typedef struct
+{
+    guint max_jobs;
+    guint n_running;
+    GQueue queue;
+} DeviceQueue;
+
 static NautilusProgressInfoManager *singleton = NULL;
 
+/* The device queues are used from the job threads, so they are kept outside
+ * of the singleton and protected by their own lock.
+ */
+static GMutex device_queues_mutex;
+static GCond device_queues_cond;
+/* filesystem id -> DeviceQueue */
+static GHashTable *device_queues = NULL;
+/* NautilusProgressInfo -> DeviceQueue it is running on */
+static GHashTable *running_jobs = NULL;
+
 static guint signals[LAST_SIGNAL] = { 0, };
 
 G_DEFINE_TYPE (NautilusProgressInfoManager, nautilus_progress_info_manager,
@@ -237,3 +265,207 @@ nautilus_progress_manager_has_viewers (NautilusProgressInfoManager *self)
 {
     return self->current_viewers != NULL;
 }
+
+static gchar *
+get_device_id (GFile *file,
+               guint *max_jobs)
+{
+    g_autoptr (GFileInfo) info = NULL;
+    g_autoptr (GMount) mount = NULL;
+    const gchar *id;
+
+    info = g_file_query_info (file,
+                              G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+                              G_FILE_QUERY_INFO_NONE,
+                              NULL, NULL);
+    id = info != NULL ? g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM) : NULL;
+    if (id == NULL)
+    {
+        return NULL;
+    }
+
+    /* Removable drives and remote locations are the ones which suffer the
+     * most from concurrent writers.
+     */
+    mount = g_file_find_enclosing_mount (file, NULL, NULL);
+    if (!g_file_is_native (file) ||
+        (mount != NULL && g_mount_can_eject (mount)))
+    {
+        *max_jobs = MAX_JOBS_PER_SLOW_DEVICE;
+    }
+    else
+    {
+        *max_jobs = MAX_JOBS_PER_DEVICE;
+    }
+
+    return g_strdup (id);
+}
+
+static gboolean
+can_start_job (DeviceQueue          *device,
+               NautilusProgressInfo *info)
+{
+    return device->n_running < device->max_jobs && g_queue_peek_head (&device->queue) == info;
+}
+
+static GList *
+find_queued_job (NautilusProgressInfo  *info,
+                 DeviceQueue          **device_out)
+{
+    GHashTableIter iter;
+    DeviceQueue *device;
+
+    if (device_queues == NULL)
+    {
+        return NULL;
+    }
+
+    g_hash_table_iter_init (&iter, device_queues);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &device))
+    {
+        for (GList *l = device->queue.head; l != NULL; l = l->next)
+        {
+            if (l->data == info)
+            {
+                *device_out = device;
+                return l;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * nautilus_progress_info_manager_wait_for_device:
+ * @info: the progress info of the job
+ * @file: a file on the device the job is going to write to
+ *
+ * Called from a job thread before it starts the bulk of its I/O. Blocks
+ * until the device of @file can take another job, or until the job is
+ * cancelled. While waiting, @info is marked as queued.
+ *
+ * Must be paired with nautilus_progress_info_manager_release_device ().
+ */
+void
+nautilus_progress_info_manager_wait_for_device (NautilusProgressInfo *info,
+                                                GFile                *file)
+{
+    g_autoptr (GCancellable) cancellable = NULL;
+    g_autofree gchar *id = NULL;
+    DeviceQueue *device;
+    guint max_jobs;
+    gboolean queued = FALSE;
+
+    id = get_device_id (file, &max_jobs);
+    if (id == NULL)
+    {
+        return;
+    }
+
+    cancellable = nautilus_progress_info_get_cancellable (info);
+
+    g_mutex_lock (&device_queues_mutex);
+
+    if (device_queues == NULL)
+    {
+        device_queues = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+        running_jobs = g_hash_table_new (NULL, NULL);
+    }
+
+    device = g_hash_table_lookup (device_queues, id);
+    if (device == NULL)
+    {
+        device = g_new0 (DeviceQueue, 1);
+        device->max_jobs = max_jobs;
+        g_queue_init (&device->queue);
+        g_hash_table_insert (device_queues, g_steal_pointer (&id), device);
+    }
+
+    g_queue_push_tail (&device->queue, info);
+
+    while (!can_start_job (device, info) &&
+           !g_cancellable_is_cancelled (cancellable))
+    {
+        if (!queued)
+        {
+            nautilus_progress_info_set_queued (info, TRUE);
+            nautilus_progress_info_set_details (info, _("Waiting for other operations on the same device"));
+            queued = TRUE;
+        }
+
+        /* Cancelling doesn't signal the condition, so wake up periodically. */
+        g_cond_wait_until (&device_queues_cond, &device_queues_mutex,
+                           g_get_monotonic_time () + QUEUE_POLL_INTERVAL);
+    }
+
+    g_queue_remove (&device->queue, info);
+
+    if (!g_cancellable_is_cancelled (cancellable))
+    {
+        device->n_running++;
+        g_hash_table_insert (running_jobs, info, device);
+    }
+
+    /* The head of the queue changed. */
+    g_cond_broadcast (&device_queues_cond);
+
+    g_mutex_unlock (&device_queues_mutex);
+
+    if (queued)
+    {
+        nautilus_progress_info_set_queued (info, FALSE);
+    }
+}
+
+/**
+ * nautilus_progress_info_manager_release_device:
+ * @info: the progress info of the job
+ *
+ * Lets the next queued job on the device start. Does nothing if the job
+ * didn't get the device from nautilus_progress_info_manager_wait_for_device ().
+ */
+void
+nautilus_progress_info_manager_release_device (NautilusProgressInfo *info)
+{
+    DeviceQueue *device;
+
+    g_mutex_lock (&device_queues_mutex);
+
+    device = running_jobs != NULL ? g_hash_table_lookup (running_jobs, info) : NULL;
+    if (device != NULL)
+    {
+        g_hash_table_remove (running_jobs, info);
+        device->n_running--;
+        g_cond_broadcast (&device_queues_cond);
+    }
+
+    g_mutex_unlock (&device_queues_mutex);
+}
+
+/**
+ * nautilus_progress_info_manager_move_info_to_front:
+ * @self: the manager
+ * @info: a queued progress info
+ *
+ * Makes the queued job of @info the next one to start on its device.
+ */
+void
+nautilus_progress_info_manager_move_info_to_front (NautilusProgressInfoManager *self,
+                                                   NautilusProgressInfo        *info)
+{
+    DeviceQueue *device;
+    GList *link;
+
+    g_mutex_lock (&device_queues_mutex);
+
+    link = find_queued_job (info, &device);
+    if (link != NULL)
+    {
+        g_queue_unlink (&device->queue, link);
+        g_queue_push_head_link (&device->queue, link);
+        g_cond_broadcast (&device_queues_cond);
+    }
+
+    g_mutex_unlock (&device_queues_mutex);
+}
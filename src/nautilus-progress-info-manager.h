@@ -22,7 +22,7 @@
 
 #pragma once
 
-#include <glib-object.h>
+#include <gio/gio.h>
 
 #include "nautilus-progress-info.h"
 
@@ -41,4 +41,11 @@ void nautilus_progress_manager_add_viewer (NautilusProgressInfoManager *self, GO
 void nautilus_progress_manager_remove_viewer (NautilusProgressInfoManager *self, GObject *viewer);
 gboolean nautilus_progress_manager_has_viewers (NautilusProgressInfoManager *self);
 
+void nautilus_progress_info_manager_wait_for_device (NautilusProgressInfo *info,
+                                                     GFile                *file);
+void nautilus_progress_info_manager_release_device (NautilusProgressInfo *info);
+
+void nautilus_progress_info_manager_move_info_to_front (NautilusProgressInfoManager *self,
+                                                        NautilusProgressInfo        *info);
+
 G_END_DECLS
\ No newline at end of file
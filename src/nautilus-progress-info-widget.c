@@ -24,6 +24,7 @@
 #include <config.h>
 
 #include "nautilus-progress-info-widget.h"
+#include "nautilus-progress-info-manager.h"
 struct _NautilusProgressInfoWidgetPrivate
 {
     NautilusProgressInfo *info;
@@ -32,6 +33,7 @@ struct _NautilusProgressInfoWidgetPrivate
     GtkWidget *details;     /* GtkLabel */
     GtkWidget *progress_bar;
     GtkWidget *button;
+    GtkWidget *start_next_button;
 };
 
 enum
@@ -73,6 +75,9 @@ update_data (NautilusProgressInfoWidget *self)
     gtk_label_set_markup (GTK_LABEL (self->priv->details), markup);
     g_free (details);
     g_free (markup);
+
+    gtk_widget_set_visible (self->priv->start_next_button,
+                            nautilus_progress_info_get_is_queued (self->priv->info));
 }
 
 static void
@@ -101,6 +106,16 @@ button_clicked (GtkWidget                  *button,
     }
 }
 
+static void
+start_next_button_clicked (GtkWidget                  *button,
+                           NautilusProgressInfoWidget *self)
+{
+    g_autoptr (NautilusProgressInfoManager) manager = NULL;
+
+    manager = nautilus_progress_info_manager_dup_singleton ();
+    nautilus_progress_info_manager_move_info_to_front (manager, self->priv->info);
+}
+
 static void
 nautilus_progress_info_widget_dispose (GObject *obj)
 {
@@ -181,6 +196,8 @@ nautilus_progress_info_widget_init (NautilusProgressInfoWidget *self)
 
     g_signal_connect (self->priv->button, "clicked",
                       G_CALLBACK (button_clicked), self);
+    g_signal_connect (self->priv->start_next_button, "clicked",
+                      G_CALLBACK (start_next_button_clicked), self);
 }
 
 static void
@@ -212,6 +229,7 @@ nautilus_progress_info_widget_class_init (NautilusProgressInfoWidgetClass *klass
     gtk_widget_class_bind_template_child_private (widget_class, NautilusProgressInfoWidget, details);
     gtk_widget_class_bind_template_child_private (widget_class, NautilusProgressInfoWidget, progress_bar);
     gtk_widget_class_bind_template_child_private (widget_class, NautilusProgressInfoWidget, button);
+    gtk_widget_class_bind_template_child_private (widget_class, NautilusProgressInfoWidget, start_next_button);
 }
 
 GtkWidget *
@@ -38,8 +38,21 @@ enum
     LAST_SIGNAL
 };
 
+/* Signals waiting to be emitted from the idle. */
+enum
+{
+    PENDING_STARTED = 1 << 0,
+    PENDING_CHANGED = 1 << 1,
+    PENDING_PROGRESS = 1 << 2,
+    PENDING_FINISHED = 1 << 3,
+    PENDING_CANCELLED = 1 << 4,
+};
+
 #define SIGNAL_DELAY_MSEC 100
 
+/* Progress is stored as an integer fraction so it can be updated atomically. */
+#define PROGRESS_SCALE 10000
+
 static guint signals[LAST_SIGNAL] = { 0 };
 
 struct _NautilusProgressInfo
@@ -49,38 +62,43 @@ struct _NautilusProgressInfo
     GCancellable *cancellable;
     guint cancellable_id;
 
+    /* Everything below up to the numeric state is protected by the mutex. */
+    GMutex mutex;
+
     GTimer *progress_timer;
 
     char *status;
     char *details;
-    double progress;
-    gdouble remaining_time;
-    gdouble elapsed_time;
-    gboolean activity_mode;
     gboolean started;
     gboolean finished;
     gboolean paused;
+    gboolean queued;
 
     GSource *idle_source;
     gboolean source_is_now;
 
-    gboolean start_at_idle;
-    gboolean finish_at_idle;
-    gboolean cancel_at_idle;
-    gboolean changed_at_idle;
-    gboolean progress_at_idle;
-
     GFile *destination;
-};
 
-G_LOCK_DEFINE_STATIC (progress_info);
+    /* Read together, so they never mix two updates. */
+    gboolean has_transfer;
+    gint files_done;
+    gint files_total;
+    goffset bytes_done;
+    goffset bytes_total;
+    goffset transfer_rate;
+
+    /* Numeric state, updated from the job threads without taking the mutex. */
+    gint progress;
+    gint activity_mode;
+    gint remaining_time;
+    gint elapsed_time;
+
+    NautilusProgressInfoDetailsFunc details_func;
 
-G_DEFINE_TYPE (NautilusProgressInfo, nautilus_progress_info, G_TYPE_OBJECT)
+    guint pending_signals;
+};
 
-static void set_details (NautilusProgressInfo *info,
-                         const char           *details);
-static void set_status (NautilusProgressInfo *info,
-                        const char           *status);
+G_DEFINE_TYPE (NautilusProgressInfo, nautilus_progress_info, G_TYPE_OBJECT)
 
 static void
 nautilus_progress_info_finalize (GObject *object)
@@ -95,6 +113,7 @@ nautilus_progress_info_finalize (GObject *object)
     g_cancellable_disconnect (info->cancellable, info->cancellable_id);
     g_object_unref (info->cancellable);
     g_clear_object (&info->destination);
+    g_mutex_clear (&info->mutex);
 
     if (G_OBJECT_CLASS (nautilus_progress_info_parent_class)->finalize)
     {
@@ -102,34 +121,12 @@ nautilus_progress_info_finalize (GObject *object)
     }
 }
 
-static void
-nautilus_progress_info_dispose (GObject *object)
-{
-    NautilusProgressInfo *info;
-
-    info = NAUTILUS_PROGRESS_INFO (object);
-
-    G_LOCK (progress_info);
-
-    /* Destroy source in dispose, because the callback
-     *  could come here before the destroy, which should
-     *  ressurect the object for a while */
-    if (info->idle_source)
-    {
-        g_source_destroy (info->idle_source);
-        g_source_unref (info->idle_source);
-        info->idle_source = NULL;
-    }
-    G_UNLOCK (progress_info);
-}
-
 static void
 nautilus_progress_info_class_init (NautilusProgressInfoClass *klass)
 {
     GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
     gobject_class->finalize = nautilus_progress_info_finalize;
-    gobject_class->dispose = nautilus_progress_info_dispose;
 
     signals[CHANGED] =
         g_signal_new ("changed",
@@ -181,95 +178,74 @@ static gboolean
 idle_callback (gpointer data)
 {
     NautilusProgressInfo *info = data;
-    gboolean start_at_idle;
-    gboolean finish_at_idle;
-    gboolean changed_at_idle;
-    gboolean progress_at_idle;
-    gboolean cancelled_at_idle;
     GSource *source;
+    guint pending;
 
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
 
     source = g_main_current_source ();
 
-    /* Protect agains races where the source has
-     *  been destroyed on another thread while it
-     *  was being dispatched.
-     *  Similar to what gdk_threads_add_idle does.
+    /* Protect against races where the source has been replaced
+     * on another thread while it was being dispatched.
      */
     if (g_source_is_destroyed (source))
     {
-        G_UNLOCK (progress_info);
-        return FALSE;
+        g_mutex_unlock (&info->mutex);
+        return G_SOURCE_REMOVE;
     }
 
-    /* We hadn't destroyed the source, so take a ref.
-     * This might ressurect the object from dispose, but
-     * that should be ok.
-     */
-    g_object_ref (info);
-
     g_assert (source == info->idle_source);
 
     g_source_unref (source);
     info->idle_source = NULL;
 
-    start_at_idle = info->start_at_idle;
-    finish_at_idle = info->finish_at_idle;
-    changed_at_idle = info->changed_at_idle;
-    progress_at_idle = info->progress_at_idle;
-    cancelled_at_idle = info->cancel_at_idle;
+    g_mutex_unlock (&info->mutex);
 
-    info->start_at_idle = FALSE;
-    info->finish_at_idle = FALSE;
-    info->changed_at_idle = FALSE;
-    info->progress_at_idle = FALSE;
-    info->cancel_at_idle = FALSE;
-
-    G_UNLOCK (progress_info);
+    /* Fetch the pending signals only after clearing the source, so that
+     * anything requested meanwhile queues a new one.
+     */
+    pending = g_atomic_int_and (&info->pending_signals, 0);
 
-    if (start_at_idle)
+    if (pending & PENDING_STARTED)
     {
         g_signal_emit (info,
                        signals[STARTED],
                        0);
     }
 
-    if (changed_at_idle)
+    if (pending & PENDING_CHANGED)
     {
         g_signal_emit (info,
                        signals[CHANGED],
                        0);
     }
 
-    if (progress_at_idle)
+    if (pending & PENDING_PROGRESS)
     {
         g_signal_emit (info,
                        signals[PROGRESS_CHANGED],
                        0);
     }
 
-    if (finish_at_idle)
+    if (pending & PENDING_FINISHED)
     {
         g_signal_emit (info,
                        signals[FINISHED],
                        0);
     }
 
-    if (cancelled_at_idle)
+    if (pending & PENDING_CANCELLED)
     {
         g_signal_emit (info,
                        signals[CANCELLED],
                        0);
     }
 
-    g_object_unref (info);
-
-    return FALSE;
+    return G_SOURCE_REMOVE;
 }
 
 
-/* Called with lock held */
+/* Called with the mutex held */
 static void
 queue_idle (NautilusProgressInfo *info,
             gboolean              now)
@@ -293,21 +269,64 @@ queue_idle (NautilusProgressInfo *info,
         {
             info->idle_source = g_timeout_source_new (SIGNAL_DELAY_MSEC);
         }
-        g_source_set_callback (info->idle_source, idle_callback, info, NULL);
+        /* The source keeps the info alive until the signals are emitted. */
+        g_source_set_callback (info->idle_source, idle_callback,
+                               g_object_ref (info), g_object_unref);
         g_source_attach (info->idle_source, NULL);
     }
 }
 
+/* Called without the mutex held. Only the first of a burst of
+ * updates has to take the mutex to schedule the idle.
+ */
+static void
+queue_signals (NautilusProgressInfo *info,
+               guint                 pending,
+               gboolean              now)
+{
+    guint old_pending;
+
+    old_pending = g_atomic_int_or (&info->pending_signals, pending);
+
+    if (now || old_pending == 0)
+    {
+        g_mutex_lock (&info->mutex);
+        queue_idle (info, now);
+        g_mutex_unlock (&info->mutex);
+    }
+}
+
+/* Called with the mutex held */
+static void
+set_details (NautilusProgressInfo *info,
+             const char           *details)
+{
+    g_free (info->details);
+    info->details = g_strdup (details);
+
+    /* Explicit details replace the ones formatted from the transfer. */
+    info->has_transfer = FALSE;
+}
+
+/* Called with the mutex held */
+static void
+set_status (NautilusProgressInfo *info,
+            const char           *status)
+{
+    g_free (info->status);
+    info->status = g_strdup (status);
+}
+
 static void
 on_canceled (GCancellable         *cancellable,
              NautilusProgressInfo *info)
 {
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
     set_details (info, _("Canceled"));
-    info->cancel_at_idle = TRUE;
     g_timer_stop (info->progress_timer);
-    queue_idle (info, TRUE);
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
+
+    queue_signals (info, PENDING_CHANGED | PENDING_CANCELLED, TRUE);
 }
 
 static void
@@ -315,6 +334,8 @@ nautilus_progress_info_init (NautilusProgressInfo *info)
 {
     NautilusProgressInfoManager *manager;
 
+    g_mutex_init (&info->mutex);
+
     info->cancellable = g_cancellable_new ();
     info->cancellable_id = g_cancellable_connect (info->cancellable,
                                                   G_CALLBACK (on_canceled),
@@ -342,7 +363,7 @@ nautilus_progress_info_get_status (NautilusProgressInfo *info)
 {
     char *res;
 
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
 
     if (info->status)
     {
@@ -353,7 +374,7 @@ nautilus_progress_info_get_status (NautilusProgressInfo *info)
         res = g_strdup (_("Preparing"));
     }
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 
     return res;
 }
@@ -361,9 +382,23 @@ nautilus_progress_info_get_status (NautilusProgressInfo *info)
 char *
 nautilus_progress_info_get_details (NautilusProgressInfo *info)
 {
+    NautilusProgressInfoDetailsFunc details_func;
+    gboolean has_transfer;
     char *res;
 
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
+    has_transfer = info->has_transfer;
+    g_mutex_unlock (&info->mutex);
+
+    /* Transfer details are only formatted when someone displays them. The
+     * func reads the transfer itself, so it is called without the mutex. */
+    details_func = g_atomic_pointer_get (&info->details_func);
+    if (details_func != NULL && has_transfer)
+    {
+        return details_func (info);
+    }
+
+    g_mutex_lock (&info->mutex);
 
     if (info->details)
     {
@@ -374,7 +409,7 @@ nautilus_progress_info_get_details (NautilusProgressInfo *info)
         res = g_strdup (_("Preparing"));
     }
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 
     return res;
 }
@@ -382,58 +417,30 @@ nautilus_progress_info_get_details (NautilusProgressInfo *info)
 double
 nautilus_progress_info_get_progress (NautilusProgressInfo *info)
 {
-    double res;
-
-    G_LOCK (progress_info);
-
-    if (info->activity_mode)
+    if (g_atomic_int_get (&info->activity_mode))
     {
-        res = -1.0;
-    }
-    else
-    {
-        res = info->progress;
+        return -1.0;
     }
 
-    G_UNLOCK (progress_info);
-
-    return res;
+    return (double) g_atomic_int_get (&info->progress) / PROGRESS_SCALE;
 }
 
 void
 nautilus_progress_info_cancel (NautilusProgressInfo *info)
 {
-    GCancellable *cancellable;
-
-    cancellable = nautilus_progress_info_get_cancellable (info);
-    g_cancellable_cancel (cancellable);
-    g_object_unref (cancellable);
+    g_cancellable_cancel (info->cancellable);
 }
 
 GCancellable *
 nautilus_progress_info_get_cancellable (NautilusProgressInfo *info)
 {
-    GCancellable *c;
-
-    G_LOCK (progress_info);
-
-    c = g_object_ref (info->cancellable);
-
-    G_UNLOCK (progress_info);
-
-    return c;
+    return g_object_ref (info->cancellable);
 }
 
 gboolean
 nautilus_progress_info_get_is_cancelled (NautilusProgressInfo *info)
 {
-    gboolean cancelled;
-
-    G_LOCK (progress_info);
-    cancelled = g_cancellable_is_cancelled (info->cancellable);
-    G_UNLOCK (progress_info);
-
-    return cancelled;
+    return g_cancellable_is_cancelled (info->cancellable);
 }
 
 gboolean
@@ -441,11 +448,11 @@ nautilus_progress_info_get_is_started (NautilusProgressInfo *info)
 {
     gboolean res;
 
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
 
     res = info->started;
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 
     return res;
 }
@@ -455,11 +462,11 @@ nautilus_progress_info_get_is_finished (NautilusProgressInfo *info)
 {
     gboolean res;
 
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
 
     res = info->finished;
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 
     return res;
 }
@@ -469,11 +476,11 @@ nautilus_progress_info_get_is_paused (NautilusProgressInfo *info)
 {
     gboolean res;
 
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
 
     res = info->paused;
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 
     return res;
 }
@@ -481,7 +488,7 @@ nautilus_progress_info_get_is_paused (NautilusProgressInfo *info)
 void
 nautilus_progress_info_pause (NautilusProgressInfo *info)
 {
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
 
     if (!info->paused)
     {
@@ -489,13 +496,13 @@ nautilus_progress_info_pause (NautilusProgressInfo *info)
         g_timer_stop (info->progress_timer);
     }
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 }
 
 void
 nautilus_progress_info_resume (NautilusProgressInfo *info)
 {
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
 
     if (info->paused)
     {
@@ -503,67 +510,94 @@ nautilus_progress_info_resume (NautilusProgressInfo *info)
         g_timer_continue (info->progress_timer);
     }
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
+}
+
+gboolean
+nautilus_progress_info_get_is_queued (NautilusProgressInfo *info)
+{
+    gboolean res;
+
+    g_mutex_lock (&info->mutex);
+
+    res = info->queued;
+
+    g_mutex_unlock (&info->mutex);
+
+    return res;
+}
+
+void
+nautilus_progress_info_set_queued (NautilusProgressInfo *info,
+                                   gboolean              queued)
+{
+    gboolean changed = FALSE;
+
+    g_mutex_lock (&info->mutex);
+
+    if (info->queued != queued)
+    {
+        info->queued = queued;
+        changed = TRUE;
+    }
+
+    g_mutex_unlock (&info->mutex);
+
+    if (changed)
+    {
+        queue_signals (info, PENDING_CHANGED, FALSE);
+    }
 }
 
 void
 nautilus_progress_info_start (NautilusProgressInfo *info)
 {
-    G_LOCK (progress_info);
+    gboolean changed = FALSE;
+
+    g_mutex_lock (&info->mutex);
 
     if (!info->started)
     {
         info->started = TRUE;
         g_timer_start (info->progress_timer);
-
-        info->start_at_idle = TRUE;
-        queue_idle (info, TRUE);
+        changed = TRUE;
     }
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
+
+    if (changed)
+    {
+        queue_signals (info, PENDING_STARTED, TRUE);
+    }
 }
 
 void
 nautilus_progress_info_finish (NautilusProgressInfo *info)
 {
-    G_LOCK (progress_info);
+    gboolean changed = FALSE;
+
+    g_mutex_lock (&info->mutex);
 
     if (!info->finished)
     {
         info->finished = TRUE;
         g_timer_stop (info->progress_timer);
-
-        info->finish_at_idle = TRUE;
-        queue_idle (info, TRUE);
+        changed = TRUE;
     }
 
-    G_UNLOCK (progress_info);
-}
+    g_mutex_unlock (&info->mutex);
 
-static void
-set_status (NautilusProgressInfo *info,
-            const char           *status)
-{
-    g_free (info->status);
-    info->status = g_strdup (status);
-
-    info->changed_at_idle = TRUE;
-    queue_idle (info, FALSE);
+    if (changed)
+    {
+        queue_signals (info, PENDING_FINISHED, TRUE);
+    }
 }
 
 void
 nautilus_progress_info_take_status (NautilusProgressInfo *info,
                                     char                 *status)
 {
-    G_LOCK (progress_info);
-
-    if (g_strcmp0 (info->status, status) != 0 &&
-        !g_cancellable_is_cancelled (info->cancellable))
-    {
-        set_status (info, status);
-    }
-
-    G_UNLOCK (progress_info);
+    nautilus_progress_info_set_status (info, status);
 
     g_free (status);
 }
@@ -572,71 +606,120 @@ void
 nautilus_progress_info_set_status (NautilusProgressInfo *info,
                                    const char           *status)
 {
-    G_LOCK (progress_info);
+    gboolean changed = FALSE;
+
+    g_mutex_lock (&info->mutex);
 
     if (g_strcmp0 (info->status, status) != 0 &&
         !g_cancellable_is_cancelled (info->cancellable))
     {
         set_status (info, status);
+        changed = TRUE;
     }
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
+
+    if (changed)
+    {
+        queue_signals (info, PENDING_CHANGED, FALSE);
+    }
 }
 
-static void
-set_details (NautilusProgressInfo *info,
-             const char           *details)
+void
+nautilus_progress_info_take_details (NautilusProgressInfo *info,
+                                     char                 *details)
 {
-    g_free (info->details);
-    info->details = g_strdup (details);
+    nautilus_progress_info_set_details (info, details);
 
-    info->changed_at_idle = TRUE;
-    queue_idle (info, FALSE);
+    g_free (details);
 }
 
 void
-nautilus_progress_info_take_details (NautilusProgressInfo *info,
-                                     char                 *details)
+nautilus_progress_info_set_details (NautilusProgressInfo *info,
+                                    const char           *details)
 {
-    G_LOCK (progress_info);
+    gboolean changed = FALSE;
+
+    g_mutex_lock (&info->mutex);
 
-    if (g_strcmp0 (info->details, details) != 0 &&
+    if ((g_strcmp0 (info->details, details) != 0 ||
+         info->has_transfer) &&
         !g_cancellable_is_cancelled (info->cancellable))
     {
         set_details (info, details);
+        changed = TRUE;
     }
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 
-    g_free (details);
+    if (changed)
+    {
+        queue_signals (info, PENDING_CHANGED, FALSE);
+    }
 }
 
 void
-nautilus_progress_info_set_details (NautilusProgressInfo *info,
-                                    const char           *details)
+nautilus_progress_info_set_details_func (NautilusProgressInfo            *info,
+                                         NautilusProgressInfoDetailsFunc  details_func)
 {
-    G_LOCK (progress_info);
+    g_atomic_pointer_set (&info->details_func, details_func);
+}
 
-    if (g_strcmp0 (info->details, details) != 0 &&
-        !g_cancellable_is_cancelled (info->cancellable))
+void
+nautilus_progress_info_set_transfer (NautilusProgressInfo *info,
+                                     gint                  files_done,
+                                     gint                  files_total,
+                                     goffset               bytes_done,
+                                     goffset               bytes_total,
+                                     goffset               transfer_rate)
+{
+    g_mutex_lock (&info->mutex);
+
+    /* Like set_details (), nothing changes once cancelled. */
+    if (g_cancellable_is_cancelled (info->cancellable))
     {
-        set_details (info, details);
+        g_mutex_unlock (&info->mutex);
+        return;
     }
 
-    G_UNLOCK (progress_info);
+    info->files_done = files_done;
+    info->files_total = files_total;
+    info->bytes_done = bytes_done;
+    info->bytes_total = bytes_total;
+    info->transfer_rate = transfer_rate;
+    info->has_transfer = TRUE;
+
+    g_mutex_unlock (&info->mutex);
+
+    queue_signals (info, PENDING_CHANGED, FALSE);
 }
 
 void
-nautilus_progress_info_pulse_progress (NautilusProgressInfo *info)
+nautilus_progress_info_get_transfer (NautilusProgressInfo *info,
+                                     gint                 *files_done,
+                                     gint                 *files_total,
+                                     goffset              *bytes_done,
+                                     goffset              *bytes_total,
+                                     goffset              *transfer_rate)
 {
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
 
-    info->activity_mode = TRUE;
-    info->progress = 0.0;
-    info->progress_at_idle = TRUE;
-    queue_idle (info, FALSE);
+    *files_total = info->files_total;
+    *files_done = info->files_done;
+    *bytes_total = info->bytes_total;
+    *bytes_done = info->bytes_done;
+    *transfer_rate = info->transfer_rate;
 
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
+}
+
+void
+nautilus_progress_info_pulse_progress (NautilusProgressInfo *info)
+{
+    g_atomic_int_set (&info->activity_mode, TRUE);
+    g_atomic_int_set (&info->progress, 0);
+
+    queue_signals (info, PENDING_PROGRESS, FALSE);
 }
 
 void
@@ -645,6 +728,7 @@ nautilus_progress_info_set_progress (NautilusProgressInfo *info,
                                      double                total)
 {
     double current_percent;
+    gint progress;
 
     if (total <= 0)
     {
@@ -665,61 +749,43 @@ nautilus_progress_info_set_progress (NautilusProgressInfo *info,
         }
     }
 
-    G_LOCK (progress_info);
+    progress = (gint) (current_percent * PROGRESS_SCALE);
 
-    if ((info->activity_mode ||     /* emit on switch from activity mode */
-         fabs (current_percent - info->progress) > 0.005) &&    /* Emit on change of 0.5 percent */
+    if ((g_atomic_int_get (&info->activity_mode) ||     /* emit on switch from activity mode */
+         ABS (progress - g_atomic_int_get (&info->progress)) > PROGRESS_SCALE / 200) &&    /* Emit on change of 0.5 percent */
         !g_cancellable_is_cancelled (info->cancellable))
     {
-        info->activity_mode = FALSE;
-        info->progress = current_percent;
-        info->progress_at_idle = TRUE;
-        queue_idle (info, FALSE);
-    }
+        g_atomic_int_set (&info->activity_mode, FALSE);
+        g_atomic_int_set (&info->progress, progress);
 
-    G_UNLOCK (progress_info);
+        queue_signals (info, PENDING_PROGRESS, FALSE);
+    }
 }
 
 void
 nautilus_progress_info_set_remaining_time (NautilusProgressInfo *info,
                                            gdouble               time)
 {
-    G_LOCK (progress_info);
-    info->remaining_time = time;
-    G_UNLOCK (progress_info);
+    g_atomic_int_set (&info->remaining_time, (gint) MIN (time, G_MAXINT));
 }
 
 gdouble
 nautilus_progress_info_get_remaining_time (NautilusProgressInfo *info)
 {
-    gint remaining_time;
-
-    G_LOCK (progress_info);
-    remaining_time = info->remaining_time;
-    G_UNLOCK (progress_info);
-
-    return remaining_time;
+    return g_atomic_int_get (&info->remaining_time);
 }
 
 void
 nautilus_progress_info_set_elapsed_time (NautilusProgressInfo *info,
                                          gdouble               time)
 {
-    G_LOCK (progress_info);
-    info->elapsed_time = time;
-    G_UNLOCK (progress_info);
+    g_atomic_int_set (&info->elapsed_time, (gint) MIN (time, G_MAXINT));
 }
 
 gdouble
 nautilus_progress_info_get_elapsed_time (NautilusProgressInfo *info)
 {
-    gint elapsed_time;
-
-    G_LOCK (progress_info);
-    elapsed_time = info->elapsed_time;
-    G_UNLOCK (progress_info);
-
-    return elapsed_time;
+    return g_atomic_int_get (&info->elapsed_time);
 }
 
 gdouble
@@ -727,9 +793,9 @@ nautilus_progress_info_get_total_elapsed_time (NautilusProgressInfo *info)
 {
     gdouble elapsed_time;
 
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
     elapsed_time = g_timer_elapsed (info->progress_timer, NULL);
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 
     return elapsed_time;
 }
@@ -738,10 +804,10 @@ void
 nautilus_progress_info_set_destination (NautilusProgressInfo *info,
                                         GFile                *file)
 {
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
     g_clear_object (&info->destination);
     info->destination = g_object_ref (file);
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 }
 
 GFile *
@@ -749,12 +815,12 @@ nautilus_progress_info_get_destination (NautilusProgressInfo *info)
 {
     GFile *destination = NULL;
 
-    G_LOCK (progress_info);
+    g_mutex_lock (&info->mutex);
     if (info->destination)
     {
         destination = g_object_ref (info->destination);
     }
-    G_UNLOCK (progress_info);
+    g_mutex_unlock (&info->mutex);
 
     return destination;
 }
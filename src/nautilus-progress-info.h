@@ -38,6 +38,11 @@ G_DECLARE_FINAL_TYPE (NautilusProgressInfo, nautilus_progress_info, NAUTILUS, PR
    All methods are threadsafe.
  */
 
+/* Formats the details of an info from its transfer counters. Called from the
+ * main loop, only when the details are actually displayed.
+ */
+typedef char * (* NautilusProgressInfoDetailsFunc) (NautilusProgressInfo *info);
+
 NautilusProgressInfo *nautilus_progress_info_new (void);
 
 GList *       nautilus_get_all_progress_info (void);
@@ -51,11 +56,14 @@ gboolean      nautilus_progress_info_get_is_started  (NautilusProgressInfo *info
 gboolean      nautilus_progress_info_get_is_finished (NautilusProgressInfo *info);
 gboolean      nautilus_progress_info_get_is_paused   (NautilusProgressInfo *info);
 gboolean      nautilus_progress_info_get_is_cancelled (NautilusProgressInfo *info);
+gboolean      nautilus_progress_info_get_is_queued   (NautilusProgressInfo *info);
 
 void          nautilus_progress_info_start           (NautilusProgressInfo *info);
 void          nautilus_progress_info_finish          (NautilusProgressInfo *info);
 void          nautilus_progress_info_pause           (NautilusProgressInfo *info);
 void          nautilus_progress_info_resume          (NautilusProgressInfo *info);
+void          nautilus_progress_info_set_queued      (NautilusProgressInfo *info,
+                                                      gboolean              queued);
 void          nautilus_progress_info_set_status      (NautilusProgressInfo *info,
 						      const char           *status);
 void          nautilus_progress_info_take_status     (NautilusProgressInfo *info,
@@ -64,6 +72,20 @@ void          nautilus_progress_info_set_details     (NautilusProgressInfo *info
 						      const char           *details);
 void          nautilus_progress_info_take_details    (NautilusProgressInfo *info,
 						      char                 *details);
+void          nautilus_progress_info_set_details_func (NautilusProgressInfo            *info,
+                                                       NautilusProgressInfoDetailsFunc  details_func);
+void          nautilus_progress_info_set_transfer    (NautilusProgressInfo *info,
+                                                      gint                  files_done,
+                                                      gint                  files_total,
+                                                      goffset               bytes_done,
+                                                      goffset               bytes_total,
+                                                      goffset               transfer_rate);
+void          nautilus_progress_info_get_transfer    (NautilusProgressInfo *info,
+                                                      gint                 *files_done,
+                                                      gint                 *files_total,
+                                                      goffset              *bytes_done,
+                                                      goffset              *bytes_total,
+                                                      goffset              *transfer_rate);
 void          nautilus_progress_info_set_progress    (NautilusProgressInfo *info,
 						      double                current,
 						      double                total);
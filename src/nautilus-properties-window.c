@@ -45,6 +45,7 @@
 #include "nautilus-global-preferences.h"
 #include "nautilus-icon-info.h"
 #include "nautilus-metadata.h"
+#include "nautilus-metadata-transaction.h"
 #include "nautilus-mime-actions.h"
 #include "nautilus-module.h"
 #include "nautilus-properties-model.h"
@@ -659,18 +660,23 @@ uri_is_local_image (const char *uri)
 static void
 reset_icon (NautilusPropertiesWindow *self)
 {
+    NautilusMetadataTransaction *transaction;
     GList *l;
 
+    transaction = nautilus_metadata_transaction_new ();
+
     for (l = self->original_files; l != NULL; l = l->next)
     {
         NautilusFile *file;
 
         file = NAUTILUS_FILE (l->data);
 
-        nautilus_file_set_metadata (file,
-                                    NAUTILUS_METADATA_KEY_CUSTOM_ICON,
-                                    NULL, NULL);
+        nautilus_metadata_transaction_set (transaction, file,
+                                           NAUTILUS_METADATA_KEY_CUSTOM_ICON,
+                                           NULL, NULL);
     }
+
+    nautilus_metadata_transaction_commit (transaction);
 }
 
 static void
@@ -4217,8 +4223,11 @@ set_icon (const char               *icon_uri,
     /* we don't allow remote URIs */
     if (icon_path != NULL)
     {
+        NautilusMetadataTransaction *transaction;
         GList *l;
 
+        transaction = nautilus_metadata_transaction_new ();
+
         for (l = self->original_files; l != NULL; l = l->next)
         {
             g_autofree gchar *file_uri = NULL;
@@ -4240,8 +4249,12 @@ set_icon (const char               *icon_uri,
                 real_icon_uri = g_strdup (icon_uri);
             }
 
-            nautilus_file_set_metadata (file, NAUTILUS_METADATA_KEY_CUSTOM_ICON, NULL, real_icon_uri);
+            nautilus_metadata_transaction_set (transaction, file,
+                                               NAUTILUS_METADATA_KEY_CUSTOM_ICON,
+                                               NULL, real_icon_uri);
         }
+
+        nautilus_metadata_transaction_commit (transaction);
     }
 }
 
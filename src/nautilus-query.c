@@ -361,11 +361,17 @@ prepare_string_for_compare (const gchar *string)
     return res;
 }
 
+gchar *
+nautilus_query_prepare_string (const gchar *string)
+{
+    return prepare_string_for_compare (string);
+}
+
 gdouble
-nautilus_query_matches_string (NautilusQuery *query,
-                               const gchar   *string)
+nautilus_query_matches_prepared_string (NautilusQuery *query,
+                                        const gchar   *prepared_string)
 {
-    gchar *prepared_string, *ptr;
+    const gchar *ptr;
     gboolean found;
     gdouble retval;
     gint idx, nonexact_malus;
@@ -378,12 +384,13 @@ nautilus_query_matches_string (NautilusQuery *query,
     g_mutex_lock (&query->prepared_words_mutex);
     if (!query->prepared_words)
     {
-        prepared_string = prepare_string_for_compare (query->text);
-        query->prepared_words = g_strsplit (prepared_string, " ", -1);
-        g_free (prepared_string);
+        gchar *prepared_text;
+
+        prepared_text = prepare_string_for_compare (query->text);
+        query->prepared_words = g_strsplit (prepared_text, " ", -1);
+        g_free (prepared_text);
     }
 
-    prepared_string = prepare_string_for_compare (string);
     found = TRUE;
     ptr = NULL;
     nonexact_malus = 0;
@@ -402,7 +409,6 @@ nautilus_query_matches_string (NautilusQuery *query,
 
     if (!found)
     {
-        g_free (prepared_string);
         return -1;
     }
 
@@ -412,6 +418,24 @@ nautilus_query_matches_string (NautilusQuery *query,
      * smaller amount.
      */
     retval = MAX (MIN_RANK, MAX_RANK - (gdouble) (ptr - prepared_string) - (gdouble) nonexact_malus / RANK_SCALE_FACTOR);
+
+    return retval;
+}
+
+gdouble
+nautilus_query_matches_string (NautilusQuery *query,
+                               const gchar   *string)
+{
+    gchar *prepared_string;
+    gdouble retval;
+
+    if (!query->text)
+    {
+        return -1;
+    }
+
+    prepared_string = prepare_string_for_compare (string);
+    retval = nautilus_query_matches_prepared_string (query, prepared_string);
     g_free (prepared_string);
 
     return retval;
@@ -673,6 +697,127 @@ nautilus_query_set_recursive (NautilusQuery          *query,
     }
 }
 
+/**
+ * nautilus_query_copy:
+ * @query: a #NautilusQuery
+ *
+ * Returns: (transfer full): a new query with the same criteria as @query, to
+ * remember what a search was started with even if @query changes afterwards.
+ */
+NautilusQuery *
+nautilus_query_copy (NautilusQuery *query)
+{
+    NautilusQuery *copy;
+
+    g_return_val_if_fail (NAUTILUS_IS_QUERY (query), NULL);
+
+    copy = nautilus_query_new ();
+    copy->text = g_strdup (query->text);
+    g_set_object (&copy->location, query->location);
+    g_clear_pointer (&copy->mime_types, g_ptr_array_unref);
+    copy->mime_types = g_ptr_array_ref (query->mime_types);
+    copy->show_hidden = query->show_hidden;
+    copy->date_range = query->date_range != NULL ? g_ptr_array_ref (query->date_range) : NULL;
+    copy->recursive = query->recursive;
+    copy->search_type = query->search_type;
+    copy->search_content = query->search_content;
+
+    return copy;
+}
+
+static gboolean
+str_array_equal (GPtrArray *a,
+                 GPtrArray *b)
+{
+    if (a->len != b->len)
+    {
+        return FALSE;
+    }
+
+    for (guint i = 0; i < a->len; i++)
+    {
+        if (g_strcmp0 (g_ptr_array_index (a, i), g_ptr_array_index (b, i)) != 0)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean
+date_range_equal (GPtrArray *a,
+                  GPtrArray *b)
+{
+    if (a == NULL || b == NULL)
+    {
+        return a == b;
+    }
+
+    return g_date_time_equal (g_ptr_array_index (a, 0), g_ptr_array_index (b, 0)) &&
+           g_date_time_equal (g_ptr_array_index (a, 1), g_ptr_array_index (b, 1));
+}
+
+/**
+ * nautilus_query_is_refinement_of:
+ * @query: a #NautilusQuery
+ * @previous: the query of a previous search
+ *
+ * Checks whether every file matching @query by name also matched @previous,
+ * which is the case when both search the same location with the same
+ * filters, and each word of the previous text is part of a word of the new
+ * one, like when typing "repo" and then "report".
+ *
+ * Returns: %TRUE if the name matches of @query are a subset of the ones of
+ *   @previous
+ */
+gboolean
+nautilus_query_is_refinement_of (NautilusQuery *query,
+                                 NautilusQuery *previous)
+{
+    g_auto (GStrv) words = NULL;
+    g_auto (GStrv) previous_words = NULL;
+    g_autofree gchar *prepared_text = NULL;
+    g_autofree gchar *prepared_previous_text = NULL;
+
+    g_return_val_if_fail (NAUTILUS_IS_QUERY (query), FALSE);
+    g_return_val_if_fail (NAUTILUS_IS_QUERY (previous), FALSE);
+
+    if (query->text == NULL || previous->text == NULL ||
+        !g_file_equal (query->location, previous->location) ||
+        query->show_hidden != previous->show_hidden ||
+        query->recursive != previous->recursive ||
+        query->search_type != previous->search_type ||
+        query->search_content != previous->search_content ||
+        !str_array_equal (query->mime_types, previous->mime_types) ||
+        !date_range_equal (query->date_range, previous->date_range))
+    {
+        return FALSE;
+    }
+
+    prepared_text = prepare_string_for_compare (query->text);
+    prepared_previous_text = prepare_string_for_compare (previous->text);
+    words = g_strsplit (prepared_text, " ", -1);
+    previous_words = g_strsplit (prepared_previous_text, " ", -1);
+
+    for (guint i = 0; previous_words[i] != NULL; i++)
+    {
+        gboolean contained = FALSE;
+
+        for (guint j = 0; words[j] != NULL && !contained; j++)
+        {
+            contained = strstr (words[j], previous_words[i]) != NULL;
+        }
+
+        if (!contained)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
 gboolean
 nautilus_query_is_empty (NautilusQuery *query)
 {
@@ -47,6 +47,7 @@ typedef enum {
 G_DECLARE_FINAL_TYPE (NautilusQuery, nautilus_query, NAUTILUS, QUERY, GObject)
 
 NautilusQuery* nautilus_query_new      (void);
+NautilusQuery* nautilus_query_copy     (NautilusQuery *query);
 
 char *         nautilus_query_get_text           (NautilusQuery *query);
 void           nautilus_query_set_text           (NautilusQuery *query, const char *text);
@@ -83,7 +84,12 @@ void           nautilus_query_set_searching      (NautilusQuery *query,
                                                   gboolean       searching);
 
 gdouble        nautilus_query_matches_string     (NautilusQuery *query, const gchar *string);
+gdouble        nautilus_query_matches_prepared_string (NautilusQuery *query,
+                                                       const gchar   *prepared_string);
+gchar *        nautilus_query_prepare_string     (const gchar   *string);
 
 char *         nautilus_query_to_readable_string (NautilusQuery *query);
 
 gboolean       nautilus_query_is_empty           (NautilusQuery *query);
+gboolean       nautilus_query_is_refinement_of   (NautilusQuery *query,
+                                                  NautilusQuery *previous);
@@ -204,6 +204,18 @@ search_directory_file_set_metadata_as_list (NautilusFile  *file,
                                            "directory", key, (const gchar **) value);
 }
 
+static void
+search_directory_file_set_metadata_from_info (NautilusFile *file,
+                                              GFileInfo    *info)
+{
+    NautilusSearchDirectoryFile *search_file;
+
+    search_file = NAUTILUS_SEARCH_DIRECTORY_FILE (file);
+    nautilus_keyfile_metadata_set_from_info (file,
+                                             search_file->metadata_filename,
+                                             "directory", info);
+}
+
 void
 nautilus_search_directory_file_update_display_name (NautilusSearchDirectoryFile *search_file)
 {
@@ -310,4 +322,5 @@ nautilus_search_directory_file_class_init (NautilusSearchDirectoryFileClass *kla
     file_class->get_where_string = search_directory_file_get_where_string;
     file_class->set_metadata = search_directory_file_set_metadata;
     file_class->set_metadata_as_list = search_directory_file_set_metadata_as_list;
+    file_class->set_metadata_from_info = search_directory_file_set_metadata_from_info;
 }
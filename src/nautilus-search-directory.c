@@ -33,7 +33,9 @@
 #include "nautilus-search-directory-file.h"
 #include "nautilus-search-engine-model.h"
 #include "nautilus-search-engine.h"
+#include "nautilus-search-hit.h"
 #include "nautilus-search-provider.h"
+#include "nautilus-ui-utilities.h"
 
 struct _NautilusSearchDirectory
 {
@@ -61,8 +63,19 @@ struct _NautilusSearchDirectory
     gboolean search_ready_and_valid;
 
     GList *files;
+    /* NautilusFile -> its link in files */
     GHashTable *files_hash;
 
+    /* Results of the previous search, along with the criteria it was started
+     * with, so they can be filtered right away if the new query only narrows
+     * down the previous one.
+     */
+    GList *previous_files;
+    NautilusQuery *previous_query;
+    /* Files added from the previous results which the running search hasn't
+     * reported yet. Whatever is left when it finishes no longer matches. */
+    GHashTable *unconfirmed_files;
+
     GList *monitor_list;
     GList *callback_list;
     GList *pending_callback_list;
@@ -151,10 +164,136 @@ reset_file_list (NautilusSearchDirectory *self)
         }
     }
 
-    nautilus_file_list_free (self->files);
-    self->files = NULL;
+    if (self->files != NULL)
+    {
+        nautilus_file_list_free (self->previous_files);
+        self->previous_files = g_steal_pointer (&self->files);
+    }
 
     g_hash_table_remove_all (self->files_hash);
+    g_hash_table_remove_all (self->unconfirmed_files);
+}
+
+static void
+clear_previous_results (NautilusSearchDirectory *self)
+{
+    g_clear_pointer (&self->previous_files, nautilus_file_list_free);
+    g_clear_object (&self->previous_query);
+}
+
+/* NautilusFile uses 0 for times it doesn't know. */
+static GDateTime *
+date_time_from_file_time (time_t time)
+{
+    if (time == 0)
+    {
+        return NULL;
+    }
+
+    return g_date_time_new_from_unix_local (time);
+}
+
+static GList *
+refine_previous_results (NautilusSearchDirectory *self)
+{
+    g_autolist (NautilusFile) previous_files = NULL;
+    g_autoptr (NautilusQuery) previous_query = NULL;
+    g_autoptr (GPtrArray) date_range = NULL;
+    NautilusQuerySearchType type;
+    GList *hits = NULL;
+
+    previous_files = g_steal_pointer (&self->previous_files);
+    previous_query = g_steal_pointer (&self->previous_query);
+    self->previous_query = nautilus_query_copy (self->query);
+
+    if (previous_files == NULL || previous_query == NULL ||
+        !nautilus_query_is_refinement_of (self->query, previous_query))
+    {
+        return NULL;
+    }
+
+    type = nautilus_query_get_search_type (self->query);
+    date_range = nautilus_query_get_date_range (self->query);
+
+    for (GList *l = previous_files; l != NULL; l = l->next)
+    {
+        NautilusFile *file = l->data;
+        NautilusSearchHit *hit;
+        g_autofree gchar *display_name = NULL;
+        g_autofree gchar *uri = NULL;
+        g_autoptr (GDateTime) mtime = NULL;
+        g_autoptr (GDateTime) atime = NULL;
+        g_autoptr (GDateTime) btime = NULL;
+        gdouble match;
+
+        if (nautilus_file_is_gone (file))
+        {
+            continue;
+        }
+
+        display_name = nautilus_file_get_display_name (file);
+        match = nautilus_query_matches_string (self->query, display_name);
+        if (match <= -1)
+        {
+            continue;
+        }
+
+        mtime = date_time_from_file_time (nautilus_file_get_mtime (file));
+        atime = date_time_from_file_time (nautilus_file_get_atime (file));
+        btime = date_time_from_file_time (nautilus_file_get_btime (file));
+
+        if (date_range != NULL)
+        {
+            GDateTime *target_date;
+
+            switch (type)
+            {
+                case NAUTILUS_QUERY_SEARCH_TYPE_LAST_ACCESS:
+                {
+                    target_date = atime;
+                }
+                break;
+
+                case NAUTILUS_QUERY_SEARCH_TYPE_LAST_MODIFIED:
+                {
+                    target_date = mtime;
+                }
+                break;
+
+                case NAUTILUS_QUERY_SEARCH_TYPE_CREATED:
+                {
+                    target_date = btime;
+                }
+                break;
+
+                default:
+                {
+                    target_date = NULL;
+                }
+            }
+
+            /* Without the time, it's up to the full search to tell whether
+             * the file still matches. */
+            if (target_date == NULL ||
+                !nautilus_date_time_is_between_dates (target_date,
+                                                      g_ptr_array_index (date_range, 0),
+                                                      g_ptr_array_index (date_range, 1)))
+            {
+                continue;
+            }
+        }
+
+        uri = nautilus_file_get_uri (file);
+
+        hit = nautilus_search_hit_new (uri);
+        nautilus_search_hit_set_fts_rank (hit, match);
+        nautilus_search_hit_set_modification_time (hit, mtime);
+        nautilus_search_hit_set_access_time (hit, atime);
+        nautilus_search_hit_set_creation_time (hit, btime);
+        hits = g_list_prepend (hits, hit);
+    }
+
+    return g_list_reverse (hits);
 }
 
 static void
@@ -182,6 +321,7 @@ static void
 start_search (NautilusSearchDirectory *self)
 {
     NautilusSearchEngineModel *model_provider;
+    g_autolist (NautilusSearchHit) refined_hits = NULL;
 
     if (!self->query)
     {
@@ -211,6 +351,26 @@ start_search (NautilusSearchDirectory *self)
 
     reset_file_list (self);
 
+    /* When the query only narrows down the previous one, show the previous
+     * results which still match immediately. The engine still does the full
+     * search, as the previous one may not have completed, and hits which were
+     * already added this way are skipped.
+     */
+    refined_hits = refine_previous_results (self);
+    if (refined_hits != NULL)
+    {
+        search_engine_hits_added (self->engine, refined_hits, self);
+
+        for (GList *l = refined_hits; l != NULL; l = l->next)
+        {
+            NautilusFile *file;
+
+            file = nautilus_file_get_by_uri (nautilus_search_hit_get_uri (l->data));
+            g_hash_table_add (self->unconfirmed_files, file);
+            nautilus_file_unref (file);
+        }
+    }
+
     nautilus_search_provider_start (NAUTILUS_SEARCH_PROVIDER (self->engine));
 }
 
@@ -627,6 +787,14 @@ search_engine_hits_added (NautilusSearchEngine    *engine,
         nautilus_file_set_search_relevance (file, nautilus_search_hit_get_relevance (hit));
         nautilus_file_set_search_fts_snippet (file, nautilus_search_hit_get_fts_snippet (hit));
 
+        if (g_hash_table_contains (self->files_hash, file))
+        {
+            /* Already added when refining the previous results. */
+            g_hash_table_remove (self->unconfirmed_files, file);
+            nautilus_file_unref (file);
+            continue;
+        }
+
         for (monitor_list = self->monitor_list; monitor_list; monitor_list = monitor_list->next)
         {
             monitor = monitor_list->data;
@@ -638,7 +806,7 @@ search_engine_hits_added (NautilusSearchEngine    *engine,
         g_signal_connect (file, "changed", G_CALLBACK (file_changed), self),
 
         file_list = g_list_prepend (file_list, file);
-        g_hash_table_add (self->files_hash, file);
+        g_hash_table_insert (self->files_hash, file, file_list);
     }
 
     self->files = g_list_concat (self->files, file_list);
@@ -666,6 +834,47 @@ search_engine_error (NautilusSearchEngine    *engine,
     g_error_free (error);
 }
 
+static void
+remove_unconfirmed_files (NautilusSearchDirectory *self)
+{
+    GHashTableIter iter;
+    NautilusFile *file;
+    GList *removed = NULL;
+
+    g_hash_table_iter_init (&iter, self->unconfirmed_files);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
+    {
+        GList *link;
+
+        link = g_hash_table_lookup (self->files_hash, file);
+        if (link == NULL)
+        {
+            continue;
+        }
+
+        self->files = g_list_delete_link (self->files, link);
+        g_hash_table_remove (self->files_hash, file);
+
+        g_signal_handlers_disconnect_by_func (file, file_changed, self);
+        for (GList *l = self->monitor_list; l != NULL; l = l->next)
+        {
+            nautilus_file_monitor_remove (file, l->data);
+        }
+
+        /* The list takes over the reference of self->files. */
+        removed = g_list_prepend (removed, file);
+    }
+    g_hash_table_remove_all (self->unconfirmed_files);
+
+    if (removed != NULL)
+    {
+        /* The files are no longer part of the directory, so the clients
+         * drop them when told they changed. */
+        nautilus_directory_emit_files_changed (NAUTILUS_DIRECTORY (self), removed);
+        nautilus_file_list_free (removed);
+    }
+}
+
 static void
 search_engine_finished (NautilusSearchEngine         *engine,
                         NautilusSearchProviderStatus  status,
@@ -681,6 +890,9 @@ search_engine_finished (NautilusSearchEngine         *engine,
      * happening. */
     if (status == NAUTILUS_SEARCH_PROVIDER_STATUS_NORMAL)
     {
+        /* The refined results the full search didn't find again don't
+         * match the new query, e.g. because of their contents. */
+        remove_unconfirmed_files (self);
         on_search_directory_search_ready_and_valid (self);
         nautilus_directory_emit_done_loading (NAUTILUS_DIRECTORY (self));
     }
@@ -710,6 +922,7 @@ search_force_reload (NautilusDirectory *directory)
     /* Remove file monitors */
     reset_file_list (self);
     stop_search (self);
+    clear_previous_results (self);
 
     file = nautilus_directory_get_corresponding_file (directory);
     nautilus_file_invalidate_all_attributes (file);
@@ -886,6 +1099,7 @@ search_dispose (GObject *object)
     }
 
     reset_file_list (self);
+    clear_previous_results (self);
 
     if (self->callback_list)
     {
@@ -906,6 +1120,7 @@ search_dispose (GObject *object)
 
     g_clear_object (&self->query);
     stop_search (self);
+    clear_previous_results (self);
     search_disconnect_engine (self);
 
     g_clear_object (&self->engine);
@@ -921,6 +1136,7 @@ search_finalize (GObject *object)
     self = NAUTILUS_SEARCH_DIRECTORY (object);
 
     g_hash_table_destroy (self->files_hash);
+    g_hash_table_destroy (self->unconfirmed_files);
 
     G_OBJECT_CLASS (nautilus_search_directory_parent_class)->finalize (object);
 }
@@ -930,6 +1146,7 @@ nautilus_search_directory_init (NautilusSearchDirectory *self)
 {
     self->query = NULL;
     self->files_hash = g_hash_table_new (g_direct_hash, g_direct_equal);
+    self->unconfirmed_files = g_hash_table_new (g_direct_hash, g_direct_equal);
 
     self->engine = nautilus_search_engine_new ();
     search_connect_engine (self);
@@ -38,6 +38,45 @@
     G_FILE_ATTRIBUTE_TIME_ACCESS "," \
     G_FILE_ATTRIBUTE_TIME_CREATED
 
+#define DIRECTORY_ATTRIBS G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+    G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP "," \
+    G_FILE_ATTRIBUTE_ACCESS_CAN_READ
+
+/* Directory infos looked up for matching items are reused by the following
+ * searches, which are usually the next keystrokes, for this long. */
+#define RECENT_INFO_MAX_AGE (30 * G_USEC_PER_SEC)
+
+typedef struct
+{
+    gchar *uri;
+    GFile *file;
+    gchar *prepared_display_name;
+    gchar *prepared_short_name;
+    gchar *mime_type;
+} RecentItem;
+
+typedef struct
+{
+    gboolean valid;
+    gint64 info_time;
+} RecentDirectory;
+
+/* Local recent items with their names prepared for matching. The index is
+ * built on the main thread and shared read-only with the search threads;
+ * it is dropped whenever the recent manager changes. */
+typedef struct
+{
+    gint ref_count;
+    GPtrArray *items;
+
+    /* Whether the parent directories of items are readable and not hidden,
+     * keyed by uri. */
+    GHashTable *directories;
+    GMutex mutex;
+} RecentIndex;
+
+static RecentIndex *recent_index = NULL;
+
 struct _NautilusSearchEngineRecent
 {
     GObject parent_instance;
@@ -46,6 +85,7 @@ struct _NautilusSearchEngineRecent
     gboolean running;
     GCancellable *cancellable;
     GtkRecentManager *recent_manager;
+    RecentIndex *index;
     guint add_hits_idle_id;
 };
 
@@ -65,6 +105,102 @@ enum
 };
 
 
+static void
+recent_item_free (RecentItem *item)
+{
+    g_free (item->uri);
+    g_object_unref (item->file);
+    g_free (item->prepared_display_name);
+    g_free (item->prepared_short_name);
+    g_free (item->mime_type);
+
+    g_free (item);
+}
+
+static RecentIndex *
+recent_index_new (GtkRecentManager *recent_manager)
+{
+    RecentIndex *index;
+    GList *recent_items;
+
+    index = g_new0 (RecentIndex, 1);
+    index->ref_count = 1;
+    index->items = g_ptr_array_new_with_free_func ((GDestroyNotify) recent_item_free);
+    index->directories = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    g_mutex_init (&index->mutex);
+
+    recent_items = gtk_recent_manager_get_items (recent_manager);
+    for (GList *l = recent_items; l != NULL; l = l->next)
+    {
+        GtkRecentInfo *info = l->data;
+        g_autofree gchar *short_name = NULL;
+        RecentItem *item;
+
+        /* Only local files are ever reported. */
+        if (!gtk_recent_info_is_local (info))
+        {
+            continue;
+        }
+
+        short_name = gtk_recent_info_get_short_name (info);
+
+        item = g_new0 (RecentItem, 1);
+        item->uri = g_strdup (gtk_recent_info_get_uri (info));
+        item->file = g_file_new_for_uri (item->uri);
+        item->prepared_display_name = nautilus_query_prepare_string (gtk_recent_info_get_display_name (info));
+        item->prepared_short_name = nautilus_query_prepare_string (short_name);
+        item->mime_type = g_strdup (gtk_recent_info_get_mime_type (info));
+
+        g_ptr_array_add (index->items, item);
+    }
+    g_list_free_full (recent_items, (GDestroyNotify) gtk_recent_info_unref);
+
+    DEBUG ("Recent engine indexed %u items", index->items->len);
+
+    return index;
+}
+
+static RecentIndex *
+recent_index_ref (RecentIndex *index)
+{
+    g_atomic_int_inc (&index->ref_count);
+
+    return index;
+}
+
+static void
+recent_index_unref (RecentIndex *index)
+{
+    if (!g_atomic_int_dec_and_test (&index->ref_count))
+    {
+        return;
+    }
+
+    g_ptr_array_unref (index->items);
+    g_hash_table_unref (index->directories);
+    g_mutex_clear (&index->mutex);
+
+    g_free (index);
+}
+
+static void
+on_recent_manager_changed (GtkRecentManager *recent_manager,
+                           gpointer          user_data)
+{
+    g_clear_pointer (&recent_index, recent_index_unref);
+}
+
+static RecentIndex *
+get_recent_index (GtkRecentManager *recent_manager)
+{
+    if (recent_index == NULL)
+    {
+        recent_index = recent_index_new (recent_manager);
+    }
+
+    return recent_index_ref (recent_index);
+}
+
 NautilusSearchEngineRecent *
 nautilus_search_engine_recent_new (void)
 {
@@ -81,6 +217,7 @@ nautilus_search_engine_recent_finalize (GObject *object)
 
     g_clear_object (&self->query);
     g_clear_object (&self->cancellable);
+    g_clear_pointer (&self->index, recent_index_unref);
 
     G_OBJECT_CLASS (nautilus_search_engine_recent_parent_class)->finalize (object);
 }
@@ -139,16 +276,32 @@ search_add_hits_idle (NautilusSearchEngineRecent *self,
 }
 
 static gboolean
-is_file_valid_recursive (NautilusSearchEngineRecent  *self,
-                         GFile                       *file,
-                         GDateTime                  **mtime,
-                         GDateTime                  **atime,
-                         GDateTime                  **ctime,
-                         GError                     **error)
+is_directory_valid_recursive (NautilusSearchEngineRecent  *self,
+                              GFile                       *directory,
+                              GError                     **error)
 {
+    RecentIndex *index = self->index;
     g_autoptr (GFileInfo) file_info = NULL;
+    g_autoptr (GFile) parent = NULL;
+    g_autofree gchar *uri = NULL;
+    RecentDirectory *cached;
+    gboolean valid;
+
+    uri = g_file_get_uri (directory);
+
+    /* Recent files tend to share their directories, so remember them. */
+    g_mutex_lock (&index->mutex);
+    cached = g_hash_table_lookup (index->directories, uri);
+    if (cached != NULL &&
+        g_get_monotonic_time () - cached->info_time < RECENT_INFO_MAX_AGE)
+    {
+        valid = cached->valid;
+        g_mutex_unlock (&index->mutex);
+        return valid;
+    }
+    g_mutex_unlock (&index->mutex);
 
-    file_info = g_file_query_info (file, FILE_ATTRIBS,
+    file_info = g_file_query_info (directory, DIRECTORY_ATTRIBS,
                                    G_FILE_QUERY_INFO_NONE,
                                    self->cancellable, error);
     if (*error != NULL)
@@ -156,37 +309,85 @@ is_file_valid_recursive (NautilusSearchEngineRecent  *self,
         return FALSE;
     }
 
-    if (!g_file_info_get_attribute_boolean (file_info,
-                                            G_FILE_ATTRIBUTE_ACCESS_CAN_READ))
+    valid = g_file_info_get_attribute_boolean (file_info,
+                                               G_FILE_ATTRIBUTE_ACCESS_CAN_READ) &&
+            !g_file_info_get_is_hidden (file_info) &&
+            !g_file_info_get_is_backup (file_info);
+
+    if (valid)
+    {
+        parent = g_file_get_parent (directory);
+        if (parent != NULL)
+        {
+            valid = is_directory_valid_recursive (self, parent, error);
+            if (*error != NULL)
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    g_mutex_lock (&index->mutex);
+    cached = g_new0 (RecentDirectory, 1);
+    cached->valid = valid;
+    cached->info_time = g_get_monotonic_time ();
+    g_hash_table_replace (index->directories, g_steal_pointer (&uri), cached);
+    g_mutex_unlock (&index->mutex);
+
+    return valid;
+}
+
+/* Checks whether @item can be reported. Its info is queried on each search,
+ * but only for items matching the query, so that deleted files are never
+ * reported.
+ */
+static gboolean
+is_item_valid (NautilusSearchEngineRecent  *self,
+               RecentItem                  *item,
+               GDateTime                  **mtime,
+               GDateTime                  **atime,
+               GDateTime                  **ctime,
+               GError                     **error)
+{
+    g_autoptr (GFileInfo) file_info = NULL;
+    gboolean readable;
+    gboolean hidden;
+
+    file_info = g_file_query_info (item->file, FILE_ATTRIBS,
+                                   G_FILE_QUERY_INFO_NONE,
+                                   self->cancellable, error);
+    if (*error != NULL)
     {
         return FALSE;
     }
 
-    if (mtime && atime && ctime)
+    readable = g_file_info_get_attribute_boolean (file_info,
+                                                  G_FILE_ATTRIBUTE_ACCESS_CAN_READ);
+    hidden = g_file_info_get_is_hidden (file_info) ||
+             g_file_info_get_is_backup (file_info);
+    *mtime = g_file_info_get_modification_date_time (file_info);
+    *atime = g_file_info_get_access_date_time (file_info);
+    *ctime = g_file_info_get_creation_date_time (file_info);
+
+    if (!readable)
     {
-        *mtime = g_file_info_get_modification_date_time (file_info);
-        *atime = g_file_info_get_access_date_time (file_info);
-        *ctime = g_file_info_get_creation_date_time (file_info);
+        return FALSE;
     }
 
     if (!nautilus_query_get_show_hidden_files (self->query))
     {
-        if (!g_file_info_get_is_hidden (file_info) &&
-            !g_file_info_get_is_backup (file_info))
-        {
-            g_autoptr (GFile) parent = g_file_get_parent (file);
+        g_autoptr (GFile) parent = NULL;
 
-            if (parent)
-            {
-                return is_file_valid_recursive (self, parent,
-                                                NULL, NULL, NULL,
-                                                error);
-            }
-        }
-        else
+        if (hidden)
         {
             return FALSE;
         }
+
+        parent = g_file_get_parent (item->file);
+        if (parent != NULL)
+        {
+            return is_directory_valid_recursive (self, parent, error);
+        }
     }
 
     return TRUE;
@@ -199,46 +400,33 @@ recent_thread_func (gpointer user_data)
     g_autoptr (GPtrArray) date_range = NULL;
     g_autoptr (GFile) query_location = NULL;
     g_autoptr (GPtrArray) mime_types = NULL;
-    GList *recent_items;
     GList *hits;
-    GList *l;
 
     g_return_val_if_fail (self->query, NULL);
+    g_return_val_if_fail (self->index, NULL);
 
     hits = NULL;
-    recent_items = gtk_recent_manager_get_items (self->recent_manager);
     mime_types = nautilus_query_get_mime_types (self->query);
     date_range = nautilus_query_get_date_range (self->query);
     query_location = nautilus_query_get_location (self->query);
 
-    for (l = recent_items; l != NULL; l = l->next)
+    for (guint i = 0; i < self->index->items->len; i++)
     {
-        GtkRecentInfo *info = l->data;
-        g_autoptr (GFile) file = NULL;
-        const gchar *uri;
-        const gchar *name;
+        RecentItem *item = g_ptr_array_index (self->index->items, i);
         gdouble rank;
 
-        uri = gtk_recent_info_get_uri (info);
-        file = g_file_new_for_uri (uri);
-
-        if (!g_file_has_prefix (file, query_location))
-        {
-            continue;
-        }
-
         if (g_cancellable_is_cancelled (self->cancellable))
         {
             break;
         }
 
-        name = gtk_recent_info_get_display_name (info);
-        rank = nautilus_query_matches_string (self->query, name);
+        rank = nautilus_query_matches_prepared_string (self->query,
+                                                       item->prepared_display_name);
 
         if (rank <= 0)
         {
-            g_autofree char *short_name = gtk_recent_info_get_short_name (info);
-            rank = nautilus_query_matches_string (self->query, short_name);
+            rank = nautilus_query_matches_prepared_string (self->query,
+                                                           item->prepared_short_name);
         }
 
         if (rank > 0)
@@ -249,12 +437,12 @@ recent_thread_func (gpointer user_data)
             g_autoptr (GDateTime) ctime = NULL;
             g_autoptr (GError) error = NULL;
 
-            if (!gtk_recent_info_is_local (info))
+            if (!g_file_has_prefix (item->file, query_location))
             {
                 continue;
             }
 
-            if (!is_file_valid_recursive (self, file, &mtime, &atime, &ctime, &error))
+            if (!is_item_valid (self, item, &mtime, &atime, &ctime, &error))
             {
                 if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
                 {
@@ -273,12 +461,12 @@ recent_thread_func (gpointer user_data)
 
             if (mime_types->len > 0)
             {
-                const gchar *mime_type = gtk_recent_info_get_mime_type (info);
+                const gchar *mime_type = item->mime_type;
                 gboolean found = FALSE;
 
-                for (gint i = 0; mime_type != NULL && i < mime_types->len; i++)
+                for (guint j = 0; mime_type != NULL && j < mime_types->len; j++)
                 {
-                    if (g_content_type_is_a (mime_type, g_ptr_array_index (mime_types, i)))
+                    if (g_content_type_is_a (mime_type, g_ptr_array_index (mime_types, j)))
                     {
                         found = TRUE;
                         break;
@@ -336,7 +524,7 @@ recent_thread_func (gpointer user_data)
                 }
             }
 
-            hit = nautilus_search_hit_new (uri);
+            hit = nautilus_search_hit_new (item->uri);
             nautilus_search_hit_set_fts_rank (hit, rank);
             nautilus_search_hit_set_modification_time (hit, mtime);
             nautilus_search_hit_set_access_time (hit, atime);
@@ -348,8 +536,6 @@ recent_thread_func (gpointer user_data)
 
     search_add_hits_idle (self, hits);
 
-    g_list_free_full (recent_items, (GDestroyNotify) gtk_recent_info_unref);
-
     return NULL;
 }
 
@@ -373,6 +559,11 @@ nautilus_search_engine_recent_start (NautilusSearchProvider *provider)
         return;
     }
 
+    /* The index is built here, as the recent manager belongs to the
+     * main thread. */
+    g_clear_pointer (&self->index, recent_index_unref);
+    self->index = get_recent_index (self->recent_manager);
+
     self->running = TRUE;
     self->cancellable = g_cancellable_new ();
     thread = g_thread_new ("nautilus-search-recent", recent_thread_func,
@@ -461,5 +652,14 @@ nautilus_search_engine_recent_class_init (NautilusSearchEngineRecentClass *klass
 static void
 nautilus_search_engine_recent_init (NautilusSearchEngineRecent *self)
 {
+    static gsize connected = 0;
+
     self->recent_manager = gtk_recent_manager_get_default ();
+
+    if (g_once_init_enter (&connected))
+    {
+        g_signal_connect (self->recent_manager, "changed",
+                          G_CALLBACK (on_recent_manager_changed), NULL);
+        g_once_init_leave (&connected, 1);
+    }
 }
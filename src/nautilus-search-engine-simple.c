@@ -22,8 +22,10 @@
 #include <config.h>
 #include "nautilus-search-engine-simple.h"
 
+#include "nautilus-global-preferences.h"
 #include "nautilus-search-engine-private.h"
 #include "nautilus-search-hit.h"
+#include "nautilus-search-index.h"
 #include "nautilus-search-provider.h"
 #include "nautilus-ui-utilities.h"
 #define DEBUG_FLAG NAUTILUS_DEBUG_SEARCH
@@ -58,6 +60,7 @@ typedef struct
     GList *hits;
 
     NautilusQuery *query;
+    gboolean use_index;
 
     gint processing_id;
     GMutex idle_mutex;
@@ -113,6 +116,15 @@ search_thread_data_new (NautilusSearchEngineSimple *engine,
     g_queue_push_tail (data->directories, location);
     data->mime_types = nautilus_query_get_mime_types (query);
 
+    /* The index has no content types, so it can't answer mime type filters. */
+    data->use_index = data->mime_types->len == 0 &&
+                      g_settings_get_boolean (nautilus_preferences,
+                                              NAUTILUS_PREFERENCES_SEARCH_INDEX);
+    if (data->use_index)
+    {
+        nautilus_search_index_request (location);
+    }
+
     data->cancellable = g_cancellable_new ();
 
     g_mutex_init (&data->idle_mutex);
@@ -452,6 +464,38 @@ next:
     g_object_unref (enumerator);
 }
 
+static void
+add_index_hit (NautilusSearchHit *hit,
+               gpointer           user_data)
+{
+    SearchThreadData *data = user_data;
+
+    data->hits = g_list_prepend (data->hits, hit);
+
+    data->n_processed_files++;
+    if (data->n_processed_files > BATCH_SIZE)
+    {
+        send_batch_in_idle (data);
+    }
+}
+
+static gboolean
+search_index (SearchThreadData *data)
+{
+    g_autoptr (NautilusSearchIndex) index = NULL;
+
+    index = nautilus_search_index_lookup (g_queue_peek_head (data->directories));
+    if (index == NULL)
+    {
+        return FALSE;
+    }
+
+    DEBUG ("Simple engine using the filename index (%u entries)",
+           nautilus_search_index_get_n_entries (index));
+
+    return nautilus_search_index_foreach_match (index, data->query, data->cancellable,
+                                                add_index_hit, data);
+}
 
 static gpointer
 search_thread_func (gpointer user_data)
@@ -463,6 +507,18 @@ search_thread_func (gpointer user_data)
 
     data = user_data;
 
+    if (data->use_index && search_index (data))
+    {
+        if (!g_cancellable_is_cancelled (data->cancellable))
+        {
+            send_batch_in_idle (data);
+        }
+
+        finish_search_thread (data);
+
+        return NULL;
+    }
+
     /* Insert id for toplevel directory into visited */
     dir = g_queue_peek_head (data->directories);
     info = g_file_query_info (dir, G_FILE_ATTRIBUTE_ID_FILE, 0, data->cancellable, NULL);
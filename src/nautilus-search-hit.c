@@ -168,6 +168,12 @@ nautilus_search_hit_get_fts_snippet (NautilusSearchHit *hit)
     return hit->fts_snippet;
 }
 
+GDateTime *
+nautilus_search_hit_get_modification_time (NautilusSearchHit *hit)
+{
+    return hit->modification_time;
+}
+
 static void
 nautilus_search_hit_set_uri (NautilusSearchHit *hit,
                              const char        *uri)
@@ -46,5 +46,6 @@ void                nautilus_search_hit_compute_scores        (NautilusSearchHit
 const char *        nautilus_search_hit_get_uri               (NautilusSearchHit *hit);
 gdouble             nautilus_search_hit_get_relevance         (NautilusSearchHit *hit);
 const gchar *       nautilus_search_hit_get_fts_snippet       (NautilusSearchHit *hit);
+GDateTime *         nautilus_search_hit_get_modification_time (NautilusSearchHit *hit);
 
 G_END_DECLS
@@ -0,0 +1,1342 @@
+/* nautilus-search-index.c
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "nautilus-search-index.h"
+
+#include "nautilus-monitor.h"
+#include "nautilus-search-engine-private.h"
+#include "nautilus-ui-utilities.h"
+#define DEBUG_FLAG NAUTILUS_DEBUG_SEARCH
+#include "nautilus-debug.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+/* On-disk layout, in native byte order:
+ *
+ *   IndexHeader
+ *   IndexEntry[n_entries]    breadth-first, so parents precede their children
+ *                            and the children of a directory are contiguous
+ *   gchar strings[]          NUL-terminated names, referenced by offset
+ *
+ * Entry 0 is the root itself and its name is the root's absolute path, so the
+ * path of any entry is the chain of names up to entry 0.
+ */
+#define INDEX_MAGIC "NAUTIDX"
+#define INDEX_VERSION 2
+
+#define NO_PARENT G_MAXUINT32
+#define UNKNOWN_TIME G_MININT64
+
+/* Delay before rebuilding after a change notification, so bursts of changes
+ * result in a single walk. The delay is not extended by later changes, so a
+ * steady stream of changes doesn't postpone the rebuild forever.
+ */
+#define REBUILD_DELAY_SECONDS 5
+/* Changes deep in the tree are only noticed by the monitors of the first
+ * directories, see update_monitors(), so indexes in use are also rebuilt
+ * every so often.
+ */
+#define REFRESH_INTERVAL_SECONDS (10 * 60)
+#define MAX_MONITORED_DIRECTORIES 64
+/* Index files of roots which are no longer searched are removed after this. */
+#define CACHE_MAX_AGE_SECONDS (7 * 24 * 60 * 60)
+/* Indexed roots which are not searched for a while are dropped, and so are
+ * the least recently searched ones beyond this number.
+ */
+#define MAX_INDEX_ROOTS 4
+#define ROOT_MAX_IDLE_SECONDS (15 * 60)
+
+typedef enum
+{
+    INDEX_ENTRY_DIRECTORY = 1 << 0,
+    INDEX_ENTRY_HIDDEN = 1 << 1,
+} IndexEntryFlags;
+
+typedef struct
+{
+    gchar magic[8];
+    guint32 version;
+    guint32 n_entries;
+    guint64 strings_size;
+    gint64 build_time;
+} IndexHeader;
+
+typedef struct
+{
+    guint32 parent;
+    guint32 name;
+    guint32 prepared_name;
+    guint32 flags;
+    guint32 first_child;
+    guint32 n_children;
+    guint64 size;
+    gint64 mtime;
+    gint64 atime;
+    gint64 ctime;
+    /* Directories are checked against this when loading the index. */
+    guint32 mtime_usec;
+    guint32 reserved;
+} IndexEntry;
+
+struct _NautilusSearchIndex
+{
+    gint ref_count;
+
+    GMappedFile *mapped;
+    const IndexHeader *header;
+    const IndexEntry *entries;
+    const gchar *strings;
+};
+
+typedef struct
+{
+    GFile *location;
+    gchar *cache_path;
+
+    NautilusSearchIndex *current;
+    gboolean stale;
+    /* Set while @current comes from a previous session and wasn't checked. */
+    gboolean unverified;
+    guint generation;
+
+    GCancellable *build_cancellable;
+    guint rebuild_timeout_id;
+    gint64 rebuild_time;
+    GList *monitors;
+
+    gint64 last_used;
+    /* Set when the root is dropped while a walk is running; the walk frees
+     * it when it finishes.
+     */
+    gboolean dropped;
+} IndexRoot;
+
+/* Roots are added and rebuilt from the main thread, but looked up from search
+ * threads, so the registry is protected by a lock.
+ */
+G_LOCK_DEFINE_STATIC (index_roots);
+static GList *index_roots = NULL;
+
+typedef struct
+{
+    GFile *location;
+    guint32 entry;
+} PendingDirectory;
+
+typedef struct
+{
+    IndexRoot *root;
+    /* An index from a previous session to check instead of walking. */
+    NautilusSearchIndex *previous;
+} BuildJob;
+
+#define INDEX_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+    G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+    G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP "," \
+    G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+    G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+    G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," \
+    G_FILE_ATTRIBUTE_TIME_ACCESS "," \
+    G_FILE_ATTRIBUTE_TIME_CREATED "," \
+    G_FILE_ATTRIBUTE_ID_FILE "," \
+    G_FILE_ATTRIBUTE_ID_FILESYSTEM
+
+#define VERIFY_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+static gboolean
+search_index_validate (NautilusSearchIndex *index)
+{
+    guint32 n_entries = index->header->n_entries;
+    guint64 strings_size = index->header->strings_size;
+
+    /* A terminated last string means every valid offset points to a
+     * terminated string.
+     */
+    if (index->strings[strings_size - 1] != '\0')
+    {
+        return FALSE;
+    }
+
+    for (guint32 i = 0; i < n_entries; i++)
+    {
+        const IndexEntry *entry = &index->entries[i];
+
+        if (entry->name >= strings_size ||
+            entry->prepared_name >= strings_size)
+        {
+            return FALSE;
+        }
+
+        /* Parents precede their children, and only the root has none. */
+        if ((i == 0) != (entry->parent == NO_PARENT) ||
+            (i != 0 && entry->parent >= i))
+        {
+            return FALSE;
+        }
+
+        if (entry->first_child > n_entries ||
+            entry->n_children > n_entries - entry->first_child)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static NautilusSearchIndex *
+search_index_new_from_mapped_file (GMappedFile *mapped)
+{
+    NautilusSearchIndex *index;
+    const IndexHeader *header;
+    gsize length;
+    gsize entries_size;
+
+    length = g_mapped_file_get_length (mapped);
+    if (length < sizeof (IndexHeader))
+    {
+        return NULL;
+    }
+
+    header = (const IndexHeader *) g_mapped_file_get_contents (mapped);
+    if (memcmp (header->magic, INDEX_MAGIC, sizeof (INDEX_MAGIC)) != 0 ||
+        header->version != INDEX_VERSION ||
+        header->n_entries == 0)
+    {
+        return NULL;
+    }
+
+    if (header->n_entries > (length - sizeof (IndexHeader)) / sizeof (IndexEntry))
+    {
+        return NULL;
+    }
+
+    entries_size = (gsize) header->n_entries * sizeof (IndexEntry);
+    if (header->strings_size == 0 ||
+        length - sizeof (IndexHeader) - entries_size != header->strings_size)
+    {
+        return NULL;
+    }
+
+    index = g_new0 (NautilusSearchIndex, 1);
+    index->ref_count = 1;
+    index->mapped = g_mapped_file_ref (mapped);
+    index->header = header;
+    index->entries = (const IndexEntry *) (header + 1);
+    index->strings = (const gchar *) (index->entries + header->n_entries);
+
+    /* The file may be truncated or corrupt, so everything that is used as an
+     * offset or index later on is checked once here.
+     */
+    if (!search_index_validate (index))
+    {
+        nautilus_search_index_unref (index);
+        return NULL;
+    }
+
+    return index;
+}
+
+/**
+ * nautilus_search_index_load:
+ * @cache_path: a file written by nautilus_search_index_build()
+ *
+ * Returns: (transfer full) (nullable): the index, or %NULL if the file is
+ *   missing, from another version, truncated or corrupt
+ */
+NautilusSearchIndex *
+nautilus_search_index_load (const gchar *cache_path)
+{
+    g_autoptr (GMappedFile) mapped = NULL;
+
+    mapped = g_mapped_file_new (cache_path, FALSE, NULL);
+    if (mapped == NULL)
+    {
+        return NULL;
+    }
+
+    return search_index_new_from_mapped_file (mapped);
+}
+
+NautilusSearchIndex *
+nautilus_search_index_ref (NautilusSearchIndex *index)
+{
+    g_return_val_if_fail (index != NULL, NULL);
+
+    g_atomic_int_inc (&index->ref_count);
+
+    return index;
+}
+
+void
+nautilus_search_index_unref (NautilusSearchIndex *index)
+{
+    g_return_if_fail (index != NULL);
+
+    if (g_atomic_int_dec_and_test (&index->ref_count))
+    {
+        g_mapped_file_unref (index->mapped);
+        g_free (index);
+    }
+}
+
+guint
+nautilus_search_index_get_n_entries (NautilusSearchIndex *index)
+{
+    return index->header->n_entries;
+}
+
+static PendingDirectory *
+pending_directory_new (GFile   *location,
+                       guint32  entry)
+{
+    PendingDirectory *pending;
+
+    pending = g_new (PendingDirectory, 1);
+    pending->location = g_object_ref (location);
+    pending->entry = entry;
+
+    return pending;
+}
+
+static void
+pending_directory_free (PendingDirectory *pending)
+{
+    g_object_unref (pending->location);
+    g_free (pending);
+}
+
+static guint32
+append_string (GString     *strings,
+               const gchar *string)
+{
+    guint32 offset;
+
+    offset = strings->len;
+    g_string_append_len (strings, string, strlen (string) + 1);
+
+    return offset;
+}
+
+static gint64
+get_info_time (GFileInfo   *info,
+               const gchar *attribute)
+{
+    if (!g_file_info_has_attribute (info, attribute))
+    {
+        return UNKNOWN_TIME;
+    }
+
+    return (gint64) g_file_info_get_attribute_uint64 (info, attribute);
+}
+
+static void
+fill_entry_from_info (IndexEntry *entry,
+                      GFileInfo  *info)
+{
+    entry->flags = 0;
+    if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+    {
+        entry->flags |= INDEX_ENTRY_DIRECTORY;
+    }
+    if (g_file_info_get_is_hidden (info) || g_file_info_get_is_backup (info))
+    {
+        entry->flags |= INDEX_ENTRY_HIDDEN;
+    }
+    entry->size = g_file_info_get_size (info);
+    entry->mtime = get_info_time (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+    entry->mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+    entry->atime = get_info_time (info, G_FILE_ATTRIBUTE_TIME_ACCESS);
+    entry->ctime = get_info_time (info, G_FILE_ATTRIBUTE_TIME_CREATED);
+}
+
+static gboolean
+write_index (const gchar  *cache_path,
+             GArray       *entries,
+             GString      *strings,
+             GCancellable *cancellable,
+             GError      **error)
+{
+    g_autoptr (GFile) cache_file = NULL;
+    g_autoptr (GFile) cache_dir = NULL;
+    g_autoptr (GFileOutputStream) stream = NULL;
+    g_autoptr (GError) local_error = NULL;
+    IndexHeader header = { 0 };
+
+    memcpy (header.magic, INDEX_MAGIC, sizeof (INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.n_entries = entries->len;
+    header.strings_size = strings->len;
+    header.build_time = g_get_real_time () / G_USEC_PER_SEC;
+
+    cache_file = g_file_new_for_path (cache_path);
+    cache_dir = g_file_get_parent (cache_file);
+    if (!g_file_make_directory_with_parents (cache_dir, cancellable, &local_error) &&
+        !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_EXISTS))
+    {
+        g_propagate_error (error, g_steal_pointer (&local_error));
+        return FALSE;
+    }
+
+    /* g_file_replace() writes to a temporary file, so readers which still map
+     * the previous version are not affected.
+     */
+    stream = g_file_replace (cache_file, NULL, FALSE,
+                             G_FILE_CREATE_PRIVATE | G_FILE_CREATE_REPLACE_DESTINATION,
+                             cancellable, error);
+    if (stream == NULL)
+    {
+        return FALSE;
+    }
+
+    if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream),
+                                    &header, sizeof (header),
+                                    NULL, cancellable, error) ||
+        !g_output_stream_write_all (G_OUTPUT_STREAM (stream),
+                                    entries->data, entries->len * sizeof (IndexEntry),
+                                    NULL, cancellable, error) ||
+        !g_output_stream_write_all (G_OUTPUT_STREAM (stream),
+                                    strings->str, strings->len,
+                                    NULL, cancellable, error))
+    {
+        return FALSE;
+    }
+
+    return g_output_stream_close (G_OUTPUT_STREAM (stream), cancellable, error);
+}
+
+/**
+ * nautilus_search_index_build:
+ * @root: a native directory
+ * @cache_path: where to store the index
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for a #GError
+ *
+ * Walks @root breadth-first, writes the resulting index to @cache_path and
+ * maps it. This is blocking and meant to be called from a worker thread.
+ *
+ * Returns: (transfer full) (nullable): the new index
+ */
+NautilusSearchIndex *
+nautilus_search_index_build (GFile         *root,
+                             const gchar   *cache_path,
+                             GCancellable  *cancellable,
+                             GError       **error)
+{
+    g_autoptr (GArray) entries = NULL;
+    g_autoptr (GHashTable) visited = NULL;
+    g_autoptr (GQueue) directories = NULL;
+    g_autoptr (GFileInfo) root_info = NULL;
+    g_autofree gchar *root_path = NULL;
+    const gchar *root_fs_id;
+    GString *strings;
+    IndexEntry root_entry = { 0 };
+    PendingDirectory *dir;
+    gboolean success;
+
+    g_return_val_if_fail (g_file_is_native (root), NULL);
+
+    root_info = g_file_query_info (root, INDEX_ATTRIBUTES,
+                                   G_FILE_QUERY_INFO_NONE,
+                                   cancellable, error);
+    if (root_info == NULL)
+    {
+        return NULL;
+    }
+
+    entries = g_array_new (FALSE, FALSE, sizeof (IndexEntry));
+    strings = g_string_new (NULL);
+    visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    directories = g_queue_new ();
+
+    root_path = g_file_get_path (root);
+    root_fs_id = g_file_info_get_attribute_string (root_info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+    fill_entry_from_info (&root_entry, root_info);
+    root_entry.parent = NO_PARENT;
+    root_entry.name = append_string (strings, root_path);
+    root_entry.prepared_name = root_entry.name;
+    g_array_append_val (entries, root_entry);
+
+    if (g_file_info_get_attribute_string (root_info, G_FILE_ATTRIBUTE_ID_FILE) != NULL)
+    {
+        g_hash_table_add (visited,
+                          g_strdup (g_file_info_get_attribute_string (root_info,
+                                                                      G_FILE_ATTRIBUTE_ID_FILE)));
+    }
+
+    g_queue_push_tail (directories, pending_directory_new (root, 0));
+
+    while (!g_cancellable_is_cancelled (cancellable) &&
+           (dir = g_queue_pop_head (directories)) != NULL)
+    {
+        g_autoptr (GFileEnumerator) enumerator = NULL;
+        GFileInfo *info;
+        guint32 dir_entry;
+        guint32 first_child;
+
+        dir_entry = dir->entry;
+        first_child = entries->len;
+
+        enumerator = g_file_enumerate_children (dir->location, INDEX_ATTRIBUTES,
+                                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                cancellable, NULL);
+
+        while (enumerator != NULL &&
+               (info = g_file_enumerator_next_file (enumerator, cancellable, NULL)) != NULL)
+        {
+            g_autofree gchar *prepared_name = NULL;
+            const gchar *display_name;
+            const gchar *id;
+            IndexEntry entry = { 0 };
+
+            display_name = g_file_info_get_display_name (info);
+            if (display_name == NULL)
+            {
+                g_object_unref (info);
+                continue;
+            }
+
+            prepared_name = nautilus_query_prepare_string (display_name);
+
+            fill_entry_from_info (&entry, info);
+            entry.parent = dir_entry;
+            entry.name = append_string (strings, g_file_info_get_name (info));
+            entry.prepared_name = append_string (strings, prepared_name);
+            g_array_append_val (entries, entry);
+
+            id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
+            /* Mount points are listed, but other file systems are not walked. */
+            if ((entry.flags & INDEX_ENTRY_DIRECTORY) &&
+                g_strcmp0 (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM),
+                           root_fs_id) == 0 &&
+                (id == NULL || g_hash_table_add (visited, g_strdup (id))))
+            {
+                g_autoptr (GFile) child = NULL;
+
+                child = g_file_get_child (dir->location, g_file_info_get_name (info));
+                g_queue_push_tail (directories,
+                                   pending_directory_new (child, entries->len - 1));
+            }
+
+            g_object_unref (info);
+        }
+
+        g_array_index (entries, IndexEntry, dir_entry).first_child = first_child;
+        g_array_index (entries, IndexEntry, dir_entry).n_children = entries->len - first_child;
+
+        pending_directory_free (dir);
+    }
+
+    g_queue_free_full (g_steal_pointer (&directories),
+                       (GDestroyNotify) pending_directory_free);
+
+    if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    {
+        g_string_free (strings, TRUE);
+        return NULL;
+    }
+
+    DEBUG ("Indexed %u entries below %s", entries->len, root_path);
+
+    success = write_index (cache_path, entries, strings, cancellable, error);
+    g_string_free (strings, TRUE);
+
+    if (!success)
+    {
+        return NULL;
+    }
+
+    return nautilus_search_index_load (cache_path);
+}
+
+static const gchar *
+entry_get_string (NautilusSearchIndex *index,
+                  guint32              offset)
+{
+    return index->strings + offset;
+}
+
+static gchar *
+entry_get_path (NautilusSearchIndex *index,
+                guint32              entry)
+{
+    g_autoptr (GPtrArray) names = NULL;
+    GString *path;
+
+    names = g_ptr_array_new ();
+    for (; entry != NO_PARENT; entry = index->entries[entry].parent)
+    {
+        g_ptr_array_add (names, (gpointer) entry_get_string (index, index->entries[entry].name));
+    }
+
+    path = g_string_new (g_ptr_array_index (names, names->len - 1));
+    for (gint i = names->len - 2; i >= 0; i--)
+    {
+        if (path->len == 0 || path->str[path->len - 1] != G_DIR_SEPARATOR)
+        {
+            g_string_append_c (path, G_DIR_SEPARATOR);
+        }
+        g_string_append (path, g_ptr_array_index (names, i));
+    }
+
+    return g_string_free (path, FALSE);
+}
+
+static guint32
+search_index_find_location (NautilusSearchIndex *index,
+                            GFile               *location)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autofree gchar *relative_path = NULL;
+    g_auto (GStrv) components = NULL;
+    guint32 entry;
+
+    root = g_file_new_for_path (entry_get_string (index, index->entries[0].name));
+    if (g_file_equal (root, location))
+    {
+        return 0;
+    }
+
+    relative_path = g_file_get_relative_path (root, location);
+    if (relative_path == NULL)
+    {
+        return NO_PARENT;
+    }
+
+    components = g_strsplit (relative_path, G_DIR_SEPARATOR_S, -1);
+    entry = 0;
+    for (guint i = 0; components[i] != NULL && entry != NO_PARENT; i++)
+    {
+        const IndexEntry *parent = &index->entries[entry];
+        guint32 child;
+
+        if (*components[i] == '\0')
+        {
+            continue;
+        }
+
+        entry = NO_PARENT;
+        for (child = parent->first_child; child < parent->first_child + parent->n_children; child++)
+        {
+            if (g_strcmp0 (entry_get_string (index, index->entries[child].name), components[i]) == 0)
+            {
+                entry = child;
+                break;
+            }
+        }
+    }
+
+    return entry;
+}
+
+static GDateTime *
+date_time_from_index (gint64 time)
+{
+    if (time == UNKNOWN_TIME)
+    {
+        return NULL;
+    }
+
+    return g_date_time_new_from_unix_local (time);
+}
+
+/**
+ * nautilus_search_index_verify:
+ * @index: a #NautilusSearchIndex
+ * @cancellable: (nullable): a #GCancellable
+ *
+ * Checks the modification time of every indexed directory, which is much
+ * cheaper than listing them and enough to notice added, removed and renamed
+ * entries. Used for indexes loaded from a previous session, whose changes
+ * were never seen. This is blocking and meant to be called from a worker
+ * thread.
+ *
+ * Returns: %TRUE if no directory changed since @index was built
+ */
+gboolean
+nautilus_search_index_verify (NautilusSearchIndex *index,
+                              GCancellable        *cancellable)
+{
+    for (guint32 i = 0; i < index->header->n_entries; i++)
+    {
+        g_autofree gchar *path = NULL;
+        g_autoptr (GFile) location = NULL;
+        g_autoptr (GFileInfo) info = NULL;
+
+        if (!(index->entries[i].flags & INDEX_ENTRY_DIRECTORY))
+        {
+            continue;
+        }
+
+        if (g_cancellable_is_cancelled (cancellable))
+        {
+            return FALSE;
+        }
+
+        path = entry_get_path (index, i);
+        location = g_file_new_for_path (path);
+        info = g_file_query_info (location, VERIFY_ATTRIBUTES,
+                                  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
+
+        if (info == NULL ||
+            get_info_time (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) != index->entries[i].mtime ||
+            g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC) != index->entries[i].mtime_usec)
+        {
+            DEBUG ("Search index outdated for %s", path);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * nautilus_search_index_foreach_match:
+ * @index: a #NautilusSearchIndex
+ * @query: the query to match against
+ * @cancellable: (nullable): a #GCancellable
+ * @func: called with a new hit for each match, which it takes ownership of
+ * @user_data: data for @func
+ *
+ * Applies the name, hidden file, date and recursion criteria of @query to the
+ * entries below the query location, the same way the simple engine's
+ * directory walk does. Nothing is checked on disk, see
+ * nautilus_search_index_lookup() for how indexes are kept up to date.
+ *
+ * Returns: %FALSE if the query location is not covered by @index
+ */
+gboolean
+nautilus_search_index_foreach_match (NautilusSearchIndex        *index,
+                                     NautilusQuery              *query,
+                                     GCancellable               *cancellable,
+                                     NautilusSearchIndexHitFunc  func,
+                                     gpointer                    user_data)
+{
+    g_autoptr (GFile) location = NULL;
+    g_autoptr (GPtrArray) date_range = NULL;
+    g_autofree guint8 *in_scope = NULL;
+    NautilusQuerySearchType type;
+    gboolean show_hidden;
+    gboolean recursive;
+    guint32 target;
+    guint32 end;
+
+    location = nautilus_query_get_location (query);
+    target = search_index_find_location (index, location);
+    if (target == NO_PARENT || !(index->entries[target].flags & INDEX_ENTRY_DIRECTORY))
+    {
+        return FALSE;
+    }
+
+    type = nautilus_query_get_search_type (query);
+    date_range = nautilus_query_get_date_range (query);
+    show_hidden = nautilus_query_get_show_hidden_files (query);
+    recursive = is_recursive_search (NAUTILUS_SEARCH_ENGINE_TYPE_NON_INDEXED,
+                                     nautilus_query_get_recursive (query),
+                                     location);
+
+    /* Thanks to the breadth-first layout, a single pass in order is enough to
+     * know which entries are below the target, without walking up the parents.
+     */
+    in_scope = g_new0 (guint8, index->header->n_entries);
+    in_scope[target] = TRUE;
+    end = recursive ? index->header->n_entries :
+          index->entries[target].first_child + index->entries[target].n_children;
+
+    for (guint32 i = index->entries[target].first_child; i < end; i++)
+    {
+        const IndexEntry *entry = &index->entries[i];
+        NautilusSearchHit *hit;
+        g_autofree gchar *path = NULL;
+        g_autofree gchar *uri = NULL;
+        g_autoptr (GDateTime) mtime = NULL;
+        g_autoptr (GDateTime) atime = NULL;
+        g_autoptr (GDateTime) ctime = NULL;
+        gdouble match;
+
+        if ((i & 0xfff) == 0 && g_cancellable_is_cancelled (cancellable))
+        {
+            break;
+        }
+
+        if (!in_scope[entry->parent])
+        {
+            continue;
+        }
+
+        if ((entry->flags & INDEX_ENTRY_HIDDEN) && !show_hidden)
+        {
+            continue;
+        }
+
+        /* Only directories with their contents in scope are recursed into. */
+        if (recursive && (entry->flags & INDEX_ENTRY_DIRECTORY))
+        {
+            in_scope[i] = TRUE;
+        }
+
+        match = nautilus_query_matches_prepared_string (query,
+                                                        entry_get_string (index, entry->prepared_name));
+        if (match <= -1)
+        {
+            continue;
+        }
+
+        mtime = date_time_from_index (entry->mtime);
+        atime = date_time_from_index (entry->atime);
+        ctime = date_time_from_index (entry->ctime);
+
+        if (date_range != NULL)
+        {
+            GDateTime *target_date;
+
+            switch (type)
+            {
+                case NAUTILUS_QUERY_SEARCH_TYPE_LAST_ACCESS:
+                {
+                    target_date = atime;
+                }
+                break;
+
+                case NAUTILUS_QUERY_SEARCH_TYPE_LAST_MODIFIED:
+                {
+                    target_date = mtime;
+                }
+                break;
+
+                case NAUTILUS_QUERY_SEARCH_TYPE_CREATED:
+                {
+                    target_date = ctime;
+                }
+                break;
+
+                default:
+                {
+                    target_date = NULL;
+                }
+            }
+
+            if (!nautilus_date_time_is_between_dates (target_date,
+                                                      g_ptr_array_index (date_range, 0),
+                                                      g_ptr_array_index (date_range, 1)))
+            {
+                continue;
+            }
+        }
+
+        path = entry_get_path (index, i);
+        uri = g_filename_to_uri (path, NULL, NULL);
+        if (uri == NULL)
+        {
+            continue;
+        }
+
+        hit = nautilus_search_hit_new (uri);
+        nautilus_search_hit_set_fts_rank (hit, match);
+        nautilus_search_hit_set_modification_time (hit, mtime);
+        nautilus_search_hit_set_access_time (hit, atime);
+        nautilus_search_hit_set_creation_time (hit, ctime);
+
+        func (hit, user_data);
+    }
+
+    return TRUE;
+}
+
+static gchar *
+get_cache_path_for_location (GFile *location)
+{
+    g_autofree gchar *uri = NULL;
+    g_autofree gchar *checksum = NULL;
+    g_autofree gchar *basename = NULL;
+
+    uri = g_file_get_uri (location);
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri, -1);
+    basename = g_strconcat (checksum, ".idx", NULL);
+
+    return g_build_filename (g_get_user_cache_dir (), "nautilus", "search-index",
+                             basename, NULL);
+}
+
+/* Must be called with the index_roots lock held. */
+static IndexRoot *
+find_root_for_location (GFile *location)
+{
+    for (GList *l = index_roots; l != NULL; l = l->next)
+    {
+        IndexRoot *root = l->data;
+
+        if (g_file_equal (root->location, location) ||
+            g_file_has_prefix (location, root->location))
+        {
+            return root;
+        }
+    }
+
+    return NULL;
+}
+
+static void schedule_rebuild (IndexRoot *root,
+                              guint      delay);
+
+static void
+index_root_free (IndexRoot *root)
+{
+    /* Only dropped roots are freed, and their index won't be loaded again
+     * soon, so don't leave it taking up space.
+     */
+    if (g_unlink (root->cache_path) != 0 && errno != ENOENT)
+    {
+        DEBUG ("Failed to remove search index %s: %s", root->cache_path, g_strerror (errno));
+    }
+
+    g_object_unref (root->location);
+    g_free (root->cache_path);
+    g_clear_pointer (&root->current, nautilus_search_index_unref);
+    g_clear_object (&root->build_cancellable);
+    g_free (root);
+}
+
+static void
+index_root_cancel_monitors (IndexRoot *root)
+{
+    g_list_free_full (g_steal_pointer (&root->monitors),
+                      (GDestroyNotify) nautilus_monitor_cancel);
+}
+
+/* The monitors feed the file changes queue, which invalidates the index. Only
+ * the root and the first directories below it are monitored, as there may be
+ * far too many directories to watch them all; the periodic refresh covers the
+ * rest. Must be called from the main thread, with the index_roots lock held.
+ */
+static void
+update_monitors (IndexRoot *root)
+{
+    NautilusSearchIndex *index = root->current;
+    guint n_monitors = 0;
+
+    index_root_cancel_monitors (root);
+
+    root->monitors = g_list_prepend (NULL, nautilus_monitor_directory (root->location));
+    if (index == NULL)
+    {
+        return;
+    }
+
+    /* Thanks to the breadth-first layout, these are the shallowest ones. */
+    for (guint32 i = 1; i < index->header->n_entries && n_monitors < MAX_MONITORED_DIRECTORIES; i++)
+    {
+        g_autofree gchar *path = NULL;
+        g_autoptr (GFile) location = NULL;
+
+        if (!(index->entries[i].flags & INDEX_ENTRY_DIRECTORY))
+        {
+            continue;
+        }
+
+        path = entry_get_path (index, i);
+        location = g_file_new_for_path (path);
+        root->monitors = g_list_prepend (root->monitors, nautilus_monitor_directory (location));
+        n_monitors++;
+    }
+}
+
+/* Must be called from the main thread, with the index_roots lock held. */
+static void
+index_root_drop (IndexRoot *root)
+{
+    g_autofree gchar *uri = g_file_get_uri (root->location);
+
+    DEBUG ("Dropping search index for %s", uri);
+
+    index_roots = g_list_remove (index_roots, root);
+    g_clear_handle_id (&root->rebuild_timeout_id, g_source_remove);
+    index_root_cancel_monitors (root);
+    g_clear_pointer (&root->current, nautilus_search_index_unref);
+
+    if (root->build_cancellable != NULL)
+    {
+        /* The walk uses the root; on_build_finished() frees it. */
+        g_cancellable_cancel (root->build_cancellable);
+        root->dropped = TRUE;
+        return;
+    }
+
+    index_root_free (root);
+}
+
+/* Must be called from the main thread, with the index_roots lock held. */
+static void
+drop_unused_roots (void)
+{
+    gint64 now = g_get_monotonic_time ();
+    IndexRoot *least_recent = NULL;
+    GList *l = index_roots;
+
+    while (l != NULL)
+    {
+        IndexRoot *root = l->data;
+
+        l = l->next;
+        if (now - root->last_used > ROOT_MAX_IDLE_SECONDS * G_USEC_PER_SEC)
+        {
+            index_root_drop (root);
+        }
+        else if (least_recent == NULL || root->last_used < least_recent->last_used)
+        {
+            least_recent = root;
+        }
+    }
+
+    if (least_recent != NULL && g_list_length (index_roots) >= MAX_INDEX_ROOTS)
+    {
+        index_root_drop (least_recent);
+    }
+}
+
+/* Index files are kept across sessions, but the roots of a previous session
+ * are only dropped, and their file removed, if they are searched again. So
+ * remove the files which weren't rebuilt for a long time.
+ */
+static void
+evict_cache_thread_func (GTask        *task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+    g_autofree gchar *cache_dir = NULL;
+    g_autoptr (GDir) dir = NULL;
+    const gchar *name;
+    gint64 now;
+
+    cache_dir = g_build_filename (g_get_user_cache_dir (), "nautilus", "search-index", NULL);
+    dir = g_dir_open (cache_dir, 0, NULL);
+    if (dir == NULL)
+    {
+        return;
+    }
+
+    now = g_get_real_time () / G_USEC_PER_SEC;
+    while ((name = g_dir_read_name (dir)) != NULL)
+    {
+        g_autofree gchar *path = NULL;
+        GStatBuf buf;
+
+        if (!g_str_has_suffix (name, ".idx"))
+        {
+            continue;
+        }
+
+        path = g_build_filename (cache_dir, name, NULL);
+        if (g_stat (path, &buf) == 0 && now - buf.st_mtime > CACHE_MAX_AGE_SECONDS)
+        {
+            DEBUG ("Removing unused search index %s", path);
+            g_unlink (path);
+        }
+    }
+}
+
+static void
+build_job_free (BuildJob *job)
+{
+    g_clear_pointer (&job->previous, nautilus_search_index_unref);
+    g_free (job);
+}
+
+static void
+build_thread_func (GTask        *task,
+                   gpointer      source_object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+    BuildJob *job = task_data;
+    IndexRoot *root = job->root;
+    NautilusSearchIndex *index;
+    GError *error = NULL;
+
+    if (job->previous != NULL && nautilus_search_index_verify (job->previous, cancellable))
+    {
+        g_task_return_pointer (task, nautilus_search_index_ref (job->previous),
+                               (GDestroyNotify) nautilus_search_index_unref);
+        return;
+    }
+
+    /* A dropped root is only freed once the walk finishes, and
+     * location/cache_path never change.
+     */
+    index = nautilus_search_index_build (root->location, root->cache_path,
+                                         cancellable, &error);
+    if (index == NULL)
+    {
+        g_task_return_error (task, error);
+        return;
+    }
+
+    g_task_return_pointer (task, index, (GDestroyNotify) nautilus_search_index_unref);
+}
+
+static void
+on_build_finished (GObject      *source_object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+    BuildJob *job = g_task_get_task_data (G_TASK (result));
+    IndexRoot *root = job->root;
+    guint generation = GPOINTER_TO_UINT (user_data);
+    g_autoptr (GError) error = NULL;
+    NautilusSearchIndex *index;
+
+    index = g_task_propagate_pointer (G_TASK (result), &error);
+
+    G_LOCK (index_roots);
+
+    if (root->dropped)
+    {
+        G_UNLOCK (index_roots);
+        g_clear_pointer (&index, nautilus_search_index_unref);
+        index_root_free (root);
+        return;
+    }
+
+    g_clear_object (&root->build_cancellable);
+
+    if (index != NULL)
+    {
+        g_clear_pointer (&root->current, nautilus_search_index_unref);
+        root->current = index;
+        root->unverified = FALSE;
+        /* Changes that arrived while walking may have been missed. */
+        root->stale = (generation != root->generation);
+        update_monitors (root);
+    }
+    else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+        g_autofree gchar *uri = g_file_get_uri (root->location);
+
+        DEBUG ("Failed to build search index for %s: %s", uri, error->message);
+    }
+
+    schedule_rebuild (root, root->stale ? REBUILD_DELAY_SECONDS : REFRESH_INTERVAL_SECONDS);
+
+    G_UNLOCK (index_roots);
+}
+
+static gboolean
+on_rebuild_timeout (gpointer user_data)
+{
+    IndexRoot *root = user_data;
+    g_autoptr (GTask) task = NULL;
+    BuildJob *job;
+
+    G_LOCK (index_roots);
+
+    root->rebuild_timeout_id = 0;
+    if (g_get_monotonic_time () - root->last_used > ROOT_MAX_IDLE_SECONDS * G_USEC_PER_SEC)
+    {
+        /* Nobody searched here for a while; don't keep walking it. */
+        index_root_drop (root);
+        G_UNLOCK (index_roots);
+        return G_SOURCE_REMOVE;
+    }
+
+    if (root->build_cancellable != NULL)
+    {
+        /* A walk is already running; on_build_finished() will reschedule. */
+        G_UNLOCK (index_roots);
+        return G_SOURCE_REMOVE;
+    }
+
+    job = g_new0 (BuildJob, 1);
+    job->root = root;
+    /* Checking the index of a previous session is only worth it if nothing
+     * is known to have changed since it was loaded.
+     */
+    if (root->unverified && root->generation == 0)
+    {
+        job->previous = nautilus_search_index_ref (root->current);
+    }
+
+    root->build_cancellable = g_cancellable_new ();
+    task = g_task_new (NULL, root->build_cancellable, on_build_finished,
+                       GUINT_TO_POINTER (root->generation));
+    g_task_set_task_data (task, job, (GDestroyNotify) build_job_free);
+    g_task_set_priority (task, G_PRIORITY_LOW);
+
+    G_UNLOCK (index_roots);
+
+    g_task_run_in_thread (task, build_thread_func);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Must be called with the index_roots lock held. A pending rebuild is only
+ * moved earlier, never later, so that changes can't keep pushing it back.
+ */
+static void
+schedule_rebuild (IndexRoot *root,
+                  guint      delay)
+{
+    gint64 rebuild_time;
+
+    rebuild_time = g_get_monotonic_time () + delay * G_USEC_PER_SEC;
+    if (root->rebuild_timeout_id != 0)
+    {
+        if (root->rebuild_time <= rebuild_time)
+        {
+            return;
+        }
+
+        g_source_remove (root->rebuild_timeout_id);
+    }
+
+    root->rebuild_time = rebuild_time;
+    root->rebuild_timeout_id = g_timeout_add_seconds (delay, on_rebuild_timeout, root);
+}
+
+/**
+ * nautilus_search_index_request:
+ * @location: the location being searched
+ *
+ * Makes sure an index covering @location exists or is being built. Only
+ * native locations are indexed, and only a few of them are kept at a time.
+ * Must be called from the main thread.
+ */
+void
+nautilus_search_index_request (GFile *location)
+{
+    static gboolean evicted = FALSE;
+    IndexRoot *root;
+
+    g_return_if_fail (G_IS_FILE (location));
+
+    if (!g_file_is_native (location))
+    {
+        return;
+    }
+
+    if (!evicted)
+    {
+        g_autoptr (GTask) task = NULL;
+
+        evicted = TRUE;
+        task = g_task_new (NULL, NULL, NULL, NULL);
+        g_task_set_priority (task, G_PRIORITY_LOW);
+        g_task_run_in_thread (task, evict_cache_thread_func);
+    }
+
+    G_LOCK (index_roots);
+
+    root = find_root_for_location (location);
+    if (root != NULL)
+    {
+        root->last_used = g_get_monotonic_time ();
+        G_UNLOCK (index_roots);
+        return;
+    }
+
+    drop_unused_roots ();
+
+    root = g_new0 (IndexRoot, 1);
+    root->last_used = g_get_monotonic_time ();
+    root->location = g_object_ref (location);
+    root->cache_path = get_cache_path_for_location (location);
+    root->current = nautilus_search_index_load (root->cache_path);
+    /* Changes made while Nautilus wasn't running were never seen. */
+    root->unverified = (root->current != NULL);
+    root->stale = root->unverified;
+    index_roots = g_list_prepend (index_roots, root);
+    update_monitors (root);
+
+    schedule_rebuild (root, 0);
+
+    G_UNLOCK (index_roots);
+}
+
+/**
+ * nautilus_search_index_lookup:
+ * @location: the location being searched
+ *
+ * An index is up to date when no change below its root was reported since
+ * it was built. Changes come from the file changes queue, which is also fed
+ * by the monitors of the root and of its first directories, and indexes in
+ * use are rebuilt every REFRESH_INTERVAL_SECONDS to catch the rest. Can be
+ * called from any thread.
+ *
+ * Returns: (transfer full) (nullable): an up to date index covering
+ *   @location, or %NULL if there is none yet
+ */
+NautilusSearchIndex *
+nautilus_search_index_lookup (GFile *location)
+{
+    NautilusSearchIndex *index = NULL;
+    IndexRoot *root;
+
+    G_LOCK (index_roots);
+
+    root = find_root_for_location (location);
+    if (root != NULL)
+    {
+        root->last_used = g_get_monotonic_time ();
+    }
+
+    if (root != NULL && root->current != NULL && !root->stale)
+    {
+        index = nautilus_search_index_ref (root->current);
+    }
+
+    G_UNLOCK (index_roots);
+
+    return index;
+}
+
+/**
+ * nautilus_search_index_invalidate:
+ * @location: a file which was added, removed, moved or changed
+ *
+ * Marks the indexes covering @location as outdated, so searches fall back to
+ * walking the tree until they are rebuilt. Called for every change consumed
+ * from the file changes queue.
+ */
+void
+nautilus_search_index_invalidate (GFile *location)
+{
+    G_LOCK (index_roots);
+
+    for (GList *l = index_roots; l != NULL; l = l->next)
+    {
+        IndexRoot *root = l->data;
+
+        if (g_file_equal (root->location, location) ||
+            g_file_has_prefix (location, root->location))
+        {
+            root->stale = TRUE;
+            root->generation++;
+            schedule_rebuild (root, REBUILD_DELAY_SECONDS);
+        }
+    }
+
+    G_UNLOCK (index_roots);
+}
@@ -0,0 +1,61 @@
+/* nautilus-search-index.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "nautilus-query.h"
+#include "nautilus-search-hit.h"
+
+G_BEGIN_DECLS
+
+/* A memory-mapped snapshot of the display names below a search root, used by
+ * the simple search engine as a fast path when Tracker can't help.
+ */
+typedef struct _NautilusSearchIndex NautilusSearchIndex;
+
+typedef void (*NautilusSearchIndexHitFunc) (NautilusSearchHit *hit,
+                                            gpointer           user_data);
+
+NautilusSearchIndex *nautilus_search_index_build         (GFile                      *root,
+                                                          const gchar                *cache_path,
+                                                          GCancellable               *cancellable,
+                                                          GError                    **error);
+NautilusSearchIndex *nautilus_search_index_load          (const gchar                *cache_path);
+NautilusSearchIndex *nautilus_search_index_ref           (NautilusSearchIndex        *index);
+void                 nautilus_search_index_unref         (NautilusSearchIndex        *index);
+
+guint                nautilus_search_index_get_n_entries (NautilusSearchIndex        *index);
+gboolean             nautilus_search_index_verify        (NautilusSearchIndex        *index,
+                                                          GCancellable               *cancellable);
+gboolean             nautilus_search_index_foreach_match (NautilusSearchIndex        *index,
+                                                          NautilusQuery              *query,
+                                                          GCancellable               *cancellable,
+                                                          NautilusSearchIndexHitFunc  func,
+                                                          gpointer                    user_data);
+
+/* Process-wide registry of indexed roots. */
+void                 nautilus_search_index_request       (GFile                      *location);
+NautilusSearchIndex *nautilus_search_index_lookup        (GFile                      *location);
+void                 nautilus_search_index_invalidate    (GFile                      *location);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (NautilusSearchIndex, nautilus_search_index_unref)
+
+G_END_DECLS
@@ -0,0 +1,235 @@
+/* nautilus-selection-snapshot.c
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "nautilus-selection-snapshot.h"
+
+/* What a single file contributed to the totals when it was last looked at.
+ * Files change while selected, so the contribution is remembered in order to
+ * subtract exactly what was added. */
+typedef struct
+{
+    gboolean is_directory;
+    gboolean item_count_known;
+    guint item_count;
+    gboolean size_known;
+    goffset size;
+} SnapshotEntry;
+
+struct _NautilusSelectionSnapshot
+{
+    GHashTable *entries;
+
+    guint folder_count;
+    guint folder_item_count;
+    guint n_unknown_item_counts;
+
+    guint non_folder_count;
+    goffset non_folder_size;
+    guint n_known_sizes;
+
+    NautilusFile *first_file;
+};
+
+static void
+snapshot_entry_init (SnapshotEntry *entry,
+                     NautilusFile  *file)
+{
+    entry->is_directory = nautilus_file_is_directory (file);
+    entry->item_count_known = FALSE;
+    entry->item_count = 0;
+    entry->size_known = FALSE;
+    entry->size = 0;
+
+    if (entry->is_directory)
+    {
+        entry->item_count_known = nautilus_file_get_directory_item_count (file,
+                                                                          &entry->item_count,
+                                                                          NULL);
+    }
+    else if (!nautilus_file_can_get_size (file))
+    {
+        entry->size_known = TRUE;
+        entry->size = nautilus_file_get_size (file);
+    }
+}
+
+static void
+snapshot_account (NautilusSelectionSnapshot *self,
+                  const SnapshotEntry       *entry,
+                  gint                       sign)
+{
+    if (entry->is_directory)
+    {
+        self->folder_count += sign;
+        if (entry->item_count_known)
+        {
+            self->folder_item_count += sign * (gint) entry->item_count;
+        }
+        else
+        {
+            self->n_unknown_item_counts += sign;
+        }
+    }
+    else
+    {
+        self->non_folder_count += sign;
+        if (entry->size_known)
+        {
+            self->non_folder_size += sign * entry->size;
+            self->n_known_sizes += sign;
+        }
+    }
+}
+
+NautilusSelectionSnapshot *
+nautilus_selection_snapshot_new (void)
+{
+    NautilusSelectionSnapshot *self;
+
+    self = g_new0 (NautilusSelectionSnapshot, 1);
+    self->entries = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+    return self;
+}
+
+void
+nautilus_selection_snapshot_free (NautilusSelectionSnapshot *self)
+{
+    g_hash_table_destroy (self->entries);
+    g_clear_object (&self->first_file);
+    g_free (self);
+}
+
+void
+nautilus_selection_snapshot_add (NautilusSelectionSnapshot *self,
+                                 gpointer                   key,
+                                 NautilusFile              *file)
+{
+    SnapshotEntry *entry;
+
+    if (g_hash_table_contains (self->entries, key))
+    {
+        nautilus_selection_snapshot_update (self, key, file);
+        return;
+    }
+
+    entry = g_new (SnapshotEntry, 1);
+    snapshot_entry_init (entry, file);
+    snapshot_account (self, entry, 1);
+    g_hash_table_insert (self->entries, key, entry);
+}
+
+void
+nautilus_selection_snapshot_remove (NautilusSelectionSnapshot *self,
+                                    gpointer                   key)
+{
+    SnapshotEntry *entry;
+
+    entry = g_hash_table_lookup (self->entries, key);
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    snapshot_account (self, entry, -1);
+    g_hash_table_remove (self->entries, key);
+}
+
+/* Re-reads the contribution of @file, if @key is part of the selection. */
+void
+nautilus_selection_snapshot_update (NautilusSelectionSnapshot *self,
+                                    gpointer                   key,
+                                    NautilusFile              *file)
+{
+    SnapshotEntry *entry;
+
+    entry = g_hash_table_lookup (self->entries, key);
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    snapshot_account (self, entry, -1);
+    snapshot_entry_init (entry, file);
+    snapshot_account (self, entry, 1);
+}
+
+void
+nautilus_selection_snapshot_clear (NautilusSelectionSnapshot *self)
+{
+    g_hash_table_remove_all (self->entries);
+    g_clear_object (&self->first_file);
+
+    self->folder_count = 0;
+    self->folder_item_count = 0;
+    self->n_unknown_item_counts = 0;
+    self->non_folder_count = 0;
+    self->non_folder_size = 0;
+    self->n_known_sizes = 0;
+}
+
+void
+nautilus_selection_snapshot_set_first_file (NautilusSelectionSnapshot *self,
+                                            NautilusFile              *file)
+{
+    g_set_object (&self->first_file, file);
+}
+
+guint
+nautilus_selection_snapshot_get_n_items (const NautilusSelectionSnapshot *self)
+{
+    return g_hash_table_size (self->entries);
+}
+
+guint
+nautilus_selection_snapshot_get_folder_count (const NautilusSelectionSnapshot *self)
+{
+    return self->folder_count;
+}
+
+/* Returns whether the item count of every selected folder is known. */
+gboolean
+nautilus_selection_snapshot_get_folder_item_count (const NautilusSelectionSnapshot *self,
+                                                   guint                           *item_count)
+{
+    *item_count = self->folder_item_count;
+
+    return self->n_unknown_item_counts == 0;
+}
+
+guint
+nautilus_selection_snapshot_get_non_folder_count (const NautilusSelectionSnapshot *self)
+{
+    return self->non_folder_count;
+}
+
+/* Returns whether the size of at least one selected file is known. */
+gboolean
+nautilus_selection_snapshot_get_non_folder_size (const NautilusSelectionSnapshot *self,
+                                                 goffset                         *size)
+{
+    *size = self->non_folder_size;
+
+    return self->n_known_sizes > 0;
+}
+
+NautilusFile *
+nautilus_selection_snapshot_get_first_file (const NautilusSelectionSnapshot *self)
+{
+    return self->first_file;
+}
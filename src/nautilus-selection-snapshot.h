@@ -0,0 +1,59 @@
+/* nautilus-selection-snapshot.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "nautilus-file.h"
+
+G_BEGIN_DECLS
+
+/* Running totals over a set of selected files. The owner adds and removes
+ * files as the selection changes, so reading the totals never needs to walk
+ * the whole selection. Each file is registered under a key of the owner's
+ * choosing, e.g. the view item holding it. */
+typedef struct _NautilusSelectionSnapshot NautilusSelectionSnapshot;
+
+NautilusSelectionSnapshot * nautilus_selection_snapshot_new                   (void);
+void                        nautilus_selection_snapshot_free                  (NautilusSelectionSnapshot       *self);
+
+void                        nautilus_selection_snapshot_add                   (NautilusSelectionSnapshot       *self,
+                                                                               gpointer                         key,
+                                                                               NautilusFile                    *file);
+void                        nautilus_selection_snapshot_remove                (NautilusSelectionSnapshot       *self,
+                                                                               gpointer                         key);
+void                        nautilus_selection_snapshot_update                (NautilusSelectionSnapshot       *self,
+                                                                               gpointer                         key,
+                                                                               NautilusFile                    *file);
+void                        nautilus_selection_snapshot_clear                 (NautilusSelectionSnapshot       *self);
+void                        nautilus_selection_snapshot_set_first_file        (NautilusSelectionSnapshot       *self,
+                                                                               NautilusFile                    *file);
+
+guint                       nautilus_selection_snapshot_get_n_items           (const NautilusSelectionSnapshot *self);
+guint                       nautilus_selection_snapshot_get_folder_count      (const NautilusSelectionSnapshot *self);
+gboolean                    nautilus_selection_snapshot_get_folder_item_count (const NautilusSelectionSnapshot *self,
+                                                                               guint                           *item_count);
+guint                       nautilus_selection_snapshot_get_non_folder_count  (const NautilusSelectionSnapshot *self);
+gboolean                    nautilus_selection_snapshot_get_non_folder_size   (const NautilusSelectionSnapshot *self,
+                                                                               goffset                         *size);
+NautilusFile *              nautilus_selection_snapshot_get_first_file        (const NautilusSelectionSnapshot *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (NautilusSelectionSnapshot, nautilus_selection_snapshot_free)
+
+G_END_DECLS
@@ -39,6 +39,12 @@
 #include "nautilus-shell-search-provider-generated.h"
 #include "nautilus-shell-search-provider.h"
 
+/* Metas are kept across searches, up to this many. */
+#define METAS_CACHE_MAX_SIZE 500
+/* The shell shows only a few results per provider, so prefetch the metas
+ * of the best hits while the search is still running. */
+#define METAS_PREFETCH_COUNT 10
+
 typedef struct
 {
     NautilusShellSearchProvider *self;
@@ -52,6 +58,13 @@ typedef struct
     gint64 start_time;
 } PendingSearch;
 
+typedef struct
+{
+    gchar *uri;
+    GVariant *meta;
+    time_t mtime;
+} CachedMeta;
+
 struct _NautilusShellSearchProvider
 {
     GObject parent;
@@ -61,7 +74,17 @@ struct _NautilusShellSearchProvider
     PendingSearch *current_search;
 
     GList *metas_requests;
+
+    /* uri -> link in metas_lru, which holds CachedMeta, most recently
+     * used first. */
     GHashTable *metas_cache;
+    GQueue metas_lru;
+
+    /* The prefetch outlives its search, as GetResultMetas only comes after
+     * the results were returned. It uses the hits of the latest search. */
+    GHashTable *prefetch_hits;
+    NautilusFileListHandle *prefetch_handle;
+    gboolean prefetch_outdated;
 };
 
 G_DEFINE_TYPE (NautilusShellSearchProvider, nautilus_shell_search_provider, G_TYPE_OBJECT)
@@ -114,10 +137,179 @@ get_gicon (NautilusShellSearchProvider *self,
     }
 }
 
+static void
+cached_meta_free (CachedMeta *cached)
+{
+    g_free (cached->uri);
+    g_variant_unref (cached->meta);
+
+    g_free (cached);
+}
+
+static GVariant *
+metas_cache_lookup (NautilusShellSearchProvider *self,
+                    const gchar                 *uri)
+{
+    GList *link;
+
+    link = g_hash_table_lookup (self->metas_cache, uri);
+    if (link == NULL)
+    {
+        return NULL;
+    }
+
+    g_queue_unlink (&self->metas_lru, link);
+    g_queue_push_head_link (&self->metas_lru, link);
+
+    return ((CachedMeta *) link->data)->meta;
+}
+
+static void
+metas_cache_remove (NautilusShellSearchProvider *self,
+                    const gchar                 *uri)
+{
+    GList *link;
+    CachedMeta *cached;
+
+    link = g_hash_table_lookup (self->metas_cache, uri);
+    if (link == NULL)
+    {
+        return;
+    }
+
+    cached = link->data;
+    g_hash_table_remove (self->metas_cache, uri);
+    g_queue_delete_link (&self->metas_lru, link);
+    cached_meta_free (cached);
+}
+
+static void
+metas_cache_insert (NautilusShellSearchProvider *self,
+                    const gchar                 *uri,
+                    GVariant                    *meta,
+                    time_t                       mtime)
+{
+    CachedMeta *cached;
+
+    metas_cache_remove (self, uri);
+
+    cached = g_new0 (CachedMeta, 1);
+    cached->uri = g_strdup (uri);
+    cached->meta = g_variant_ref_sink (meta);
+    cached->mtime = mtime;
+
+    g_queue_push_head (&self->metas_lru, cached);
+    g_hash_table_insert (self->metas_cache, cached->uri, self->metas_lru.head);
+
+    while (self->metas_lru.length > METAS_CACHE_MAX_SIZE)
+    {
+        cached = g_queue_pop_tail (&self->metas_lru);
+        g_hash_table_remove (self->metas_cache, cached->uri);
+        cached_meta_free (cached);
+    }
+}
+
+/* Drops the meta of @uri if it was built for another version of the file. */
+static void
+metas_cache_check_mtime (NautilusShellSearchProvider *self,
+                         const gchar                 *uri,
+                         time_t                       mtime)
+{
+    GList *link;
+
+    link = g_hash_table_lookup (self->metas_cache, uri);
+    if (link != NULL && ((CachedMeta *) link->data)->mtime != mtime)
+    {
+        metas_cache_remove (self, uri);
+    }
+}
+
+static void
+metas_cache_clear (NautilusShellSearchProvider *self)
+{
+    g_hash_table_remove_all (self->metas_cache);
+    g_queue_clear_full (&self->metas_lru, (GDestroyNotify) cached_meta_free);
+}
+
+static void
+cache_metas_for_files (NautilusShellSearchProvider *self,
+                       GList                       *file_list)
+{
+    GVariantBuilder meta;
+    NautilusFile *file;
+    GFile *file_location;
+    GList *l;
+    gchar *uri, *display_name;
+    gchar *path, *description;
+    gchar *thumbnail_path;
+    GIcon *gicon;
+    GFile *location;
+    gint icon_scale;
+
+    icon_scale = gdk_monitor_get_scale_factor (g_list_model_get_item (gdk_display_get_monitors (gdk_display_get_default ()), 0));
+
+    for (l = file_list; l != NULL; l = l->next)
+    {
+        file = l->data;
+        g_variant_builder_init (&meta, G_VARIANT_TYPE ("a{sv}"));
+
+        uri = nautilus_file_get_uri (file);
+        display_name = get_display_name (self, file);
+        file_location = nautilus_file_get_location (file);
+        path = g_file_get_path (file_location);
+        description = path ? g_path_get_dirname (path) : NULL;
+
+        g_variant_builder_add (&meta, "{sv}",
+                               "id", g_variant_new_string (uri));
+        g_variant_builder_add (&meta, "{sv}",
+                               "name", g_variant_new_string (display_name));
+        /* Some backends like trash:/// don't have a path, so we show the uri itself. */
+        g_variant_builder_add (&meta, "{sv}",
+                               "description", g_variant_new_string (description ? description : uri));
+
+        gicon = NULL;
+        thumbnail_path = nautilus_file_get_thumbnail_path (file);
+
+        if (thumbnail_path != NULL)
+        {
+            location = g_file_new_for_path (thumbnail_path);
+            gicon = g_file_icon_new (location);
+
+            g_free (thumbnail_path);
+            g_object_unref (location);
+        }
+        else
+        {
+            gicon = get_gicon (self, file);
+        }
+
+        if (gicon == NULL)
+        {
+            gicon = G_ICON (nautilus_file_get_icon_texture (file, 128,
+                                                            icon_scale,
+                                                            NAUTILUS_FILE_ICON_FLAGS_USE_THUMBNAILS));
+        }
+
+        g_variant_builder_add (&meta, "{sv}",
+                               "icon", g_icon_serialize (gicon));
+        g_object_unref (gicon);
+
+        metas_cache_insert (self, uri,
+                            g_variant_builder_end (&meta),
+                            nautilus_file_get_mtime (file));
+
+        g_object_unref (file_location);
+        g_free (display_name);
+        g_free (path);
+        g_free (description);
+        g_free (uri);
+    }
+}
+
 static void
 pending_search_free (PendingSearch *search)
 {
-    g_hash_table_destroy (search->hits);
+    g_hash_table_unref (search->hits);
     g_clear_object (&search->query);
     g_clear_object (&search->engine);
     g_clear_object (&search->invocation);
@@ -166,6 +358,84 @@ cancel_current_search_ignoring_partial_results (NautilusShellSearchProvider *sel
     }
 }
 
+static gint
+search_hit_compare_relevance (gconstpointer a,
+                              gconstpointer b);
+
+static void prefetch_metas (NautilusShellSearchProvider *self);
+
+static void
+prefetch_metas_ready_cb (GList    *file_list,
+                         gpointer  user_data)
+{
+    NautilusShellSearchProvider *self = user_data;
+
+    self->prefetch_handle = NULL;
+    cache_metas_for_files (self, file_list);
+
+    /* Better hits may have arrived in the meantime. */
+    if (self->prefetch_outdated)
+    {
+        self->prefetch_outdated = FALSE;
+        prefetch_metas (self);
+    }
+}
+
+static void
+prefetch_metas (NautilusShellSearchProvider *self)
+{
+    GList *hits, *l;
+    GList *files = NULL;
+    guint n_hits;
+
+    if (self->prefetch_hits == NULL)
+    {
+        return;
+    }
+
+    if (self->prefetch_handle != NULL)
+    {
+        self->prefetch_outdated = TRUE;
+        return;
+    }
+
+    hits = g_hash_table_get_values (self->prefetch_hits);
+    hits = g_list_sort (hits, search_hit_compare_relevance);
+
+    for (l = hits, n_hits = 0;
+         l != NULL && n_hits < METAS_PREFETCH_COUNT;
+         l = l->next, n_hits++)
+    {
+        const gchar *hit_uri = nautilus_search_hit_get_uri (l->data);
+
+        if (!g_hash_table_contains (self->metas_cache, hit_uri))
+        {
+            files = g_list_prepend (files, nautilus_file_get_by_uri (hit_uri));
+        }
+    }
+    g_list_free (hits);
+
+    if (files == NULL)
+    {
+        return;
+    }
+
+    nautilus_file_list_call_when_ready (files,
+                                        NAUTILUS_FILE_ATTRIBUTES_FOR_ICON,
+                                        &self->prefetch_handle,
+                                        prefetch_metas_ready_cb,
+                                        self);
+    nautilus_file_list_free (files);
+}
+
+static void
+cancel_prefetch (NautilusShellSearchProvider *self)
+{
+    g_clear_pointer (&self->prefetch_handle, nautilus_file_list_cancel_call_when_ready);
+    g_clear_pointer (&self->prefetch_hits, g_hash_table_unref);
+    self->prefetch_outdated = FALSE;
+}
+
 static void
 search_hits_added_cb (NautilusSearchEngine *engine,
                       GList                *hits,
@@ -175,6 +445,7 @@ search_hits_added_cb (NautilusSearchEngine *engine,
     GList *l;
     NautilusSearchHit *hit;
     const gchar *hit_uri;
+    GDateTime *mtime;
 
     g_debug ("*** Search engine hits added");
 
@@ -185,8 +456,19 @@ search_hits_added_cb (NautilusSearchEngine *engine,
         hit_uri = nautilus_search_hit_get_uri (hit);
         g_debug ("    %s", hit_uri);
 
+        mtime = nautilus_search_hit_get_modification_time (hit);
+        if (mtime != NULL)
+        {
+            metas_cache_check_mtime (search->self, hit_uri, g_date_time_to_unix (mtime));
+        }
+
         g_hash_table_replace (search->hits, g_strdup (hit_uri), g_object_ref (hit));
     }
+
+    if (search->hits == search->self->prefetch_hits)
+    {
+        prefetch_metas (search->self);
+    }
 }
 
 static gint
@@ -498,6 +780,9 @@ execute_search (NautilusShellSearchProvider  *self,
     self->current_search = pending_search;
     g_application_hold (g_application_get_default ());
 
+    cancel_prefetch (self);
+    self->prefetch_hits = g_hash_table_ref (pending_search->hits);
+
     search_add_volumes_and_bookmarks (pending_search);
 
     /* start searching */
@@ -570,9 +855,11 @@ result_metas_return_from_cache (ResultMetasData *data)
     {
         for (idx = 0; data->uris[idx] != NULL; idx++)
         {
-            meta = g_hash_table_lookup (data->self->metas_cache,
-                                        data->uris[idx]);
-            g_variant_builder_add_value (&builder, meta);
+            meta = metas_cache_lookup (data->self, data->uris[idx]);
+            if (meta != NULL)
+            {
+                g_variant_builder_add_value (&builder, meta);
+            }
         }
     }
 
@@ -607,75 +894,8 @@ result_list_attributes_ready_cb (GList    *file_list,
                                  gpointer  user_data)
 {
     ResultMetasData *data = user_data;
-    GVariantBuilder meta;
-    NautilusFile *file;
-    GFile *file_location;
-    GList *l;
-    gchar *uri, *display_name;
-    gchar *path, *description;
-    gchar *thumbnail_path;
-    GIcon *gicon;
-    GFile *location;
-    GVariant *meta_variant;
-    gint icon_scale;
-
-    icon_scale = gdk_monitor_get_scale_factor (g_list_model_get_item (gdk_display_get_monitors (gdk_display_get_default ()), 0));
-
-    for (l = file_list; l != NULL; l = l->next)
-    {
-        file = l->data;
-        g_variant_builder_init (&meta, G_VARIANT_TYPE ("a{sv}"));
-
-        uri = nautilus_file_get_uri (file);
-        display_name = get_display_name (data->self, file);
-        file_location = nautilus_file_get_location (file);
-        path = g_file_get_path (file_location);
-        description = path ? g_path_get_dirname (path) : NULL;
-
-        g_variant_builder_add (&meta, "{sv}",
-                               "id", g_variant_new_string (uri));
-        g_variant_builder_add (&meta, "{sv}",
-                               "name", g_variant_new_string (display_name));
-        /* Some backends like trash:/// don't have a path, so we show the uri itself. */
-        g_variant_builder_add (&meta, "{sv}",
-                               "description", g_variant_new_string (description ? description : uri));
-
-        gicon = NULL;
-        thumbnail_path = nautilus_file_get_thumbnail_path (file);
-
-        if (thumbnail_path != NULL)
-        {
-            location = g_file_new_for_path (thumbnail_path);
-            gicon = g_file_icon_new (location);
 
-            g_free (thumbnail_path);
-            g_object_unref (location);
-        }
-        else
-        {
-            gicon = get_gicon (data->self, file);
-        }
-
-        if (gicon == NULL)
-        {
-            gicon = G_ICON (nautilus_file_get_icon_texture (file, 128,
-                                                            icon_scale,
-                                                            NAUTILUS_FILE_ICON_FLAGS_USE_THUMBNAILS));
-        }
-
-        g_variant_builder_add (&meta, "{sv}",
-                               "icon", g_icon_serialize (gicon));
-        g_object_unref (gicon);
-
-        meta_variant = g_variant_builder_end (&meta);
-        g_hash_table_insert (data->self->metas_cache,
-                             g_strdup (uri), g_variant_ref_sink (meta_variant));
-
-        g_free (display_name);
-        g_free (path);
-        g_free (description);
-        g_free (uri);
-    }
+    cache_metas_for_files (data->self, file_list);
 
     data->handle = NULL;
     data->self->metas_requests = g_list_remove (data->self->metas_requests, data);
@@ -700,9 +920,18 @@ handle_get_result_metas (NautilusShellSearchProvider2  *skeleton,
 
     for (idx = 0; results[idx] != NULL; idx++)
     {
+        g_autoptr (NautilusFile) existing_file = NULL;
+
         uri = results[idx];
 
-        if (!g_hash_table_lookup (self->metas_cache, uri))
+        /* Files that are already loaded know their current mtime. */
+        existing_file = nautilus_file_get_existing_by_uri (uri);
+        if (existing_file != NULL && nautilus_file_get_mtime (existing_file) != 0)
+        {
+            metas_cache_check_mtime (self, uri, nautilus_file_get_mtime (existing_file));
+        }
+
+        if (!g_hash_table_contains (self->metas_cache, uri))
         {
             missing_files = g_list_prepend (missing_files, nautilus_file_get_by_uri (uri));
         }
@@ -816,9 +1045,14 @@ search_provider_dispose (GObject *obj)
     NautilusShellSearchProvider *self = NAUTILUS_SHELL_SEARCH_PROVIDER (obj);
 
     g_clear_object (&self->skeleton);
-    g_hash_table_destroy (self->metas_cache);
     cancel_current_search_ignoring_partial_results (self);
     cancel_result_meta_requests (self);
+    cancel_prefetch (self);
+    if (self->metas_cache != NULL)
+    {
+        metas_cache_clear (self);
+        g_clear_pointer (&self->metas_cache, g_hash_table_destroy);
+    }
 
     G_OBJECT_CLASS (nautilus_shell_search_provider_parent_class)->dispose (obj);
 }
@@ -826,8 +1060,8 @@ search_provider_dispose (GObject *obj)
 static void
 nautilus_shell_search_provider_init (NautilusShellSearchProvider *self)
 {
-    self->metas_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                               g_free, (GDestroyNotify) g_variant_unref);
+    self->metas_cache = g_hash_table_new (g_str_hash, g_str_equal);
+    g_queue_init (&self->metas_lru);
 
     self->skeleton = nautilus_shell_search_provider2_skeleton_new ();
 
@@ -28,6 +28,7 @@
 #include "nautilus-directory-notify.h"
 #include "nautilus-global-preferences.h"
 #include "nautilus-file-utilities.h"
+#include "nautilus-profile.h"
 #include <math.h>
 #include <eel/eel-graphic-effects.h>
 #include <eel/eel-string.h>
@@ -525,6 +526,8 @@ thumbnail_thread_func (GTask        *task,
         info = g_queue_peek_head ((GQueue *) &thumbnails_to_make);
         currently_thumbnailing = info;
         current_orig_mtime = info->original_file_mtime;
+        nautilus_profile_counter ("thumbnail-queue",
+                                  g_queue_get_length ((GQueue *) &thumbnails_to_make));
         /*********************************
          * MUTEX UNLOCKED
          *********************************/
@@ -552,6 +555,7 @@ thumbnail_thread_func (GTask        *task,
         /* Create the thumbnail. */
         DEBUG ("(Thumbnail Thread) Creating thumbnail: %s\n",
                info->image_uri);
+        nautilus_profile_span_begin ("thumbnail", "generate");
 
         pixbuf = gnome_desktop_thumbnail_factory_generate_thumbnail (thumbnail_factory,
                                                                      info->image_uri,
@@ -589,6 +593,7 @@ thumbnail_thread_func (GTask        *task,
                                                                      current_orig_mtime,
                                                                      NULL, NULL);
         }
+        nautilus_profile_span_end ("thumbnail", "generate");
         /* We need to call nautilus_file_changed(), but I don't think that is
          *  thread safe. So add an idle handler and do it from the main loop. */
         g_idle_add_full (G_PRIORITY_HIGH_IDLE,
@@ -154,13 +154,29 @@ set_metadata_callback (GObject      *source_object,
     }
 }
 
+static void
+vfs_file_set_metadata_from_info (NautilusFile *file,
+                                 GFileInfo    *info)
+{
+    GFile *location;
+
+    location = nautilus_file_get_location (file);
+    g_file_set_attributes_async (location,
+                                 info,
+                                 0,
+                                 G_PRIORITY_DEFAULT,
+                                 NULL,
+                                 set_metadata_callback,
+                                 nautilus_file_ref (file));
+    g_object_unref (location);
+}
+
 static void
 vfs_file_set_metadata (NautilusFile *file,
                        const char   *key,
                        const char   *value)
 {
     GFileInfo *info;
-    GFile *location;
     char *gio_key;
 
     info = g_file_info_new ();
@@ -179,15 +195,7 @@ vfs_file_set_metadata (NautilusFile *file,
     }
     g_free (gio_key);
 
-    location = nautilus_file_get_location (file);
-    g_file_set_attributes_async (location,
-                                 info,
-                                 0,
-                                 G_PRIORITY_DEFAULT,
-                                 NULL,
-                                 set_metadata_callback,
-                                 nautilus_file_ref (file));
-    g_object_unref (location);
+    vfs_file_set_metadata_from_info (file, info);
     g_object_unref (info);
 }
 
@@ -196,7 +204,6 @@ vfs_file_set_metadata_as_list (NautilusFile  *file,
                                const char    *key,
                                char         **value)
 {
-    GFile *location;
     GFileInfo *info;
     char *gio_key;
 
@@ -213,16 +220,8 @@ vfs_file_set_metadata_as_list (NautilusFile  *file,
     }
     g_free (gio_key);
 
-    location = nautilus_file_get_location (file);
-    g_file_set_attributes_async (location,
-                                 info,
-                                 0,
-                                 G_PRIORITY_DEFAULT,
-                                 NULL,
-                                 set_metadata_callback,
-                                 nautilus_file_ref (file));
+    vfs_file_set_metadata_from_info (file, info);
     g_object_unref (info);
-    g_object_unref (location);
 }
 
 static gboolean
@@ -725,6 +724,7 @@ nautilus_vfs_file_class_init (NautilusVFSFileClass *klass)
     file_class->get_where_string = vfs_file_get_where_string;
     file_class->set_metadata = vfs_file_set_metadata;
     file_class->set_metadata_as_list = vfs_file_set_metadata_as_list;
+    file_class->set_metadata_from_info = vfs_file_set_metadata_from_info;
     file_class->mount = vfs_file_mount;
     file_class->unmount = vfs_file_unmount;
     file_class->eject = vfs_file_eject;
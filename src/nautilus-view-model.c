@@ -1,6 +1,8 @@
 #include "nautilus-view-model.h"
 #include "nautilus-view-item.h"
+#include "nautilus-selection-snapshot.h"
 #include "nautilus-global-preferences.h"
+#include "nautilus-profile.h"
 
 struct _NautilusViewModel
 {
@@ -11,6 +13,11 @@ struct _NautilusViewModel
     GtkMultiSelection *selection_model;
     GtkSorter *sorter;
     gulong sorter_changed_id;
+
+    /* The selection as of the last change we have seen, used to find out
+     * what a "selection-changed" emission actually added or removed. */
+    GtkBitset *selected;
+    NautilusSelectionSnapshot *selection_snapshot;
 };
 
 static GType
@@ -124,6 +131,7 @@ dispose (GObject *object)
         g_signal_handlers_disconnect_by_func (self->selection_model,
                                               gtk_selection_model_selection_changed,
                                               self);
+        g_signal_handlers_disconnect_by_data (self->selection_model, self);
         g_object_unref (self->selection_model);
         self->selection_model = NULL;
     }
@@ -151,6 +159,8 @@ finalize (GObject *object)
 
     g_hash_table_destroy (self->map_files_to_model);
     g_clear_object (&self->sorter);
+    g_clear_pointer (&self->selected, gtk_bitset_unref);
+    g_clear_pointer (&self->selection_snapshot, nautilus_selection_snapshot_free);
 }
 
 static void
@@ -199,6 +209,132 @@ set_property (GObject      *object,
     }
 }
 
+static void
+update_first_selected_file (NautilusViewModel *self)
+{
+    g_autoptr (NautilusViewItem) item = NULL;
+
+    if (!gtk_bitset_is_empty (self->selected))
+    {
+        item = g_list_model_get_item (G_LIST_MODEL (self->internal_model),
+                                      gtk_bitset_get_minimum (self->selected));
+    }
+
+    nautilus_selection_snapshot_set_first_file (self->selection_snapshot,
+                                                item != NULL ? nautilus_view_item_get_file (item) : NULL);
+}
+
+static void
+snapshot_add_items (NautilusViewModel *self,
+                    GtkBitset         *positions,
+                    gboolean           add)
+{
+    GtkBitsetIter iter;
+    guint position;
+
+    for (gboolean valid = gtk_bitset_iter_init_first (&iter, positions, &position);
+         valid;
+         valid = gtk_bitset_iter_next (&iter, &position))
+    {
+        g_autoptr (NautilusViewItem) item = NULL;
+
+        item = g_list_model_get_item (G_LIST_MODEL (self->internal_model), position);
+        if (item == NULL)
+        {
+            continue;
+        }
+
+        if (add)
+        {
+            nautilus_selection_snapshot_add (self->selection_snapshot, item,
+                                             nautilus_view_item_get_file (item));
+        }
+        else
+        {
+            nautilus_selection_snapshot_remove (self->selection_snapshot, item);
+        }
+    }
+}
+
+static void
+on_selection_changed (GtkSelectionModel *selection_model,
+                      guint              position,
+                      guint              n_items,
+                      gpointer           user_data)
+{
+    NautilusViewModel *self = NAUTILUS_VIEW_MODEL (user_data);
+    g_autoptr (GtkBitset) range = NULL;
+    g_autoptr (GtkBitset) selection = NULL;
+    g_autoptr (GtkBitset) current = NULL;
+    g_autoptr (GtkBitset) previous = NULL;
+    g_autoptr (GtkBitset) added = NULL;
+    g_autoptr (GtkBitset) removed = NULL;
+    GtkBitset *selected;
+
+    /* Only look at the range that changed, so rubberbanding over a huge
+     * directory costs what the rubberband touched, not the whole selection. */
+    range = gtk_bitset_new_range (position, n_items);
+    selection = gtk_selection_model_get_selection_in_range (selection_model, position, n_items);
+    current = gtk_bitset_copy (selection);
+    gtk_bitset_intersect (current, range);
+
+    previous = gtk_bitset_copy (self->selected);
+    gtk_bitset_intersect (previous, range);
+
+    added = gtk_bitset_copy (current);
+    gtk_bitset_subtract (added, previous);
+    removed = gtk_bitset_copy (previous);
+    gtk_bitset_subtract (removed, current);
+
+    snapshot_add_items (self, removed, FALSE);
+    snapshot_add_items (self, added, TRUE);
+
+    selected = gtk_bitset_copy (self->selected);
+    gtk_bitset_subtract (selected, removed);
+    gtk_bitset_union (selected, added);
+    gtk_bitset_unref (self->selected);
+    self->selected = selected;
+
+    update_first_selected_file (self);
+}
+
+static void
+on_selection_model_items_changed (GListModel *model,
+                                  guint       position,
+                                  guint       removed,
+                                  guint       added,
+                                  gpointer    user_data)
+{
+    NautilusViewModel *self = NAUTILUS_VIEW_MODEL (user_data);
+    g_autoptr (GtkBitset) range = NULL;
+    g_autoptr (GtkBitset) added_selected = NULL;
+
+    /* Only the reported range changed. Selected items in it may have just
+     * moved, as when sorting, and are added back from the selection model.
+     * Removed items are taken out of the snapshot before they leave the
+     * model, so the snapshot only needs rebuilding if that was bypassed. */
+    gtk_bitset_splice (self->selected, position, removed, added);
+
+    if (added > 0)
+    {
+        range = gtk_bitset_new_range (position, added);
+        added_selected = gtk_selection_model_get_selection_in_range (GTK_SELECTION_MODEL (self->selection_model),
+                                                                     position, added);
+        gtk_bitset_intersect (added_selected, range);
+        gtk_bitset_union (self->selected, added_selected);
+        snapshot_add_items (self, added_selected, TRUE);
+    }
+
+    if (gtk_bitset_get_size (self->selected) !=
+        nautilus_selection_snapshot_get_n_items (self->selection_snapshot))
+    {
+        nautilus_selection_snapshot_clear (self->selection_snapshot);
+        snapshot_add_items (self, self->selected, TRUE);
+    }
+
+    update_first_selected_file (self);
+}
+
 static void
 constructed (GObject *object)
 {
@@ -209,9 +345,16 @@ constructed (GObject *object)
     self->internal_model = g_list_store_new (NAUTILUS_TYPE_VIEW_ITEM);
     self->selection_model = gtk_multi_selection_new (g_object_ref (G_LIST_MODEL (self->internal_model)));
     self->map_files_to_model = g_hash_table_new (NULL, NULL);
+    self->selected = gtk_bitset_new_empty ();
+    self->selection_snapshot = nautilus_selection_snapshot_new ();
 
     g_signal_connect_swapped (self->internal_model, "items-changed",
                               G_CALLBACK (g_list_model_items_changed), self);
+    /* Keep the snapshot up to date before anybody hears about the change. */
+    g_signal_connect (self->selection_model, "items-changed",
+                      G_CALLBACK (on_selection_model_items_changed), self);
+    g_signal_connect (self->selection_model, "selection-changed",
+                      G_CALLBACK (on_selection_changed), self);
     g_signal_connect_swapped (self->selection_model, "selection-changed",
                               G_CALLBACK (gtk_selection_model_selection_changed), self);
 }
@@ -263,7 +406,9 @@ on_sorter_changed (GtkSorter       *sorter,
 {
     NautilusViewModel *self = NAUTILUS_VIEW_MODEL (user_data);
 
+    nautilus_profile_span_begin ("view", "sort");
     g_list_store_sort (self->internal_model, compare_data_func, self);
+    nautilus_profile_span_end ("view", "sort");
 }
 
 NautilusViewModel *
@@ -296,7 +441,9 @@ nautilus_view_model_set_sorter (NautilusViewModel *self,
     {
         self->sorter_changed_id = g_signal_connect (self->sorter, "changed",
                                                     G_CALLBACK (on_sorter_changed), self);
+        nautilus_profile_span_begin ("view", "sort");
         g_list_store_sort (self->internal_model, compare_data_func, self);
+        nautilus_profile_span_end ("view", "sort");
     }
 }
 
@@ -355,6 +502,7 @@ nautilus_view_model_remove_item (NautilusViewModel *self,
         NautilusFile *file;
 
         file = nautilus_view_item_get_file (item);
+        nautilus_selection_snapshot_remove (self->selection_snapshot, item);
         g_list_store_remove (self->internal_model, i);
         g_hash_table_remove (self->map_files_to_model, file);
     }
@@ -363,6 +511,8 @@ nautilus_view_model_remove_item (NautilusViewModel *self,
 void
 nautilus_view_model_remove_all_items (NautilusViewModel *self)
 {
+    nautilus_profile_mark ("view");
+    nautilus_selection_snapshot_clear (self->selection_snapshot);
     g_list_store_remove_all (self->internal_model);
     g_hash_table_remove_all (self->map_files_to_model);
 }
@@ -385,6 +535,9 @@ nautilus_view_model_add_items (NautilusViewModel *self,
     GList *l;
     int i = 0;
 
+    nautilus_profile_span_begin ("view", "add-items");
+    nautilus_profile_counter ("view-items-added", g_queue_get_length (items));
+
     /* Sort items before adding them to the internal model. This ensures that
      * the first sorted item is become the initial focus and scroll anchor. */
     g_queue_sort (items, compare_data_func, self);
@@ -406,6 +559,8 @@ nautilus_view_model_add_items (NautilusViewModel *self,
                          0, array, g_queue_get_length (items));
 
     g_list_store_sort (self->internal_model, compare_data_func, self);
+
+    nautilus_profile_span_end ("view", "add-items");
 }
 
 guint
@@ -420,3 +575,21 @@ nautilus_view_model_get_index (NautilusViewModel *self,
 
     return i;
 }
+
+/* Running totals of the current selection, kept up to date incrementally.
+ * Owned by the model. */
+const NautilusSelectionSnapshot *
+nautilus_view_model_get_selection_snapshot (NautilusViewModel *self)
+{
+    return self->selection_snapshot;
+}
+
+/* Lets the selection totals pick up changes to the file of @item, like its
+ * size or item count becoming known. */
+void
+nautilus_view_model_item_file_changed (NautilusViewModel *self,
+                                       NautilusViewItem  *item)
+{
+    nautilus_selection_snapshot_update (self->selection_snapshot, item,
+                                        nautilus_view_item_get_file (item));
+}
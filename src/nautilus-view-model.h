@@ -3,6 +3,7 @@
 #include <glib.h>
 #include "nautilus-file.h"
 #include "nautilus-view-item.h"
+#include "nautilus-selection-snapshot.h"
 
 G_BEGIN_DECLS
 
@@ -30,5 +31,8 @@ void nautilus_view_model_add_items (NautilusViewModel *self,
                                     GQueue            *items);
 guint nautilus_view_model_get_index (NautilusViewModel     *self,
                                      NautilusViewItem *item);
+const NautilusSelectionSnapshot * nautilus_view_model_get_selection_snapshot (NautilusViewModel *self);
+void nautilus_view_model_item_file_changed (NautilusViewModel *self,
+                                            NautilusViewItem  *item);
 
 G_END_DECLS
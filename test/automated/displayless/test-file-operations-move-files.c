@@ -1,5 +1,9 @@
 #include "test-utilities.h"
 #include <src/nautilus-tag-manager.h>
+/* For the move plan, which is private. */
+#include "src/nautilus-file-operations.c"
+
+#include <string.h>
 
 static void
 test_move_one_file (void)
@@ -264,6 +268,79 @@ test_move_files_small (void)
     empty_directory_by_prefix (root, "move");
 }
 
+/* Files are renamed directly when nothing in the destination has their name.
+ * A destination file which appears after the destination was listed, or one
+ * which was already there, must never be replaced; the file is left to the
+ * regular code path, which reports the conflict.
+ */
+static void
+test_move_files_keep_existing (void)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) dir = NULL;
+    g_autoptr (GFile) listed_source = NULL;
+    g_autoptr (GFile) listed = NULL;
+    g_autoptr (GFile) appeared_source = NULL;
+    g_autoptr (GFile) appeared = NULL;
+    g_autoptr (GFile) moved = NULL;
+    g_autoptr (GFile) moved_source = NULL;
+    g_autoptr (MovePlan) plan = NULL;
+    g_autofree gchar *contents = NULL;
+    g_autoptr (GError) error = NULL;
+
+    create_multiple_files ("move", 3);
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    g_assert_true (root != NULL);
+
+    dir = g_file_get_child (root, "move_dir");
+    g_assert_true (dir != NULL);
+
+    /* Already there when the destination is listed. */
+    listed_source = g_file_get_child (root, "move_file_0");
+    listed = g_file_get_child (dir, "move_file_0");
+    g_file_replace_contents (listed, "existing", strlen ("existing"), NULL, FALSE,
+                             G_FILE_CREATE_NONE, NULL, NULL, &error);
+    g_assert_no_error (error);
+
+    plan = move_plan_new (dir);
+#ifndef RENAME_NOREPLACE
+    /* Nothing is renamed directly then. */
+    g_assert_null (plan);
+#else
+    g_assert_nonnull (plan);
+
+    /* Appears after the destination was listed. */
+    appeared_source = g_file_get_child (root, "move_file_1");
+    appeared = g_file_get_child (dir, "move_file_1");
+    g_file_replace_contents (appeared, "appeared", strlen ("appeared"), NULL, FALSE,
+                             G_FILE_CREATE_NONE, NULL, NULL, &error);
+    g_assert_no_error (error);
+
+    g_assert_null (move_plan_move_file (plan, listed_source));
+    g_assert_true (g_file_query_exists (listed_source, NULL));
+    g_file_load_contents (listed, NULL, &contents, NULL, NULL, &error);
+    g_assert_no_error (error);
+    g_assert_cmpstr (contents, ==, "existing");
+    g_clear_pointer (&contents, g_free);
+
+    g_assert_null (move_plan_move_file (plan, appeared_source));
+    g_assert_true (g_file_query_exists (appeared_source, NULL));
+    g_file_load_contents (appeared, NULL, &contents, NULL, NULL, &error);
+    g_assert_no_error (error);
+    g_assert_cmpstr (contents, ==, "appeared");
+
+    /* Without a conflict, the file is moved. */
+    moved_source = g_file_get_child (root, "move_file_2");
+    moved = move_plan_move_file (plan, moved_source);
+    g_assert_nonnull (moved);
+    g_assert_false (g_file_query_exists (moved_source, NULL));
+    g_assert_true (g_file_query_exists (moved, NULL));
+#endif
+
+    empty_directory_by_prefix (root, "move");
+}
+
 static void
 test_move_files_small_undo (void)
 {
@@ -1865,6 +1942,8 @@ setup_test_suite (void)
                      test_move_one_empty_directory_undo_redo);
     g_test_add_func ("/test-move-files/1.0",
                      test_move_files_small);
+    g_test_add_func ("/test-move-files-keep-existing/1.0",
+                     test_move_files_keep_existing);
     g_test_add_func ("/test-move-files-undo/1.0",
                      test_move_files_small_undo);
     g_test_add_func ("/test-move-files-undo-redo/1.0",
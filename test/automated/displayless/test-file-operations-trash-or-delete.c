@@ -1,6 +1,9 @@
 #include "test-utilities.h"
 #include <src/nautilus-tag-manager.h>
 
+#include <glib/gstdio.h>
+#include <string.h>
+
 static void
 test_trash_one_file (void)
 {
@@ -72,6 +75,156 @@ test_trash_more_files (void)
     test_trash_more_files_func (100);
 }
 
+/* Undo only restores trashed files whose deletion date is within a couple of
+ * seconds of when they were trashed, so every info file needs its own date.
+ * The trash lives in the isolated data directory, see main ().
+ */
+static void
+test_trash_deletion_dates_func (gint files_to_trash)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GDateTime) before = NULL;
+    g_autoptr (GDateTime) after = NULL;
+    g_autoptr (GHashTable) trashed_paths = NULL;
+    g_autoptr (GDir) info_dir = NULL;
+    g_autolist (GFile) files = NULL;
+    g_autofree gchar *trash_directory = NULL;
+    g_autofree gchar *info_directory = NULL;
+    g_autofree gchar *files_directory = NULL;
+    g_autoptr (GError) error = NULL;
+    const gchar *info_name;
+    gint64 latest_date = 0;
+    GStatBuf root_stat;
+    GStatBuf trash_stat;
+
+    trash_directory = g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+    info_directory = g_build_filename (trash_directory, "info", NULL);
+    files_directory = g_build_filename (trash_directory, "files", NULL);
+    g_mkdir_with_parents (info_directory, 0700);
+    g_mkdir_with_parents (files_directory, 0700);
+
+    /* Otherwise GIO picks a trash directory on the device of the files. */
+    if (g_stat (test_get_tmp_dir (), &root_stat) != 0 ||
+        g_stat (trash_directory, &trash_stat) != 0 ||
+        root_stat.st_dev != trash_stat.st_dev)
+    {
+        g_test_skip ("The home trash is on another device than the test files");
+        return;
+    }
+
+    create_multiple_files ("trash_dates", files_to_trash);
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    g_assert_true (root != NULL);
+
+    trashed_paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    for (int i = 0; i < files_to_trash; i++)
+    {
+        g_autofree gchar *file_name = NULL;
+        GFile *file;
+
+        file_name = g_strdup_printf ("trash_dates_file_%i", i);
+        file = g_file_get_child (root, file_name);
+        files = g_list_prepend (files, file);
+        g_hash_table_add (trashed_paths, g_file_get_path (file));
+    }
+
+    before = g_date_time_new_now_local ();
+    nautilus_file_operations_trash_or_delete_sync (files);
+    after = g_date_time_new_now_local ();
+
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        g_assert_false (g_file_query_exists (l->data, NULL));
+    }
+
+    /* The trashed names may have been suffixed, so match the info files by
+     * their original path.
+     */
+    info_dir = g_dir_open (info_directory, 0, &error);
+    g_assert_no_error (error);
+    while ((info_name = g_dir_read_name (info_dir)) != NULL)
+    {
+        g_autofree gchar *info_path = NULL;
+        g_autofree gchar *escaped_path = NULL;
+        g_autofree gchar *original_path = NULL;
+        g_autofree gchar *deletion_date = NULL;
+        g_autofree gchar *trash_name = NULL;
+        g_autofree gchar *trashed_path = NULL;
+        g_autoptr (GKeyFile) key_file = NULL;
+        g_autoptr (GDateTime) date = NULL;
+
+        if (!g_str_has_suffix (info_name, ".trashinfo"))
+        {
+            continue;
+        }
+
+        info_path = g_build_filename (info_directory, info_name, NULL);
+        key_file = g_key_file_new ();
+        g_key_file_load_from_file (key_file, info_path, G_KEY_FILE_NONE, &error);
+        g_assert_no_error (error);
+
+        escaped_path = g_key_file_get_string (key_file, "Trash Info", "Path", &error);
+        g_assert_no_error (error);
+        original_path = g_uri_unescape_string (escaped_path, NULL);
+        if (!g_hash_table_remove (trashed_paths, original_path))
+        {
+            continue;
+        }
+
+        deletion_date = g_key_file_get_string (key_file, "Trash Info", "DeletionDate", &error);
+        g_assert_no_error (error);
+        date = g_date_time_new_from_iso8601 (deletion_date, g_date_time_get_timezone (before));
+        g_assert_nonnull (date);
+
+        /* The date is written with a precision of a second. */
+        g_assert_cmpint (g_date_time_to_unix (date), >=, g_date_time_to_unix (before));
+        g_assert_cmpint (g_date_time_to_unix (date), <=, g_date_time_to_unix (after));
+        latest_date = MAX (latest_date, g_date_time_to_unix (date));
+
+        trash_name = g_strndup (info_name, strlen (info_name) - strlen (".trashinfo"));
+        trashed_path = g_build_filename (files_directory, trash_name, NULL);
+        g_unlink (trashed_path);
+        g_unlink (info_path);
+    }
+
+    g_assert_cmpuint (g_hash_table_size (trashed_paths), ==, 0);
+
+    /* With a single date for the whole batch, the last files of a long batch
+     * would be dated from its start.
+     */
+    if (g_date_time_to_unix (after) - g_date_time_to_unix (before) > 2)
+    {
+        g_assert_cmpint (latest_date, >=, g_date_time_to_unix (after) - 2);
+    }
+    else if (files_to_trash > 10)
+    {
+        g_test_message ("The batch took less than 2 seconds, the dates were not "
+                        "spread over it");
+    }
+
+    empty_directory_by_prefix (root, "trash_dates");
+}
+
+static void
+test_trash_deletion_dates (void)
+{
+    test_trash_deletion_dates_func (10);
+}
+
+/* Long enough for the batch to take more than a couple of seconds. */
+static void
+test_trash_deletion_dates_long_batch (void)
+{
+    if (!g_test_slow ())
+    {
+        g_test_skip ("Only run in slow mode");
+        return;
+    }
+
+    test_trash_deletion_dates_func (20000);
+}
+
 static void
 test_delete_one_file (void)
 {
@@ -540,6 +693,10 @@ setup_test_suite (void)
                      test_trash_one_file);
     g_test_add_func ("/test-trash-more-files/1.0",
                      test_trash_more_files);
+    g_test_add_func ("/test-trash-deletion-dates/1.0",
+                     test_trash_deletion_dates);
+    g_test_add_func ("/test-trash-deletion-dates/1.1",
+                     test_trash_deletion_dates_long_batch);
     g_test_add_func ("/test-delete-one-file/1.0",
                      test_delete_one_file);
     g_test_add_func ("/test-delete-more-files/1.0",
@@ -574,7 +731,8 @@ main (int   argc,
     g_autoptr (NautilusTagManager) tag_manager = NULL;
     int ret;
 
-    g_test_init (&argc, &argv, NULL);
+    /* Keeps the trash tests away from the real trash. */
+    g_test_init (&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
     g_test_set_nonfatal_assertions ();
     nautilus_ensure_extension_points ();
     undo_manager = nautilus_file_undo_manager_new ();
@@ -0,0 +1,128 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include <src/nautilus-profile.h>
+
+static gpointer
+trace_in_thread (gpointer data)
+{
+    nautilus_profile_span_begin ("test", data);
+    nautilus_profile_span_end ("test", data);
+
+    return NULL;
+}
+
+static void
+test_profile_write_trace (void)
+{
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *path = NULL;
+    g_autofree gchar *contents = NULL;
+    GThread *thread;
+    int id;
+
+    path = g_build_filename (g_get_tmp_dir (), "nautilus-test-trace.json", NULL);
+
+    nautilus_profile_span_begin ("test", "before-tracing");
+    nautilus_profile_span_end ("test", "before-tracing");
+
+    nautilus_profile_set_tracing (TRUE);
+    g_assert_true (nautilus_profile_is_tracing ());
+
+    nautilus_profile_span_begin ("test", "main-span");
+    nautilus_profile_async_begin ("test", "async-span", &id);
+    nautilus_profile_counter ("test-counter", 42);
+    nautilus_profile_span_end ("test", "main-span");
+
+    thread = g_thread_new ("trace", trace_in_thread, "thread-span");
+    g_thread_join (thread);
+
+    nautilus_profile_async_end ("test", "async-span", &id);
+
+    g_assert_true (nautilus_profile_write_trace (path, &error));
+    g_assert_no_error (error);
+
+    g_assert_true (g_file_get_contents (path, &contents, NULL, &error));
+    g_assert_no_error (error);
+
+    g_assert_true (g_str_has_prefix (contents, "{\"traceEvents\":["));
+    g_assert_null (strstr (contents, "before-tracing"));
+    g_assert_nonnull (strstr (contents, "\"name\":\"main-span\",\"cat\":\"test\",\"ph\":\"B\""));
+    g_assert_nonnull (strstr (contents, "\"name\":\"main-span\",\"cat\":\"test\",\"ph\":\"E\""));
+    g_assert_nonnull (strstr (contents, "\"name\":\"async-span\",\"cat\":\"test\",\"ph\":\"b\""));
+    g_assert_nonnull (strstr (contents, "\"name\":\"async-span\",\"cat\":\"test\",\"ph\":\"e\""));
+    g_assert_nonnull (strstr (contents, "\"args\":{\"value\":42}"));
+    g_assert_nonnull (strstr (contents, "thread-span"));
+
+    g_unlink (path);
+}
+
+static guint64
+get_event_tid (const gchar *event)
+{
+    const gchar *tid;
+
+    tid = strstr (event, "\"tid\":");
+    g_assert_nonnull (tid);
+
+    return g_ascii_strtoull (tid + strlen ("\"tid\":"), NULL, 10);
+}
+
+/* The buffer of an exited thread is reused by the next one, which must
+ * not lose the events of the first thread nor attribute them to itself.
+ */
+static void
+test_profile_recycle_buffers (void)
+{
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *path = NULL;
+    g_autofree gchar *contents = NULL;
+    const gchar *first;
+    const gchar *second;
+    GThread *thread;
+
+    path = g_build_filename (g_get_tmp_dir (), "nautilus-test-trace-recycle.json", NULL);
+
+    nautilus_profile_set_tracing (TRUE);
+
+    thread = g_thread_new ("trace", trace_in_thread, "first-thread-span");
+    g_thread_join (thread);
+    thread = g_thread_new ("trace", trace_in_thread, "second-thread-span");
+    g_thread_join (thread);
+
+    g_assert_true (nautilus_profile_write_trace (path, &error));
+    g_assert_no_error (error);
+
+    g_assert_true (g_file_get_contents (path, &contents, NULL, &error));
+    g_assert_no_error (error);
+
+    first = strstr (contents, "first-thread-span");
+    second = strstr (contents, "second-thread-span");
+    g_assert_nonnull (first);
+    g_assert_nonnull (second);
+    g_assert_cmpuint (get_event_tid (first), !=, get_event_tid (second));
+
+    g_unlink (path);
+}
+
+static void
+setup_test_suite (void)
+{
+    g_test_add_func ("/profile/write-trace/1.0",
+                     test_profile_write_trace);
+    g_test_add_func ("/profile/write-trace/1.1",
+                     test_profile_recycle_buffers);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions ();
+
+    setup_test_suite ();
+
+    return g_test_run ();
+}
@@ -0,0 +1,113 @@
+#include <glib.h>
+#include "src/nautilus-global-preferences.h"
+#include "src/nautilus-query.h"
+
+static NautilusQuery *
+create_query (const char *text)
+{
+    NautilusQuery *query;
+    g_autoptr (GFile) location = NULL;
+
+    location = g_file_new_for_path (g_get_tmp_dir ());
+
+    query = nautilus_query_new ();
+    nautilus_query_set_text (query, text);
+    nautilus_query_set_location (query, location);
+
+    return query;
+}
+
+/* Typing more of a word only narrows down the previous results */
+static void
+test_refinement_longer_text (void)
+{
+    g_autoptr (NautilusQuery) previous = NULL;
+    g_autoptr (NautilusQuery) query = NULL;
+
+    previous = create_query ("repo");
+    query = create_query ("report");
+
+    g_assert_true (nautilus_query_is_refinement_of (query, previous));
+    g_assert_false (nautilus_query_is_refinement_of (previous, query));
+}
+
+/* A different word may match files the previous search didn't find */
+static void
+test_refinement_different_text (void)
+{
+    g_autoptr (NautilusQuery) previous = NULL;
+    g_autoptr (NautilusQuery) query = NULL;
+
+    previous = create_query ("repo");
+    query = create_query ("rep");
+
+    g_assert_false (nautilus_query_is_refinement_of (query, previous));
+
+    g_clear_object (&query);
+    query = create_query ("photo");
+
+    g_assert_false (nautilus_query_is_refinement_of (query, previous));
+}
+
+/* Full text search also matches by contents, so the results of a search
+ * by name only are not a superset of it, nor the other way around */
+static void
+test_refinement_search_content (void)
+{
+    g_autoptr (NautilusQuery) previous = NULL;
+    g_autoptr (NautilusQuery) query = NULL;
+
+    previous = create_query ("repo");
+    query = create_query ("report");
+    nautilus_query_set_search_content (query, NAUTILUS_QUERY_SEARCH_CONTENT_FULL_TEXT);
+
+    g_assert_false (nautilus_query_is_refinement_of (query, previous));
+    g_assert_false (nautilus_query_is_refinement_of (previous, query));
+
+    nautilus_query_set_search_content (previous, NAUTILUS_QUERY_SEARCH_CONTENT_FULL_TEXT);
+
+    g_assert_true (nautilus_query_is_refinement_of (query, previous));
+}
+
+/* Searching somewhere else never reuses the results */
+static void
+test_refinement_location (void)
+{
+    g_autoptr (NautilusQuery) previous = NULL;
+    g_autoptr (NautilusQuery) query = NULL;
+    g_autoptr (GFile) location = NULL;
+
+    previous = create_query ("repo");
+    query = create_query ("report");
+    location = g_file_new_for_path (g_get_home_dir ());
+    nautilus_query_set_location (query, location);
+
+    g_assert_false (nautilus_query_is_refinement_of (query, previous));
+}
+
+static void
+setup_test_suite (void)
+{
+    g_test_add_func ("/query-is-refinement-of/1.0",
+                     test_refinement_longer_text);
+    g_test_add_func ("/query-is-refinement-of/1.1",
+                     test_refinement_different_text);
+    g_test_add_func ("/query-is-refinement-of/1.2",
+                     test_refinement_search_content);
+    g_test_add_func ("/query-is-refinement-of/1.3",
+                     test_refinement_location);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions ();
+    /* Needed for nautilus-query.c. */
+    nautilus_global_preferences_init ();
+
+    setup_test_suite ();
+
+    return g_test_run ();
+}
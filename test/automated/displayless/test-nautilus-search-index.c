@@ -0,0 +1,199 @@
+#include "test-utilities.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+#include <src/nautilus-search-index.h>
+
+static void
+count_hit (NautilusSearchHit *hit,
+           gpointer           user_data)
+{
+    guint *n_hits = user_data;
+
+    g_print ("Hit: %s\n", nautilus_search_hit_get_uri (hit));
+    *n_hits += 1;
+
+    g_object_unref (hit);
+}
+
+static guint
+count_matches (NautilusSearchIndex    *index,
+               const gchar            *text,
+               GFile                  *location,
+               NautilusQueryRecursive  recursive)
+{
+    g_autoptr (NautilusQuery) query = NULL;
+    guint n_hits = 0;
+
+    query = nautilus_query_new ();
+    nautilus_query_set_text (query, text);
+    nautilus_query_set_location (query, location);
+    nautilus_query_set_recursive (query, recursive);
+
+    g_assert_true (nautilus_search_index_foreach_match (index, query, NULL,
+                                                        count_hit, &n_hits));
+
+    return n_hits;
+}
+
+static void
+test_search_index (void)
+{
+    g_autoptr (GFile) location = NULL;
+    g_autoptr (GFile) subdirectory = NULL;
+    g_autoptr (NautilusSearchIndex) index = NULL;
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *cache_path = NULL;
+
+    location = g_file_new_for_path (test_get_tmp_dir ());
+    cache_path = g_build_filename (g_get_tmp_dir (), "nautilus-test-search-index.idx", NULL);
+
+    create_search_file_hierarchy ("index");
+
+    index = nautilus_search_index_build (location, cache_path, NULL, &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (index);
+
+    /* The root, 3 directories and 4 files. */
+    g_assert_cmpuint (nautilus_search_index_get_n_entries (index), ==, 8);
+
+    g_assert_cmpuint (count_matches (index, "engine_index", location,
+                                     NAUTILUS_QUERY_RECURSIVE_NEVER), ==, 3);
+    g_assert_cmpuint (count_matches (index, "engine_index", location,
+                                     NAUTILUS_QUERY_RECURSIVE_ALWAYS), ==, 5);
+    g_assert_cmpuint (count_matches (index, "ENGINE_INDEX_CHILD", location,
+                                     NAUTILUS_QUERY_RECURSIVE_ALWAYS), ==, 2);
+
+    subdirectory = g_file_get_child (location, "engine_index_directory");
+    g_assert_cmpuint (count_matches (index, "index_child", subdirectory,
+                                     NAUTILUS_QUERY_RECURSIVE_ALWAYS), ==, 1);
+
+    delete_search_file_hierarchy ("index");
+    g_unlink (cache_path);
+    test_clear_tmp_dir ();
+}
+
+static void
+test_search_index_outdated (void)
+{
+    g_autoptr (GFile) location = NULL;
+    g_autoptr (GFile) subdirectory = NULL;
+    g_autoptr (GFile) new_file = NULL;
+    g_autoptr (GFileOutputStream) stream = NULL;
+    g_autoptr (NautilusSearchIndex) index = NULL;
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *cache_path = NULL;
+
+    location = g_file_new_for_path (test_get_tmp_dir ());
+    cache_path = g_build_filename (g_get_tmp_dir (), "nautilus-test-search-index.idx", NULL);
+
+    create_search_file_hierarchy ("index");
+
+    /* Make sure adding a file below changes the modification time. */
+    subdirectory = g_file_get_child (location, "engine_index_directory");
+    g_file_set_attribute_uint64 (subdirectory, G_FILE_ATTRIBUTE_TIME_MODIFIED, 1,
+                                 G_FILE_QUERY_INFO_NONE, NULL, &error);
+    g_assert_no_error (error);
+
+    index = nautilus_search_index_build (location, cache_path, NULL, &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (index);
+    g_assert_true (nautilus_search_index_verify (index, NULL));
+
+    /* A change made behind the back of the index, in a subdirectory. */
+    new_file = g_file_get_child (subdirectory, "engine_index_added");
+    stream = g_file_create (new_file, G_FILE_CREATE_NONE, NULL, &error);
+    g_assert_no_error (error);
+    g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, NULL);
+
+    g_assert_false (nautilus_search_index_verify (index, NULL));
+
+    g_file_delete (new_file, NULL, NULL);
+    delete_search_file_hierarchy ("index");
+    g_unlink (cache_path);
+    test_clear_tmp_dir ();
+}
+
+static void
+test_search_index_corrupt (void)
+{
+    g_autoptr (GFile) location = NULL;
+    g_autoptr (NautilusSearchIndex) index = NULL;
+    g_autoptr (NautilusSearchIndex) loaded = NULL;
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *cache_path = NULL;
+    g_autofree gchar *contents = NULL;
+    gsize length;
+
+    location = g_file_new_for_path (test_get_tmp_dir ());
+    cache_path = g_build_filename (g_get_tmp_dir (), "nautilus-test-search-index.idx", NULL);
+
+    create_search_file_hierarchy ("index");
+
+    index = nautilus_search_index_build (location, cache_path, NULL, &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (index);
+
+    loaded = nautilus_search_index_load (cache_path);
+    g_assert_nonnull (loaded);
+    g_clear_pointer (&loaded, nautilus_search_index_unref);
+
+    g_file_get_contents (cache_path, &contents, &length, &error);
+    g_assert_no_error (error);
+
+    /* Truncated. */
+    g_file_set_contents (cache_path, contents, length - 1, &error);
+    g_assert_no_error (error);
+    loaded = nautilus_search_index_load (cache_path);
+    g_assert_null (loaded);
+
+    /* Unterminated strings. */
+    contents[length - 1] = 'x';
+    g_file_set_contents (cache_path, contents, length, &error);
+    g_assert_no_error (error);
+    loaded = nautilus_search_index_load (cache_path);
+    g_assert_null (loaded);
+    contents[length - 1] = '\0';
+
+    /* The name offset of the root entry, right after the 32 bytes header,
+     * pointing past the strings.
+     */
+    memset (contents + 32 + sizeof (guint32), 0xff, sizeof (guint32));
+    g_file_set_contents (cache_path, contents, length, &error);
+    g_assert_no_error (error);
+    loaded = nautilus_search_index_load (cache_path);
+    g_assert_null (loaded);
+
+    delete_search_file_hierarchy ("index");
+    g_unlink (cache_path);
+    test_clear_tmp_dir ();
+}
+
+static void
+setup_test_suite (void)
+{
+    g_test_add_func ("/search-index/build-and-match/1.0",
+                     test_search_index);
+    g_test_add_func ("/search-index/outdated/1.0",
+                     test_search_index_outdated);
+    g_test_add_func ("/search-index/corrupt/1.0",
+                     test_search_index_corrupt);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions ();
+    nautilus_ensure_extension_points ();
+    /* Needed for nautilus-query.c.
+     * FIXME: tests are not installed, so the system does not
+     * have the gschema. Installed tests is a long term GNOME goal.
+     */
+    nautilus_global_preferences_init ();
+
+    setup_test_suite ();
+
+    return g_test_run ();
+}
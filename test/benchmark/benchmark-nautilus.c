@@ -0,0 +1,730 @@
+/*
+ * Headless benchmarks for the hot paths of directory loading, sorting,
+ * searching and file operations.
+ *
+ * Run with `meson test --benchmark` or directly:
+ *
+ *       ./benchmark-nautilus --output results.json --iterations 5 --large
+ *
+ * Results are written as JSON so they can be compared between revisions.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include <src/nautilus-directory.h>
+#include <src/nautilus-file.h>
+#include <src/nautilus-file-operations.h>
+#include <src/nautilus-file-undo-manager.h>
+#include <src/nautilus-file-utilities.h>
+#include <src/nautilus-global-preferences.h>
+#include <src/nautilus-query.h>
+#include <src/nautilus-search-engine-simple.h>
+#include <src/nautilus-search-hit.h>
+#include <src/nautilus-search-provider.h>
+#include <src/nautilus-tag-manager.h>
+#include <src/nautilus-view-item.h>
+#include <src/nautilus-view-model.h>
+
+#define DIRECTORY_LOAD_ATTRIBUTES \
+    (NAUTILUS_FILE_ATTRIBUTE_INFO | \
+     NAUTILUS_FILE_ATTRIBUTE_DIRECTORY_ITEM_COUNT | \
+     NAUTILUS_FILE_ATTRIBUTE_MOUNT)
+
+#define SMALL_FILE_SIZE 1024
+
+typedef enum
+{
+    TREE_FLAT,
+    TREE_DEEP,
+    TREE_MANY_SMALL_FILES,
+    TREE_MANY_SUBDIRS,
+} TreeKind;
+
+typedef struct
+{
+    const char *name;
+    TreeKind kind;
+    guint size;
+    gboolean large;
+
+    GFile *location;
+    guint n_files;
+    guint n_directories;
+    goffset n_bytes;
+} Tree;
+
+static Tree trees[] =
+{
+    { "flat-100k", TREE_FLAT, 100000, FALSE },
+    { "flat-1m", TREE_FLAT, 1000000, TRUE },
+    { "deep", TREE_DEEP, 64, FALSE },
+    { "many-small-files", TREE_MANY_SMALL_FILES, 64, FALSE },
+    { "many-subdirs", TREE_MANY_SUBDIRS, 10000, FALSE },
+};
+
+static const struct
+{
+    const char *name;
+    NautilusFileSortType sort_type;
+} sort_types[] =
+{
+    { "display-name", NAUTILUS_FILE_SORT_BY_DISPLAY_NAME },
+    { "size", NAUTILUS_FILE_SORT_BY_SIZE },
+    { "type", NAUTILUS_FILE_SORT_BY_TYPE },
+    { "mtime", NAUTILUS_FILE_SORT_BY_MTIME },
+    { "atime", NAUTILUS_FILE_SORT_BY_ATIME },
+    { "btime", NAUTILUS_FILE_SORT_BY_BTIME },
+    { "starred", NAUTILUS_FILE_SORT_BY_STARRED },
+    { "trashed-time", NAUTILUS_FILE_SORT_BY_TRASHED_TIME },
+    { "search-relevance", NAUTILUS_FILE_SORT_BY_SEARCH_RELEVANCE },
+    { "recency", NAUTILUS_FILE_SORT_BY_RECENCY },
+};
+
+static const char *extensions[] = { "txt", "png", "c", "pdf", "ogg", "" };
+
+static gint iterations = 3;
+static gboolean large = FALSE;
+static gchar *output_path = NULL;
+static gchar *filter = NULL;
+
+static GOptionEntry entries[] =
+{
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Number of timed runs per benchmark", "N" },
+    { "large", 0, 0, G_OPTION_ARG_NONE, &large, "Also generate the 1M file tree", NULL },
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_path, "Write results to FILE instead of stdout", "FILE" },
+    { "filter", 'f', 0, G_OPTION_ARG_STRING, &filter, "Only run benchmarks whose name contains TEXT", "TEXT" },
+    { NULL }
+};
+
+static GString *results;
+
+/* Timing */
+
+static int
+compare_durations (gconstpointer a,
+                   gconstpointer b)
+{
+    gint64 duration_a = *(const gint64 *) a;
+    gint64 duration_b = *(const gint64 *) b;
+
+    return (duration_a > duration_b) - (duration_a < duration_b);
+}
+
+static void
+report (const char *benchmark,
+        Tree       *tree,
+        const char *variant,
+        gint64     *durations,
+        guint       n_durations,
+        guint       n_items,
+        goffset     n_bytes)
+{
+    gdouble median_ms;
+
+    qsort (durations, n_durations, sizeof (gint64), compare_durations);
+    median_ms = durations[n_durations / 2] / 1000.0;
+
+    if (results->str[results->len - 1] == '}')
+    {
+        g_string_append (results, ",\n");
+    }
+
+    g_string_append_printf (results,
+                            "    {\"benchmark\": \"%s\", \"tree\": \"%s\", \"variant\": \"%s\", "
+                            "\"iterations\": %u, \"items\": %u, "
+                            "\"min_ms\": %.3f, \"median_ms\": %.3f, \"max_ms\": %.3f",
+                            benchmark, tree->name, variant != NULL ? variant : "",
+                            n_durations, n_items,
+                            durations[0] / 1000.0, median_ms,
+                            durations[n_durations - 1] / 1000.0);
+    if (n_bytes > 0 && median_ms > 0)
+    {
+        g_string_append_printf (results, ", \"bytes\": %" G_GOFFSET_FORMAT
+                                ", \"mib_per_s\": %.3f",
+                                n_bytes, (n_bytes / (1024.0 * 1024.0)) / (median_ms / 1000.0));
+    }
+    g_string_append (results, "}");
+
+    g_printerr ("%s/%s%s%s: median %.3f ms\n",
+                benchmark, tree->name,
+                variant != NULL ? "/" : "", variant != NULL ? variant : "",
+                median_ms);
+}
+
+static gboolean
+should_run (const char *benchmark,
+            Tree       *tree)
+{
+    g_autofree gchar *name = NULL;
+
+    if (filter == NULL)
+    {
+        return TRUE;
+    }
+
+    name = g_strdup_printf ("%s/%s", benchmark, tree->name);
+
+    return strstr (name, filter) != NULL;
+}
+
+static void
+wait_for (gboolean *done)
+{
+    while (!*done)
+    {
+        g_main_context_iteration (NULL, TRUE);
+    }
+}
+
+/* Tree generation */
+
+static void
+create_file (const char *path,
+             goffset     size,
+             gboolean    sparse)
+{
+    static char buffer[SMALL_FILE_SIZE];
+    int fd;
+
+    fd = g_open (path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        g_error ("Failed to create %s: %s", path, g_strerror (errno));
+    }
+
+    if (sparse)
+    {
+        /* Varied sizes make the size sort meaningful without filling the disk. */
+        if (ftruncate (fd, size) != 0)
+        {
+            g_error ("Failed to resize %s: %s", path, g_strerror (errno));
+        }
+    }
+    else if (write (fd, buffer, MIN (size, SMALL_FILE_SIZE)) < 0)
+    {
+        g_error ("Failed to write %s: %s", path, g_strerror (errno));
+    }
+
+    close (fd);
+}
+
+static void
+create_files (Tree       *tree,
+              const char *directory,
+              guint       n_files,
+              gboolean    sparse)
+{
+    for (guint i = 0; i < n_files; i++)
+    {
+        g_autofree gchar *name = NULL;
+        g_autofree gchar *path = NULL;
+        const char *extension = extensions[i % G_N_ELEMENTS (extensions)];
+        goffset size;
+
+        name = g_strdup_printf ("file-%07u%s%s", i,
+                                *extension != '\0' ? "." : "", extension);
+        path = g_build_filename (directory, name, NULL);
+        size = sparse ? (i * 7919) % 65536 : SMALL_FILE_SIZE;
+
+        create_file (path, size, sparse);
+
+        tree->n_files++;
+        tree->n_bytes += size;
+    }
+}
+
+static void
+create_directory (Tree       *tree,
+                  const char *path)
+{
+    if (g_mkdir (path, 0755) != 0)
+    {
+        g_error ("Failed to create %s: %s", path, g_strerror (errno));
+    }
+
+    tree->n_directories++;
+}
+
+static void
+generate_tree (Tree       *tree,
+               const char *base)
+{
+    g_autofree gchar *root = NULL;
+    gint64 start;
+
+    start = g_get_monotonic_time ();
+    root = g_build_filename (base, tree->name, NULL);
+    create_directory (tree, root);
+
+    switch (tree->kind)
+    {
+        case TREE_FLAT:
+        {
+            create_files (tree, root, tree->size, TRUE);
+        }
+        break;
+
+        case TREE_DEEP:
+        {
+            g_autofree gchar *path = g_strdup (root);
+
+            for (guint depth = 0; depth < tree->size; depth++)
+            {
+                g_autofree gchar *parent = g_steal_pointer (&path);
+
+                create_files (tree, parent, 16, TRUE);
+                path = g_build_filename (parent, "level", NULL);
+                create_directory (tree, path);
+            }
+        }
+        break;
+
+        case TREE_MANY_SMALL_FILES:
+        {
+            for (guint i = 0; i < tree->size; i++)
+            {
+                g_autofree gchar *name = g_strdup_printf ("dir-%04u", i);
+                g_autofree gchar *path = g_build_filename (root, name, NULL);
+
+                create_directory (tree, path);
+                create_files (tree, path, 256, FALSE);
+            }
+        }
+        break;
+
+        case TREE_MANY_SUBDIRS:
+        {
+            for (guint i = 0; i < tree->size; i++)
+            {
+                g_autofree gchar *name = g_strdup_printf ("dir-%06u", i);
+                g_autofree gchar *path = g_build_filename (root, name, NULL);
+
+                create_directory (tree, path);
+                create_files (tree, path, 1, TRUE);
+            }
+        }
+        break;
+    }
+
+    tree->location = g_file_new_for_path (root);
+
+    g_printerr ("Generated %s: %u files, %u directories in %.1f s\n",
+                tree->name, tree->n_files, tree->n_directories,
+                (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC);
+}
+
+static void
+remove_recursively (const char *path)
+{
+    GDir *dir;
+    const char *name;
+
+    dir = g_dir_open (path, 0, NULL);
+    if (dir != NULL)
+    {
+        while ((name = g_dir_read_name (dir)) != NULL)
+        {
+            g_autofree gchar *child = g_build_filename (path, name, NULL);
+
+            remove_recursively (child);
+        }
+        g_dir_close (dir);
+    }
+
+    g_remove (path);
+}
+
+/* Directory load */
+
+typedef struct
+{
+    gboolean done;
+    GList *files;
+} LoadData;
+
+static void
+directory_ready_cb (NautilusDirectory *directory,
+                    GList             *files,
+                    gpointer           user_data)
+{
+    LoadData *data = user_data;
+
+    data->files = nautilus_file_list_copy (files);
+    data->done = TRUE;
+}
+
+/* Nothing else keeps the directory alive, so every load starts cold. */
+static GList *
+load_directory (GFile *location)
+{
+    g_autoptr (NautilusDirectory) directory = NULL;
+    LoadData data = { 0 };
+
+    directory = nautilus_directory_get (location);
+    nautilus_directory_call_when_ready (directory, DIRECTORY_LOAD_ATTRIBUTES, TRUE,
+                                        directory_ready_cb, &data);
+    wait_for (&data.done);
+
+    return data.files;
+}
+
+static void
+benchmark_directory_load (Tree *tree)
+{
+    g_autofree gint64 *durations = g_new (gint64, iterations);
+    guint n_files = 0;
+
+    for (gint i = 0; i < iterations; i++)
+    {
+        GList *files;
+        gint64 start;
+
+        start = g_get_monotonic_time ();
+        files = load_directory (tree->location);
+        durations[i] = g_get_monotonic_time () - start;
+
+        n_files = g_list_length (files);
+        nautilus_file_list_free (files);
+    }
+
+    report ("directory-load", tree, NULL, durations, iterations, n_files, 0);
+}
+
+/* View model sort */
+
+typedef struct
+{
+    NautilusFileSortType sort_type;
+} SortData;
+
+static int
+sort_func (gconstpointer a,
+           gconstpointer b,
+           gpointer      user_data)
+{
+    SortData *data = user_data;
+    NautilusFile *file_a = nautilus_view_item_get_file (NAUTILUS_VIEW_ITEM ((gpointer) a));
+    NautilusFile *file_b = nautilus_view_item_get_file (NAUTILUS_VIEW_ITEM ((gpointer) b));
+
+    return nautilus_file_compare_for_sort (file_a, file_b, data->sort_type, TRUE, FALSE);
+}
+
+static void
+benchmark_sort (Tree *tree)
+{
+    g_autolist (NautilusFile) files = NULL;
+    g_autolist (NautilusViewItem) items = NULL;
+
+    files = load_directory (tree->location);
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        items = g_list_prepend (items, nautilus_view_item_new (l->data, 64));
+    }
+
+    for (guint s = 0; s < G_N_ELEMENTS (sort_types); s++)
+    {
+        g_autofree gint64 *durations = g_new (gint64, iterations);
+        SortData data = { sort_types[s].sort_type };
+
+        for (gint i = 0; i < iterations; i++)
+        {
+            g_autoptr (NautilusViewModel) model = nautilus_view_model_new ();
+            g_autoptr (GtkSorter) sorter = NULL;
+            GQueue queue = G_QUEUE_INIT;
+            gint64 start;
+
+            sorter = GTK_SORTER (gtk_custom_sorter_new (sort_func, &data, NULL));
+            nautilus_view_model_set_sorter (model, sorter);
+            for (GList *l = items; l != NULL; l = l->next)
+            {
+                g_queue_push_tail (&queue, l->data);
+            }
+
+            start = g_get_monotonic_time ();
+            nautilus_view_model_add_items (model, &queue);
+            durations[i] = g_get_monotonic_time () - start;
+
+            g_queue_clear (&queue);
+        }
+
+        report ("view-model-sort", tree, sort_types[s].name, durations, iterations,
+                g_list_length (items), 0);
+    }
+}
+
+/* Simple search engine */
+
+typedef struct
+{
+    gboolean done;
+    guint n_hits;
+    gint64 first_hit;
+} SearchData;
+
+static void
+search_hits_added_cb (NautilusSearchProvider *provider,
+                      GList                  *hits,
+                      gpointer                user_data)
+{
+    SearchData *data = user_data;
+
+    if (data->n_hits == 0)
+    {
+        data->first_hit = g_get_monotonic_time ();
+    }
+    data->n_hits += g_list_length (hits);
+}
+
+static void
+search_finished_cb (NautilusSearchProvider       *provider,
+                    NautilusSearchProviderStatus  status,
+                    gpointer                      user_data)
+{
+    SearchData *data = user_data;
+
+    data->done = TRUE;
+}
+
+static void
+benchmark_search (Tree *tree)
+{
+    g_autoptr (NautilusSearchEngineSimple) engine = NULL;
+    g_autoptr (NautilusQuery) query = NULL;
+    g_autofree gint64 *first_hit_durations = g_new (gint64, iterations);
+    g_autofree gint64 *durations = g_new (gint64, iterations);
+    SearchData data = { 0 };
+
+    engine = nautilus_search_engine_simple_new ();
+    g_signal_connect (engine, "hits-added", G_CALLBACK (search_hits_added_cb), &data);
+    g_signal_connect (engine, "finished", G_CALLBACK (search_finished_cb), &data);
+
+    query = nautilus_query_new ();
+    /* Matches one generated file in thirty. */
+    nautilus_query_set_text (query, "7.png");
+    nautilus_query_set_location (query, tree->location);
+    nautilus_query_set_recursive (query, NAUTILUS_QUERY_RECURSIVE_ALWAYS);
+    nautilus_search_provider_set_query (NAUTILUS_SEARCH_PROVIDER (engine), query);
+
+    for (gint i = 0; i < iterations; i++)
+    {
+        gint64 start;
+
+        data = (SearchData) { 0 };
+
+        start = g_get_monotonic_time ();
+        nautilus_search_provider_start (NAUTILUS_SEARCH_PROVIDER (engine));
+        wait_for (&data.done);
+        durations[i] = g_get_monotonic_time () - start;
+        first_hit_durations[i] = data.n_hits > 0 ? data.first_hit - start : durations[i];
+    }
+
+    report ("search-simple", tree, "first-hit", first_hit_durations, iterations,
+            data.n_hits, 0);
+    report ("search-simple", tree, "complete", durations, iterations,
+            data.n_hits, 0);
+}
+
+/* File operations */
+
+static void
+benchmark_file_operations (Tree       *tree,
+                           const char *base)
+{
+    g_autofree gint64 *copy_durations = g_new (gint64, iterations);
+    g_autofree gint64 *move_durations = g_new (gint64, iterations);
+    g_autofree gint64 *delete_durations = g_new (gint64, iterations);
+    g_autoptr (GFile) copy_destination = NULL;
+    g_autoptr (GFile) move_destination = NULL;
+    g_autofree gchar *copy_path = NULL;
+    g_autofree gchar *move_path = NULL;
+
+    copy_path = g_build_filename (base, "copy-destination", NULL);
+    move_path = g_build_filename (base, "move-destination", NULL);
+    copy_destination = g_file_new_for_path (copy_path);
+    move_destination = g_file_new_for_path (move_path);
+
+    for (gint i = 0; i < iterations; i++)
+    {
+        g_autoptr (GFile) copied = NULL;
+        g_autoptr (GFile) moved = NULL;
+        g_autoptr (GList) sources = NULL;
+        gint64 start;
+
+        g_mkdir (copy_path, 0755);
+        g_mkdir (move_path, 0755);
+
+        sources = g_list_prepend (NULL, tree->location);
+        start = g_get_monotonic_time ();
+        nautilus_file_operations_copy_sync (sources, copy_destination);
+        copy_durations[i] = g_get_monotonic_time () - start;
+
+        copied = g_file_get_child (copy_destination, tree->name);
+        g_list_free (sources);
+        sources = g_list_prepend (NULL, copied);
+        start = g_get_monotonic_time ();
+        nautilus_file_operations_move_sync (sources, move_destination);
+        move_durations[i] = g_get_monotonic_time () - start;
+
+        moved = g_file_get_child (move_destination, tree->name);
+        g_list_free (sources);
+        sources = g_list_prepend (NULL, moved);
+        start = g_get_monotonic_time ();
+        nautilus_file_operations_delete_sync (sources);
+        delete_durations[i] = g_get_monotonic_time () - start;
+
+        remove_recursively (copy_path);
+        remove_recursively (move_path);
+    }
+
+    report ("file-operations", tree, "copy", copy_durations, iterations,
+            tree->n_files, tree->n_bytes);
+    report ("file-operations", tree, "move", move_durations, iterations,
+            tree->n_files, 0);
+    report ("file-operations", tree, "delete", delete_durations, iterations,
+            tree->n_files, 0);
+}
+
+/* Deep count */
+
+static void
+deep_counts_ready_cb (NautilusFile *file,
+                      gpointer      user_data)
+{
+    gboolean *done = user_data;
+
+    *done = TRUE;
+}
+
+static void
+benchmark_deep_count (Tree *tree)
+{
+    g_autoptr (NautilusFile) file = NULL;
+    g_autofree gint64 *durations = g_new (gint64, iterations);
+    guint directory_count = 0;
+    guint file_count = 0;
+
+    file = nautilus_file_get (tree->location);
+
+    for (gint i = 0; i < iterations; i++)
+    {
+        gboolean done = FALSE;
+        gint64 start;
+
+        nautilus_file_invalidate_attributes (file, NAUTILUS_FILE_ATTRIBUTE_DEEP_COUNTS);
+
+        start = g_get_monotonic_time ();
+        nautilus_file_call_when_ready (file, NAUTILUS_FILE_ATTRIBUTE_DEEP_COUNTS,
+                                       deep_counts_ready_cb, &done);
+        wait_for (&done);
+        durations[i] = g_get_monotonic_time () - start;
+    }
+
+    nautilus_file_get_deep_counts (file, &directory_count, &file_count, NULL, NULL, FALSE);
+    report ("deep-count", tree, NULL, durations, iterations,
+            directory_count + file_count, 0);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_autoptr (NautilusFileUndoManager) undo_manager = NULL;
+    g_autoptr (NautilusTagManager) tag_manager = NULL;
+    g_autoptr (GOptionContext) context = NULL;
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *base = NULL;
+
+    context = g_option_context_new ("- benchmark Nautilus hot paths");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        return 1;
+    }
+    iterations = MAX (iterations, 1);
+
+    undo_manager = nautilus_file_undo_manager_new ();
+    tag_manager = nautilus_tag_manager_new_dummy ();
+    nautilus_ensure_extension_points ();
+    nautilus_global_preferences_init ();
+
+    base = g_dir_make_tmp ("nautilus-benchmark.XXXXXX", &error);
+    if (base == NULL)
+    {
+        g_printerr ("%s\n", error->message);
+        return 1;
+    }
+
+    results = g_string_new ("{\n  \"results\": [\n");
+
+    for (guint t = 0; t < G_N_ELEMENTS (trees); t++)
+    {
+        Tree *tree = &trees[t];
+
+        if (tree->large && !large)
+        {
+            continue;
+        }
+
+        generate_tree (tree, base);
+
+        if (tree->kind == TREE_FLAT || tree->kind == TREE_MANY_SUBDIRS)
+        {
+            if (should_run ("directory-load", tree))
+            {
+                benchmark_directory_load (tree);
+            }
+            if (should_run ("view-model-sort", tree))
+            {
+                benchmark_sort (tree);
+            }
+        }
+
+        if (should_run ("search-simple", tree))
+        {
+            benchmark_search (tree);
+        }
+
+        if (tree->kind != TREE_FLAT && should_run ("deep-count", tree))
+        {
+            benchmark_deep_count (tree);
+        }
+
+        if ((tree->kind == TREE_MANY_SMALL_FILES || tree->kind == TREE_DEEP) &&
+            should_run ("file-operations", tree))
+        {
+            benchmark_file_operations (tree, base);
+        }
+    }
+
+    g_string_append (results, "\n  ]\n}\n");
+
+    if (output_path != NULL)
+    {
+        if (!g_file_set_contents (output_path, results->str, results->len, &error))
+        {
+            g_printerr ("%s\n", error->message);
+        }
+    }
+    else
+    {
+        g_print ("%s", results->str);
+    }
+
+    for (guint t = 0; t < G_N_ELEMENTS (trees); t++)
+    {
+        g_clear_object (&trees[t].location);
+    }
+    remove_recursively (base);
+    g_string_free (results, TRUE);
+
+    return error != NULL ? 1 : 0;
+}